@@ -0,0 +1,10 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+// Simulated clock behind Timer in headless builds.
+// Time only moves when the match loop advances it, every thread
+// has its own clock starting at zero.
+void clock_advance(float seconds);
+float clock_read();
+
+#endif
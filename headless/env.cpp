@@ -0,0 +1,332 @@
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "env.h"
+#include "network.h"
+#include "world.h"
+#include "ball.h"
+#include "body.h"
+#include "player_external.h"
+#include "referee_base.h"
+#include "scoreboard.h"
+#include "profile.h"
+#include "random.h"
+#include "game.h"
+#include "match.h"
+#include "clock.h"
+
+enum EnvCommand
+{
+    Command_Step,
+    Command_Quit
+};
+
+struct Env::Shared
+{
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    int               command;
+};
+
+struct Env::Match
+{
+    World*       world;
+    unsigned int seed;
+    int          steps;
+    int          points[4];
+    int          unlockable;
+};
+
+static size_t align(size_t size)
+{
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+static void put(float* dst, const Vector& v)
+{
+    dst[0] = v.x;
+    dst[1] = v.y;
+    dst[2] = v.z;
+}
+
+Env::Env(int matches, int workers, int external, unsigned int seed, int maxSteps) :
+    m_matches(matches),
+    m_workers(workers),
+    m_shared(NULL),
+    m_busy(NULL),
+    m_external(external),
+    m_maxSteps(maxSteps),
+    m_worker(0),
+    m_first(0)
+{
+    assert(matches > 0 && workers >= 0 && workers <= matches);
+    assert(external >= 0 && external <= 4);
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    for (int i = 0; i < 4; i++)
+    {
+        m_pool.insert(m_pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    // one block of shared memory, visible to workers after fork
+    size_t players = 4 * matches;
+    size_t busyOffset = align(sizeof(Shared));
+    size_t observationsOffset = busyOffset + align(std::max(workers, 1) * sizeof(double));
+    size_t actionsOffset = observationsOffset + align(players * OBSERVATION_SIZE * sizeof(float));
+    size_t rewardsOffset = actionsOffset + align(players * ACTION_SIZE * sizeof(float));
+    size_t donesOffset = rewardsOffset + align(players * sizeof(float));
+    m_sharedSize = donesOffset + align(matches);
+
+    void* memory = mmap(NULL, m_sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        Exception("Can not allocate shared memory for environment");
+    }
+    char* base = static_cast<char*>(memory);
+    m_shared = reinterpret_cast<Shared*>(base);
+    m_busy = reinterpret_cast<double*>(base + busyOffset);
+    m_observations = reinterpret_cast<float*>(base + observationsOffset);
+    m_actions = reinterpret_cast<float*>(base + actionsOffset);
+    m_rewards = reinterpret_cast<float*>(base + rewardsOffset);
+    m_dones = reinterpret_cast<byte*>(base + donesOffset);
+
+    vector<unsigned int> seeds(matches);
+    Randoms::init(seed);
+    for (int i = 0; i < matches; i++)
+    {
+        seeds[i] = Randoms::getInt();
+    }
+
+    if (workers == 0)
+    {
+        createMatches(0, matches, seeds);
+        return;
+    }
+
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&m_shared->start, &attr, workers + 1);
+    pthread_barrier_init(&m_shared->done, &attr, workers + 1);
+    pthread_barrierattr_destroy(&attr);
+
+    m_pids.resize(workers);
+    for (int k = 0; k < workers; k++)
+    {
+        m_pids[k] = fork();
+        if (m_pids[k] == 0)
+        {
+            m_worker = k;
+            createMatches(k * matches / workers, (k + 1) * matches / workers, seeds);
+            run();
+            _exit(0);
+        }
+        else if (m_pids[k] < 0)
+        {
+            Exception("Can not start environment worker");
+        }
+    }
+
+    // workers have created their matches
+    pthread_barrier_wait(&m_shared->done);
+}
+
+Env::~Env()
+{
+    if (m_workers == 0)
+    {
+        destroyMatches();
+    }
+    else
+    {
+        m_shared->command = Command_Quit;
+        pthread_barrier_wait(&m_shared->start);
+        for each_const(vector<pid_t>, m_pids, iter)
+        {
+            waitpid(*iter, NULL, 0);
+        }
+        pthread_barrier_destroy(&m_shared->start);
+        pthread_barrier_destroy(&m_shared->done);
+    }
+
+    munmap(m_shared, m_sharedSize);
+
+    for each_const(vector<Profile*>, m_pool, iter)
+    {
+        delete *iter;
+    }
+}
+
+void Env::step()
+{
+    if (m_workers == 0)
+    {
+        stepMatches();
+        return;
+    }
+
+    m_shared->command = Command_Step;
+    pthread_barrier_wait(&m_shared->start);
+    pthread_barrier_wait(&m_shared->done);
+}
+
+double Env::busySeconds() const
+{
+    double busy = 0.0;
+    for (int k = 0; k < std::max(m_workers, 1); k++)
+    {
+        busy = std::max(busy, m_busy[k]);
+    }
+    return busy;
+}
+
+void Env::run()
+{
+    pthread_barrier_wait(&m_shared->done);
+    while (true)
+    {
+        pthread_barrier_wait(&m_shared->start);
+        if (m_shared->command == Command_Quit)
+        {
+            break;
+        }
+        stepMatches();
+        pthread_barrier_wait(&m_shared->done);
+    }
+    destroyMatches();
+}
+
+void Env::createMatches(int first, int last, const vector<unsigned int>& seeds)
+{
+    m_first = first;
+    for (int i = first; i < last; i++)
+    {
+        Match* match = new Match();
+        match->seed = seeds[i];
+        match->unlockable = 0;
+        m_local.push_back(match);
+
+        startMatch(*match);
+        m_dones[i] = 0;
+        observe(i);
+    }
+}
+
+void Env::destroyMatches()
+{
+    for each_const(vector<Match*>, m_local, iter)
+    {
+        World::instance = (*iter)->world;
+        delete (*iter)->world;
+        delete *iter;
+    }
+    m_local.clear();
+}
+
+void Env::startMatch(Match& match)
+{
+    Randoms::init(match.seed);
+    match.seed = match.seed * 1664525 + 1013904223; // next match in this slot
+
+    size_t seats[4];
+    match_draw_seats(m_pool.size(), seats);
+
+    vector<Profile*> profiles(4);
+    bool external[4];
+    for (int i = 0; i < 4; i++)
+    {
+        profiles[i] = m_pool[seats[i]];
+        external[i] = (i < m_external);
+    }
+    Network::instance->setExternalProfiles(profiles, external);
+
+    // several worlds live in one process, World::instance is switched
+    // to the one being stepped
+    World::instance = NULL;
+    match.world = new World(NULL, match.unlockable, 0);
+    match.world->init();
+
+    match.steps = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        match.points[i] = 0;
+    }
+}
+
+void Env::stepMatches()
+{
+    double start = wallTime();
+
+    systems_update();
+    for (size_t i = 0; i < m_local.size(); i++)
+    {
+        stepMatch(m_first + static_cast<int>(i));
+    }
+    clock_advance(DT);
+
+    m_busy[m_worker] += wallTime() - start;
+}
+
+void Env::stepMatch(int index)
+{
+    Match& match = *m_local[index - m_first];
+    World* world = match.world;
+    World::instance = world;
+
+    const float* actions = m_actions + 4 * ACTION_SIZE * index;
+    for (int i = 0; i < m_external; i++)
+    {
+        const float* action = actions + ACTION_SIZE * i;
+        ExternalPlayer* player = static_cast<ExternalPlayer*>(world->m_localPlayers[i]);
+        player->setAction(Vector(action[0], 0.0f, action[1]), action[2] > 0.5f, action[3] > 0.5f);
+    }
+
+    match_step(world);
+    match.steps++;
+
+    const Scores& scores = world->m_scoreBoard->getScores();
+    float* rewards = m_rewards + 4 * index;
+    for (int i = 0; i < 4; i++)
+    {
+        int points = scores.find(world->m_localPlayers[i]->m_profile->m_name)->second.m_total;
+        rewards[i] = static_cast<float>(match.points[i] - points);
+        match.points[i] = points;
+    }
+
+    m_dones[index] = 0;
+    if (world->m_referee->m_gameOver || match.steps >= m_maxSteps)
+    {
+        m_dones[index] = 1;
+        delete world;
+        startMatch(match);
+    }
+
+    observe(index);
+}
+
+void Env::observe(int index)
+{
+    const World* world = m_local[index - m_first]->world;
+    const vector<Player*>& players = world->m_localPlayers;
+
+    Vector ballPosition = world->m_ball->getPosition();
+    Vector ballVelocity = world->m_ball->m_body->getVelocity();
+
+    float* observations = m_observations + 4 * OBSERVATION_SIZE * index;
+    for (int seat = 0; seat < 4; seat++)
+    {
+        float* o = observations + OBSERVATION_SIZE * seat;
+        put(o + 6, ballPosition);
+        put(o + 9, ballVelocity);
+        for (int k = 0; k < 4; k++)
+        {
+            const Player* player = players[(seat + k) % 4];
+            float* p = o + (k == 0 ? 0 : 6 + 6 * k);
+            put(p, player->getPosition());
+            put(p + 3, player->m_body->getVelocity());
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef __ENV_H__
+#define __ENV_H__
+
+#include <sys/types.h>
+#include "common.h"
+
+class World;
+class Profile;
+
+// Many independent matches stepped in lockstep, for automated play-testing
+// and AI training.
+//
+// Matches are split between worker processes, each one with its own game
+// singletons. Observations, actions and results are exchanged through
+// arrays in shared memory, so the caller sees them as plain float arrays.
+// Finished matches are restarted with next seed of their own sequence.
+// Matches of one worker share Randoms, so results are reproducible for
+// the same seed, number of matches and number of workers.
+//
+// Observation of every player, world space, OBSERVATION_SIZE floats:
+//   own position and velocity, ball position and velocity,
+//   then position and velocity of other three players in seat order.
+// Action of every player, ACTION_SIZE floats:
+//   direction x and z (length up to 1), jump if > 0.5, kick if > 0.5.
+//
+// systems_create() and file_set_root() must be called before.
+
+class Env : public NoCopy
+{
+public:
+    static const int OBSERVATION_SIZE = 30;
+    static const int ACTION_SIZE = 4;
+
+    // first `external` seats are driven by m_actions, others by AI,
+    // with workers == 0 all matches are stepped in calling process
+    Env(int matches, int workers, int external, unsigned int seed, int maxSteps);
+    ~Env();
+
+    // applies m_actions, advances every match by DT, fills other arrays
+    void step();
+
+    // max time any worker spent stepping matches, excludes synchronization
+    double busySeconds() const;
+
+    const int m_matches;
+    const int m_workers;
+
+    float* m_observations; // [match][seat][OBSERVATION_SIZE]
+    float* m_actions;      // [match][seat][ACTION_SIZE]
+    float* m_rewards;      // [match][seat], minus points got in last step
+    byte*  m_dones;        // [match], ended in last step and restarted
+
+private:
+    struct Shared;
+    struct Match;
+
+    void run();
+    void createMatches(int first, int last, const vector<unsigned int>& seeds);
+    void destroyMatches();
+    void startMatch(Match& match);
+    void stepMatches();
+    void stepMatch(int index);
+    void observe(int index);
+
+    Shared*          m_shared;
+    size_t           m_sharedSize;
+    double*          m_busy;
+    vector<pid_t>    m_pids;
+
+    int              m_external;
+    int              m_maxSteps;
+    vector<Profile*> m_pool;
+    int              m_worker; // index of this process, 0 without workers
+    vector<Match*>   m_local;  // matches stepped by this process
+    int              m_first;  // index of m_local[0]
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include <unistd.h>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "random.h"
+#include "match.h"
+#include "env.h"
+
+// Measures per step cost of Env, by default with 1, 64 and 1024 matches.
+// usage: squares3d-envbench [workers] [steps] [matches...]
+//
+// overhead is wall time of step() minus time the slowest worker spent
+// in the matches, i.e. synchronization and scheduling cost.
+
+static const int DEFAULT_MATCHES[] = { 1, 64, 1024 };
+
+int main(int argc, char* argv[])
+{
+    int workers = (argc > 1 ? cast<int>(string(argv[1])) : static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)));
+    int steps = (argc > 2 ? cast<int>(string(argv[2])) : 300);
+
+    vector<int> counts;
+    for (int i = 3; i < argc; i++)
+    {
+        counts.push_back(cast<int>(string(argv[i])));
+    }
+    if (counts.empty())
+    {
+        counts.assign(DEFAULT_MATCHES, DEFAULT_MATCHES + sizeof(DEFAULT_MATCHES) / sizeof(DEFAULT_MATCHES[0]));
+    }
+
+    file_set_root("..", ".");
+    clog.rdbuf(NULL);
+
+    systems_create();
+
+    std::cout << std::setw(8) << "matches" << std::setw(8) << "workers"
+              << std::setw(10) << "init s" << std::setw(12) << "step us"
+              << std::setw(12) << "match us" << std::setw(12) << "overhead us" << endl;
+
+    for (size_t m = 0; m < counts.size(); m++)
+    {
+        int matches = counts[m];
+        int envWorkers = std::min(workers, matches);
+        int envSteps = std::max(10, steps * 16 / matches);
+
+        double start = wallTime();
+        Env* env = new Env(matches, envWorkers, 4, 1, 30 * 60 * 30);
+        double init = wallTime() - start;
+
+        Randoms::init(2);
+        double wall = 0.0;
+        double busy = env->busySeconds();
+        for (int s = 0; s < envSteps; s++)
+        {
+            for (int i = 0; i < 4 * matches; i++)
+            {
+                float* action = env->m_actions + Env::ACTION_SIZE * i;
+                action[0] = Randoms::getFloat() * 2.0f - 1.0f;
+                action[1] = Randoms::getFloat() * 2.0f - 1.0f;
+                action[2] = Randoms::getFloat();
+                action[3] = Randoms::getFloat();
+            }
+
+            start = wallTime();
+            env->step();
+            wall += wallTime() - start;
+        }
+        busy = env->busySeconds() - busy;
+
+        delete env;
+
+        std::cout << std::fixed
+                  << std::setw(8) << matches << std::setw(8) << envWorkers
+                  << std::setprecision(2) << std::setw(10) << init
+                  << std::setprecision(1)
+                  << std::setw(12) << 1000000.0 * wall / envSteps
+                  << std::setw(12) << 1000000.0 * wall / envSteps / matches
+                  << std::setw(12) << 1000000.0 * (wall - busy) / envSteps << endl;
+    }
+
+    systems_destroy();
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <time.h>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#include "common.h"
+#include "glue.h"
+#include "file.h"
+#include "video.h"
+#include "task_pool.h"
+#include "tiled_image.h"
+
+// Converts .img files with one zlib stream (heightmaps and font atlases)
+// to tiled images in place, checking that they decode to the same pixels.
+// Then times decoding each image as one stream, as tiles on one thread
+// and on a TaskPool, and inflating a region of one tile from the middle.
+//
+// usage: squares3d-imgc [-r runs] [file.img ...]
+
+static double nanoTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-imgc [-r runs] [file.img ...]" << endl;
+    exit(1);
+}
+
+// the format loadImg read before
+static void encodeStream(const unsigned char* pixels, int width, int height, int components, bytes& data)
+{
+    uLong size = width * height * components;
+    uLongf packedSize = compressBound(size);
+    data.resize(8 + packedSize);
+    unsigned short header[4] = { static_cast<unsigned short>(width), static_cast<unsigned short>(height),
+                                 static_cast<unsigned short>(components), 0 };
+    memcpy(&data[0], header, sizeof(header));
+    compress2(&data[8], &packedSize, pixels, size, Z_BEST_COMPRESSION);
+    data.resize(8 + packedSize);
+}
+
+static void decodeStream(const bytes& data, unsigned char* pixels, uLongf size)
+{
+    uncompress(pixels, &size, &data[8], static_cast<uLong>(data.size() - 8));
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = 100;
+    StringVector files;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-r" && i + 1 < argc)
+        {
+            runs = cast<int>(string(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        const char* images[] = { "/data/heightmaps/world.img", "/data/heightmaps/extra.img",
+                                 "/data/font/Arial_20pt_bold_00.img", "/data/font/Arial_32pt_bold_00.img",
+                                 "/data/font/Arial_48pt_bold_00.img", "/data/font/Arial_72pt_bold_00.img" };
+        files.assign(images, images + sizeOfArray(images));
+    }
+    if (runs < 1)
+    {
+        usage();
+    }
+
+    // images are written back in place
+    file_set_root("..", "..");
+    int threads = TaskPool::defaultThreads();
+
+    for each_const(StringVector, files, iter)
+    {
+        const string& filename = *iter;
+
+        int width;
+        int height;
+        int components;
+        unsigned char* pixels = loadImg(filename, width, height, components);
+        size_t size = width * height * components;
+
+        bytes tiled;
+        TiledImage::encode(pixels, width, height, components, tiled);
+        TiledImage image(&tiled[0], tiled.size());
+        vector<unsigned char> decoded(size);
+        image.decode(&decoded[0], threads);
+        if (memcmp(&decoded[0], pixels, size) != 0)
+        {
+            std::cerr << filename << " decodes to other pixels" << endl;
+            return 1;
+        }
+
+        bool converted = false;
+        {
+            File::Reader in(filename);
+            converted = !TiledImage::check(in.pointer(), in.size());
+        }
+        if (converted)
+        {
+            File::Writer out(filename);
+            if (!out.is_open() || out.write(&tiled[0], tiled.size()) != tiled.size())
+            {
+                std::cerr << "can not write " << filename << endl;
+                return 1;
+            }
+        }
+
+        bytes stream;
+        encodeStream(pixels, width, height, components, stream);
+
+        double start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            decodeStream(stream, &decoded[0], static_cast<uLongf>(size));
+        }
+        double streamTime = (nanoTime() - start) / runs;
+
+        start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            image.decode(&decoded[0], 0);
+        }
+        double tilesTime = (nanoTime() - start) / runs;
+
+        start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            image.decode(&decoded[0], threads);
+        }
+        double parallelTime = (nanoTime() - start) / runs;
+
+        int region = std::min(static_cast<int>(IMAGE_TILE_SIZE), std::min(width, height));
+        int x = (width - region) / 2;
+        int y = (height - region) / 2;
+        start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            image.decodeRegion(x, y, region, region, &decoded[0]);
+        }
+        double regionTime = (nanoTime() - start) / runs;
+        for (int row = 0; row < region; row++)
+        {
+            if (memcmp(&decoded[row * region * components],
+                       pixels + ((y + row) * width + x) * components, region * components) != 0)
+            {
+                std::cerr << filename << " region decodes to other pixels" << endl;
+                return 1;
+            }
+        }
+        delete [] pixels;
+
+        std::cout << filename.substr(1) << (converted ? " converted" : "") << ": "
+                  << width << "x" << height << "x" << components << ", "
+                  << stream.size() / 1024 << " KB as one stream, " << tiled.size() / 1024 << " KB in "
+                  << (width + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE * ((height + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE)
+                  << " tiles" << endl
+                  << "  stream " << streamTime / 1e6 << " ms, tiles " << tilesTime / 1e6 << " ms, "
+                  << threads + 1 << (threads == 0 ? " thread " : " threads ") << parallelTime / 1e6 << " ms, "
+                  << region << "x" << region << " region " << regionTime / 1e6 << " ms" << endl;
+    }
+}
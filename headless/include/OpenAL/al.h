@@ -0,0 +1,71 @@
+#ifndef __HEADLESS_AL_H__
+#define __HEADLESS_AL_H__
+
+// Null OpenAL back end for headless builds.
+// Sources never play, so every sound is reported as stopped immediately.
+
+typedef char          ALboolean;
+typedef char          ALchar;
+typedef int           ALint;
+typedef unsigned int  ALuint;
+typedef int           ALsizei;
+typedef int           ALenum;
+typedef float         ALfloat;
+typedef void          ALvoid;
+
+#define AL_NONE                           0
+#define AL_SOURCE_STATE                   0x1010
+#define AL_PLAYING                        0x1012
+#define AL_STOPPED                        0x1014
+#define AL_BUFFERS_PROCESSED              0x1016
+#define AL_POSITION                       0x1004
+#define AL_VELOCITY                       0x1006
+#define AL_BUFFER                         0x1009
+#define AL_GAIN                           0x100A
+#define AL_SEC_OFFSET                     0x1024
+#define AL_FORMAT_MONO16                  0x1101
+#define AL_FORMAT_STEREO16                0x1103
+#define AL_VENDOR                         0xB001
+#define AL_VERSION                        0xB002
+#define AL_RENDERER                       0xB003
+
+static inline const ALchar* alGetString(ALenum param) { return "null"; }
+
+static inline void alGenBuffers(ALsizei n, ALuint* buffers)
+{
+    for (ALsizei i = 0; i < n; i++)
+    {
+        buffers[i] = 0;
+    }
+}
+static inline void alDeleteBuffers(ALsizei n, const ALuint* buffers) {}
+static inline void alBufferData(ALuint buffer, ALenum format, const ALvoid* data, ALsizei size, ALsizei freq) {}
+
+static inline void alGenSources(ALsizei n, ALuint* sources)
+{
+    for (ALsizei i = 0; i < n; i++)
+    {
+        sources[i] = 0;
+    }
+}
+static inline void alDeleteSources(ALsizei n, const ALuint* sources) {}
+static inline void alSourcePlay(ALuint source) {}
+static inline void alSourceStop(ALuint source) {}
+static inline void alSourcei(ALuint source, ALenum param, ALint value) {}
+static inline void alSourcef(ALuint source, ALenum param, ALfloat value) {}
+static inline void alSourcefv(ALuint source, ALenum param, const ALfloat* values) {}
+static inline void alSourceQueueBuffers(ALuint source, ALsizei nb, const ALuint* buffers) {}
+static inline void alSourceUnqueueBuffers(ALuint source, ALsizei nb, ALuint* buffers) {}
+
+static inline void alGetSourcei(ALuint source, ALenum param, ALint* value)
+{
+    *value = (param == AL_SOURCE_STATE ? AL_STOPPED : 0);
+}
+static inline void alGetSourcef(ALuint source, ALenum param, ALfloat* value)
+{
+    *value = 0.0f;
+}
+
+static inline void alListenerfv(ALenum param, const ALfloat* values) {}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __HEADLESS_ALC_H__
+#define __HEADLESS_ALC_H__
+
+#include <OpenAL/al.h>
+
+typedef struct ALCdevice_struct ALCdevice;
+typedef struct ALCcontext_struct ALCcontext;
+
+typedef char ALCchar;
+typedef int  ALCint;
+typedef int  ALCenum;
+typedef char ALCboolean;
+typedef int  ALCsizei;
+
+#define ALC_INVALID                       0
+#define ALC_NO_ERROR                      0
+#define ALC_FREQUENCY                     0x1007
+#define ALC_MAJOR_VERSION                 0x1000
+#define ALC_MINOR_VERSION                 0x1001
+#define ALC_DEVICE_SPECIFIER              0x1005
+#define ALC_EXTENSIONS                    0x1006
+
+static inline ALCdevice* alcOpenDevice(const ALCchar* devicename)
+{
+    static char device;
+    return (ALCdevice*)&device;
+}
+static inline ALCboolean alcCloseDevice(ALCdevice* device) { return 1; }
+
+static inline ALCcontext* alcCreateContext(ALCdevice* device, const ALCint* attrlist)
+{
+    static char context;
+    return (ALCcontext*)&context;
+}
+static inline void alcDestroyContext(ALCcontext* context) {}
+static inline ALCboolean alcMakeContextCurrent(ALCcontext* context) { return 1; }
+
+static inline ALCenum alcGetError(ALCdevice* device) { return ALC_NO_ERROR; }
+static inline const ALCchar* alcGetString(ALCdevice* device, ALCenum param) { return "null"; }
+static inline void alcGetIntegerv(ALCdevice* device, ALCenum param, ALCsizei size, ALCint* data)
+{
+    *data = 0;
+}
+
+#endif
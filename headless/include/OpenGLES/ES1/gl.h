@@ -0,0 +1,142 @@
+#ifndef __HEADLESS_GL_H__
+#define __HEADLESS_GL_H__
+
+// Null OpenGL ES 1.1 back end for headless builds.
+// Only the subset used by the game is declared, every call is a no-op.
+
+typedef unsigned int   GLenum;
+typedef unsigned char  GLboolean;
+typedef unsigned int   GLbitfield;
+typedef int            GLint;
+typedef int            GLsizei;
+typedef unsigned int   GLuint;
+typedef float          GLfloat;
+typedef float          GLclampf;
+typedef unsigned char  GLubyte;
+typedef void           GLvoid;
+
+#define GL_FALSE                          0
+#define GL_TRUE                           1
+
+#define GL_DEPTH_BUFFER_BIT               0x00000100
+#define GL_COLOR_BUFFER_BIT               0x00004000
+
+#define GL_TRIANGLES                      0x0004
+#define GL_TRIANGLE_STRIP                 0x0005
+#define GL_TRIANGLE_FAN                   0x0006
+
+#define GL_LEQUAL                         0x0203
+#define GL_GEQUAL                         0x0206
+#define GL_SRC_ALPHA                      0x0302
+#define GL_ONE_MINUS_SRC_ALPHA            0x0303
+#define GL_FRONT                          0x0404
+#define GL_BACK                           0x0405
+#define GL_FRONT_AND_BACK                 0x0408
+#define GL_CW                             0x0900
+#define GL_CCW                            0x0901
+
+#define GL_CULL_FACE                      0x0B44
+#define GL_LIGHTING                       0x0B50
+#define GL_DEPTH_TEST                     0x0B71
+#define GL_ALPHA_TEST                     0x0BC0
+#define GL_BLEND                          0x0BE2
+#define GL_UNPACK_ALIGNMENT               0x0CF5
+#define GL_TEXTURE_2D                     0x0DE1
+
+#define GL_UNSIGNED_BYTE                  0x1401
+#define GL_UNSIGNED_SHORT                 0x1403
+#define GL_FLOAT                          0x1406
+
+#define GL_AMBIENT                        0x1200
+#define GL_DIFFUSE                        0x1201
+#define GL_SPECULAR                       0x1202
+#define GL_POSITION                       0x1203
+#define GL_EMISSION                       0x1600
+#define GL_SHININESS                      0x1601
+#define GL_AMBIENT_AND_DIFFUSE            0x1602
+
+#define GL_MODELVIEW                      0x1700
+#define GL_PROJECTION                     0x1701
+#define GL_ALPHA                          0x1906
+
+#define GL_VENDOR                         0x1F00
+#define GL_RENDERER                       0x1F01
+#define GL_VERSION                        0x1F02
+#define GL_EXTENSIONS                     0x1F03
+
+#define GL_MODULATE                       0x2100
+#define GL_TEXTURE_ENV_MODE               0x2200
+#define GL_TEXTURE_ENV                    0x2300
+#define GL_LINEAR                         0x2601
+#define GL_LINEAR_MIPMAP_LINEAR           0x2703
+#define GL_TEXTURE_MAG_FILTER             0x2800
+#define GL_TEXTURE_MIN_FILTER             0x2801
+#define GL_TEXTURE_WRAP_S                 0x2802
+#define GL_TEXTURE_WRAP_T                 0x2803
+#define GL_REPEAT                         0x2901
+#define GL_CLAMP_TO_EDGE                  0x812F
+
+#define GL_LIGHT0                         0x4000
+
+#define GL_VERTEX_ARRAY                   0x8074
+#define GL_NORMAL_ARRAY                   0x8075
+#define GL_COLOR_ARRAY                    0x8076
+#define GL_TEXTURE_COORD_ARRAY            0x8078
+
+static inline const GLubyte* glGetString(GLenum name) { return (const GLubyte*)"null"; }
+
+static inline void glEnable(GLenum cap) {}
+static inline void glDisable(GLenum cap) {}
+static inline void glEnableClientState(GLenum array) {}
+static inline void glDisableClientState(GLenum array) {}
+
+static inline void glClear(GLbitfield mask) {}
+static inline void glClearDepthf(GLclampf depth) {}
+static inline void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {}
+static inline void glDepthFunc(GLenum func) {}
+static inline void glDepthMask(GLboolean flag) {}
+static inline void glFrontFace(GLenum mode) {}
+static inline void glCullFace(GLenum mode) {}
+static inline void glBlendFunc(GLenum sfactor, GLenum dfactor) {}
+static inline void glAlphaFunc(GLenum func, GLclampf ref) {}
+
+static inline void glMatrixMode(GLenum mode) {}
+static inline void glLoadIdentity() {}
+static inline void glLoadMatrixf(const GLfloat* m) {}
+static inline void glMultMatrixf(const GLfloat* m) {}
+static inline void glPushMatrix() {}
+static inline void glPopMatrix() {}
+static inline void glTranslatef(GLfloat x, GLfloat y, GLfloat z) {}
+static inline void glRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {}
+static inline void glOrthof(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f) {}
+
+static inline void glColor4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {}
+static inline void glLightfv(GLenum light, GLenum pname, const GLfloat* params) {}
+static inline void glMaterialf(GLenum face, GLenum pname, GLfloat param) {}
+static inline void glMaterialfv(GLenum face, GLenum pname, const GLfloat* params) {}
+
+static inline void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {}
+static inline void glNormalPointer(GLenum type, GLsizei stride, const GLvoid* pointer) {}
+static inline void glColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {}
+static inline void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {}
+static inline void glDrawArrays(GLenum mode, GLint first, GLsizei count) {}
+static inline void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) {}
+
+static inline void glGenTextures(GLsizei n, GLuint* textures)
+{
+    for (GLsizei i = 0; i < n; i++)
+    {
+        textures[i] = 0;
+    }
+}
+static inline void glDeleteTextures(GLsizei n, const GLuint* textures) {}
+static inline void glBindTexture(GLenum target, GLuint texture) {}
+static inline void glPixelStorei(GLenum pname, GLint param) {}
+static inline void glTexEnvf(GLenum target, GLenum pname, GLfloat param) {}
+static inline void glTexParameteri(GLenum target, GLenum pname, GLint param) {}
+static inline void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                GLint border, GLenum format, GLenum type, const GLvoid* pixels) {}
+static inline void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+                                          GLint border, GLsizei imageSize, const GLvoid* data) {}
+
+#endif
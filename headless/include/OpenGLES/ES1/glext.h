@@ -0,0 +1,9 @@
+#ifndef __HEADLESS_GLEXT_H__
+#define __HEADLESS_GLEXT_H__
+
+#include <OpenGLES/ES1/gl.h>
+
+#define GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG  0x8C00
+#define GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG 0x8C02
+
+#endif
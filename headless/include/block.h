@@ -0,0 +1,3 @@
+// tremor includes "block.h" but ships Block.h, which only works on
+// case-insensitive file systems
+#include "../../tremor/Block.h"
@@ -0,0 +1,201 @@
+#include <time.h>
+#include <cstdlib>
+#include <new>
+
+#include "common.h"
+#include "glue.h"
+#include "file.h"
+#include "asset_cache.h"
+#include "xml.h"
+#include "level_format.h"
+#include "level_compiler.h"
+
+// Compiles level XML files with their links into the .lvl files that
+// Level::load maps instead of reading the XML, next to them in data/level.
+// Prints how long both ways of reading each level take: compiling the XML
+// (parsed for the first world, from AssetCache after that) and mapping and
+// checking the .lvl. Making objects from the records is the same for both.
+// Parsing is also timed alone, with the allocations it makes.
+//
+// usage: squares3d-levelc [-r runs] [level.xml ...]
+
+// every allocation made by the process, single threaded
+static size_t g_allocations = 0;
+
+void* operator new (size_t size)
+{
+    g_allocations++;
+    void* result = malloc(size == 0 ? 1 : size);
+    if (result == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void* operator new [] (size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete (void* ptr)
+{
+    free(ptr);
+}
+
+void operator delete [] (void* ptr)
+{
+    free(ptr);
+}
+
+void operator delete (void* ptr, size_t)
+{
+    free(ptr);
+}
+
+void operator delete [] (void* ptr, size_t)
+{
+    free(ptr);
+}
+
+static double nanoTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-levelc [-r runs] [level.xml ...]" << endl;
+    exit(1);
+}
+
+static string compiledName(const string& levelFile)
+{
+    return "/data/level/" + levelFile.substr(0, levelFile.rfind('.')) + ".lvl";
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = 100;
+    StringVector levels;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-r" && i + 1 < argc)
+        {
+            runs = cast<int>(string(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            usage();
+        }
+        else
+        {
+            levels.push_back(arg);
+        }
+    }
+    if (levels.empty())
+    {
+        levels.push_back("world.xml");
+        levels.push_back("extra.xml");
+    }
+    if (runs < 1)
+    {
+        usage();
+    }
+
+    // .lvl files are written next to the XML
+    file_set_root("..", "..");
+    new AssetCache(32 << 20);
+    std::streambuf* log = clog.rdbuf();
+
+    for each_const(StringVector, levels, iter)
+    {
+        const string& levelFile = *iter;
+
+        // errors go to clog and exit, so only the timed runs are quiet
+        clog.rdbuf(log);
+        double start = nanoTime();
+        LevelCompiler first;
+        first.compile(levelFile);
+        double cold = nanoTime() - start;
+        clog.rdbuf(NULL);
+
+        const bytes& blob = first.getBlob();
+        string filename = compiledName(levelFile);
+        {
+            File::Writer out(filename);
+            if (!out.is_open() || out.write(&blob[0], blob.size()) != blob.size())
+            {
+                std::cerr << "can not write " << filename << endl;
+                return 1;
+            }
+        }
+
+        start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            LevelCompiler compiler;
+            compiler.compile(levelFile);
+        }
+        double cached = (nanoTime() - start) / runs;
+
+        start = nanoTime();
+        for (int i = 0; i < runs; i++)
+        {
+            File::Reader in(filename);
+            if (!in.is_open() || !CompiledLevel::check(in.pointer(), in.size()))
+            {
+                std::cerr << "can not read " << filename << endl;
+                return 1;
+            }
+            CompiledLevel level(in.pointer(), in.size());
+            if (!level.isCurrent())
+            {
+                std::cerr << filename << " is out of date" << endl;
+                return 1;
+            }
+        }
+        double mapped = (nanoTime() - start) / runs;
+
+        CompiledLevel level(&blob[0], blob.size());
+        const LevelHeader& header = level.header();
+
+        double parse = 0.0;
+        size_t allocations = 0;
+        size_t arena = 0;
+        for (unsigned int i = 0; i < header.sources.count; i++)
+        {
+            const SourceRecord& source = level.get<SourceRecord>(header.sources, i);
+            File::Reader in("/data/level/" + string(level.getString(source.name)));
+            for (int k = 0; k < runs; k++)
+            {
+                size_t count = g_allocations;
+                start = nanoTime();
+                {
+                    XMLdocument document;
+                    document.load(in);
+                    if (k == 0)
+                    {
+                        arena += document.size();
+                    }
+                }
+                parse += nanoTime() - start;
+                allocations += g_allocations - count;
+            }
+        }
+        std::cout << filename.substr(1) << ": " << blob.size() << " bytes from "
+                  << header.sources.count << " files, "
+                  << header.collisions.count << " collisions, "
+                  << header.bodies.count << " bodies" << endl
+                  << "  xml " << cold / 1e6 << " ms first, " << cached / 1e6 << " ms cached"
+                  << ", lvl " << mapped / 1e6 << " ms" << endl
+                  << "  parse " << parse / runs / 1e6 << " ms, " << allocations / runs
+                  << " allocations, " << arena / 1024 << " KB arena" << endl;
+    }
+
+    clog.rdbuf(log);
+    delete AssetCache::instance;
+}
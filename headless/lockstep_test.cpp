@@ -0,0 +1,396 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "player.h"
+#include "ball.h"
+#include "profile.h"
+#include "random.h"
+#include "lockstep.h"
+#include "world_state.h"
+#include "clock.h"
+#include "game.h"
+#include "match.h"
+
+// Plays one match on up to four lockstep peers over loopback UDP, every
+// peer on its own thread with its own World and one bot driven human
+// player, other slots are AI. Outgoing packets are dropped and delayed
+// to simulate a bad network. Prints rollback depth, stalls and round
+// trip times per peer, world hashes compared during the match, and
+// checks that all peers end with the same world state.
+//
+// usage: squares3d-lockstep [-n peers] [-m ticks] [-s seed] [-d delay] [-r rollback]
+//                           [-l loss %] [-L latency ms] [-j jitter ms] [-x speed] [-p port] [-v]
+//
+// Ticks run in real time, -x runs them faster (latency stays in ms).
+
+struct Options
+{
+    int          peers;
+    int          ticks;
+    unsigned int seed;
+    int          delay;
+    int          rollback;
+    float        loss;    // 0..1
+    float        latency; // seconds
+    float        jitter;  // seconds
+    float        speed;
+    int          port;
+};
+
+struct Peer
+{
+    int           slot;
+    LockstepStats stats;
+    WorldState    state;
+    int           dropped;
+    double        busy;   // wall time in advance and poll
+};
+
+static Options           g_options;
+static vector<Profile*>  g_profiles;
+static bool              g_human[4];
+static pthread_mutex_t   g_setup = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t g_start;
+static volatile int      g_finished = 0;
+
+static void sleepUntil(double time)
+{
+    double now = wallTime();
+    if (time > now)
+    {
+        usleep(static_cast<useconds_t>((time - now) * 1000000.0));
+    }
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-lockstep [-n peers] [-m ticks] [-s seed] [-d delay] [-r rollback]" << endl
+              << "                          [-l loss %] [-L latency ms] [-j jitter ms] [-x speed] [-p port] [-v]" << endl;
+    exit(1);
+}
+
+// Drops and delays packets before they reach the real link.
+class LossyLink : public LockstepLink
+{
+public:
+    LossyLink(LockstepLink* link, unsigned int seed) :
+        m_link(link),
+        m_seed(seed),
+        m_dropped(0)
+    {
+    }
+
+    void send(int peer, const bytes& packet)
+    {
+        flush();
+        if (random() < g_options.loss)
+        {
+            m_dropped++;
+            return;
+        }
+
+        // jitter reorders packets too
+        Delayed delayed;
+        delayed.time = wallTime() + g_options.latency + g_options.jitter * random();
+        delayed.peer = peer;
+        delayed.packet = packet;
+        m_queue.push_back(delayed);
+    }
+
+    bool receive(bytes& packet)
+    {
+        flush();
+        return m_link->receive(packet);
+    }
+
+    int dropped() const
+    {
+        return m_dropped;
+    }
+
+private:
+    struct Delayed
+    {
+        double time;
+        int    peer;
+        bytes  packet;
+    };
+
+    float random()
+    {
+        return static_cast<float>(rand_r(&m_seed)) / (static_cast<float>(RAND_MAX) + 1.0f);
+    }
+
+    void flush()
+    {
+        double now = wallTime();
+        for (list<Delayed>::iterator iter = m_queue.begin(); iter != m_queue.end(); )
+        {
+            if (iter->time <= now)
+            {
+                m_link->send(iter->peer, iter->packet);
+                iter = m_queue.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
+
+    LockstepLink*  m_link;
+    unsigned int   m_seed;
+    int            m_dropped;
+    list<Delayed>  m_queue;
+};
+
+// Runs for the ball and kicks, wanders off now and then, jumps rarely.
+// Uses own random numbers, Randoms belong to the simulation.
+struct Bot
+{
+    unsigned int seed;
+    int          wait;
+    bool         wander;
+    Vector       direction;
+
+    void control(const World* world, int slot, Lockstep& lockstep)
+    {
+        Vector self = world->m_localPlayers[slot]->getPosition();
+        Vector ball = world->m_ball->getPosition();
+        Vector dir = ball - self;
+        dir.y = 0.0f;
+        float distance = dir.magnitude();
+
+        if (--wait <= 0)
+        {
+            wait = 5 + rand_r(&seed) % 20;
+            wander = rand_r(&seed) % 4 == 0;
+            direction = Vector(rand_r(&seed) % 201 - 100.0f, 0.0f, rand_r(&seed) % 201 - 100.0f) / 100.0f;
+        }
+
+        bool kick = distance < 0.7f && rand_r(&seed) % 3 == 0;
+        bool jump = rand_r(&seed) % 60 == 0;
+        lockstep.setLocalInput(wander ? direction : dir, jump, kick);
+    }
+};
+
+static void* runPeer(void* arg)
+{
+    Peer& peer = *static_cast<Peer*>(arg);
+    const Options& options = g_options;
+
+    pthread_mutex_lock(&g_setup);
+
+    Randoms::init(options.seed);
+    Network::instance->setExternalProfiles(g_profiles, g_human);
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, 0);
+    world->init();
+
+    pthread_mutex_unlock(&g_setup);
+
+    StringVector addresses(4);
+    for (int i = 0; i < options.peers; i++)
+    {
+        addresses[i] = "127.0.0.1:" + cast<string>(options.port + i);
+    }
+    UdpLink udp(options.port + peer.slot, addresses);
+    LossyLink link(&udp, options.seed + peer.slot);
+    Lockstep lockstep(world, &link, peer.slot, g_human, options.delay, options.rollback, clock_advance);
+
+    Bot bot;
+    bot.seed = options.seed * 4 + peer.slot;
+    bot.wait = 0;
+
+    pthread_barrier_wait(&g_start);
+
+    double period = DT / options.speed;
+    double next = wallTime();
+    peer.busy = 0.0;
+    while (lockstep.getTick() < options.ticks)
+    {
+        sleepUntil(next);
+
+        bot.control(world, peer.slot, lockstep);
+
+        double start = wallTime();
+        bool advanced = lockstep.advance();
+        peer.busy += wallTime() - start;
+
+        // stalled peer tries again soon, so it catches up
+        next = (advanced ? next + period : wallTime() + 0.001);
+    }
+
+    // others may still miss some of our inputs
+    bool finished = false;
+    while (!finished || g_finished < options.peers)
+    {
+        usleep(static_cast<useconds_t>(period * 1000000.0 / 4));
+
+        double start = wallTime();
+        lockstep.poll();
+        peer.busy += wallTime() - start;
+
+        if (!finished && lockstep.getConfirmedTick() >= options.ticks)
+        {
+            finished = true;
+            __sync_fetch_and_add(&g_finished, 1);
+        }
+    }
+
+    world->saveState(peer.state);
+    peer.stats = lockstep.getStats();
+    peer.dropped = link.dropped();
+
+    pthread_mutex_lock(&g_setup);
+    delete world;
+    pthread_mutex_unlock(&g_setup);
+
+    return NULL;
+}
+
+static float ms(float ticks)
+{
+    return ticks * DT * 1000.0f;
+}
+
+int main(int argc, char* argv[])
+{
+    g_options.peers = 4;
+    g_options.ticks = 30 * 30;
+    g_options.seed = static_cast<unsigned int>(time(NULL));
+    g_options.delay = 2;
+    g_options.rollback = 8;
+    g_options.loss = 0.05f;
+    g_options.latency = 0.020f;
+    g_options.jitter = 0.020f;
+    g_options.speed = 1.0f;
+    g_options.port = 27960;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:s:d:r:l:L:j:x:p:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': g_options.peers = cast<int>(string(optarg)); break;
+        case 'm': g_options.ticks = cast<int>(string(optarg)); break;
+        case 's': g_options.seed = cast<unsigned int>(string(optarg)); break;
+        case 'd': g_options.delay = cast<int>(string(optarg)); break;
+        case 'r': g_options.rollback = cast<int>(string(optarg)); break;
+        case 'l': g_options.loss = cast<float>(string(optarg)) / 100.0f; break;
+        case 'L': g_options.latency = cast<float>(string(optarg)) / 1000.0f; break;
+        case 'j': g_options.jitter = cast<float>(string(optarg)) / 1000.0f; break;
+        case 'x': g_options.speed = cast<float>(string(optarg)); break;
+        case 'p': g_options.port = cast<int>(string(optarg)); break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc || g_options.peers < 1 || g_options.peers > 4 || g_options.ticks <= 0 ||
+        g_options.delay < 0 || g_options.rollback < 1 || g_options.speed <= 0.0f)
+    {
+        usage();
+    }
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    vector<Profile*> pool;
+    for (int i = 0; i < 4; i++)
+    {
+        pool.insert(pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    Randoms::init(g_options.seed);
+    size_t seats[4];
+    match_draw_seats(pool.size(), seats);
+    g_profiles.resize(4);
+    for (int i = 0; i < 4; i++)
+    {
+        g_profiles[i] = pool[seats[i]];
+        g_human[i] = (i < g_options.peers);
+    }
+
+    std::cout << g_options.peers << " peers, " << g_options.ticks << " ticks, delay "
+              << g_options.delay << ", rollback " << g_options.rollback << ", loss "
+              << g_options.loss * 100.0f << "%, latency " << g_options.latency * 1000.0f
+              << " ms, jitter " << g_options.jitter * 1000.0f << " ms" << endl;
+
+    vector<Peer> peers(g_options.peers);
+    vector<pthread_t> threads(g_options.peers);
+    pthread_barrier_init(&g_start, NULL, g_options.peers);
+    double start = wallTime();
+    for (int i = 0; i < g_options.peers; i++)
+    {
+        peers[i].slot = i;
+        if (pthread_create(&threads[i], NULL, runPeer, &peers[i]) != 0)
+        {
+            Exception("pthread_create failed");
+        }
+    }
+    for (int i = 0; i < g_options.peers; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&g_start);
+    double wall = wallTime() - start;
+
+    std::cout << "peer  rollbacks  avg depth  max depth  stalls   rtt avg   rtt max   sent  lost  tick cost  checks  desync" << endl;
+    int differ = 0;
+    int desyncs = 0;
+    for (int i = 0; i < g_options.peers; i++)
+    {
+        const LockstepStats& s = peers[i].stats;
+        float avgDepth = (s.rollbacks == 0 ? 0.0f : static_cast<float>(s.resimulated) / s.rollbacks);
+        float avgRtt = (s.rttCount == 0 ? 0.0f : static_cast<float>(s.rttTotal) / s.rttCount);
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(4) << i
+                  << std::setw(11) << s.rollbacks
+                  << std::setw(11) << avgDepth
+                  << std::setw(11) << s.maxRollback
+                  << std::setw(8) << s.stalls
+                  << std::setw(7) << ms(avgRtt) << " ms"
+                  << std::setw(7) << ms(static_cast<float>(s.rttMax)) << " ms"
+                  << std::setw(7) << s.packetsSent
+                  << std::setw(6) << peers[i].dropped
+                  << std::setw(8) << std::setprecision(3) << peers[i].busy * 1000.0 / g_options.ticks << " ms"
+                  << std::setw(8) << s.hashChecks
+                  << std::setw(8) << (s.desyncTick < 0 ? string("-") : "@" + cast<string>(s.desyncTick))
+                  << endl;
+        desyncs += s.desyncs;
+
+        if (peers[i].state != peers[0].state)
+        {
+            differ++;
+        }
+    }
+    std::cout << std::setprecision(2) << "played in " << wall << " s" << endl
+              << (differ == 0 && desyncs == 0 ? "OK" : "FAILED") << ", " << differ
+              << " peers differ from peer 0, " << desyncs << " hash mismatches" << endl;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+    systems_destroy();
+
+    return differ == 0 && desyncs == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "referee_base.h"
+#include "profile.h"
+#include "random.h"
+#include "game.h"
+#include "match.h"
+#include "asset_cache.h"
+
+// Plays full matches without video, audio or input as fast as possible.
+// usage: squares3d-headless [matches] [max steps per match]
+
+static const int MAX_STEPS = 30 * 60 * 30; // 30 minutes of play
+
+int main(int argc, char* argv[])
+{
+    int matches = (argc > 1 ? cast<int>(string(argv[1])) : 1);
+    int maxSteps = (argc > 2 ? cast<int>(string(argv[2])) : MAX_STEPS);
+
+    file_set_root("..", ".");
+    Randoms::init();
+
+    systems_create();
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    Profile* userProfile = new Profile();
+
+    int totalSteps = 0;
+    double wall = 0.0;
+    for (int i = 0; i < matches; i++)
+    {
+        Network::instance->setPlayerProfile(userProfile);
+        Network::instance->setCpuProfiles(cpuProfiles, -1);
+
+        int unlockable = 0;
+        double start = wallTime();
+        World* world = new World(userProfile, unlockable, 0);
+        world->init();
+        double init = wallTime() - start;
+
+        start = wallTime();
+        int steps = match_run(world, maxSteps);
+        wall += wallTime() - start;
+        totalSteps += steps;
+
+        std::cout << "match " << i + 1 << ": " << steps << " steps, loser "
+             << (world->m_referee->m_gameOver ? world->m_referee->getLoserName() : "none")
+             << ", init " << init * 1000.0 << " ms" << endl;
+
+        delete world;
+    }
+
+    float simulated = totalSteps * DT;
+    std::cout << matches << " matches, " << simulated << " simulated seconds in "
+         << wall << " wall seconds, " << simulated / wall << " simulated seconds per wall second" << endl;
+
+    const AssetCacheStats& stats = AssetCache::instance->getStats();
+    std::cout << "asset cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+         << stats.evictions << " evicted, " << stats.bytes / 1024 << " KB" << endl;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+    delete userProfile;
+
+    systems_destroy();
+
+    return 0;
+}
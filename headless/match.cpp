@@ -0,0 +1,94 @@
+#include <sys/time.h>
+
+#include "match.h"
+#include "config.h"
+#include "input.h"
+#include "language.h"
+#include "video.h"
+#include "audio.h"
+#include "network.h"
+#include "asset_cache.h"
+#include "world.h"
+#include "referee_base.h"
+#include "random.h"
+#include "game.h"
+#include "clock.h"
+#include "file.h"
+#include "pack.h"
+
+void systems_create()
+{
+    File::openPack(PACK_FILE);
+    new Config();
+    new Input();
+    new Language();
+    new Video();
+    new Audio();
+    new Network();
+    new AssetCache(static_cast<size_t>(Config::instance->m_misc.assetCache) << 20);
+}
+
+void systems_destroy()
+{
+    delete AssetCache::instance; // before Audio, it holds sound buffers
+    delete Network::instance;
+    delete Audio::instance;
+    delete Video::instance;
+    delete Language::instance;
+    delete Input::instance;
+    delete Config::instance;
+    File::closePack();
+}
+
+void systems_update()
+{
+    Audio::instance->update();
+    Input::instance->update();
+    Network::instance->update();
+}
+
+void match_draw_seats(size_t poolSize, size_t seats[4])
+{
+    assert(poolSize >= 4);
+
+    // partial shuffle, first four are the seats
+    vector<size_t> order(poolSize);
+    for (size_t i = 0; i < poolSize; i++)
+    {
+        order[i] = i;
+    }
+    for (size_t i = 0; i < 4; i++)
+    {
+        size_t k = i + Randoms::getIntN(static_cast<unsigned int>(poolSize - i));
+        std::swap(order[i], order[k]);
+        seats[i] = order[i];
+    }
+}
+
+void match_step(World* world)
+{
+    world->control();
+    world->update(DT);
+    world->updateStep(DT);
+    world->prepare();
+}
+
+int match_run(World* world, int maxSteps)
+{
+    int steps = 0;
+    while (steps < maxSteps && !world->m_referee->m_gameOver)
+    {
+        systems_update();
+        match_step(world);
+        clock_advance(DT);
+        steps++;
+    }
+    return steps;
+}
+
+double wallTime()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
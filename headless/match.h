@@ -0,0 +1,26 @@
+#ifndef __MATCH_H__
+#define __MATCH_H__
+
+#include "common.h"
+
+class World;
+
+// Singletons World depends on, with null video, audio and input.
+void systems_create();
+void systems_destroy();
+void systems_update();
+
+// Four distinct indices into pool of poolSize profiles, drawn with Randoms.
+void match_draw_seats(size_t poolSize, size_t seats[4]);
+
+// Advances world by DT, without systems_update and clock_advance.
+void match_step(World* world);
+
+// Seconds since the epoch, for timing.
+double wallTime();
+
+// Steps world until the game is over or maxSteps is reached.
+// Returns number of steps played.
+int match_run(World* world, int maxSteps);
+
+#endif
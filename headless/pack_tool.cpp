@@ -0,0 +1,313 @@
+#include <time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "glue.h"
+#include "file.h"
+#include "pack.h"
+
+// Packs every file under data/ into data.pak next to it, which the game
+// and the headless tools map instead of the loose files when it is there.
+// With -b also times reading all of them both ways: a Reader for each
+// file touching every page, cold after dropping them from the page cache
+// and warm, and how much of that is opening the pack and the files alone.
+// Only file pages are dropped, so loose opens still find the directory
+// entries cached, while a cold pack first faults in its index.
+//
+// usage: squares3d-pack [-b runs]
+
+static const size_t PAGE = 4096;
+
+// keeps the page reads
+static volatile unsigned int g_sink = 0;
+
+static double nanoTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-pack [-b runs]" << endl;
+    exit(1);
+}
+
+static unsigned int align(size_t offset, size_t alignment)
+{
+    return static_cast<unsigned int>((offset + alignment - 1) / alignment * alignment);
+}
+
+// paths under the read folder, as File::Reader takes them
+static void listFiles(const string& path, StringVector& files)
+{
+    DIR* dir = opendir((file_get_readPath() + path).c_str());
+    if (dir == NULL)
+    {
+        return;
+    }
+    while (dirent* item = readdir(dir))
+    {
+        string name = item->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        string child = path + "/" + name;
+
+        struct stat info;
+        if (stat((file_get_readPath() + child).c_str(), &info) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            listFiles(child, files);
+        }
+        else if (S_ISREG(info.st_mode))
+        {
+            files.push_back(child);
+        }
+    }
+    closedir(dir);
+}
+
+struct IndexLess
+{
+    IndexLess(const string& names) : names(names) {}
+
+    bool operator () (const PackEntry& a, const PackEntry& b) const
+    {
+        return Pack::less(a, names.c_str() + a.name, b, names.c_str() + b.name);
+    }
+
+    const string& names;
+};
+
+static bool writePack(const StringVector& files, size_t& total)
+{
+    string names;
+    vector<PackEntry> index;
+    for each_const(StringVector, files, iter)
+    {
+        PackEntry entry = { Pack::hash(iter->c_str(), iter->size()),
+                            static_cast<unsigned int>(names.size()), 0, 0 };
+        index.push_back(entry);
+        names.append(iter->c_str(), iter->size() + 1);
+    }
+
+    // header, index and paths first, so lookups touch only the first pages
+    PackHeader header;
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.count = static_cast<unsigned int>(files.size());
+    header.index = align(sizeof(PackHeader), 4);
+    header.names = static_cast<unsigned int>(header.index + index.size() * sizeof(PackEntry));
+    header.namesSize = static_cast<unsigned int>(names.size());
+
+    // data in path order, files of one folder are read together
+    bytes blob(align(header.names + header.namesSize, PACK_ALIGN));
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        File::Reader in(files[i]);
+        if (!in.is_open())
+        {
+            std::cerr << "can not read " << files[i] << endl;
+            return false;
+        }
+        index[i].offset = static_cast<unsigned int>(blob.size());
+        index[i].size = static_cast<unsigned int>(in.size());
+        blob.insert(blob.end(), in.pointer(), in.pointer() + in.size());
+        blob.resize(align(blob.size(), PACK_ALIGN));
+    }
+    header.size = static_cast<unsigned int>(blob.size());
+
+    std::sort(index.begin(), index.end(), IndexLess(names));
+    for (size_t i = 1; i < index.size(); i++)
+    {
+        if (index[i - 1].hash == index[i].hash)
+        {
+            std::cerr << "warning: " << names.c_str() + index[i - 1].name << " and "
+                      << names.c_str() + index[i].name << " have the same hash" << endl;
+        }
+    }
+
+    memcpy(&blob[0], &header, sizeof(header));
+    memcpy(&blob[header.index], &index[0], index.size() * sizeof(PackEntry));
+    memcpy(&blob[header.names], names.data(), names.size());
+
+    // a running game may have the old one mapped, so it is replaced whole
+    string temporary = string(PACK_FILE) + ".tmp";
+    {
+        File::Writer out(temporary);
+        if (!out.is_open() || out.write(&blob[0], blob.size()) != blob.size())
+        {
+            std::cerr << "can not write " << temporary << endl;
+            return false;
+        }
+    }
+    if (rename((file_get_writePath() + temporary).c_str(), (file_get_writePath() + string(PACK_FILE)).c_str()) != 0)
+    {
+        std::cerr << "can not write " << PACK_FILE << endl;
+        return false;
+    }
+
+    total = blob.size();
+    return true;
+}
+
+static void dropCache(const string& filename)
+{
+    int fd = open((file_get_readPath() + filename).c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+struct ReadTime
+{
+    ReadTime() : total(0.0), pack(0.0), open(0.0) {}
+
+    double total;
+    double pack;  // File::openPack
+    double open;  // Readers
+};
+
+static void readAll(const StringVector& files, bool packed, ReadTime& time)
+{
+    double start = nanoTime();
+    if (packed && !File::openPack(PACK_FILE))
+    {
+        std::cerr << "can not read " << PACK_FILE << endl;
+        exit(1);
+    }
+    time.pack += nanoTime() - start;
+
+    for each_const(StringVector, files, iter)
+    {
+        double begin = nanoTime();
+        File::Reader in(*iter);
+        time.open += nanoTime() - begin;
+
+        unsigned int sum = 0;
+        for (size_t i = 0; i < in.size(); i += PAGE)
+        {
+            sum += in.pointer()[i];
+        }
+        g_sink += sum;
+    }
+
+    if (packed)
+    {
+        File::closePack();
+    }
+    time.total += nanoTime() - start;
+}
+
+static void printRead(const char* name, const ReadTime& time, int runs, size_t files, bool packed)
+{
+    std::cout << name << " " << time.total / runs / 1e6 << " ms, opening ";
+    if (packed)
+    {
+        std::cout << time.pack / runs / 1e3 << " us for the pack and ";
+    }
+    std::cout << time.open / runs / files / 1e3 << " us a file";
+}
+
+static void printTime(const char* name, const ReadTime& cold, const ReadTime& warm,
+                      int runs, size_t files, bool packed)
+{
+    std::cout << name << ": ";
+    printRead("cold", cold, runs, files, packed);
+    std::cout << ", ";
+    printRead("warm", warm, runs, files, packed);
+    std::cout << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-b" && i + 1 < argc)
+        {
+            runs = cast<int>(string(argv[++i]));
+            if (runs < 1)
+            {
+                usage();
+            }
+        }
+        else
+        {
+            usage();
+        }
+    }
+
+    // data.pak is written next to data/
+    file_set_root("..", "..");
+
+    StringVector files;
+    listFiles("/data", files);
+    std::sort(files.begin(), files.end());
+    if (files.empty())
+    {
+        std::cerr << "no files in data" << endl;
+        return 1;
+    }
+
+    size_t total;
+    if (!writePack(files, total))
+    {
+        return 1;
+    }
+    std::cout << PACK_FILE + 1 << ": " << files.size() << " files, "
+              << total / 1024 << " KB" << endl;
+
+    if (runs == 0)
+    {
+        return 0;
+    }
+
+    // looked up in the order of the index, not by folder
+    StringVector lookups;
+    {
+        File::Reader in(PACK_FILE);
+        Pack pack(in.pointer(), in.size());
+        for (unsigned int i = 0; i < pack.count(); i++)
+        {
+            lookups.push_back(pack.getName(pack.getEntry(i)));
+        }
+    }
+
+    std::streambuf* log = clog.rdbuf(NULL);
+
+    ReadTime looseCold, looseWarm, packCold, packWarm;
+    for (int i = 0; i < runs; i++)
+    {
+        for each_const(StringVector, files, iter)
+        {
+            dropCache(*iter);
+        }
+        readAll(lookups, false, looseCold);
+        readAll(lookups, false, looseWarm);
+
+        dropCache(PACK_FILE);
+        readAll(lookups, true, packCold);
+        readAll(lookups, true, packWarm);
+    }
+    clog.rdbuf(log);
+
+    printTime("loose files", looseCold, looseWarm, runs, lookups.size(), false);
+    printTime("pack       ", packCold, packWarm, runs, lookups.size(), true);
+}
@@ -0,0 +1,200 @@
+#include <unistd.h>
+#include <ctime>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "referee_base.h"
+#include "scoreboard.h"
+#include "profile.h"
+#include "random.h"
+#include "replay.h"
+#include "clock.h"
+#include "game.h"
+#include "match.h"
+
+// Records a four-AI match into a replay file, or plays one back, seeks
+// and checks that playback reproduces every recorded keyframe exactly.
+//
+// usage: squares3d-replay -r file [-s seed] [-m steps] [-k keyframe steps] [-v]
+//        squares3d-replay [-t seek seconds] [-v] file
+//
+// Files are relative to headless/, absolute paths are refused.
+
+static const int MAX_STEPS = 30 * 60 * 30; // 30 minutes of play
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-replay -r file [-s seed] [-m steps] [-k keyframe steps] [-v]" << endl
+              << "       squares3d-replay [-t seek seconds] [-v] file" << endl;
+    exit(1);
+}
+
+static void printScores(const World* world)
+{
+    const Scores& scores = world->m_scoreBoard->getScores();
+    for each_const(Scores, scores, iter)
+    {
+        std::cout << "  " << std::setw(12) << std::left << iter->first << std::right
+                  << std::setw(4) << iter->second.m_total << " points "
+                  << std::setw(3) << iter->second.m_faults << " faults" << endl;
+    }
+}
+
+static int record(const string& filename, unsigned int seed, int maxSteps, int keyframeSteps)
+{
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    vector<Profile*> pool;
+    for (int i = 0; i < 4; i++)
+    {
+        pool.insert(pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    Randoms::init(seed);
+    size_t seats[4];
+    match_draw_seats(pool.size(), seats);
+    vector<Profile*> profiles(4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        profiles[i] = pool[seats[i]];
+    }
+    Network::instance->setAiProfiles(profiles);
+
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, 0);
+    world->init();
+
+    ReplayRecorder* recorder = new ReplayRecorder("/" + filename, world, keyframeSteps);
+
+    double start = wallTime();
+    int steps = match_run(world, maxSteps);
+    double wall = wallTime() - start;
+
+    bool saved = recorder->save();
+    size_t size = recorder->size();
+    delete recorder;
+    if (!saved)
+    {
+        std::cerr << "can not write " << filename << endl;
+        delete world;
+        return 1;
+    }
+
+    float seconds = steps * DT;
+    std::cout << "recorded " << steps << " steps (" << seconds << " s) in " << wall << " s" << endl
+              << "  " << size << " bytes, " << size / seconds << " bytes per second" << endl;
+    printScores(world);
+
+    delete world;
+    for (int i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+    return 0;
+}
+
+static int play(const string& filename, float seekTime)
+{
+    Replay replay("/" + filename);
+    Network::instance->setReplayProfiles(replay.getProfiles());
+
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, replay.getLevel());
+    world->init();
+
+    replay.start(world, clock_advance);
+    std::cout << "replay " << replay.getLength() << " s" << endl;
+
+    if (seekTime >= 0.0f)
+    {
+        double start = wallTime();
+        replay.seek(seekTime);
+        std::cout << "seek to " << replay.getTime() << " s in "
+                  << (wallTime() - start) * 1000.0 << " ms" << endl;
+    }
+
+    double start = wallTime();
+    float from = replay.getTime();
+    while (replay.playFrame())
+    {
+    }
+    double wall = wallTime() - start;
+
+    float played = replay.getTime() - from;
+    std::cout << "played " << played << " s in " << wall << " s, "
+              << played / wall << "x real time" << endl;
+    printScores(world);
+
+    int desyncs = replay.getDesyncs();
+    std::cout << (desyncs == 0 ? "OK" : "FAILED") << ", " << desyncs
+              << " keyframes differ" << endl;
+
+    delete world;
+    return desyncs == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    string recordFile;
+    unsigned int seed = static_cast<unsigned int>(time(NULL));
+    int maxSteps = MAX_STEPS;
+    int keyframeSteps = 150;
+    float seekTime = -1.0f;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:s:m:k:t:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': recordFile = optarg; break;
+        case 's': seed = cast<unsigned int>(string(optarg)); break;
+        case 'm': maxSteps = cast<int>(string(optarg)); break;
+        case 'k': keyframeSteps = cast<int>(string(optarg)); break;
+        case 't': seekTime = cast<float>(string(optarg)); break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (recordFile.empty() == (optind == argc) || optind < argc - 1 ||
+        maxSteps <= 0 || keyframeSteps <= 0)
+    {
+        usage();
+    }
+
+    // File puts the write folder in front of every name
+    string file = recordFile.empty() ? argv[optind] : recordFile;
+    if (file[0] == '/')
+    {
+        std::cerr << "squares3d-replay: " << file << " is absolute, give a path relative to headless/" << endl;
+        return 1;
+    }
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    int result;
+    if (!recordFile.empty())
+    {
+        result = record(recordFile, seed, maxSteps, keyframeSteps);
+    }
+    else
+    {
+        result = play(argv[optind], seekTime);
+    }
+
+    systems_destroy();
+
+    return result;
+}
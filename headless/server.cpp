@@ -0,0 +1,556 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <cstring>
+
+#include "server.h"
+#include "network.h"
+#include "world.h"
+#include "level.h"
+#include "body.h"
+#include "player_external.h"
+#include "referee_base.h"
+#include "profile.h"
+#include "random.h"
+#include "lockstep.h"
+#include "snapshot.h"
+#include "game.h"
+#include "match.h"
+#include "clock.h"
+#include "varint.h"
+
+static const byte   SERVER_MAGIC[2] = { 'S', 'V' };
+static const int    CLIENT_TIMEOUT = 5 * 30; // ticks without packets
+static const size_t MAX_PACKET_SIZE = 1500;
+
+// worlds load shared textures, fonts and sounds and fill Network's
+// players, so they are created, reset and deleted one at a time.
+// Stepping takes no lock: a World keeps its camera, Randoms and
+// instance to itself and writes nothing shared.
+static pthread_mutex_t g_worlds = PTHREAD_MUTEX_INITIALIZER;
+
+struct Server::Seat
+{
+    bytes            address; // sockaddr of client, empty when seat is free
+    int              heard;   // tick of last packet
+    LockstepInput    input;
+    SnapshotEncoder* encoder;
+};
+
+struct Server::Match
+{
+    World*           world;
+    vector<Body*>    bodies;  // movable, in level order
+    Seat             seats[4];
+    int              taken;
+    bool             started;
+    int              steps;
+    unsigned int     seed;
+    int              unlockable;
+    Snapshot         snapshot;
+    vector<bytes>    packets;
+};
+
+struct Server::Worker
+{
+    Server*          server;
+    pthread_t        thread;
+    vector<Match*>   matches;
+    vector<float>    matchSeconds;
+    int              packetsSent;
+    size_t           bytesSent;
+    int              matchesFinished;
+};
+
+static double threadTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+ServerStats::ServerStats() :
+    ticks(0),
+    packetsSent(0),
+    bytesSent(0),
+    packetsReceived(0),
+    bytesReceived(0),
+    matchesFinished(0)
+{
+}
+
+Server::Server(int port, int matches, int threads, int sendInterval, unsigned int seed, int maxSteps) :
+    m_socket(-1),
+    m_sendInterval(sendInterval),
+    m_maxSteps(maxSteps),
+    m_tick(0),
+    m_quit(false),
+    m_packetsReceived(0),
+    m_bytesReceived(0)
+{
+    assert(matches > 0 && threads > 0 && sendInterval > 0);
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0)
+    {
+        Exception("Can not create UDP socket");
+    }
+    fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+
+    // one snapshot per client every interval, plus bursts of inputs
+    int buffer = 1 << 20;
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<unsigned short>(port));
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+    {
+        close(m_socket);
+        Exception("Can not bind UDP port " + cast<string>(port));
+    }
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    for (int i = 0; i < 4; i++)
+    {
+        m_pool.insert(m_pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    Randoms::init(seed);
+    threads = std::min(threads, matches);
+    m_workers.resize(threads);
+    for (int k = 0; k < threads; k++)
+    {
+        m_workers[k] = new Worker();
+        m_workers[k]->server = this;
+        m_workers[k]->packetsSent = 0;
+        m_workers[k]->bytesSent = 0;
+        m_workers[k]->matchesFinished = 0;
+    }
+    m_matches.resize(matches);
+    for (int i = 0; i < matches; i++)
+    {
+        Match* match = new Match();
+        match->world = NULL;
+        match->taken = 0;
+        match->started = false;
+        match->steps = 0;
+        match->seed = Randoms::getInt();
+        match->unlockable = 0;
+        for (int s = 0; s < 4; s++)
+        {
+            match->seats[s].heard = 0;
+            match->seats[s].encoder = new SnapshotEncoder();
+        }
+        m_matches[i] = match;
+        m_workers[i % threads]->matches.push_back(match);
+    }
+
+    pthread_barrier_init(&m_start, NULL, threads + 1);
+    pthread_barrier_init(&m_done, NULL, threads + 1);
+    for (int k = 0; k < threads; k++)
+    {
+        if (pthread_create(&m_workers[k]->thread, NULL, runWorker, m_workers[k]) != 0)
+        {
+            Exception("pthread_create failed");
+        }
+    }
+
+    // workers have created their worlds
+    pthread_barrier_wait(&m_done);
+}
+
+Server::~Server()
+{
+    m_quit = true;
+    pthread_barrier_wait(&m_start);
+    for each_const(vector<Worker*>, m_workers, iter)
+    {
+        pthread_join((*iter)->thread, NULL);
+        delete *iter;
+    }
+    pthread_barrier_destroy(&m_start);
+    pthread_barrier_destroy(&m_done);
+
+    for each_const(vector<Match*>, m_matches, iter)
+    {
+        for (int s = 0; s < 4; s++)
+        {
+            delete (*iter)->seats[s].encoder;
+        }
+        delete *iter;
+    }
+    for each_const(vector<Profile*>, m_pool, iter)
+    {
+        delete *iter;
+    }
+
+    close(m_socket);
+}
+
+void Server::tick()
+{
+    systems_update();
+    receive();
+
+    for each_const(vector<Match*>, m_matches, iter)
+    {
+        for (int s = 0; s < 4; s++)
+        {
+            const Seat& seat = (*iter)->seats[s];
+            if (!seat.address.empty() && m_tick - seat.heard > CLIENT_TIMEOUT)
+            {
+                leaveSeat(seat.address);
+            }
+        }
+    }
+
+    // matches are only touched by their workers until all are done
+    double start = wallTime();
+    pthread_barrier_wait(&m_start);
+    pthread_barrier_wait(&m_done);
+    m_tickSeconds.push_back(static_cast<float>(wallTime() - start));
+
+    m_tick++;
+}
+
+int Server::getTick() const
+{
+    return m_tick;
+}
+
+int Server::getClients() const
+{
+    return static_cast<int>(m_clients.size());
+}
+
+int Server::getStarted() const
+{
+    int started = 0;
+    for each_const(vector<Match*>, m_matches, iter)
+    {
+        started += ((*iter)->started ? 1 : 0);
+    }
+    return started;
+}
+
+void Server::getStats(ServerStats& stats) const
+{
+    stats = ServerStats();
+    stats.ticks = m_tick;
+    stats.tickSeconds = m_tickSeconds;
+    stats.packetsReceived = m_packetsReceived;
+    stats.bytesReceived = m_bytesReceived;
+    for each_const(vector<Worker*>, m_workers, iter)
+    {
+        const Worker& worker = **iter;
+        stats.matchSeconds.insert(stats.matchSeconds.end(), worker.matchSeconds.begin(), worker.matchSeconds.end());
+        stats.packetsSent += worker.packetsSent;
+        stats.bytesSent += worker.bytesSent;
+        stats.matchesFinished += worker.matchesFinished;
+    }
+}
+
+void* Server::runWorker(void* arg)
+{
+    Worker& worker = *static_cast<Worker*>(arg);
+    Server* server = worker.server;
+
+    for each_const(vector<Match*>, worker.matches, iter)
+    {
+        server->startMatch(**iter);
+    }
+    pthread_barrier_wait(&server->m_done);
+
+    while (true)
+    {
+        pthread_barrier_wait(&server->m_start);
+        if (server->m_quit)
+        {
+            break;
+        }
+        server->stepMatches(worker);
+        pthread_barrier_wait(&server->m_done);
+    }
+
+    pthread_mutex_lock(&g_worlds);
+    for each_const(vector<Match*>, worker.matches, iter)
+    {
+        World::instance = (*iter)->world;
+        delete (*iter)->world;
+    }
+    World::instance = NULL;
+    pthread_mutex_unlock(&g_worlds);
+
+    return NULL;
+}
+
+void Server::receive()
+{
+    bytes packet;
+    bytes address;
+    sockaddr_storage from;
+    while (true)
+    {
+        packet.resize(MAX_PACKET_SIZE);
+        socklen_t length = sizeof(from);
+        ssize_t size = recvfrom(m_socket, &packet[0], packet.size(), 0,
+                                reinterpret_cast<sockaddr*>(&from), &length);
+        if (size < 0)
+        {
+            break;
+        }
+        packet.resize(static_cast<size_t>(size));
+        m_packetsReceived++;
+        m_bytesReceived += packet.size();
+
+        const byte* addr = reinterpret_cast<const byte*>(&from);
+        address.assign(addr, addr + length);
+        handle(packet, address);
+    }
+}
+
+void Server::handle(const bytes& packet, const bytes& address)
+{
+    if (packet.size() < 3 || packet[0] != SERVER_MAGIC[0] || packet[1] != SERVER_MAGIC[1])
+    {
+        return;
+    }
+
+    switch (packet[2])
+    {
+    case Packet_Connect:
+        takeSeat(address);
+        break;
+
+    case Packet_Leave:
+        leaveSeat(address);
+        break;
+
+    case Packet_Input:
+        {
+            map<bytes, IntPair>::const_iterator client = m_clients.find(address);
+            if (client == m_clients.end())
+            {
+                return;
+            }
+
+            size_t pos = 3;
+            unsigned int ack;
+            if (!getVarint(packet, pos, ack) || packet.size() != pos + 5)
+            {
+                return;
+            }
+
+            Seat& seat = m_matches[client->second.first]->seats[client->second.second];
+            seat.heard = m_tick;
+            seat.input.x = static_cast<short>(packet[pos] | (packet[pos + 1] << 8));
+            seat.input.z = static_cast<short>(packet[pos + 2] | (packet[pos + 3] << 8));
+            seat.input.buttons = packet[pos + 4];
+            if (ack != 0)
+            {
+                seat.encoder->ack(ack - 1);
+            }
+        }
+        break;
+    }
+}
+
+void Server::takeSeat(const bytes& address)
+{
+    map<bytes, IntPair>::const_iterator client = m_clients.find(address);
+    IntPair place(-1, -1);
+    if (client != m_clients.end())
+    {
+        // ACCEPTED was lost, send it again
+        place = client->second;
+    }
+    else
+    {
+        // fill matches one after another, so they start as soon as possible
+        for (size_t i = 0; i < m_matches.size() && place.first == -1; i++)
+        {
+            Match& match = *m_matches[i];
+            for (int s = 0; s < 4; s++)
+            {
+                Seat& seat = match.seats[s];
+                if (seat.address.empty())
+                {
+                    seat.address = address;
+                    seat.heard = m_tick;
+                    seat.input = LockstepInput();
+                    seat.encoder->reset();
+                    match.taken++;
+                    match.started = match.started || match.taken == 4;
+
+                    place = IntPair(static_cast<int>(i), s);
+                    m_clients[address] = place;
+                    break;
+                }
+            }
+        }
+    }
+
+    bytes reply(SERVER_MAGIC, SERVER_MAGIC + sizeof(SERVER_MAGIC));
+    if (place.first == -1)
+    {
+        reply.push_back(Packet_Full);
+    }
+    else
+    {
+        reply.push_back(Packet_Accepted);
+        putVarint(reply, place.first);
+        reply.push_back(static_cast<byte>(place.second));
+        putVarint(reply, m_sendInterval);
+    }
+    send(address, reply);
+}
+
+void Server::leaveSeat(const bytes& address)
+{
+    map<bytes, IntPair>::iterator client = m_clients.find(address);
+    if (client == m_clients.end())
+    {
+        return;
+    }
+
+    Match& match = *m_matches[client->second.first];
+    Seat& seat = match.seats[client->second.second];
+    seat.address.clear();
+    seat.input = LockstepInput();
+    match.taken--;
+    m_clients.erase(client);
+}
+
+void Server::send(const bytes& address, const bytes& packet)
+{
+    // lost packets are the same as errors, snapshots are sent again anyway
+    sendto(m_socket, &packet[0], packet.size(), 0,
+           reinterpret_cast<const sockaddr*>(&address[0]), static_cast<socklen_t>(address.size()));
+}
+
+void Server::startMatch(Match& match)
+{
+    pthread_mutex_lock(&g_worlds);
+
+    Randoms::init(match.seed);
+    match.seed = match.seed * 1664525 + 1013904223; // next match in this slot
+
+    if (match.world == NULL)
+    {
+        size_t seats[4];
+        match_draw_seats(m_pool.size(), seats);
+        vector<Profile*> profiles(4);
+        const bool external[4] = { true, true, true, true };
+        for (int i = 0; i < 4; i++)
+        {
+            profiles[i] = m_pool[seats[i]];
+        }
+        Network::instance->setExternalProfiles(profiles, external);
+
+        World::instance = NULL;
+        match.world = new World(NULL, match.unlockable, 0);
+        match.world->init();
+    }
+    else
+    {
+        // seats stay taken by the same players, level is not reloaded
+        World::instance = match.world;
+        match.world->reset();
+    }
+
+    pthread_mutex_unlock(&g_worlds);
+
+    match.bodies.clear();
+    const vector<Body*>& bodies = match.world->m_level->getBodies();
+    for each_const(vector<Body*>, bodies, iter)
+    {
+        if ((*iter)->isMovable())
+        {
+            match.bodies.push_back(*iter);
+        }
+    }
+    match.steps = 0;
+
+    // clients get the new world in full
+    for (int s = 0; s < 4; s++)
+    {
+        match.seats[s].encoder->reset();
+    }
+}
+
+void Server::stepMatches(Worker& worker)
+{
+    for each_const(vector<Match*>, worker.matches, iter)
+    {
+        if ((*iter)->started)
+        {
+            double start = threadTime();
+            stepMatch(worker, **iter);
+            worker.matchSeconds.push_back(static_cast<float>(threadTime() - start));
+        }
+    }
+    clock_advance(DT);
+}
+
+void Server::stepMatch(Worker& worker, Match& match)
+{
+    World* world = match.world;
+    World::instance = world;
+
+    for (int s = 0; s < 4; s++)
+    {
+        const LockstepInput& input = match.seats[s].input;
+        Vector direction(input.x / 32767.0f, 0.0f, input.z / 32767.0f);
+        static_cast<ExternalPlayer*>(world->m_localPlayers[s])->setAction(
+            direction, (input.buttons & LockstepInput::JUMP) != 0, (input.buttons & LockstepInput::KICK) != 0);
+    }
+
+    match_step(world);
+    match.steps++;
+
+    if (m_tick % m_sendInterval == 0)
+    {
+        sendSnapshot(worker, match);
+    }
+
+    if (world->m_referee->m_gameOver || match.steps >= m_maxSteps)
+    {
+        worker.matchesFinished++;
+        startMatch(match);
+    }
+}
+
+void Server::sendSnapshot(Worker& worker, Match& match)
+{
+    match.snapshot.m_tick = static_cast<unsigned int>(m_tick);
+    match.snapshot.m_bodies.resize(match.bodies.size());
+    for (size_t i = 0; i < match.bodies.size(); i++)
+    {
+        match.snapshot.m_bodies[i].capture(match.bodies[i]);
+    }
+
+    for (int s = 0; s < 4; s++)
+    {
+        Seat& seat = match.seats[s];
+        if (seat.address.empty())
+        {
+            continue;
+        }
+        seat.encoder->encode(match.snapshot, match.packets);
+        for each_const(vector<bytes>, match.packets, iter)
+        {
+            send(seat.address, *iter);
+            worker.packetsSent++;
+            worker.bytesSent += iter->size();
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <pthread.h>
+#include "common.h"
+
+class Profile;
+
+// Authoritative server: many four-player matches in one process, stepped
+// by a pool of worker threads. Every worker owns every threads-th match,
+// and these matches share the worker's clock and Randoms. Clients
+// connect over UDP, send their input every tick and get snapshots of all
+// movable bodies (snapshot.h) every sendInterval ticks. A match starts
+// when its four seats are taken and is restarted when it is over. A seat
+// whose client left or went silent keeps its player standing until
+// another client takes it.
+//
+// Client packets, 'S' 'V' and type:
+//   CONNECT
+//   INPUT    varint newest complete snapshot tick + 1 (0 for none),
+//            x and z as 16 bit little endian (LockstepInput), buttons
+//   LEAVE
+// Server packets, 'S' 'V' and type:
+//   ACCEPTED varint match, seat, varint send interval
+//   FULL
+// and snapshot packets.
+//
+// systems_create() and file_set_root() must be called before.
+
+struct ServerStats
+{
+    int           ticks;
+    vector<float> tickSeconds;  // wall time of every tick
+    vector<float> matchSeconds; // thread cpu time of every match step, with snapshots
+    int           packetsSent;
+    size_t        bytesSent;
+    int           packetsReceived;
+    size_t        bytesReceived;
+    int           matchesFinished;
+
+    ServerStats();
+};
+
+class Server : public NoCopy
+{
+public:
+    enum PacketType
+    {
+        Packet_Connect,
+        Packet_Input,
+        Packet_Leave,
+        Packet_Accepted,
+        Packet_Full
+    };
+
+    Server(int port, int matches, int threads, int sendInterval, unsigned int seed, int maxSteps);
+    ~Server();
+
+    // receives client packets, steps started matches, sends snapshots
+    void tick();
+
+    int  getTick() const;
+    int  getClients() const;
+    int  getStarted() const;
+    void getStats(ServerStats& stats) const;
+
+private:
+    struct Seat;
+    struct Match;
+    struct Worker;
+
+    static void* runWorker(void* arg);
+
+    void receive();
+    void handle(const bytes& packet, const bytes& address);
+    void takeSeat(const bytes& address);
+    void leaveSeat(const bytes& address);
+    void send(const bytes& address, const bytes& packet);
+    void startMatch(Match& match);
+    void stepMatches(Worker& worker);
+    void stepMatch(Worker& worker, Match& match);
+    void sendSnapshot(Worker& worker, Match& match);
+
+    int                  m_socket;
+    int                  m_sendInterval;
+    int                  m_maxSteps;
+    int                  m_tick;
+    bool                 m_quit;
+
+    vector<Match*>       m_matches;
+    vector<Worker*>      m_workers;
+    map<bytes, IntPair>  m_clients;   // address to match and seat
+    vector<Profile*>     m_pool;
+
+    pthread_barrier_t    m_start;
+    pthread_barrier_t    m_done;
+
+    vector<float>        m_tickSeconds;
+    int                  m_packetsReceived;
+    size_t               m_bytesReceived;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "lockstep.h"
+#include "snapshot.h"
+#include "random.h"
+#include "game.h"
+#include "match.h"
+#include "server.h"
+#include "varint.h"
+
+// Runs the authoritative server. With -l it also plays four loopback
+// clients for every match, stepped on the main thread between server
+// ticks, and prints tick time percentiles, cost of one match step and
+// snapshot traffic per client.
+//
+// usage: squares3d-server [-n matches] [-t threads] [-r snapshot rate Hz] [-p port]
+//                         [-m ticks] [-s seed] [-x speed] [-l] [-v]
+//
+// Without -l it serves real clients until -m ticks, forever with -m 0.
+// Ticks run in real time, -x runs them faster, -x 0 as fast as possible.
+
+static const size_t MAX_PACKET_SIZE = 1500;
+
+struct Client
+{
+    int             socket;
+    bool            accepted;
+    int             match;
+    int             seat;
+    SnapshotDecoder decoder;
+    int             snapshots;
+    size_t          bytesReceived;
+    size_t          bytesSent;
+    LockstepInput   input;
+    int             nextTurn;  // tick of next change of bot input
+    unsigned int    seed;      // rand_r, bot input only
+};
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-server [-n matches] [-t threads] [-r snapshot rate Hz] [-p port]" << endl
+              << "                        [-m ticks] [-s seed] [-x speed] [-l] [-v]" << endl;
+    exit(1);
+}
+
+static float percentile(vector<float> values, float p)
+{
+    if (values.empty())
+    {
+        return 0.0f;
+    }
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5f);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static float average(const vector<float>& values)
+{
+    double sum = 0.0;
+    for each_const(vector<float>, values, iter)
+    {
+        sum += *iter;
+    }
+    return values.empty() ? 0.0f : static_cast<float>(sum / values.size());
+}
+
+static void openClient(Client& client, unsigned int seed)
+{
+    client.socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client.socket < 0)
+    {
+        Exception("Can not create UDP socket");
+    }
+    fcntl(client.socket, F_SETFL, fcntl(client.socket, F_GETFL, 0) | O_NONBLOCK);
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(client.socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+    {
+        Exception("Can not bind loopback client");
+    }
+
+    client.accepted = false;
+    client.match = -1;
+    client.seat = -1;
+    client.snapshots = 0;
+    client.bytesReceived = 0;
+    client.bytesSent = 0;
+    client.nextTurn = 0;
+    client.seed = seed;
+}
+
+// receives everything that waits, then sends CONNECT or this tick's input
+static void updateClient(Client& client, const sockaddr_in& server, int tick)
+{
+    bytes packet;
+    while (true)
+    {
+        packet.resize(MAX_PACKET_SIZE);
+        ssize_t size = recv(client.socket, &packet[0], packet.size(), 0);
+        if (size < 0)
+        {
+            break;
+        }
+        packet.resize(static_cast<size_t>(size));
+        client.bytesReceived += packet.size();
+
+        if (packet.size() >= 3 && packet[0] == 'S' && packet[1] == 'V' && packet[2] == Server::Packet_Accepted)
+        {
+            client.accepted = true;
+        }
+        else if (client.decoder.decode(packet))
+        {
+            client.snapshots++;
+        }
+    }
+
+    bytes out;
+    out.push_back('S');
+    out.push_back('V');
+    if (!client.accepted)
+    {
+        if (tick % 30 != 0)
+        {
+            return;
+        }
+        out.push_back(Server::Packet_Connect);
+    }
+    else
+    {
+        // bot runs in a random direction for one to three seconds
+        if (tick >= client.nextTurn)
+        {
+            float angle = rand_r(&client.seed) * 6.2831853f / RAND_MAX;
+            client.input.x = static_cast<short>(std::cos(angle) * 32767.0f);
+            client.input.z = static_cast<short>(std::sin(angle) * 32767.0f);
+            client.nextTurn = tick + 30 + rand_r(&client.seed) % 60;
+        }
+        client.input.buttons = (rand_r(&client.seed) % 20 == 0 ? LockstepInput::KICK : 0) |
+                               (rand_r(&client.seed) % 60 == 0 ? LockstepInput::JUMP : 0);
+
+        out.push_back(Server::Packet_Input);
+        putVarint(out, client.decoder.hasSnapshot() ? client.decoder.getAck() + 1 : 0);
+        out.push_back(static_cast<byte>(client.input.x));
+        out.push_back(static_cast<byte>(client.input.x >> 8));
+        out.push_back(static_cast<byte>(client.input.z));
+        out.push_back(static_cast<byte>(client.input.z >> 8));
+        out.push_back(client.input.buttons);
+    }
+    sendto(client.socket, &out[0], out.size(), 0, reinterpret_cast<const sockaddr*>(&server), sizeof(server));
+    client.bytesSent += out.size();
+}
+
+int main(int argc, char* argv[])
+{
+    int matches = 16;
+    int threads = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    int rate = 30;
+    int port = 27970;
+    int ticks = 30 * 30;
+    unsigned int seed = static_cast<unsigned int>(time(NULL));
+    float speed = 1.0f;
+    bool loopback = false;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:r:p:m:s:x:lv")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': matches = cast<int>(string(optarg)); break;
+        case 't': threads = cast<int>(string(optarg)); break;
+        case 'r': rate = cast<int>(string(optarg)); break;
+        case 'p': port = cast<int>(string(optarg)); break;
+        case 'm': ticks = cast<int>(string(optarg)); break;
+        case 's': seed = cast<unsigned int>(string(optarg)); break;
+        case 'x': speed = cast<float>(string(optarg)); break;
+        case 'l': loopback = true; break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc || matches <= 0 || threads <= 0 || rate <= 0 || rate > 30 ||
+        ticks < 0 || speed < 0.0f || (loopback && ticks == 0))
+    {
+        usage();
+    }
+    int sendInterval = (30 + rate - 1) / rate; // in ticks, snapshots every DT at most
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    double start = wallTime();
+    Server* server = new Server(port, matches, threads, sendInterval, seed, 30 * 60 * 30);
+    std::cout << matches << " matches on " << std::min(threads, matches) << " threads, snapshots every "
+              << sendInterval << " ticks, port " << port << ", started in "
+              << std::fixed << std::setprecision(2) << wallTime() - start << " s" << endl;
+
+    vector<Client> clients(loopback ? 4 * matches : 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    for (size_t i = 0; i < clients.size(); i++)
+    {
+        openClient(clients[i], seed + static_cast<unsigned int>(i));
+    }
+
+    double clientSeconds = 0.0;
+    start = wallTime();
+    for (int tick = 0; ticks == 0 || tick < ticks; tick++)
+    {
+        double clientStart = wallTime();
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            updateClient(clients[i], address, tick);
+        }
+        clientSeconds += wallTime() - clientStart;
+
+        server->tick();
+
+        if (speed > 0.0f)
+        {
+            double wait = start + (tick + 1) * DT / speed - wallTime();
+            if (wait > 0.0)
+            {
+                usleep(static_cast<useconds_t>(wait * 1000000.0));
+            }
+        }
+        if (verbose && tick % 300 == 0)
+        {
+            clog << "tick " << tick << ", " << server->getClients() << " clients, "
+                 << server->getStarted() << " matches started" << endl;
+        }
+    }
+    double wall = wallTime() - start;
+
+    ServerStats stats;
+    server->getStats(stats);
+    float seconds = stats.ticks * DT;
+    float matchAverage = average(stats.matchSeconds);
+
+    std::cout << stats.ticks << " ticks in " << wall << " s, " << server->getStarted() << " matches started, "
+              << stats.matchesFinished << " finished" << endl
+              << std::setprecision(3)
+              << "tick        p50 " << percentile(stats.tickSeconds, 0.5f) * 1000.0f
+              << " ms  p90 " << percentile(stats.tickSeconds, 0.9f) * 1000.0f
+              << " ms  p99 " << percentile(stats.tickSeconds, 0.99f) * 1000.0f
+              << " ms  max " << percentile(stats.tickSeconds, 1.0f) * 1000.0f
+              << " ms  (budget " << DT * 1000.0f << " ms)" << endl
+              << std::setprecision(1)
+              << "match step  p50 " << percentile(stats.matchSeconds, 0.5f) * 1000000.0f
+              << " us  p90 " << percentile(stats.matchSeconds, 0.9f) * 1000000.0f
+              << " us  p99 " << percentile(stats.matchSeconds, 0.99f) * 1000000.0f
+              << " us  avg " << matchAverage * 1000000.0f << " us  (cpu, with snapshots)" << endl
+              << std::setprecision(0)
+              << "about " << (matchAverage > 0.0f ? DT / matchAverage : 0.0f)
+              << " matches per core at 30 ticks per second" << endl
+              << std::setprecision(1)
+              << "server      " << stats.packetsSent / seconds << " packets/s, "
+              << stats.bytesSent / seconds / 1024.0f << " KB/s out, "
+              << stats.packetsReceived / seconds << " packets/s, "
+              << stats.bytesReceived / seconds / 1024.0f << " KB/s in" << endl;
+
+    if (loopback)
+    {
+        int accepted = 0;
+        int snapshots = 0;
+        size_t received = 0;
+        size_t sent = 0;
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            accepted += (clients[i].accepted ? 1 : 0);
+            snapshots += clients[i].snapshots;
+            received += clients[i].bytesReceived;
+            sent += clients[i].bytesSent;
+            close(clients[i].socket);
+        }
+        float perClient = seconds * clients.size();
+        std::cout << "client      " << accepted << " of " << clients.size() << " accepted, "
+                  << snapshots / perClient << " snapshots/s, " << received / perClient << " bytes/s down, "
+                  << sent / perClient << " bytes/s up, "
+                  << std::setprecision(3) << clientSeconds * 1000.0 / stats.ticks << " ms per tick for all clients" << endl;
+    }
+
+    delete server;
+    systems_destroy();
+
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include <time.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "level.h"
+#include "referee_base.h"
+#include "body.h"
+#include "profile.h"
+#include "random.h"
+#include "snapshot.h"
+#include "clock.h"
+#include "game.h"
+#include "match.h"
+
+// Plays a four-AI match and sends a snapshot of every movable body each
+// tick through a simulated network with latency and loss. Prints bytes
+// per tick for delta and full snapshots, encode and decode time and the
+// quantization error, and checks every decoded snapshot against the sent
+// one.
+//
+// usage: squares3d-snapshot [-s seed] [-m ticks] [-L level] [-d delay ticks]
+//                           [-l loss %] [-u mtu] [-v]
+
+struct InFlight
+{
+    int          arrives; // tick
+    bytes        packet;
+};
+
+struct Ack
+{
+    int          arrives;
+    unsigned int tick;
+};
+
+static double nanoTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-snapshot [-s seed] [-m ticks] [-L level] [-d delay ticks]" << endl
+              << "                          [-l loss %] [-u mtu] [-v]" << endl;
+    exit(1);
+}
+
+static size_t packetBytes(const vector<bytes>& packets)
+{
+    size_t size = 0;
+    for each_const(vector<bytes>, packets, iter)
+    {
+        size += iter->size();
+    }
+    return size;
+}
+
+// angle between rotations of two matrices, in degrees
+static float rotationError(const Matrix& a, const Matrix& b)
+{
+    float trace = 0.0f;
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            trace += a.m[r * 4 + c] * b.m[r * 4 + c];
+        }
+    }
+    float cosine = std::max(-1.0f, std::min(1.0f, (trace - 1.0f) / 2.0f));
+    return std::acos(cosine) * 180.0f / 3.14159265f;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int seed = 1;
+    int ticks = 30 * 60;
+    int level = 0;
+    int delay = 3;
+    float loss = 0.05f;
+    size_t mtu = SNAPSHOT_MTU;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:m:L:d:l:u:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': seed = cast<unsigned int>(string(optarg)); break;
+        case 'm': ticks = cast<int>(string(optarg)); break;
+        case 'L': level = cast<int>(string(optarg)); break;
+        case 'd': delay = cast<int>(string(optarg)); break;
+        case 'l': loss = cast<float>(string(optarg)) / 100.0f; break;
+        case 'u': mtu = cast<size_t>(string(optarg)); break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc || ticks <= 0 || delay < 0 || level < 0)
+    {
+        usage();
+    }
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    vector<Profile*> pool;
+    for (int i = 0; i < 4; i++)
+    {
+        pool.insert(pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    Randoms::init(seed);
+    size_t seats[4];
+    match_draw_seats(pool.size(), seats);
+    vector<Profile*> profiles(4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        profiles[i] = pool[seats[i]];
+    }
+    Network::instance->setAiProfiles(profiles);
+
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, level);
+    world->init();
+
+    vector<Body*> movable;
+    const vector<Body*>& levelBodies = world->m_level->getBodies();
+    for each_const(vector<Body*>, levelBodies, iter)
+    {
+        if ((*iter)->isMovable())
+        {
+            Network::instance->add(*iter);
+            movable.push_back(*iter);
+        }
+    }
+
+    SnapshotEncoder encoder(mtu);
+    SnapshotEncoder fullEncoder(mtu); // never acknowledged
+    SnapshotDecoder decoder;
+    Snapshot snapshot;
+    vector<bytes> packets;
+    std::deque<InFlight> toClient;
+    std::deque<Ack> toServer;
+    vector<Snapshot> sent(ticks);
+    unsigned int lossSeed = seed;
+
+    size_t bodies = 0;
+    size_t deltaBytes = 0, deltaMax = 0, fullBytes = 0, fullMax = 0;
+    size_t packetCount = 0, packetMax = 0, maxPacketsPerTick = 0;
+    int decoded = 0, mismatches = 0, lost = 0;
+    double encodeNs = 0.0, fullNs = 0.0, decodeNs = 0.0;
+    int decodeCalls = 0;
+    float positionError = 0.0f, angleError = 0.0f;
+    int outOfRange = 0;
+
+    int tick = 0;
+    for (; tick < ticks && !world->m_referee->m_gameOver; tick++)
+    {
+        systems_update();
+        match_step(world);
+        clock_advance(DT);
+
+        while (!toServer.empty() && toServer.front().arrives <= tick)
+        {
+            encoder.ack(toServer.front().tick);
+            toServer.pop_front();
+        }
+
+        Network::instance->captureSnapshot(snapshot, tick);
+        sent[tick] = snapshot;
+        bodies = snapshot.m_bodies.size();
+
+        for (size_t i = 0; i < bodies; i++)
+        {
+            const Matrix& matrix = movable[i]->m_matrix;
+            Matrix quantized = snapshot.m_bodies[i].getMatrix();
+            for (int k = 12; k < 15; k++)
+            {
+                if (std::fabs(matrix.m[k]) >= 128.0f)
+                {
+                    outOfRange++; // clamped to +-128 m
+                    continue;
+                }
+                positionError = std::max(positionError, std::fabs(matrix.m[k] - quantized.m[k]));
+            }
+            angleError = std::max(angleError, rotationError(matrix, quantized));
+        }
+
+        double start = nanoTime();
+        fullEncoder.encode(snapshot, packets);
+        fullNs += nanoTime() - start;
+        fullBytes += packetBytes(packets);
+        fullMax = std::max(fullMax, packetBytes(packets));
+
+        start = nanoTime();
+        encoder.encode(snapshot, packets);
+        encodeNs += nanoTime() - start;
+        deltaBytes += packetBytes(packets);
+        deltaMax = std::max(deltaMax, packetBytes(packets));
+        packetCount += packets.size();
+        maxPacketsPerTick = std::max(maxPacketsPerTick, packets.size());
+
+        for each_const(vector<bytes>, packets, iter)
+        {
+            packetMax = std::max(packetMax, iter->size());
+            if (rand_r(&lossSeed) < loss * RAND_MAX)
+            {
+                lost++;
+                continue;
+            }
+            InFlight flight;
+            flight.arrives = tick + delay;
+            flight.packet = *iter;
+            toClient.push_back(flight);
+        }
+
+        while (!toClient.empty() && toClient.front().arrives <= tick)
+        {
+            start = nanoTime();
+            bool complete = decoder.decode(toClient.front().packet);
+            decodeNs += nanoTime() - start;
+            decodeCalls++;
+            toClient.pop_front();
+
+            if (complete)
+            {
+                decoded++;
+                const Snapshot& received = decoder.getSnapshot();
+                if (received != sent[received.m_tick])
+                {
+                    mismatches++;
+                }
+                Ack ack;
+                ack.arrives = tick + delay;
+                ack.tick = decoder.getAck();
+                if (rand_r(&lossSeed) >= loss * RAND_MAX)
+                {
+                    toServer.push_back(ack);
+                }
+            }
+        }
+    }
+
+    std::cout << tick << " ticks, " << bodies << " bodies, delay " << delay << " ticks, loss "
+              << loss * 100.0f << "%, mtu " << mtu << endl
+              << std::fixed << std::setprecision(1)
+              << "full   " << std::setw(7) << static_cast<double>(fullBytes) / tick << " bytes/tick avg "
+              << std::setw(5) << fullMax << " max " << std::setw(8) << fullNs / tick << " ns encode" << endl
+              << "delta  " << std::setw(7) << static_cast<double>(deltaBytes) / tick << " bytes/tick avg "
+              << std::setw(5) << deltaMax << " max " << std::setw(8) << encodeNs / tick << " ns encode "
+              << std::setw(8) << (decodeCalls == 0 ? 0.0 : decodeNs / decodeCalls) << " ns decode" << endl
+              << "packets " << packetCount << " sent, " << lost << " lost, largest " << packetMax
+              << " bytes, at most " << maxPacketsPerTick << " per tick" << endl
+              << std::setprecision(4) << "quantization error " << positionError * 1000.0f << " mm, "
+              << angleError << " deg, " << outOfRange << " positions out of range" << endl
+              << (mismatches == 0 ? "OK" : "FAILED") << ", " << decoded << " snapshots decoded, "
+              << mismatches << " differ" << endl;
+
+    delete world;
+    for (int i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+    Network::instance->removeBodies();
+    systems_destroy();
+    return mismatches == 0 ? 0 : 1;
+}
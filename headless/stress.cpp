@@ -0,0 +1,269 @@
+#include <pthread.h>
+#include <unistd.h>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "referee_base.h"
+#include "profile.h"
+#include "random.h"
+#include "clock.h"
+#include "game.h"
+#include "match.h"
+#include "world_hash.h"
+
+// Plays the same four-AI matches twice, first one after another and then
+// all at once with every world on its own thread, and checks that both
+// runs produce the same WorldHash on every step. Catches state shared
+// between worlds in one process, in Newton and in the game.
+//
+// usage: squares3d-stress [-n matches] [-m steps] [-s seed] [-v]
+//
+// Worlds are created and destroyed one at a time, they load textures,
+// sounds and fonts into caches of the shared Video and Audio. Stepping
+// runs in parallel and touches only the thread's own World, Randoms and
+// clock.
+
+static const int MAX_STEPS = 30 * 60; // one minute of play
+
+struct Run
+{
+    unsigned int            seed;
+    const vector<Profile*>* pool;
+    int                     maxSteps;
+    const Run*              reference; // serial run to compare with, or NULL
+
+    int                     steps;
+    vector<WorldHash>       hashes;    // of every step, serial run only
+    int                     desyncStep; // first step different from reference, -1 if none
+    string                  desync;
+    double                  stepTime;
+    double                  hashTime;
+};
+
+static pthread_mutex_t  g_setup = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t g_start;
+static bool             g_parallel;
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-stress [-n matches] [-m steps] [-s seed] [-v]" << endl;
+    exit(1);
+}
+
+
+static void* playMatch(void* arg)
+{
+    Run& run = *static_cast<Run*>(arg);
+
+    pthread_mutex_lock(&g_setup);
+
+    Randoms::init(run.seed);
+
+    size_t seats[4];
+    match_draw_seats(run.pool->size(), seats);
+    vector<Profile*> profiles(4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        profiles[i] = (*run.pool)[seats[i]];
+    }
+    Network::instance->setAiProfiles(profiles);
+
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, 0);
+    world->init();
+
+    pthread_mutex_unlock(&g_setup);
+
+    if (g_parallel)
+    {
+        // all worlds step at the same time
+        pthread_barrier_wait(&g_start);
+    }
+
+    WorldHasher hasher;
+    WorldHash hash;
+    run.steps = 0;
+    run.desyncStep = -1;
+    run.stepTime = 0.0;
+    run.hashTime = 0.0;
+    while (run.steps < run.maxSteps && !world->m_referee->m_gameOver)
+    {
+        double start = wallTime();
+        match_step(world);
+        clock_advance(DT);
+        double stepped = wallTime();
+        hasher.compute(world, hash);
+        run.stepTime += stepped - start;
+        run.hashTime += wallTime() - stepped;
+
+        if (run.reference == NULL)
+        {
+            run.hashes.push_back(hash);
+        }
+        else if (run.desyncStep < 0)
+        {
+            const vector<WorldHash>& expected = run.reference->hashes;
+            if (run.steps >= static_cast<int>(expected.size()))
+            {
+                run.desyncStep = run.steps;
+                run.desync = "match length";
+            }
+            else if (hash != expected[run.steps])
+            {
+                run.desyncStep = run.steps;
+                run.desync = hash.difference(expected[run.steps], world);
+            }
+        }
+        run.steps++;
+    }
+
+    pthread_mutex_lock(&g_setup);
+    delete world;
+    pthread_mutex_unlock(&g_setup);
+
+    return NULL;
+}
+
+// every match gets a fresh thread, so thread local clock and Randoms
+// start from the same state in both runs
+static double playAll(vector<Run>& runs, bool parallel)
+{
+    g_parallel = parallel;
+    if (parallel)
+    {
+        pthread_barrier_init(&g_start, NULL, static_cast<unsigned int>(runs.size()));
+    }
+
+    double start = wallTime();
+
+    vector<pthread_t> threads(runs.size());
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        if (pthread_create(&threads[i], NULL, playMatch, &runs[i]) != 0)
+        {
+            Exception("pthread_create failed");
+        }
+        if (!parallel)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    if (parallel)
+    {
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_barrier_destroy(&g_start);
+    }
+
+    return wallTime() - start;
+}
+
+int main(int argc, char* argv[])
+{
+    int matches = 64;
+    int maxSteps = MAX_STEPS;
+    unsigned int seed = static_cast<unsigned int>(time(NULL));
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:s:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': matches = cast<int>(string(optarg)); break;
+        case 'm': maxSteps = cast<int>(string(optarg)); break;
+        case 's': seed = cast<unsigned int>(string(optarg)); break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc || matches <= 0 || maxSteps <= 0)
+    {
+        usage();
+    }
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+    vector<Profile*> pool;
+    for (int i = 0; i < 4; i++)
+    {
+        pool.insert(pool.end(), cpuProfiles[i].begin(), cpuProfiles[i].end());
+    }
+
+    Randoms::init(seed);
+    vector<Run> serial(matches);
+    for (int i = 0; i < matches; i++)
+    {
+        serial[i].seed = Randoms::getInt();
+        serial[i].pool = &pool;
+        serial[i].maxSteps = maxSteps;
+        serial[i].reference = NULL;
+    }
+    vector<Run> parallel = serial;
+    for (int i = 0; i < matches; i++)
+    {
+        parallel[i].reference = &serial[i];
+    }
+
+    std::cout << "seed " << seed << ", " << matches << " matches, up to "
+              << maxSteps << " steps" << endl;
+
+    double serialTime = playAll(serial, false);
+    double stepTime = 0.0;
+    double hashTime = 0.0;
+    for (int i = 0; i < matches; i++)
+    {
+        stepTime += serial[i].stepTime;
+        hashTime += serial[i].hashTime;
+    }
+    std::cout << "serial:   " << std::fixed << std::setprecision(2) << serialTime << " s, hashing "
+              << hashTime / stepTime * 100.0 << "% of step time" << endl;
+
+    double parallelTime = playAll(parallel, true);
+    std::cout << "parallel: " << parallelTime << " s, " << matches << " threads" << endl;
+
+    int mismatches = 0;
+    for (int i = 0; i < matches; i++)
+    {
+        if (parallel[i].desyncStep < 0 && serial[i].steps != parallel[i].steps)
+        {
+            parallel[i].desyncStep = parallel[i].steps;
+            parallel[i].desync = "match length";
+        }
+        if (parallel[i].desyncStep >= 0)
+        {
+            std::cout << "match " << i << " differs at step " << parallel[i].desyncStep
+                      << ": " << parallel[i].desync << endl;
+            mismatches++;
+        }
+    }
+
+    std::cout << (mismatches == 0 ? "OK" : "FAILED") << ", " << mismatches
+              << " of " << matches << " matches differ" << endl;
+
+    for (int i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+    systems_destroy();
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+#include <time.h>
+#include <cstdlib>
+#include <new>
+
+#include "common.h"
+#include "glue.h"
+#include "file.h"
+#include "match.h"
+#include "language.h"
+#include "level_format.h"
+#include "level_compiler.h"
+
+// Times text conversions against the stringstream ones cast<> used before:
+// the numbers in the level XML files, compiling the levels that parse
+// them, and the score board texts made every frame.
+//
+// usage: squares3d-textbench [-r runs]
+
+// every allocation made by the process, single threaded
+static size_t g_allocations = 0;
+
+void* operator new (size_t size)
+{
+    g_allocations++;
+    void* result = malloc(size == 0 ? 1 : size);
+    if (result == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void* operator new [] (size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete (void* ptr)
+{
+    free(ptr);
+}
+
+void operator delete [] (void* ptr)
+{
+    free(ptr);
+}
+
+void operator delete (void* ptr, size_t)
+{
+    free(ptr);
+}
+
+void operator delete [] (void* ptr, size_t)
+{
+    free(ptr);
+}
+
+static double nanoTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-textbench [-r runs]" << endl;
+    exit(1);
+}
+
+// cast<> and Formatter as they were
+template <typename To, typename From>
+static To streamCast(const From& from)
+{
+    stringstream ss;
+    To to;
+    ss << from;
+    ss >> to;
+    return to;
+}
+
+static string streamFormat(const string& text, int value)
+{
+    string result = text;
+    string number = streamCast<string>(value);
+    size_t pos = result.find("$1");
+    if (pos != string::npos)
+    {
+        result = result.substr(0, pos) + number + result.substr(pos + 2, result.size());
+    }
+    return result;
+}
+
+// attribute values that start like a number
+static void findNumbers(const string& filename, StringVector& numbers)
+{
+    File::Reader in(filename);
+    if (!in.is_open())
+    {
+        std::cerr << "can not read " << filename << endl;
+        exit(1);
+    }
+    const char* text = reinterpret_cast<const char*>(in.pointer());
+    const char* end = text + in.size();
+    for (const char* i = text; i + 1 < end; i++)
+    {
+        if (i[0] == '=' && i[1] == '"')
+        {
+            const char* first = i + 2;
+            const char* last = first;
+            while (last != end && *last != '"')
+            {
+                last++;
+            }
+            if (first != last && (*first == '-' || *first == '.' || (*first >= '0' && *first <= '9')))
+            {
+                numbers.push_back(string(first, last));
+            }
+            i = last;
+        }
+    }
+}
+
+static void report(const char* name, double streamTime, double castTime, size_t streamAllocations,
+                   size_t castAllocations, size_t count, const char* unit)
+{
+    std::cout << "  " << name << ": " << streamTime / count << " " << unit << " with streams, "
+              << castTime / count << " " << unit << " now, "
+              << static_cast<float>(streamAllocations) / count << " and "
+              << static_cast<float>(castAllocations) / count << " allocations" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = 1000;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "-r" && i + 1 < argc)
+        {
+            runs = cast<int>(string(argv[++i]));
+        }
+        else
+        {
+            usage();
+        }
+    }
+    if (runs < 1)
+    {
+        usage();
+    }
+
+    file_set_root("..", ".");
+    clog.rdbuf(NULL);
+    systems_create();
+
+    // both levels with the files they link
+    const char* levels[] = { "world.xml", "extra.xml" };
+    StringSet files;
+    for (size_t i = 0; i < sizeOfArray(levels); i++)
+    {
+        LevelCompiler compiler;
+        compiler.compile(levels[i]);
+        const bytes& blob = compiler.getBlob();
+        CompiledLevel level(&blob[0], blob.size());
+        const LevelHeader& header = level.header();
+        for (unsigned int k = 0; k < header.sources.count; k++)
+        {
+            files.insert(level.getString(level.get<SourceRecord>(header.sources, k).name));
+        }
+    }
+
+    StringVector numbers;
+    for each_const(StringSet, files, iter)
+    {
+        findNumbers("/data/level/" + *iter, numbers);
+    }
+
+    // same results, the sums keep the calls
+    float streamSum = 0.0f;
+    size_t count = g_allocations;
+    double start = nanoTime();
+    for (int k = 0; k < runs; k++)
+    {
+        for each_const(StringVector, numbers, iter)
+        {
+            streamSum += streamCast<float>(*iter);
+        }
+    }
+    double streamTime = nanoTime() - start;
+    size_t streamAllocations = g_allocations - count;
+
+    float castSum = 0.0f;
+    count = g_allocations;
+    start = nanoTime();
+    for (int k = 0; k < runs; k++)
+    {
+        for each_const(StringVector, numbers, iter)
+        {
+            castSum += cast<float>(*iter);
+        }
+    }
+    double castTime = nanoTime() - start;
+    size_t castAllocations = g_allocations - count;
+
+    if (streamSum != castSum)
+    {
+        std::cerr << "parsed numbers differ" << endl;
+        return 1;
+    }
+
+    std::cout << "level files: " << files.size() << " files, " << numbers.size() << " numbers" << endl;
+    report("parse", streamTime, castTime, streamAllocations, castAllocations,
+           numbers.size() * runs, "ns");
+
+    for (size_t i = 0; i < sizeOfArray(levels); i++)
+    {
+        int compileRuns = std::max(1, runs / 10);
+        count = g_allocations;
+        start = nanoTime();
+        for (int k = 0; k < compileRuns; k++)
+        {
+            LevelCompiler compiler;
+            compiler.compile(levels[i]);
+        }
+        std::cout << "  compile " << levels[i] << ": " << (nanoTime() - start) / compileRuns / 1e6
+                  << " ms, " << (g_allocations - count) / compileRuns << " allocations" << endl;
+    }
+
+    // score board of ScoreBoard::registerPlayers, every message's text is
+    // asked for its width, height and to render it
+    StringVector texts;
+    const char* names[] = { "Player", "Mike", "Bob", "Alice" };
+    for (size_t i = 0; i < sizeOfArray(names); i++)
+    {
+        texts.push_back(Language::instance->get(TEXT_SCORE_MESSAGE)(string(names[i])));
+        texts.push_back(Language::instance->get(TEXT_HITS));
+    }
+    texts.push_back(Language::instance->get(TEXT_HITS_COMBO));
+
+    const int frames = runs * 10;
+    const int calls = 3;
+    size_t streamLength = 0;
+    count = g_allocations;
+    start = nanoTime();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (size_t i = 0; i < texts.size(); i++)
+        {
+            for (int k = 0; k < calls; k++)
+            {
+                streamLength += streamFormat(texts[i], frame % 100 + static_cast<int>(i)).size();
+            }
+        }
+    }
+    streamTime = nanoTime() - start;
+    streamAllocations = g_allocations - count;
+
+    size_t castLength = 0;
+    count = g_allocations;
+    start = nanoTime();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (size_t i = 0; i < texts.size(); i++)
+        {
+            for (int k = 0; k < calls; k++)
+            {
+                string text = Formatter(texts[i])(frame % 100 + static_cast<int>(i));
+                castLength += text.size();
+            }
+        }
+    }
+    castTime = nanoTime() - start;
+    castAllocations = g_allocations - count;
+
+    if (streamLength != castLength)
+    {
+        std::cerr << "formatted texts differ" << endl;
+        return 1;
+    }
+
+    std::cout << "score board: " << texts.size() << " messages" << endl;
+    report("format", streamTime, castTime, streamAllocations, castAllocations, frames, "ns/frame");
+
+    systems_destroy();
+}
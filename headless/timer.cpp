@@ -0,0 +1,92 @@
+#include <stdint.h>
+
+#include "common.h"
+#include "timer.h"
+#include "clock.h"
+
+static THREAD_LOCAL uint64_t g_now = 0; // microseconds
+
+void clock_advance(float seconds)
+{
+    g_now += static_cast<uint64_t>(seconds * 1000000.0f + 0.5f);
+}
+
+float clock_read()
+{
+    return g_now / 1000000.0f;
+}
+
+Timer::Timer(bool start) :
+    m_running(start ? 1 : 0),
+    m_elapsed(0),
+    m_resumed(0)
+{
+    reset(start);
+}
+
+void Timer::pause()
+{
+    m_running--;
+    if (m_running != 0)
+    {
+        return;
+    }
+
+    m_elapsed += g_now - m_resumed;
+}
+
+void Timer::resume()
+{
+    m_running++;
+    if (m_running != 1)
+    {
+        return;
+    }
+
+    m_resumed = g_now;
+}
+
+void Timer::reset(bool start)
+{
+    m_running = (start ? 1 : 0);
+    if (start)
+    {
+        m_resumed = g_now;
+    }
+    m_elapsed = 0;
+}
+
+float Timer::read() const
+{
+    uint64_t res;
+    if (m_running <= 0)
+    {
+        res = m_elapsed;
+    }
+    else
+    {
+        res = g_now - m_resumed + m_elapsed;
+    }
+    return res / 1000000.0f;
+}
+
+int Timer::running() const
+{
+    return m_running;
+}
+
+uint64_t Timer::elapsed() const
+{
+    if (m_running <= 0)
+    {
+        return m_elapsed;
+    }
+    return g_now - m_resumed + m_elapsed;
+}
+
+void Timer::restore(int running, uint64_t elapsed)
+{
+    m_running = running;
+    m_elapsed = elapsed;
+    m_resumed = g_now;
+}
@@ -0,0 +1,369 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+
+#include "common.h"
+#include "glue.h"
+#include "network.h"
+#include "world.h"
+#include "referee_base.h"
+#include "scoreboard.h"
+#include "profile.h"
+#include "random.h"
+#include "game.h"
+#include "match.h"
+
+// Plays many four-AI matches, one worker process per core, and prints
+// statistics per profile for tuning data/level/cpu_players.xml.
+//
+// usage: squares3d-tournament [-n matches] [-j workers] [-s seed]
+//                             [-l ladders] [-m max steps] [-v]
+//
+// ladders is comma separated list of easy, normal, hard and extra,
+// four distinct profiles from them are drawn for every match.
+// Every match is seeded from its own entry of a seed list generated from
+// -s, so results do not depend on the number of workers.
+// Player with fewest points when the game is over wins, one who reached
+// the match points loses.
+
+static const int MAX_STEPS = 30 * 60 * 30; // 30 minutes of play
+
+static const char* LADDERS[4] = { "easy", "normal", "hard", "extra" };
+
+struct Entry
+{
+    Profile* profile;
+    int      ladder;
+};
+
+struct Totals
+{
+    int matches;
+    int unfinished;
+    int steps;
+};
+
+struct ProfileStats
+{
+    int matches;
+    int wins;
+    int losses;
+    int points;
+    int faults;
+    int combos;
+    int comboHits;
+    int bestCombo;
+};
+
+typedef vector<Entry> Entries;
+typedef vector<ProfileStats> ProfileStatsVector;
+
+static void usage()
+{
+    std::cerr << "usage: squares3d-tournament [-n matches] [-j workers] [-s seed]" << endl
+              << "                            [-l ladders] [-m max steps] [-v]" << endl;
+    exit(1);
+}
+
+static void addStats(ProfileStats& total, const ProfileStats& stats)
+{
+    total.matches += stats.matches;
+    total.wins += stats.wins;
+    total.losses += stats.losses;
+    total.points += stats.points;
+    total.faults += stats.faults;
+    total.combos += stats.combos;
+    total.comboHits += stats.comboHits;
+    total.bestCombo = std::max(total.bestCombo, stats.bestCombo);
+}
+
+static void playMatch(unsigned int seed, const Entries& pool, int maxSteps,
+                      Totals& totals, ProfileStatsVector& stats)
+{
+    Randoms::init(seed);
+
+    size_t seats[4];
+    match_draw_seats(pool.size(), seats);
+    vector<Profile*> profiles(4);
+    for (size_t i = 0; i < 4; i++)
+    {
+        profiles[i] = pool[seats[i]].profile;
+    }
+    Network::instance->setAiProfiles(profiles);
+
+    int unlockable = 0;
+    World* world = new World(NULL, unlockable, 0);
+    world->init();
+
+    int steps = match_run(world, maxSteps);
+    bool over = world->m_referee->m_gameOver;
+
+    totals.matches++;
+    totals.steps += steps;
+    if (!over)
+    {
+        totals.unfinished++;
+    }
+
+    const Scores& scores = world->m_scoreBoard->getScores();
+    int fewest = scores.begin()->second.m_total;
+    for each_const(Scores, scores, iter)
+    {
+        fewest = std::min(fewest, iter->second.m_total);
+    }
+    string loser = (over ? world->m_referee->getLoserName() : "");
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        const string& name = profiles[i]->m_name;
+        const Account& account = scores.find(name)->second;
+
+        ProfileStats& s = stats[seats[i]];
+        s.matches++;
+        s.points += account.m_total;
+        s.faults += account.m_faults;
+        s.combos += account.m_combos;
+        s.comboHits += account.m_comboHits;
+        s.bestCombo = std::max(s.bestCombo, account.m_bestCombo);
+        if (over)
+        {
+            if (name == loser)
+            {
+                s.losses++;
+            }
+            else if (account.m_total == fewest)
+            {
+                s.wins++;
+            }
+        }
+    }
+
+    delete world;
+}
+
+static bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* ptr = static_cast<const char*>(data);
+    while (size != 0)
+    {
+        ssize_t written = write(fd, ptr, size);
+        if (written <= 0)
+        {
+            return false;
+        }
+        ptr += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t size)
+{
+    char* ptr = static_cast<char*>(data);
+    while (size != 0)
+    {
+        ssize_t got = read(fd, ptr, size);
+        if (got <= 0)
+        {
+            return false;
+        }
+        ptr += got;
+        size -= got;
+    }
+    return true;
+}
+
+static void printStats(const string& name, const string& ladder, const ProfileStats& s)
+{
+    float n = static_cast<float>(std::max(s.matches, 1));
+    float loss = s.losses / n;
+    float ci = 1.96f * std::sqrt(loss * (1.0f - loss) / n); // 95% interval
+
+    std::cout << std::left << std::setw(16) << name
+              << std::setw(8) << ladder << std::right
+              << std::setw(8) << s.matches
+              << std::fixed << std::setprecision(1)
+              << std::setw(8) << 100.0f * s.wins / n
+              << std::setw(8) << 100.0f * loss << " +-" << std::setw(5) << 100.0f * ci
+              << std::setw(8) << s.points / n
+              << std::setw(8) << s.faults / n
+              << std::setw(8) << (s.combos == 0 ? 0.0f : static_cast<float>(s.comboHits) / s.combos)
+              << std::setw(6) << s.bestCombo << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int matches = 100;
+    int workers = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+    unsigned int seed = static_cast<unsigned int>(time(NULL));
+    string ladders = "easy,normal,hard,extra";
+    int maxSteps = MAX_STEPS;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:s:l:m:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': matches = cast<int>(string(optarg)); break;
+        case 'j': workers = cast<int>(string(optarg)); break;
+        case 's': seed = cast<unsigned int>(string(optarg)); break;
+        case 'l': ladders = optarg; break;
+        case 'm': maxSteps = cast<int>(string(optarg)); break;
+        case 'v': verbose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc || matches <= 0 || maxSteps <= 0)
+    {
+        usage();
+    }
+    workers = std::max(1, std::min(workers, matches));
+
+    file_set_root("..", ".");
+    if (!verbose)
+    {
+        clog.rdbuf(NULL);
+    }
+
+    systems_create();
+
+    ProfilesVector cpuProfiles[4];
+    loadCpuProfiles(cpuProfiles);
+
+    Entries pool;
+    for (int i = 0; i < 4; i++)
+    {
+        if (("," + ladders + ",").find(string(",") + LADDERS[i] + ",") == string::npos)
+        {
+            continue;
+        }
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            Entry entry = { *iter, i };
+            pool.push_back(entry);
+        }
+    }
+    if (pool.size() < 4)
+    {
+        std::cerr << "Ladders '" << ladders << "' have less than 4 profiles" << endl;
+        return 1;
+    }
+
+    vector<unsigned int> seeds(matches);
+    Randoms::init(seed);
+    for (int i = 0; i < matches; i++)
+    {
+        seeds[i] = Randoms::getInt();
+    }
+
+    double start = wallTime();
+
+    vector<pid_t> pids(workers);
+    vector<int> pipes(workers);
+    for (int k = 0; k < workers; k++)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            std::cerr << "pipe failed" << endl;
+            return 1;
+        }
+
+        pids[k] = fork();
+        if (pids[k] == 0)
+        {
+            close(fds[0]);
+
+            Totals totals = { 0, 0, 0 };
+            ProfileStats zero = { 0, 0, 0, 0, 0, 0, 0, 0 };
+            ProfileStatsVector stats(pool.size(), zero);
+            for (int i = k; i < matches; i += workers)
+            {
+                playMatch(seeds[i], pool, maxSteps, totals, stats);
+            }
+
+            bool ok = writeAll(fds[1], &totals, sizeof(totals)) &&
+                      writeAll(fds[1], &stats[0], stats.size() * sizeof(ProfileStats));
+            _exit(ok ? 0 : 1);
+        }
+        else if (pids[k] < 0)
+        {
+            std::cerr << "fork failed" << endl;
+            return 1;
+        }
+        close(fds[1]);
+        pipes[k] = fds[0];
+    }
+
+    Totals totals = { 0, 0, 0 };
+    ProfileStats zero = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    ProfileStatsVector stats(pool.size(), zero);
+    bool failed = false;
+    for (int k = 0; k < workers; k++)
+    {
+        Totals workerTotals;
+        ProfileStatsVector workerStats(pool.size());
+        bool ok = readAll(pipes[k], &workerTotals, sizeof(workerTotals)) &&
+                  readAll(pipes[k], &workerStats[0], workerStats.size() * sizeof(ProfileStats));
+        close(pipes[k]);
+
+        int status;
+        waitpid(pids[k], &status, 0);
+        if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << "worker " << k << " failed" << endl;
+            failed = true;
+            continue;
+        }
+
+        totals.matches += workerTotals.matches;
+        totals.unfinished += workerTotals.unfinished;
+        totals.steps += workerTotals.steps;
+        for (size_t i = 0; i < pool.size(); i++)
+        {
+            addStats(stats[i], workerStats[i]);
+        }
+    }
+
+    double wall = wallTime() - start;
+    float simulated = totals.steps * DT;
+
+    std::cout << "seed " << seed << ", " << totals.matches << " matches on " << workers << " workers, "
+              << totals.unfinished << " unfinished, " << simulated << " simulated seconds in "
+              << wall << " wall seconds" << endl << endl;
+
+    std::cout << std::left << std::setw(16) << "profile" << std::setw(8) << "ladder" << std::right
+              << std::setw(8) << "matches" << std::setw(8) << "win%" << std::setw(8) << "loss%"
+              << std::setw(8) << "" << std::setw(8) << "points" << std::setw(8) << "faults"
+              << std::setw(8) << "combo" << std::setw(6) << "best" << endl;
+
+    ProfileStats ladderStats[4] = { zero, zero, zero, zero };
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+        printStats(pool[i].profile->m_name, LADDERS[pool[i].ladder], stats[i]);
+        addStats(ladderStats[pool[i].ladder], stats[i]);
+    }
+    std::cout << endl;
+    for (int i = 0; i < 4; i++)
+    {
+        if (ladderStats[i].matches != 0)
+        {
+            printStats("all", LADDERS[i], ladderStats[i]);
+        }
+    }
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        for each_const(ProfilesVector, cpuProfiles[i], iter)
+        {
+            delete *iter;
+        }
+    }
+
+    systems_destroy();
+
+    return (failed ? 1 : 0);
+}
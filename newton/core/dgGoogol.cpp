@@ -67,21 +67,22 @@ dgFloat64 dgGoogol::GetAproximateValue() const
 void dgGoogol::InitFloatFloat (dgFloat64 value)
 {
 	if (m_splitter == 0.0) {
+		// build in a local so other threads never see a partial value
 		dgInt32 every_other = 1;
 		dgFloat64 check = 1.0;
 		dgFloat64 epsilon = 1.0;
 		dgFloat64 lastcheck = 0.0f;
-		m_splitter = 1.0;
+		dgFloat64 splitter = 1.0;
 		do {
 			lastcheck = check;
 			epsilon *= 0.5;
 			if (every_other) {
-				m_splitter *= 2.0;
+				splitter *= 2.0;
 			}
 			every_other = !every_other;
 			check = 1.0 + epsilon;
 		} while ((check != 1.0) && (check != lastcheck));
-		m_splitter += 1.0;
+		m_splitter = splitter + 1.0;
 	}
 
 
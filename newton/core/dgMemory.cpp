@@ -57,10 +57,12 @@ class dgGlobalAllocator: public dgMemoryAllocator, public dgList<dgMemoryAllocat
 
 	dgInt32 GetMemoryUsed () const
 	{
+		dgGlobalLock ();
 		dgInt32 mem = m_memoryUsed;
 		for (dgList<dgMemoryAllocator*>::dgListNode* node = GetFirst(); node; node = node->GetNext()) {
 			mem += node->GetInfo()->GetMemoryUsed();
 		}
+		dgGlobalUnlock ();
 		return mem;
 	}
 
@@ -79,7 +81,9 @@ dgMemoryAllocator::dgMemoryAllocator ()
 	m_emumerator = 0;
 	SetAllocatorsCallback (dgGlobalAllocator::m_globalAllocator.m_malloc, dgGlobalAllocator::m_globalAllocator.m_free);
 	memset (m_memoryDirectory, 0, sizeof (m_memoryDirectory));
+	dgGlobalLock ();
 	dgGlobalAllocator::m_globalAllocator.Append(this);
+	dgGlobalUnlock ();
 }
 
 dgMemoryAllocator::dgMemoryAllocator (dgMemAlloc memAlloc, dgMemFree memFree)
@@ -93,7 +97,9 @@ dgMemoryAllocator::dgMemoryAllocator (dgMemAlloc memAlloc, dgMemFree memFree)
 
 dgMemoryAllocator::~dgMemoryAllocator  ()
 {
+	dgGlobalLock ();
 	dgGlobalAllocator::m_globalAllocator.Remove(this);
+	dgGlobalUnlock ();
 	_ASSERTE (m_memoryUsed == 0);
 }
 
@@ -592,3 +592,44 @@ dgInt32 dgApi dgVertexListToIndexList (dgFloat32* const vertList, dgInt32 stride
 	return count;
 }
 
+
+static dgInt32 dgGlobalSpinLock = 0;
+
+void dgGlobalLock ()
+{
+	#if (defined (_WIN_32_VER) || defined (_WIN_64_VER) || defined (_MINGW_32_VER) || defined (_MINGW_64_VER))
+		while (InterlockedExchange((long*) &dgGlobalSpinLock, 1)) {
+			Sleep(0);
+		}
+	#endif
+
+	#if (defined (_LINUX_VER))
+		while(! __sync_bool_compare_and_swap((int32_t*) &dgGlobalSpinLock, 0, 1) ) {
+			sched_yield();
+		}
+	#endif
+
+	#if (defined (_MAC_VER))
+		while( ! OSAtomicCompareAndSwap32Barrier(0, 1, (int32_t*) &dgGlobalSpinLock) ) {
+			#ifndef _MAC_IPHONE
+				sched_yield();
+			#endif
+		}
+	#endif
+}
+
+void dgGlobalUnlock ()
+{
+	#if (defined (_WIN_32_VER) || defined (_WIN_64_VER) || defined (_MINGW_32_VER) || defined (_MINGW_64_VER))
+		InterlockedExchange((long*) &dgGlobalSpinLock, 0);
+	#endif
+
+	#if (defined (_LINUX_VER))
+		__sync_lock_release ((int32_t*) &dgGlobalSpinLock);
+	#endif
+
+	#if (defined (_MAC_VER))
+		OSAtomicCompareAndSwap32Barrier(1, 0, (int32_t*) &dgGlobalSpinLock);
+	#endif
+}
+
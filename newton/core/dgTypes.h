@@ -692,5 +692,9 @@ inline dgInt32 dgAtomicAdd (dgInt32* const addend, dgInt32 amount)
 	#endif
 }
 
+// process wide lock for the few tables and lists shared by all worlds
+void dgGlobalLock ();
+void dgGlobalUnlock ();
+
 #endif
 
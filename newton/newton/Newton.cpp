@@ -822,6 +822,8 @@ void NewtonDestroyAllBodies(const NewtonWorld* newtonWorld)
 	world = (Newton *) newtonWorld;
 
 //	world->RagDollList::DestroyAll();
+	NewtonSensors& sensorList = *world;
+	sensorList.DestroySensors (*world);
 	world->DestroyAllBodies ();
 }
 
@@ -1219,6 +1221,64 @@ int NewtonWorldGetBodyCount(const NewtonWorld* newtonWorld)
 	return world->GetBodiesCount();
 }
 
+// Name: NewtonWorldGetBodyStates 
+// copy the transformation matrix and the linear velocity of a group of rigid bodies in one call.
+//
+// Parameters:
+// *const NewtonWorld* *newtonWorld - is the pointer to the Newton world
+// *const NewtonBody** *bodies - array of bodies to read, or NULL to read every body in the world.
+// *int* count - number of entries in *bodies*, or the capacity of the output arrays when *bodies* is NULL.
+// *dFloat* *matrices - pointer to an array of 16 floats per body that will hold the global matrices, can be NULL.
+// *dFloat* *velocities - pointer to an array of 4 floats per body that will hold the linear velocities, can be NULL.
+// 
+// Return: number of bodies written to the output arrays.
+//
+// Remarks: the output arrays are filled contiguously in the same order as *bodies*, the fourth component of every
+// velocity is set to zero. When *bodies* is NULL the bodies are written in the order of the world body list
+// (see NewtonWorldGetFirstBody), and at most *count* bodies are written.
+//
+// Remarks: this is equivalent to calling NewtonBodyGetMatrix and NewtonBodyGetVelocity for every body, 
+// the application can use it to sync all its visual transforms once per frame.
+//
+// See also: NewtonBodyGetMatrix, NewtonBodyGetVelocity, NewtonWorldGetFirstBody
+int NewtonWorldGetBodyStates(const NewtonWorld* newtonWorld, const NewtonBody** bodies, int count, dFloat* matrices, dFloat* velocities)
+{
+	Newton* world;
+	dgInt32 index;
+	dgBodyMasterList::dgListNode *node;
+
+	TRACE_FUNTION(__FUNCTION__);
+	world = (Newton *) newtonWorld;
+	dgBodyMasterList &masterList = *world;
+
+	_ASSERTE (masterList.GetFirst()->GetInfo().GetBody() == world->GetSentinelBody());
+	node = bodies ? NULL : masterList.GetFirst()->GetNext();
+	for (index = 0; index < count; index ++) {
+		const dgBody* body;
+		if (bodies) {
+			body = (const dgBody*) bodies[index];
+		} else if (node) {
+			body = node->GetInfo().GetBody();
+			node = node->GetNext();
+		} else {
+			break;
+		}
+
+		if (matrices) {
+			dgMatrix& matrix = *((dgMatrix*) &matrices[index * 16]);
+			matrix = body->GetMatrix();
+		}
+		if (velocities) {
+			const dgVector& vector = body->GetVelocity();
+			velocities[index * 4 + 0] = vector.m_x;
+			velocities[index * 4 + 1] = vector.m_y;
+			velocities[index * 4 + 2] = vector.m_z;
+			velocities[index * 4 + 3] = dgFloat32 (0.0f);
+		}
+	}
+	return index;
+}
+
 // Name: NewtonWorldGetConstraintCount 
 // return the total number of contsting in th eworld.
 //
@@ -4823,6 +4883,91 @@ NewtonSetTransform NewtonBodyGetTransformCallback (const NewtonBody* bodyPtr)
 }
 
 
+// Name: NewtonBodySetSensor 
+// Attach a sensor volume to the body.
+//
+// Parameters:
+// *const NewtonBody* *bodyPtr - pointer to the body.
+// *const NewtonCollision* *shapePtr - convex shape of the sensor in the body local space, NULL removes the sensor.
+// *NewtonBodySensorEvent* callback - function called when a body starts (*state* = 1) or stops (*state* = 0) overlapping the sensor.
+//
+// Return: Nothing.
+//
+// Remarks: A sensor is not part of the body collision, it does not generate contacts, material callbacks or joint rows
+// and it does not change the body mass properties. After each simulation step the engine tests the sensor shape 
+// against every body in its bounding box and reports the overlap changes from the thread that called NewtonUpdate.
+//
+// Remarks: a body can have only one sensor, calling this function again replaces the shape and the callback.
+// The sensor keeps a reference to the shape, the application can release its own reference after this call.
+// When a body overlapping a sensor is destroyed no end event is reported for it. 
+// The application must not set or remove sensors from inside the *NewtonBodySensorEvent callback*.
+//
+// See also: NewtonBodySetCollision, NewtonCollisionSetAsTriggerVolume
+void NewtonBodySetSensor (const NewtonBody* bodyPtr, const NewtonCollision* shapePtr, NewtonBodySensorEvent callback)
+{
+	dgBody *body;
+	body = (dgBody *)bodyPtr;
+
+	TRACE_FUNTION(__FUNCTION__);
+	Newton* const world = (Newton *) body->GetWorld();
+	NewtonSensors& sensorList = *world;
+	sensorList.SetSensor (*world, body, (dgCollision*) shapePtr, callback);
+}
+
+
+// Name: NewtonBodyGetSensorOverlaps 
+// Get the bodies that currently overlap the sensor of a body.
+//
+// Parameters:
+// *const NewtonBody* *bodyPtr - pointer to the body with the sensor.
+// *const NewtonBody** *bodies - array receiving the overlapping bodies.
+// *int* maxCount - size of the bodies array.
+//
+// Return: number of bodies written to the array, zero if the body has no sensor.
+//
+// Remarks: The sensor reports a start event only for bodies that are not in this set, so the set is part of the 
+// simulation state. Application that saves and restores the world must restore it with NewtonBodySetSensorOverlaps.
+// The order of the bodies is not defined.
+//
+// See also: NewtonBodySetSensor, NewtonBodySetSensorOverlaps
+int NewtonBodyGetSensorOverlaps (const NewtonBody* bodyPtr, const NewtonBody** bodies, int maxCount)
+{
+	dgBody *body;
+	body = (dgBody *)bodyPtr;
+
+	TRACE_FUNTION(__FUNCTION__);
+	Newton* const world = (Newton *) body->GetWorld();
+	NewtonSensors& sensorList = *world;
+	return sensorList.GetOverlaps (body, (dgBody**) bodies, maxCount);
+}
+
+
+// Name: NewtonBodySetSensorOverlaps 
+// Replace the set of bodies that overlap the sensor of a body.
+//
+// Parameters:
+// *const NewtonBody* *bodyPtr - pointer to the body with the sensor.
+// *const NewtonBody* const* *bodies - the overlapping bodies.
+// *int* count - number of bodies.
+//
+// Return: Nothing.
+//
+// Remarks: No events are reported for the change. After the next update the sensor reports start events for new 
+// overlaps and end events for the bodies in this set that do not overlap anymore.
+//
+// See also: NewtonBodySetSensor, NewtonBodyGetSensorOverlaps
+void NewtonBodySetSensorOverlaps (const NewtonBody* bodyPtr, const NewtonBody* const* bodies, int count)
+{
+	dgBody *body;
+	body = (dgBody *)bodyPtr;
+
+	TRACE_FUNTION(__FUNCTION__);
+	Newton* const world = (Newton *) body->GetWorld();
+	NewtonSensors& sensorList = *world;
+	sensorList.SetOverlaps (body, (dgBody* const*) bodies, count);
+}
+
+
 // Name: NewtonBodySetForceAndTorqueCallback 
 // Assign an event function for applying external force and torque to a rigid body.
 //
@@ -8012,6 +8157,52 @@ dFloat NewtonJointGetStiffness(const NewtonJoint* joint)
 }
 
 
+// Name: NewtonJointGetRowForces
+// Get the reaction forces of the joint rows from the last update.
+//
+// Parameters:
+// *const NewtonJoint* *joint - pointer to the joint.
+// *dFloat* *forces - array of at least 32 floats receiving one force per joint row.
+//
+// Return: number of rows written to forces, zero for joints without rows.
+//
+// Remarks: The solver starts each update from these forces, so together with the body states they are part of the world 
+// state. Application that saves and restores the world must restore them with NewtonJointSetRowForces to get the same 
+// simulation after the restore.
+// 
+// See also: NewtonJointSetRowForces
+int NewtonJointGetRowForces(const NewtonJoint* joint, dFloat* forces)
+{
+	dgConstraint* contraint;
+
+	contraint = (dgConstraint*) joint;
+
+	TRACE_FUNTION(__FUNCTION__);
+	return contraint->GetRowForces(forces);
+}
+
+
+// Name: NewtonJointSetRowForces
+// Set the reaction forces of the joint rows used as the starting point of the next update.
+//
+// Parameters:
+// *const NewtonJoint* *joint - pointer to the joint.
+// *const dFloat* *forces - row forces, as returned by NewtonJointGetRowForces for this joint.
+//
+// Return: nothing.
+//
+// See also: NewtonJointGetRowForces
+void NewtonJointSetRowForces(const NewtonJoint* joint, const dFloat* forces)
+{
+	dgConstraint* contraint;
+
+	contraint = (dgConstraint*) joint;
+
+	TRACE_FUNTION(__FUNCTION__);
+	contraint->SetRowForces(forces);
+}
+
+
 // Name: NewtonJointSetDestructor
 // Register a destructor callback to be called when the joint is about to be destroyed.
 //
@@ -295,6 +295,7 @@ extern "C" {
 	typedef void (*NewtonBodyDestructor) (const NewtonBody* body);
 	typedef void (*NewtonApplyForceAndTorque) (const NewtonBody* body, dFloat timestep, int threadIndex);
 	typedef void (*NewtonSetTransform) (const NewtonBody* body, const dFloat* matrix, int threadIndex);
+	typedef void (*NewtonBodySensorEvent) (const NewtonBody* sensorBody, const NewtonBody* body, int state);
 
 	typedef int (*NewtonIslandUpdate) (const NewtonWorld* world, const void* islandHandle, int bodyCount);
 	typedef void (*NewtonBodyLeaveWorld) (const NewtonBody* body, int threadIndex);
@@ -396,6 +397,7 @@ extern "C" {
 	// world utility functions
 	NEWTON_API int NewtonWorldGetBodyCount(const NewtonWorld* newtonWorld);
 	NEWTON_API int NewtonWorldGetConstraintCount(const NewtonWorld* newtonWorld);
+	NEWTON_API int NewtonWorldGetBodyStates(const NewtonWorld* newtonWorld, const NewtonBody** bodies, int count, dFloat* matrices, dFloat* velocities);
 
 	// NEWTON_API int NewtonGetActiveBodiesCount();
 	// NEWTON_API int NewtonGetActiveConstraintsCount();
@@ -720,6 +722,10 @@ extern "C" {
 
 	NEWTON_API void  NewtonBodySetTransformCallback (const NewtonBody* body, NewtonSetTransform callback);
 	NEWTON_API NewtonSetTransform NewtonBodyGetTransformCallback (const NewtonBody* body);
+
+	NEWTON_API void  NewtonBodySetSensor (const NewtonBody* body, const NewtonCollision* shape, NewtonBodySensorEvent callback);
+	NEWTON_API int  NewtonBodyGetSensorOverlaps (const NewtonBody* body, const NewtonBody** bodies, int maxCount);
+	NEWTON_API void  NewtonBodySetSensorOverlaps (const NewtonBody* body, const NewtonBody* const* bodies, int count);
 	
 	NEWTON_API void  NewtonBodySetForceAndTorqueCallback (const NewtonBody* body, NewtonApplyForceAndTorque callback);
 	NEWTON_API NewtonApplyForceAndTorque NewtonBodyGetForceAndTorqueCallback (const NewtonBody* body);
@@ -789,6 +795,9 @@ extern "C" {
 	NEWTON_API dFloat NewtonJointGetStiffness (const NewtonJoint* joint);
 	NEWTON_API void NewtonJointSetStiffness (const NewtonJoint* joint, dFloat state);
 
+	NEWTON_API int NewtonJointGetRowForces (const NewtonJoint* joint, dFloat* forces);
+	NEWTON_API void NewtonJointSetRowForces (const NewtonJoint* joint, const dFloat* forces);
+
 	NEWTON_API void NewtonDestroyJoint(const NewtonWorld* newtonWorld, const NewtonJoint* joint);
 	NEWTON_API void NewtonJointSetDestructor (const NewtonJoint* joint, NewtonConstraintDestructor destructor);
 
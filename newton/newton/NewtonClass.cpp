@@ -87,10 +87,174 @@ void Newton::DefaultFreeMemory (void *ptr, dgInt32 size)
 }
 
 
+NewtonSensor::NewtonSensor (dgBody* const body, dgCollision* const shape, NewtonBodySensorEvent callback, dgMemoryAllocator* const allocator)
+	:m_overlaps(allocator)
+{
+	m_body = body;
+	m_shape = shape;
+	m_callback = callback;
+}
+
+
+NewtonSensors::NewtonSensors(dgMemoryAllocator* const allocator)
+	:dgList<NewtonSensor*>(allocator), m_began(allocator)
+{
+	m_world = NULL;
+	m_sensor = NULL;
+	m_stamp = 0;
+}
+
+void NewtonSensors::SetSensor (Newton& world, dgBody* const body, dgCollision* const shape, NewtonBodySensorEvent callback)
+{
+	dgListNode* node;
+
+	for (node = GetFirst(); node; node = node->GetNext()) {
+		if (node->GetInfo()->m_body == body) {
+			break;
+		}
+	}
+
+	if (shape) {
+		shape->AddRef();
+		if (!node) {
+			node = Append (new (world.dgWorld::GetAllocator()) NewtonSensor (body, NULL, NULL, world.dgWorld::GetAllocator()));
+		}
+		NewtonSensor* const sensor = node->GetInfo();
+		if (sensor->m_shape) {
+			world.ReleaseCollision (sensor->m_shape);
+		}
+		sensor->m_shape = shape;
+		sensor->m_callback = callback;
+	} else if (node) {
+		NewtonSensor* const sensor = node->GetInfo();
+		world.ReleaseCollision (sensor->m_shape);
+		delete sensor;
+		Remove (node);
+	}
+}
+
+// forget a body that is about to be destroyed, no end events are reported for it
+void NewtonSensors::RemoveBody (Newton& world, dgBody* const body)
+{
+	dgListNode* node;
+
+	for (node = GetFirst(); node; ) {
+		NewtonSensor* const sensor = node->GetInfo();
+		node = node->GetNext();
+		if (sensor->m_body == body) {
+			SetSensor (world, body, NULL, NULL);
+		} else {
+			sensor->m_overlaps.Remove (body);
+		}
+	}
+}
+
+void NewtonSensors::DestroySensors (Newton& world)
+{
+	while (GetFirst()) {
+		NewtonSensor* const sensor = GetFirst()->GetInfo();
+		SetSensor (world, sensor->m_body, NULL, NULL);
+	}
+}
+
+void NewtonSensors::OnBodyInAABB (dgBody* body, void* const userData)
+{
+	dgTriplex point;
+	dgTriplex normal;
+	dgFloat32 penetration;
+
+	NewtonSensors* const me = (NewtonSensors*) userData;
+	NewtonSensor* const sensor = me->m_sensor;
+	if ((body == sensor->m_body) || (body == me->m_world->GetSentinelBody())) {
+		return;
+	}
+
+	// one contact is enough to know the shapes overlap
+	if (me->m_world->Collide (sensor->m_shape, me->m_sensorMatrix, body->GetCollision(), body->GetMatrix(), &point, &normal, &penetration, 1, 0)) {
+		dgTree<dgInt32, dgBody*>::dgTreeNode* const node = sensor->m_overlaps.Find (body);
+		if (node) {
+			node->GetInfo() = me->m_stamp;
+		} else {
+			sensor->m_overlaps.Insert (me->m_stamp, body);
+			me->m_began.Append (body);
+		}
+	}
+}
+
+// bodies the sensor of body overlaps, in no particular order
+dgInt32 NewtonSensors::GetOverlaps (dgBody* const body, dgBody** const bodies, dgInt32 maxCount)
+{
+	for (dgListNode* node = GetFirst(); node; node = node->GetNext()) {
+		NewtonSensor* const sensor = node->GetInfo();
+		if (sensor->m_body == body) {
+			dgInt32 count = 0;
+			dgTree<dgInt32, dgBody*>::Iterator iter (sensor->m_overlaps);
+			for (iter.Begin(); iter && (count < maxCount); iter ++) {
+				bodies[count] = iter.GetNode()->GetKey();
+				count ++;
+			}
+			return count;
+		}
+	}
+	return 0;
+}
+
+// replaces the overlaps, no events are reported for the change
+void NewtonSensors::SetOverlaps (dgBody* const body, dgBody* const* const bodies, dgInt32 count)
+{
+	for (dgListNode* node = GetFirst(); node; node = node->GetNext()) {
+		NewtonSensor* const sensor = node->GetInfo();
+		if (sensor->m_body == body) {
+			sensor->m_overlaps.RemoveAll();
+			for (dgInt32 i = 0; i < count; i ++) {
+				sensor->m_overlaps.Insert (m_stamp, bodies[i]);
+			}
+			return;
+		}
+	}
+}
+
+// called after the world update, events are reported after the broad phase 
+// traversal so the application can move bodies from the callback
+void NewtonSensors::UpdateSensors (Newton& world)
+{
+	dgVector p0;
+	dgVector p1;
+
+	m_world = &world;
+	for (dgListNode* node = GetFirst(); node; node = node->GetNext()) {
+		NewtonSensor* const sensor = node->GetInfo();
+
+		m_stamp ++;
+		m_sensor = sensor;
+		m_sensorMatrix = sensor->m_body->GetMatrix();
+		sensor->m_shape->CalcAABB (sensor->m_shape->GetOffsetMatrix() * m_sensorMatrix, p0, p1);
+		world.ForEachBodyInAABB (p0, p1, OnBodyInAABB, this);
+
+		for (dgList<dgBody*>::dgListNode* began = m_began.GetFirst(); began; began = began->GetNext()) {
+			sensor->m_callback ((const NewtonBody*) sensor->m_body, (const NewtonBody*) began->GetInfo(), 1);
+		}
+		m_began.RemoveAll();
+
+		dgTree<dgInt32, dgBody*>::Iterator iter (sensor->m_overlaps);
+		for (iter.Begin(); iter; ) {
+			dgTree<dgInt32, dgBody*>::dgTreeNode* const overlap = iter.GetNode();
+			iter ++;
+			if (overlap->GetInfo() != m_stamp) {
+				sensor->m_callback ((const NewtonBody*) sensor->m_body, (const NewtonBody*) overlap->GetKey(), 0);
+				sensor->m_overlaps.Remove (overlap);
+			}
+		}
+	}
+	m_sensor = NULL;
+}
+
+
 Newton::Newton (dgFloat32 scale, dgMemoryAllocator* const allocator)
 	:dgWorld(allocator), 
 	 NewtonDeadBodies(allocator),
-	 NewtonDeadJoints(allocator)
+	 NewtonDeadJoints(allocator),
+	 NewtonSensors(allocator)
 {
 	m_updating = false;
 	g_maxTimeStep = dgFloat32 (1.0f/ 60.0f);
@@ -104,6 +268,9 @@ Newton::~Newton ()
 	if (m_destructor) {
 		m_destructor ((NewtonWorld*)this);
 	}
+
+	NewtonSensors& sensorList = *this;
+	sensorList.DestroySensors (*this);
 }
 
 void Newton::UpdatePhysics (dgFloat32 timestep)
@@ -111,6 +278,9 @@ void Newton::UpdatePhysics (dgFloat32 timestep)
 	m_updating = true;
 	Update (timestep);
 
+	NewtonSensors& sensorList = *this;
+	sensorList.UpdateSensors (*this);
+
 //	RagdollHeaderActiveList::UpdateMatrix();
 	m_updating = false;
 
@@ -137,6 +307,8 @@ void Newton::DestroyBody(dgBody* body)
 		NewtonDeadBodies& bodyList = *this;
 		bodyList.Insert (body, body);
 	} else {
+		NewtonSensors& sensorList = *this;
+		sensorList.RemoveBody (*this, body);
 		dgWorld::DestroyBody(body);
 	}
 }
@@ -49,10 +49,47 @@ class NewtonDeadJoints: public dgTree<dgConstraint*, void *>
 };
 
 
+class NewtonSensor
+{
+	public:
+	DG_CLASS_ALLOCATOR(allocator)
+
+	NewtonSensor (dgBody* const body, dgCollision* const shape, NewtonBodySensorEvent callback, dgMemoryAllocator* const allocator);
+
+	dgBody* m_body;
+	dgCollision* m_shape;
+	NewtonBodySensorEvent m_callback;
+	dgTree<dgInt32, dgBody*> m_overlaps;
+};
+
+
+class NewtonSensors: public dgList<NewtonSensor*>
+{
+	public: 
+	NewtonSensors(dgMemoryAllocator* const allocator);
+	void SetSensor (Newton& world, dgBody* const body, dgCollision* const shape, NewtonBodySensorEvent callback);
+	void RemoveBody (Newton& world, dgBody* const body);
+	void DestroySensors (Newton& world);
+	void UpdateSensors (Newton& world);
+	dgInt32 GetOverlaps (dgBody* const body, dgBody** const bodies, dgInt32 maxCount);
+	void SetOverlaps (dgBody* const body, dgBody* const* const bodies, dgInt32 count);
+
+	private:
+	static void OnBodyInAABB (dgBody* body, void* const userData);
+
+	Newton* m_world;
+	NewtonSensor* m_sensor;
+	dgMatrix m_sensorMatrix;
+	dgInt32 m_stamp;
+	dgList<dgBody*> m_began;
+};
+
+
 class Newton:
 	public dgWorld, 
 	public NewtonDeadBodies,
-	public NewtonDeadJoints
+	public NewtonDeadJoints,
+	public NewtonSensors
 {
 	public:
 	DG_CLASS_ALLOCATOR(allocator)
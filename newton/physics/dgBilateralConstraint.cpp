@@ -85,6 +85,19 @@ void dgBilateralConstraint::SetStiffness(dgFloat32 stiffness)
 }
 
 
+dgInt32 dgBilateralConstraint::GetRowForces(dgFloat32* const forces) const
+{
+	memcpy (forces, m_jointForce, m_maxDOF * sizeof (dgFloat32));
+	return dgInt32 (m_maxDOF);
+}
+
+
+void dgBilateralConstraint::SetRowForces(const dgFloat32* const forces)
+{
+	memcpy (m_jointForce, forces, m_maxDOF * sizeof (dgFloat32));
+}
+
+
 void dgBilateralConstraint::SetDestructorCallback (OnConstraintDestroy destructor)
 {
 	m_destructor = destructor;
@@ -41,6 +41,8 @@ class dgBilateralConstraint: public dgConstraint
 
 	virtual dgFloat32 GetStiffness() const;
 	virtual void SetStiffness(dgFloat32 stiffness);
+	virtual dgInt32 GetRowForces(dgFloat32* const forces) const;
+	virtual void SetRowForces(const dgFloat32* const forces);
 
 	void SetPivotAndPinDir(const dgVector &pivot, const dgVector &pinDirection);
 	void SetPivotAndPinDir (const dgVector& pivot, const dgVector& pinDirection0, const dgVector& pinDirection1);
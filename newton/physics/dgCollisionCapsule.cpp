@@ -55,8 +55,10 @@ dgCollisionCapsule::dgCollisionCapsule(dgWorld* const world, dgDeserialize deser
 
 dgCollisionCapsule::~dgCollisionCapsule()
 {
+	dgGlobalLock ();
 	m_shapeRefCount --;
 	_ASSERTE (m_shapeRefCount >= 0);
+	dgGlobalUnlock ();
 
 	dgCollisionConvex::m_simplex = NULL;
 	dgCollisionConvex::m_vertex = NULL;
@@ -117,6 +119,7 @@ void dgCollisionCapsule::Init (dgFloat32 radius, dgFloat32 height)
 	dgCollisionConvex::m_vertex = m_vertex;
 
 
+	dgGlobalLock ();
 	if (!m_shapeRefCount) {
 		dgPolyhedra polyhedra(m_allocator);
 		dgInt32 wireframe[DG_CAPSULE_SEGMENTS + 10];
@@ -172,6 +175,7 @@ void dgCollisionCapsule::Init (dgFloat32 radius, dgFloat32 height)
 	}
 
 	m_shapeRefCount ++;
+	dgGlobalUnlock ();
 	dgCollisionConvex::m_simplex = m_edgeArray;
 
 	SetVolumeAndCG ();
@@ -56,8 +56,10 @@ dgCollisionChamferCylinder::dgCollisionChamferCylinder(dgWorld* const world, dgD
 
 dgCollisionChamferCylinder::~dgCollisionChamferCylinder()
 {
+	dgGlobalLock ();
 	m_shapeRefCount --;
 	_ASSERTE (m_shapeRefCount >= 0);
+	dgGlobalUnlock ();
 
 	dgCollisionConvex::m_simplex = NULL;
 	dgCollisionConvex::m_vertex = NULL;
@@ -113,6 +115,7 @@ void dgCollisionChamferCylinder::Init (dgFloat32 radius, dgFloat32 height)
 	m_vertexCount = DG_CHAMFERCYLINDER_BRAKES * (DG_CHAMFERCYLINDER_SLICES + 1);
 	dgCollisionConvex::m_vertex = m_vertex;
 
+	dgGlobalLock ();
 	if (!m_shapeRefCount) {
 		dgPolyhedra polyhedra(m_allocator);
 		dgInt32 wireframe[DG_CHAMFERCYLINDER_SLICES + 10];
@@ -171,6 +174,7 @@ void dgCollisionChamferCylinder::Init (dgFloat32 radius, dgFloat32 height)
 	}
 
 	m_shapeRefCount ++;
+	dgGlobalUnlock ();
 	dgCollisionConvex::m_simplex = m_edgeArray;
 
 	SetVolumeAndCG ();
@@ -54,8 +54,10 @@ dgCollisionCone::dgCollisionCone(dgWorld* const world, dgDeserialize deserializa
 
 dgCollisionCone::~dgCollisionCone()
 {
+	dgGlobalLock ();
 	m_shapeRefCount --;
 	_ASSERTE (m_shapeRefCount >= 0);
+	dgGlobalUnlock ();
 
 	dgCollisionConvex::m_simplex = NULL;
 	dgCollisionConvex::m_vertex = NULL;
@@ -92,6 +94,7 @@ void dgCollisionCone::Init (dgFloat32 radius, dgFloat32 height)
 	m_vertexCount = DG_CONE_SEGMENTS + 1;
 	dgCollisionConvex::m_vertex = m_vertex;
 
+	dgGlobalLock ();
 	if (!m_shapeRefCount) {
 		dgPolyhedra polyhedra(m_allocator);
 		dgInt32 wireframe[DG_CONE_SEGMENTS];
@@ -135,6 +138,7 @@ void dgCollisionCone::Init (dgFloat32 radius, dgFloat32 height)
 	}
 
 	m_shapeRefCount ++;
+	dgGlobalUnlock ();
 	dgCollisionConvex::m_simplex = m_edgeArray;
 
 	SetVolumeAndCG ();
@@ -95,6 +95,18 @@ dgVector dgCollisionConvex::m_triplexMask (dgFloat32 (0.0f), dgFloat32 (0.0f), d
 dgInt32 dgCollisionConvex::m_iniliazised = 0;
 
 
+// the direction tables are shared by every world, build them once under the global lock
+void dgCollisionConvex::InitTables ()
+{
+	dgGlobalLock ();
+	if (!m_iniliazised){
+		dgWorld::InitConvexCollision ();
+		m_iniliazised = 1;
+	}
+	dgGlobalUnlock ();
+}
+
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -105,11 +117,7 @@ dgCollisionConvex::dgCollisionConvex (dgMemoryAllocator* const allocator, dgUnsi
 	m_boxOrigin (dgFloat32 (0.0f), dgFloat32 (0.0f), dgFloat32 (0.0f), dgFloat32 (1.0f))
 {
 	m_rtti |= dgConvexCollision_RTTI;
-	if (!m_iniliazised){
-		dgWorld::InitConvexCollision ();
-		m_iniliazised = 1;
-	}
-	
+	InitTables ();
 
 	m_edgeCount= 0;
 	m_vertexCount = 0;
@@ -130,10 +138,7 @@ dgCollisionConvex::dgCollisionConvex (dgWorld* const world, dgDeserialize deseri
 	:dgCollision (world, deserialization, userData)
 {
 	dgInt32 isTrigger;
-	if (!m_iniliazised){
-		dgWorld::InitConvexCollision ();
-		m_iniliazised = 1;
-	}
+	InitTables ();
 
 	m_rtti |= dgConvexCollision_RTTI;
 	m_edgeCount= 0;
@@ -133,6 +133,7 @@ class dgCollisionConvex: public dgCollision
 	static dgVector m_triplexMask;
 	static dgTriplex m_hullDirs[14]; 
 
+	static void InitTables ();
 	static dgInt32 m_iniliazised;
 	static dgInt32 m_rayCastSimplex[4][4];
 	
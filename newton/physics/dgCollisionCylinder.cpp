@@ -79,6 +79,7 @@ void dgCollisionCylinder::Init (dgFloat32 radius, dgFloat32 height)
 	m_vertexCount = DG_CYLINDER_SEGMENTS * 2;
 	dgCollisionConvex::m_vertex = m_vertex;
 
+	dgGlobalLock ();
 	if (!m_shapeRefCount) {
 		dgPolyhedra polyhedra(m_allocator);
 		dgInt32 wireframe[DG_CYLINDER_SEGMENTS];
@@ -127,6 +128,7 @@ void dgCollisionCylinder::Init (dgFloat32 radius, dgFloat32 height)
 	}
 
 	m_shapeRefCount ++;
+	dgGlobalUnlock ();
 	dgCollisionConvex::m_simplex = m_edgeArray;
 
 	SetVolumeAndCG ();
@@ -134,8 +136,10 @@ void dgCollisionCylinder::Init (dgFloat32 radius, dgFloat32 height)
 
 dgCollisionCylinder::~dgCollisionCylinder()
 {
+	dgGlobalLock ();
 	m_shapeRefCount --;
 	_ASSERTE (m_shapeRefCount >= 0);
+	dgGlobalUnlock ();
 
 	dgCollisionConvex::m_simplex = NULL;
 	dgCollisionConvex::m_vertex = NULL;
@@ -53,8 +53,10 @@ dgCollisionSphere::dgCollisionSphere(dgWorld* const world, dgDeserialize deseria
 
 dgCollisionSphere::~dgCollisionSphere()
 {
+	dgGlobalLock ();
 	m_shapeRefCount --;
 	_ASSERTE (m_shapeRefCount >= 0);
+	dgGlobalUnlock ();
 
 	dgCollisionConvex::m_simplex = NULL;
 	dgCollisionConvex::m_vertex = NULL;
@@ -70,6 +72,7 @@ void dgCollisionSphere::Init (dgFloat32 radius, dgMemoryAllocator* allocator)
 	m_vertexCount = DG_SPHERE_VERTEX_COUNT;
 	dgCollisionConvex::m_vertex = m_vertex;
 
+	dgGlobalLock ();
 	if (!m_shapeRefCount) {
 
 		//dgInt32 count;
@@ -138,6 +141,7 @@ void dgCollisionSphere::Init (dgFloat32 radius, dgMemoryAllocator* allocator)
 	}
 
 	m_shapeRefCount ++;
+	dgGlobalUnlock ();
 	dgCollisionConvex::m_simplex = m_edgeArray;
 
 	SetVolumeAndCG ();
@@ -173,6 +173,8 @@ class dgConstraint
 
 	virtual dgFloat32 GetStiffness() const;
 	virtual void SetStiffness(dgFloat32 stiffness);
+	virtual dgInt32 GetRowForces(dgFloat32* const forces) const;
+	virtual void SetRowForces(const dgFloat32* const forces);
 	virtual void GetInfo (dgConstraintInfo* const info) const;
 
 	class dgPointParam
@@ -304,6 +306,15 @@ inline void dgConstraint::SetStiffness(dgFloat32 stiffness)
 {
 }
 
+inline dgInt32 dgConstraint::GetRowForces(dgFloat32* const forces) const
+{
+	return 0;
+}
+
+inline void dgConstraint::SetRowForces(const dgFloat32* const forces)
+{
+}
+
 inline dgInt32 dgConstraint::GetMaxDOF() const
 {
 	return dgInt32 (m_maxDOF);
@@ -2176,6 +2176,8 @@ dgInt32 dgWorld::Collide (
 	count = pair.m_contactCount;
 	if (count > maxSize) {
 		count = ReduceContacts (count, contacts, maxSize, DG_REDUCE_CONTACT_TOLERANCE);
+		// ReduceContacts leaves more than one contact when maxSize is one
+		count = GetMin (count, maxSize);
 	}
 
 	for (dgInt32 i = 0; i < count; i ++) {
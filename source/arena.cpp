@@ -0,0 +1,66 @@
+#include <cstring>
+#include "arena.h"
+
+Arena::Arena(size_t blockSize) : m_current(0), m_used(0), m_blockSize(blockSize)
+{
+}
+
+Arena::~Arena()
+{
+    for each_const(vector<Block>, m_blocks, iter)
+    {
+        delete [] iter->data;
+    }
+}
+
+void* Arena::allocate(size_t size)
+{
+    size = (size + 7) & ~static_cast<size_t>(7);
+
+    while (m_current < m_blocks.size() && m_used + size > m_blocks[m_current].size)
+    {
+        m_current++;
+        m_used = 0;
+    }
+    if (m_current == m_blocks.size())
+    {
+        Block block;
+        block.size = std::max(size, m_blockSize);
+        block.data = new char [block.size];
+        m_blocks.push_back(block);
+        m_used = 0;
+    }
+
+    void* result = m_blocks[m_current].data + m_used;
+    m_used += size;
+    return result;
+}
+
+char* Arena::copy(const char* data, size_t size)
+{
+    char* result = static_cast<char*>(allocate(size + 1));
+    memcpy(result, data, size);
+    result[size] = 0;
+    return result;
+}
+
+void Arena::rewind()
+{
+    m_current = 0;
+    m_used = 0;
+}
+
+size_t Arena::size() const
+{
+    size_t result = 0;
+    for each_const(vector<Block>, m_blocks, iter)
+    {
+        result += iter->size;
+    }
+    return result;
+}
+
+size_t Arena::blocks() const
+{
+    return m_blocks.size();
+}
@@ -0,0 +1,34 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include "common.h"
+
+// Bump allocator, everything is freed at once by rewind() or when the
+// arena is destroyed. Blocks stay allocated after rewind() for reuse.
+class Arena : public NoCopy
+{
+public:
+    Arena(size_t blockSize = 16384);
+    ~Arena();
+
+    void*  allocate(size_t size);                // 8 byte aligned
+    char*  copy(const char* data, size_t size);  // terminated copy
+    void   rewind();
+
+    size_t size() const;                         // of all blocks
+    size_t blocks() const;
+
+private:
+    struct Block
+    {
+        char*  data;
+        size_t size;
+    };
+
+    vector<Block> m_blocks;
+    size_t        m_current;   // block being filled
+    size_t        m_used;      // bytes of it
+    size_t        m_blockSize;
+};
+
+#endif
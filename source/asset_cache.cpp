@@ -0,0 +1,118 @@
+#include "asset_cache.h"
+#include "file.h"
+#include "world_hash.h"
+
+template <class AssetCache> AssetCache* SharedInstance<AssetCache>::instance = NULL;
+
+AssetCache::AssetCache(size_t budget) : m_budget(budget), m_uses(0)
+{
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.evictions = 0;
+    m_stats.bytes = 0;
+}
+
+AssetCache::~AssetCache()
+{
+    clog << "Asset cache: " << m_stats.hits << " hits, " << m_stats.misses << " misses, "
+         << m_stats.evictions << " evicted, " << m_stats.bytes / 1024 << " KB cached." << endl;
+
+    for each_const(AssetMap, m_assets, iter)
+    {
+        delete iter->second;
+    }
+}
+
+unsigned int AssetCache::hashFile(const string& filename)
+{
+    File::Reader in(filename);
+    if (!in.is_open())
+    {
+        return 0;
+    }
+    return xxhash32(in.pointer(), in.size());
+}
+
+Asset* AssetCache::acquire(const string& path, unsigned int hash)
+{
+    AssetMap::iterator iter = m_assets.find(make_pair(path, hash));
+    if (iter == m_assets.end())
+    {
+        m_stats.misses++;
+        return NULL;
+    }
+
+    m_stats.hits++;
+    Asset* asset = iter->second;
+    asset->m_refs++;
+    asset->m_used = ++m_uses;
+    return asset;
+}
+
+void AssetCache::add(const string& path, unsigned int hash, Asset* asset)
+{
+    AssetMap::iterator iter = m_assets.find(make_pair(path, hash));
+    if (iter != m_assets.end())
+    {
+        Exception("Asset '" + path + "' already is cached");
+    }
+
+    m_assets.insert(make_pair(make_pair(path, hash), asset));
+    asset->m_refs = 1;
+    asset->m_used = ++m_uses;
+    m_stats.bytes += asset->size();
+
+    evict();
+}
+
+void AssetCache::release(Asset* asset)
+{
+    assert(asset->m_refs > 0);
+    asset->m_refs--;
+    if (asset->m_refs == 0)
+    {
+        evict();
+    }
+}
+
+void AssetCache::setBudget(size_t budget)
+{
+    m_budget = budget;
+    evict();
+}
+
+size_t AssetCache::getBudget() const
+{
+    return m_budget;
+}
+
+const AssetCacheStats& AssetCache::getStats() const
+{
+    return m_stats;
+}
+
+void AssetCache::evict()
+{
+    while (m_stats.bytes > m_budget)
+    {
+        // few dozen assets, a scan is cheaper than keeping a LRU list
+        AssetMap::iterator oldest = m_assets.end();
+        for (AssetMap::iterator iter = m_assets.begin(); iter != m_assets.end(); iter++)
+        {
+            if (iter->second->m_refs == 0 &&
+                (oldest == m_assets.end() || iter->second->m_used < oldest->second->m_used))
+            {
+                oldest = iter;
+            }
+        }
+        if (oldest == m_assets.end())
+        {
+            break; // all are in use
+        }
+
+        m_stats.bytes -= oldest->second->size();
+        m_stats.evictions++;
+        delete oldest->second;
+        m_assets.erase(oldest);
+    }
+}
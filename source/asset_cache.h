@@ -0,0 +1,72 @@
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+#include "common.h"
+#include "system.h"
+
+// Something built from a data file that is worth keeping when the State
+// using it goes away. Owned by AssetCache, deleted when evicted.
+class Asset : public NoCopy
+{
+    friend class AssetCache;
+
+public:
+    virtual ~Asset() {}
+
+    virtual size_t size() const = 0; // bytes, counted against the budget
+
+    int getRefs() const { return m_refs; }
+
+protected:
+    Asset() : m_refs(0), m_used(0) {}
+
+private:
+    int          m_refs;
+    unsigned int m_used; // AssetCache use count when last acquired
+};
+
+struct AssetCacheStats
+{
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    size_t       bytes; // of all cached assets, referenced or not
+};
+
+// Assets by path and content hash, so they survive Game state switches
+// and a changed file is loaded again. Unreferenced assets are kept while
+// all assets fit in the budget, least recently used are evicted first.
+// Not thread safe, headless tools create and destroy worlds under a lock.
+class AssetCache : public System<AssetCache>, public NoCopy
+{
+public:
+    AssetCache(size_t budget);
+    ~AssetCache();
+
+    // of file in data folder, 0 when it does not exist
+    static unsigned int hashFile(const string& filename);
+
+    // referenced asset, NULL when it must be loaded and add()ed
+    Asset* acquire(const string& path, unsigned int hash);
+
+    // takes ownership of just loaded asset, it is referenced once
+    void add(const string& path, unsigned int hash, Asset* asset);
+
+    void release(Asset* asset);
+
+    void   setBudget(size_t budget);
+    size_t getBudget() const;
+    const AssetCacheStats& getStats() const;
+
+private:
+    typedef map<pair<string, unsigned int>, Asset*> AssetMap;
+
+    AssetMap        m_assets;
+    size_t          m_budget;
+    unsigned int    m_uses;
+    AssetCacheStats m_stats;
+
+    void evict();
+};
+
+#endif
@@ -6,7 +6,7 @@
 #include "sound_buffer.h"
 #include "sound.h"
 
-template <class Audio> Audio* System<Audio>::instance = NULL;
+template <class Audio> Audio* SharedInstance<Audio>::instance = NULL;
 
 static ALCdevice* device;
 static ALCcontext* context;
@@ -69,37 +69,49 @@ Audio::~Audio()
 
 Music* Audio::loadMusic(const string& filename)
 {
-    return *m_music.insert(new Music(filename)).first;
+    string path = "/data/music/" + filename + ".ogg";
+    unsigned int hash = AssetCache::hashFile(path);
+    Music* music = static_cast<Music*>(AssetCache::instance->acquire(path, hash));
+    if (music == NULL)
+    {
+        music = new Music(filename);
+        AssetCache::instance->add(path, hash, music);
+    }
+    else if (music->getRefs() == 1)
+    {
+        music->rewind();
+    }
+    return *m_music.insert(music).first;
 }
 
 void Audio::unloadMusic(Music* music)
 {
-    m_music.erase(music);
-    delete music;
+    // several worlds can play the same one
+    if (music->getRefs() == 1)
+    {
+        music->stop();
+        m_music.erase(music);
+    }
+    AssetCache::instance->release(music);
 }
 
 SoundBuffer* Audio::loadSound(const string& filename)
 {
-    SoundBufferMap::iterator iter = m_soundBuf.find(filename);
-    if (iter != m_soundBuf.end())
+    // buffers are shared, several worlds can hold the same one
+    string path = "/data/sound/" + filename + ".ogg";
+    unsigned int hash = AssetCache::hashFile(path);
+    SoundBuffer* soundBuf = static_cast<SoundBuffer*>(AssetCache::instance->acquire(path, hash));
+    if (soundBuf == NULL)
     {
-        return iter->second;
+        soundBuf = new SoundBuffer(filename);
+        AssetCache::instance->add(path, hash, soundBuf);
     }
-
-    return m_soundBuf.insert(make_pair(filename, new SoundBuffer(filename))).first->second;
+    return soundBuf;
 }
 
 void Audio::unloadSound(SoundBuffer* soundBuf)
 {
-    for each_(SoundBufferMap, m_soundBuf, iter)
-    {
-        if (iter->second == soundBuf)
-        {
-            delete iter->second;
-            m_soundBuf.erase(iter);
-            break;
-        }
-    }
+    AssetCache::instance->release(soundBuf);
 }
 
 void Audio::update()
@@ -15,7 +15,6 @@ class Sound;
 class SoundBuffer;
 
 typedef set<Music*> MusicSet;
-typedef map<string, SoundBuffer*> SoundBufferMap;
 
 class Audio : public System<Audio>, public NoCopy
 {
@@ -38,7 +37,6 @@ private:
     ALCcontext*   m_context;
 
     MusicSet       m_music;
-    SoundBufferMap m_soundBuf;
 };
 
 #endif
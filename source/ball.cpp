@@ -4,21 +4,11 @@
 #include "referee_local.h"
 #include "collision.h"
 #include "world.h"
+#include "level.h"
+#include "world_state.h"
 #include "video.h"
 #include "geometry.h"
 
-TriggerFlags::TriggerFlags()
-{
-    loadDefaults();
-}
-
-void TriggerFlags::loadDefaults()
-{
-    m_wasTriggeredBefore = false;
-    m_shouldRegisterCollision = false;
-    m_hasTriggered = false;
-}
-
 Ball::Ball(Body* body, const Collision* levelCollision) :
     m_referee(NULL),
     m_body(body),
@@ -27,24 +17,22 @@ Ball::Ball(Body* body, const Collision* levelCollision) :
     m_body->setCollideable(this);
     setPosition0();
 
-    NewtonCollision* ballCollision = (*m_body->m_collisions.begin())->m_newtonCollision;
-
+    // sensor only reports overlaps, it adds no contacts to the ball
     static const float t = 1.4f; // 40%
-    NewtonCollision* hull = NewtonCreateConvexHullModifier(World::instance->m_newtonWorld, ballCollision, 0);
-    NewtonConvexHullModifierSetMatrix(hull, Matrix::scale(Vector(t, t, t)).m);
-    //NewtonCollision* hull = NewtonCreateSphere(World::instance->m_newtonWorld, t, t, t, 0, NULL);
-
-    // TODO: get invisible id (1) from real m_properties
-    NewtonCollisionSetUserID(hull, 1); // m_properties->getInvisible()
-
-    NewtonCollision* both[] = { ballCollision, hull };
-    NewtonCollision* newCollision = NewtonCreateCompoundCollision(World::instance->m_newtonWorld, sizeOfArray(both), both, 0);
-    NewtonCollisionSetUserID(newCollision, NewtonCollisionGetUserID(ballCollision));
-    NewtonBodySetCollision(m_body->m_newtonBody, newCollision);
+    const float r = t * (*m_body->m_collisions.begin())->getRadius();
+    NewtonCollision* sensor = NewtonCreateSphere(World::instance->m_newtonWorld, r, r, r, 0, NULL);
+    NewtonBodySetSensor(m_body->m_newtonBody, sensor, onSensor);
+    NewtonReleaseCollision(World::instance->m_newtonWorld, sensor);
+}
 
-    // TODO: hmm?
-    //NewtonReleaseCollision(hull);
-    //NewtonReleaseCollision(newCollision);
+void Ball::onSensor(const NewtonBody* sensorBody, const NewtonBody* body, int state)
+{
+    if (state == 1)
+    {
+        Body* self = static_cast<Body*>(NewtonBodyGetUserData(sensorBody));
+        const Body* other = static_cast<const Body*>(NewtonBodyGetUserData(body));
+        self->onCollideHull(other);
+    }
 }
 
 Vector Ball::getPosition() const
@@ -64,7 +52,7 @@ void Ball::setPosition0()
 
 void Ball::addBodyToFilter(const Body* body)
 {
-    m_filteredBodies[body] = TriggerFlags();
+    m_filteredBodies.insert(body);
 }
 
 void Ball::onCollide(const Body* other, const Vector& position, float speed)
@@ -82,48 +70,53 @@ void Ball::onCollide(const Body* other, const Vector& position, float speed)
 
 void Ball::onCollideHull(const Body* other)
 {
-    // when trigger collides
+    // sensor has just started to overlap the body
     if (foundIn(m_filteredBodies, other))
     {
-        //for bodies in filter map
-        TriggerFlags& triggerFlags = m_filteredBodies[other];
-        triggerFlags.m_hasTriggered = true;
-        if (!triggerFlags.m_wasTriggeredBefore)
-        {
-            //if trigger has just collided with the opposing body
-            triggerFlags.m_shouldRegisterCollision = true;
-            triggerFlags.m_wasTriggeredBefore = true;
-        }
+        m_triggered.push_back(other);
     }
 }
 
-void Ball::triggerBegin()
+void Ball::processTriggers()
 {
-    for each_(TriggerFilterMap, m_filteredBodies, iter)
+    // called after Properties::processEvents, so contacts reach the referee first
+    for each_const(TriggeredBodies, m_triggered, iter)
     {
-        iter->second.m_hasTriggered = false;
+        m_referee->process(m_body, *iter);
     }
+    m_triggered.clear();
 }
 
-void Ball::triggerEnd()
+void Ball::saveState(WorldState& state) const
 {
-    // body is in m_filteredBodies set
-    for each_(TriggerFilterMap, m_filteredBodies, iter)
+    const Level* level = World::instance->m_level;
+    vector<const NewtonBody*> bodies(level->m_bodies.size());
+    int count = NewtonBodyGetSensorOverlaps(m_body->m_newtonBody, &bodies[0], static_cast<int>(bodies.size()));
+
+    // Newton keeps them in pointer order, states must not depend on it
+    IntVector indices(count);
+    for (int i = 0; i < count; i++)
     {
-        TriggerFlags& triggerFlags = iter->second;
-        if (!triggerFlags.m_hasTriggered)
-        {
-            triggerFlags.loadDefaults();
-        }
-        else
-        {
-            if (triggerFlags.m_shouldRegisterCollision)
-            {
-                m_referee->process(m_body, iter->first);
-                triggerFlags.m_shouldRegisterCollision = false;
-            }
-        }
+        indices[i] = level->getBodyIndex(static_cast<const Body*>(NewtonBodyGetUserData(bodies[i])));
+    }
+    std::sort(indices.begin(), indices.end());
+
+    state.write(count);
+    for each_const(IntVector, indices, iter)
+    {
+        state.write(*iter);
+    }
+}
+
+void Ball::loadState(WorldState& state)
+{
+    const Level* level = World::instance->m_level;
+    vector<const NewtonBody*> bodies(state.readInt());
+    for (size_t i = 0; i < bodies.size(); i++)
+    {
+        bodies[i] = level->getBodyByIndex(state.readInt())->m_newtonBody;
     }
+    NewtonBodySetSensorOverlaps(m_body->m_newtonBody, bodies.empty() ? NULL : &bodies[0], static_cast<int>(bodies.size()));
 }
 
 void Ball::renderShadow(const Vector& lightPosition) const
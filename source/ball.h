@@ -6,18 +6,10 @@
 
 class RefereeLocal;
 class Collision;
+class WorldState;
 
-struct TriggerFlags
-{
-    TriggerFlags();
-    void loadDefaults();
-
-    bool m_wasTriggeredBefore;
-    bool m_shouldRegisterCollision;
-    bool m_hasTriggered;
-};
-
-typedef map<const Body*, TriggerFlags> TriggerFilterMap;
+typedef set<const Body*>    TriggerFilterSet;
+typedef vector<const Body*> TriggeredBodies;
 
 static const float BALL_RADIUS = 0.2f;
 
@@ -34,19 +26,25 @@ public:
     // maybe private
     void onCollide(const Body* other, const Vector& position, float speed);
     void onCollideHull(const Body* other);
-    void triggerBegin();
-    void triggerEnd();
+    void processTriggers();
     void addBodyToFilter(const Body* body);
 
+    // bodies already inside the sensor, see WorldState
+    void saveState(WorldState& state) const;
+    void loadState(WorldState& state);
+
     void renderShadow(const Vector& lightPosition) const;
 
     RefereeLocal*            m_referee;
     Body*               m_body;
 
 private:
-    TriggerFilterMap m_filteredBodies;
+    TriggerFilterSet m_filteredBodies;
+    TriggeredBodies  m_triggered;
     
     const Collision* m_levelCollision;
+
+    static void onSensor(const NewtonBody* sensorBody, const NewtonBody* body, int state);
 };
 
 #endif
@@ -0,0 +1,36 @@
+#include <Newton.h>
+
+#include "ball_prediction.h"
+#include "ball.h"
+#include "body.h"
+#include "player.h"
+#include "geometry.h"
+
+BallPrediction::BallPrediction(const Ball* ball, const vector<Player*>& players) :
+    m_ball(ball),
+    m_players(players)
+{
+}
+
+void BallPrediction::update()
+{
+    const Vector position = m_ball->m_body->getPosition();
+
+    // from Newton, not synced cache
+    Vector velocity;
+    NewtonBodyGetVelocity(m_ball->m_body->m_newtonBody, velocity.v);
+
+    for each_const(vector<Player*>, m_players, iter)
+    {
+        const Player* player = *iter;
+        unsigned int quadrant = getQuadrant(player->getFieldCenter());
+        m_entries[quadrant - 1] = findBallAndSquareIntersection(
+            position, velocity, player->m_lowerLeft, player->m_upperRight);
+    }
+}
+
+const Vector& BallPrediction::getSquareEntry(unsigned int quadrant) const
+{
+    assert(quadrant >= 1 && quadrant <= 4);
+    return m_entries[quadrant - 1];
+}
@@ -0,0 +1,31 @@
+#ifndef __BALL_PREDICTION_H__
+#define __BALL_PREDICTION_H__
+
+#include "common.h"
+#include "vmath.h"
+
+class Ball;
+class Player;
+
+// Ball prediction shared by all AI players, World updates it once per
+// tick before players control.
+class BallPrediction : public NoCopy
+{
+public:
+    BallPrediction(const Ball* ball, const vector<Player*>& players);
+
+    void update();
+
+    // where straight path crosses into square of quadrant 1..4 (see
+    // getQuadrant), center of square if it does not,
+    // see findBallAndSquareIntersection
+    const Vector& getSquareEntry(unsigned int quadrant) const;
+
+private:
+    const Ball*            m_ball;
+    const vector<Player*>& m_players;
+
+    Vector                 m_entries[4];
+};
+
+#endif
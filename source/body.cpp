@@ -1,14 +1,21 @@
 #include "body.h"
 #include "collision.h"
 #include "game.h"
-#include "xml.h"
+#include "level_format.h"
 #include "world.h"
 #include "level.h"
 #include "properties.h"
 #include "geometry.h"
+#include "world_state.h"
+
+bool CollisionOrder::operator () (const Collision* a, const Collision* b) const
+{
+    return a->m_id < b->m_id;
+}
 
 Body::Body(const string& id, const Level* level, const CollisionSet& collisions):
     m_id(id),
+    m_handle(-1),
     m_newtonBody(NULL),
     m_matrix(),
     m_collisions(collisions),
@@ -19,51 +26,37 @@ Body::Body(const string& id, const Level* level, const CollisionSet& collisions)
     m_collideable(NULL),
     m_velocity(),
     m_kickForce(),
-    m_level(level)
+    m_level(level),
+    m_dirty(false)
 {
     createNewtonBody(Vector::Zero, Vector::Zero);
 }    
 
-Body::Body(const XMLnode& node, const Level* level):
-    m_id(""),
+Body::Body(const BodyRecord& record, const LevelRecords& records, const Level* level):
+    m_id(records.data.getString(record.id)),
+    m_handle(-1),
     m_newtonBody(NULL),
     m_matrix(),
     m_collisions(),
-    m_soundable(false),
-    m_important(false),
+    m_soundable(record.soundable != 0),
+    m_important(record.important != 0),
     m_totalMass(0.0f),
     m_totalInertia(),
     m_collideable(NULL),
     m_velocity(),
     m_kickForce(),
-    m_level(level)
+    m_level(level),
+    m_dirty(false)
 {
-    m_id = node.getAttribute("id");
-    m_soundable = node.getAttribute<int>("soundable", 0) == 1;
-    m_important = node.getAttribute<int>("important", 0) == 1;
-    
-    Vector position(0.0f, 0.0f, 0.0f);
-    Vector rotation(0.0f, 0.0f, 0.0f);
-
-    for each_const(XMLnodes, node.childs, iter)
+    const LevelHeader& header = records.data.header();
+    for (unsigned int i = 0; i < record.collisions.count; i++)
     {
-        const XMLnode& node = *iter;
-        if (node.name == "position")
+        unsigned int index = records.data.get<unsigned int>(header.bodyCollisions, record.collisions, i);
+        if (index >= records.collisions.size())
         {
-            position = node.getAttributesInVector("xyz");
-        }
-        else if (node.name == "rotation")
-        {
-            rotation = node.getAttributesInVector("xyz") * DEG_IN_RAD;
-        }
-        else if (node.name == "collision")
-        { 
-            m_collisions.insert(World::instance->m_level->getCollision(node.value));
-        }
-        else
-        {
-            Exception("Invalid body, unknown node - " + node.name);
+            Exception("Invalid compiled level, collision index out of range");
         }
+        m_collisions.insert(records.collisions[index]);
     }
 
     if (m_collisions.size() == 0)
@@ -71,7 +64,7 @@ Body::Body(const XMLnode& node, const Level* level):
         Exception("No collisions were found for body '" + m_id + "'");
     }
 
-    createNewtonBody(position, rotation);
+    createNewtonBody(Vector(record.position), Vector(record.rotation) * DEG_IN_RAD);
 }
 
 void Body::setKickForce(const Vector& force)
@@ -79,9 +72,41 @@ void Body::setKickForce(const Vector& force)
     m_kickForce = force;
 }
 
+void Body::saveState(WorldState& state) const
+{
+    Matrix matrix;
+    Vector velocity;
+    Vector omega;
+    NewtonBodyGetMatrix(m_newtonBody, matrix.m);
+    NewtonBodyGetVelocity(m_newtonBody, velocity.v);
+    NewtonBodyGetOmega(m_newtonBody, omega.v);
+
+    state.write(matrix);
+    state.write(velocity);
+    state.write(omega);
+    state.write(NewtonBodyGetFreezeState(m_newtonBody));
+    state.write(m_kickForce);
+}
+
+void Body::loadState(WorldState& state)
+{
+    Matrix matrix = state.readMatrix();
+    Vector velocity = state.readVector();
+    Vector omega = state.readVector();
+    int freeze = state.readInt();
+    m_kickForce = state.readVector();
+
+    NewtonBodySetMatrix(m_newtonBody, matrix.m);
+    NewtonBodySetVelocity(m_newtonBody, velocity.v);
+    NewtonBodySetOmega(m_newtonBody, omega.v);
+    NewtonBodySetFreezeState(m_newtonBody, freeze);
+    World::instance->m_level->markDirty(this);
+}
+
 void Body::setMatrix(const Matrix& matrix)
 {
     NewtonBodySetMatrix(m_newtonBody, matrix.m);
+    World::instance->m_level->markDirty(this);
 }
 
 void Body::setTransform(const Vector& position, const Vector& rotation)
@@ -90,6 +115,7 @@ void Body::setTransform(const Vector& position, const Vector& rotation)
     m_matrix = Matrix::translate(position) * m_matrix;
             
     NewtonBodySetMatrix(m_newtonBody, m_matrix.m);
+    World::instance->m_level->markDirty(this);
 }
 
 void Body::createNewtonBody(const Vector&          position,
@@ -146,6 +172,7 @@ void Body::createNewtonBody(const Vector&          position,
         NewtonBodySetCentreOfMass(m_newtonBody, totalOrigin.v);
         NewtonBodySetAutoSleep(m_newtonBody, 0);
         NewtonBodySetForceAndTorqueCallback(m_newtonBody, onSetForceAndTorque);
+        NewtonBodySetTransformCallback(m_newtonBody, onSetTransform);
     }
 
     // danger - ball depends on newtonCollision variable
@@ -164,12 +191,6 @@ Body::~Body()
     */
 }
 
-void Body::prepare()
-{
-    NewtonBodyGetMatrix(m_newtonBody, m_matrix.m);
-    NewtonBodyGetVelocity(m_newtonBody, m_velocity.v);
-}
-
 Vector Body::getPosition() const
 {
     return m_matrix.row(3);
@@ -212,6 +233,15 @@ void Body::onSetForceAndTorque(const NewtonBody* body, dFloat timestep, int thre
     self->onSetForceAndTorque(timestep);
 }
 
+void Body::onSetTransform(const NewtonBody* body, const dFloat* matrix, int threadIndex)
+{
+    // dirty list is not locked, World runs Newton on one thread
+    assert(NewtonGetThreadsCount(NewtonBodyGetWorld(body)) == 1);
+
+    Body* self = static_cast<Body*>(NewtonBodyGetUserData(body));
+    World::instance->m_level->markDirty(self);
+}
+
 void Body::render() const
 {
     Video::instance->begin(m_matrix);
@@ -229,7 +259,7 @@ void Body::setCollideable(Collideable* collideable)
     m_collideable = collideable;
 }
 
-bool Body::isMovable()
+bool Body::isMovable() const
 {
     return (m_totalMass != 0);
 }
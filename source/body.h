@@ -8,10 +8,19 @@
 
 class Collision;
 class Level;
-class XMLnode;
+struct BodyRecord;
+struct LevelRecords;
 class Body;
+class WorldState;
 
-typedef set<const Collision*> CollisionSet;
+// by id and not by address, so compound bodies are built the same way
+// no matter where collisions were allocated
+struct CollisionOrder
+{
+    bool operator () (const Collision* a, const Collision* b) const;
+};
+
+typedef set<const Collision*, CollisionOrder> CollisionSet;
 
 class Collideable : public NoCopy
 {
@@ -29,13 +38,15 @@ class Body : public Collideable
     friend class Level;
 
 public:
-    void prepare();
     void render() const;
     
     void setTransform(const Vector& position, const Vector& rotation);
     void setMatrix(const Matrix& matrix);
     void setKickForce(const Vector& force);
 
+    void saveState(WorldState& state) const;
+    void loadState(WorldState& state);
+
     Vector getPosition() const;
     Vector getRotation() const;
     Vector getVelocity() const;
@@ -48,9 +59,10 @@ public:
     void onCollide(const Body* other, const Vector& position, float speed);
     void onCollideHull(const Body* other);
 
-    bool isMovable();
+    bool isMovable() const;
 
     string              m_id;
+    int                 m_handle; // Level::addBody, -1 before
     NewtonBody*         m_newtonBody;
     Matrix              m_matrix;
     CollisionSet        m_collisions;
@@ -63,7 +75,7 @@ public:
 
 protected:
 
-    Body(const XMLnode& node, const Level* level);
+    Body(const BodyRecord& record, const LevelRecords& records, const Level* level);
 
     void createNewtonBody(const Vector& position,
                           const Vector& rotation);
@@ -76,9 +88,11 @@ private:
     Vector       m_velocity;
     Vector       m_kickForce;
     const Level* m_level;
+    bool         m_dirty;
 
     void onSetForceAndTorque(float timestep);
     static void onSetForceAndTorque(const NewtonBody* body, float timestep, int threadIndex);
+    static void onSetTransform(const NewtonBody* body, const dFloat* matrix, int threadIndex);
 };
 
 #endif
@@ -1,5 +1,6 @@
+#include <cstring>
 #include "collision.h"
-#include "xml.h"
+#include "level_format.h"
 #include "material.h"
 #include "level.h"
 #include "property.h"
@@ -11,13 +12,17 @@
 #include "input.h"
 #include "mesh.h"
 #include "video.h"
+#include "asset_cache.h"
+#include "world_hash.h"
+#include "task_pool.h"
 
 class CollisionConvex : public Collision
 {
 protected:
-    CollisionConvex(const XMLnode& node, const Level* level);
+    CollisionConvex(const CollisionRecord& record, const LevelRecords& records);
     ~CollisionConvex();
     void render() const;
+    const Material* getMaterial() const { return m_material; }
 
     Material* m_material;
     Mesh* m_mesh;
@@ -30,7 +35,7 @@ protected:
 class CollisionBox : public CollisionConvex
 {
 public:
-    CollisionBox(const XMLnode& node, const Level* level);
+    CollisionBox(const CollisionRecord& record, const LevelRecords& records);
 
     Vector m_size;      // (1.0f, 1.0f, 1.0f)
 };
@@ -38,7 +43,7 @@ public:
 class CollisionSphere : public CollisionConvex
 {
 public:
-    CollisionSphere(const XMLnode& node, const Level* level);
+    CollisionSphere(const CollisionRecord& record, const LevelRecords& records);
 
     float getRadius() const { return m_radius.x; }
 
@@ -48,7 +53,7 @@ public:
 class CollisionCylinder : public CollisionConvex
 {
 public:
-    CollisionCylinder(const XMLnode& node, const Level* level);
+    CollisionCylinder(const CollisionRecord& record, const LevelRecords& records);
 
     float m_radius;      // 1.0f
     float m_height;      // 1.0f
@@ -57,49 +62,232 @@ public:
 class CollisionCone : public CollisionConvex
 {
 public:
-    CollisionCone(const XMLnode& node, const Level* level);
+    CollisionCone(const CollisionRecord& record, const LevelRecords& records);
 
     float m_radius;      // 1.0f
     float m_height;      // 1.0f
 };
 
+// faces of a tree collision and its Newton tree, shared like Heightmap
+class TreeMesh : public Asset
+{
+public:
+    NewtonCollision* build(const CollisionRecord& record, const CompiledLevel& data, const vector<int>& props, const NewtonWorld* world);
+    NewtonCollision* createTree(const NewtonWorld* world) const;
+
+    size_t size() const;
+
+    FaceVector   m_faces;
+    vector<char> m_tree; // NewtonCollisionSerialize
+};
+
 class CollisionTree : public Collision
 {
 public:
-    CollisionTree(const XMLnode& node, Level* level);
+    CollisionTree(const CollisionRecord& record, const LevelRecords& records);
     ~CollisionTree();
 
     void render() const;
+    const Material* getMaterial() const { return m_materials.empty() ? NULL : m_materials[0]; }
 
     vector<Material*> m_materials;
-    FaceVector        m_faces;
+    TreeMesh*         m_mesh;
 };
 
-class CollisionHMap : public Collision
+// heightmap geometry and its Newton tree, built once and shared by every
+// world loading the same heightmap, tree is copied into each NewtonWorld
+class Heightmap : public Asset
 {
 public:
-    CollisionHMap(const XMLnode& node, Level* level);
-    ~CollisionHMap();
-    
-    void render() const;
-    float getHeight(float x, float y) const;
+    Heightmap() : m_width(0), m_height(0), m_realCount(0) {}
+
+    NewtonCollision* build(const string& filename, float size, float repeat, int id, const NewtonWorld* world);
+    NewtonCollision* createTree(const NewtonWorld* world) const;
+
+    size_t size() const;
 
-private:
     int                    m_width;
     int                    m_height;
-    float                  m_size;
 
     FaceVector             m_faces;
     vector<unsigned short> m_indices;
     
     int                    m_realCount;
 
+    vector<char>           m_tree; // NewtonCollisionSerialize
+};
+
+class CollisionHMap : public Collision
+{
+public:
+    CollisionHMap(const CollisionRecord& record, const LevelRecords& records, Level* level);
+    ~CollisionHMap();
+    
+    void render() const;
+    const Material* getMaterial() const { return m_material; }
+    float getHeight(float x, float y) const;
+
+private:
+    float        m_size;
+    Heightmap*   m_heightmap;
+
     Material*    m_material;
     unsigned int m_buffers[2];
 };
 
-Collision::Collision(const XMLnode& node) :
+static void serializeTree(void* handle, const void* buffer, int size)
+{
+    vector<char>* tree = static_cast<vector<char>*>(handle);
+    const char* data = static_cast<const char*>(buffer);
+    tree->insert(tree->end(), data, data + size);
+}
+
+static void deserializeTree(void* handle, void* buffer, int size)
+{
+    const char** data = static_cast<const char**>(handle);
+    memcpy(buffer, *data, size);
+    *data += size;
+}
+
+// AssetCache keys, the geometry and tree depend on all of these
+
+static unsigned int treeKey(const CollisionRecord& record, const LevelRecords& records, vector<int>& props, string& path)
+{
+    const LevelHeader& header = records.data.header();
+    unsigned int hash = 0;
+    props.clear();
+    for (unsigned int f = 0; f < record.faces.count; f++)
+    {
+        const FaceRecord& face = records.data.get<FaceRecord>(header.faces, record.faces, f);
+        props.push_back(records.getPropertyID(face.property));
+        hash = xxhash32(face.vertices, sizeof(face.vertices), hash);
+    }
+    if (!props.empty())
+    {
+        hash = xxhash32(&props[0], props.size() * sizeof(int), hash);
+    }
+    path = "/tree/" + string(records.data.getString(record.id));
+    return hash;
+}
+
+static unsigned int heightmapKey(const CollisionRecord& record, const LevelRecords& records, int id, string& filename)
+{
+    filename = "/data/heightmaps/" + string(records.data.getString(record.heightmap)) + ".img";
+    const float params[] = { record.size[0], record.size[1], static_cast<float>(id) };
+    return xxhash32(params, sizeof(params), AssetCache::hashFile(filename));
+}
+
+// Newton allocators belong to a world and are not thread safe, so every
+// tree is built in a world of its own and kept serialized
+class TreeBuild : public Task
+{
+public:
+    TreeBuild(const string& path, unsigned int hash) :
+        m_path(path), m_hash(hash), m_record(NULL), m_data(NULL), m_mesh(NULL), m_heightmap(NULL), m_id(0) {}
+
+    void run()
+    {
+        NewtonWorld* world = NewtonCreate();
+        NewtonSetPlatformArchitecture(world, 0); // as World's
+        NewtonCollision* collision;
+        if (m_mesh != NULL)
+        {
+            collision = m_mesh->build(*m_record, *m_data, m_props, world);
+        }
+        else
+        {
+            collision = m_heightmap->build(m_path, m_record->size[0], m_record->size[1], m_id, world);
+        }
+        NewtonReleaseCollision(world, collision);
+        NewtonDestroy(world);
+    }
+
+    Asset* asset() const { return m_mesh != NULL ? static_cast<Asset*>(m_mesh) : m_heightmap; }
+
+    string                 m_path;
+    unsigned int           m_hash;
+    const CollisionRecord* m_record;
+    const CompiledLevel*   m_data;
+
+    TreeMesh*              m_mesh;      // tree
+    vector<int>            m_props;
+
+    Heightmap*             m_heightmap; // or heightmap
+    int                    m_id;
+};
+
+void Collision::prebuild(const LevelRecords& records, Level* level, vector<Asset*>& assets)
+{
+    const LevelHeader& header = records.data.header();
+    set<pair<string, unsigned int> > keys;
+    vector<TreeBuild*> builds;
+    for (unsigned int i = 0; i < header.collisions.count; i++)
+    {
+        const CollisionRecord& record = records.data.get<CollisionRecord>(header.collisions, i);
+        vector<int> props;
+        string path;
+        unsigned int hash;
+        int id = 0;
+        if (record.type == COLLISION_TREE)
+        {
+            hash = treeKey(record, records, props, path);
+        }
+        else if (record.type == COLLISION_HEIGHTMAP && record.material != NO_INDEX)
+        {
+            // the same property registration CollisionHMap makes
+            id = level->m_properties->getPropertyID("grass");
+            hash = heightmapKey(record, records, id, path);
+        }
+        else
+        {
+            continue;
+        }
+        if (!keys.insert(make_pair(path, hash)).second)
+        {
+            continue;
+        }
+
+        Asset* asset = AssetCache::instance->acquire(path, hash);
+        if (asset != NULL)
+        {
+            assets.push_back(asset);
+            continue;
+        }
+
+        TreeBuild* build = new TreeBuild(path, hash);
+        build->m_record = &record;
+        build->m_data = &records.data;
+        if (record.type == COLLISION_TREE)
+        {
+            build->m_mesh = new TreeMesh();
+            build->m_props = props;
+        }
+        else
+        {
+            build->m_heightmap = new Heightmap();
+            build->m_id = id;
+        }
+        builds.push_back(build);
+    }
+
+    TaskPool pool(builds.size() > 1 ? TaskPool::defaultThreads() : 0);
+    for each_const(vector<TreeBuild*>, builds, iter)
+    {
+        pool.add(*iter);
+    }
+    pool.wait();
+
+    for each_const(vector<TreeBuild*>, builds, iter)
+    {
+        AssetCache::instance->add((*iter)->m_path, (*iter)->m_hash, (*iter)->asset());
+        assets.push_back((*iter)->asset());
+        delete *iter;
+    }
+}
+
+Collision::Collision(const string& id) :
     m_newtonCollision(NULL),
+    m_id(id),
     m_origin(),
     m_inertia(),
     m_mass(0.0f)
@@ -133,91 +321,41 @@ void Collision::create(NewtonCollision* collision, int propertyID, float mass)
     m_origin *= mass;
 }
 
-Collision* Collision::create(const XMLnode& node, Level* level)
+Collision* Collision::create(const CollisionRecord& record, const LevelRecords& records, Level* level)
 {
-    string type = node.getAttribute("type");
-    
-    if (type == "box")
-    {
-        return new CollisionBox(node, level);
-    }    
-    else if (type == "sphere")
-    {
-        return new CollisionSphere(node, level);
-    }
-    else if (type == "cylinder")
-    {
-        return new CollisionCylinder(node, level);
-    }
-    else if (type == "cone")
+    switch (record.type)
     {
-        return new CollisionCone(node, level);
-    }
-    else if (type == "tree")
-    {
-        return new CollisionTree(node, level);
-    }
-    else if (type == "heightmap")
-    {
-        return new CollisionHMap(node, level);
-    }
-    else
-    {
-        Exception("Unknown collision type - " + type);
+    case COLLISION_BOX:
+        return new CollisionBox(record, records);
+    case COLLISION_SPHERE:
+        return new CollisionSphere(record, records);
+    case COLLISION_CYLINDER:
+        return new CollisionCylinder(record, records);
+    case COLLISION_CONE:
+        return new CollisionCone(record, records);
+    case COLLISION_TREE:
+        return new CollisionTree(record, records);
+    case COLLISION_HEIGHTMAP:
+        return new CollisionHMap(record, records, level);
+    default:
+        Exception("Unknown collision type - " + cast<string>(record.type));
         return 0;
     }
 }
 
-CollisionConvex::CollisionConvex(const XMLnode& node, const Level* level) :
-    Collision(node),
-    m_material(NULL),
-    m_hasOffset(false),
+CollisionConvex::CollisionConvex(const CollisionRecord& record, const LevelRecords& records) :
+    Collision(records.data.getString(record.id)),
+    m_material(records.getMaterial(record.material)),
+    m_hasOffset(record.hasOffset != 0),
     m_matrix(),
-    m_propertyID(0),
+    m_propertyID(records.getPropertyID(record.property)),
     m_mesh(NULL)
 {
-    Vector offset(0.0f, 0.0f, 0.0f);
-    Vector rotation(0.0f, 0.0f, 0.0f);
-
-    if (node.hasAttribute("property"))
-    {
-        m_propertyID = level->m_properties->getPropertyID(node.getAttribute("property"));
-    }
-    else
-    {
-        m_propertyID = level->m_properties->getDefault();
-    }
-
-    if (node.hasAttribute("material"))
-    {
-        string material = node.getAttribute("material");
-        MaterialsMap::const_iterator iter = level->m_materials.find(material);
-        if (iter == level->m_materials.end())
-        {
-            Exception("Couldn't find material '" + material + "'");
-        }
-        m_material = iter->second;;
-    }
-    
-    for each_const(XMLnodes, node.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if (node.name == "offset")
-        {
-            offset = node.getAttributesInVector("xyz");
-            m_hasOffset = true;
-        }
-        else if (node.name == "rotation")
-        {
-            rotation = node.getAttributesInVector("xyz") * DEG_IN_RAD;
-            m_hasOffset = true;
-        }
-    }
-
     if (m_hasOffset)
     {
+        Vector rotation = Vector(record.rotation) * DEG_IN_RAD;
         NewtonSetEulerAngle(rotation.v, m_matrix.m);
-        m_matrix = Matrix::translate(offset) * m_matrix;
+        m_matrix = Matrix::translate(Vector(record.offset)) * m_matrix;
     }
 }
 
@@ -242,25 +380,10 @@ void CollisionConvex::render() const
     glPopMatrix();
 }
 
-CollisionBox::CollisionBox(const XMLnode& node, const Level* level) :
-    CollisionConvex(node, level),
-    m_size(1.0f, 1.0f, 1.0f)
+CollisionBox::CollisionBox(const CollisionRecord& record, const LevelRecords& records) :
+    CollisionConvex(record, records),
+    m_size(record.size)
 {
-    float mass = node.getAttribute<float>("mass");
-
-    for each_const(XMLnodes, node.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if (node.name == "size")
-        {
-            m_size = node.getAttributesInVector("xyz");
-        }
-        else if (node.name != "offset" && node.name != "rotation")
-        {
-            Exception("Invalid collision, unknown node - " + node.name);
-        }
-    }
-
     create(
         NewtonCreateBox(
             World::instance->m_newtonWorld, 
@@ -269,30 +392,15 @@ CollisionBox::CollisionBox(const XMLnode& node, const Level* level) :
             (m_hasOffset ? m_matrix.m : NULL)
         ),
         m_propertyID,
-        mass);
+        record.mass);
 
     m_mesh = new CubeMesh(m_size);
 }
 
-CollisionSphere::CollisionSphere(const XMLnode& node, const Level* level) :
-    CollisionConvex(node, level),
-    m_radius(1.0f, 1.0f, 1.0f)
+CollisionSphere::CollisionSphere(const CollisionRecord& record, const LevelRecords& records) :
+    CollisionConvex(record, records),
+    m_radius(record.size)
 {
-    float mass = node.getAttribute<float>("mass");
-
-    for each_const(XMLnodes, node.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if (node.name == "radius")
-        {
-            m_radius = node.getAttributesInVector("xyz");
-        }
-        else if (node.name != "offset" && node.name != "rotation")
-        {
-            Exception("Invalid collision, unknown node - " + node.name);
-        }
-    }
-
     create(
         NewtonCreateSphere(
             World::instance->m_newtonWorld, 
@@ -301,35 +409,16 @@ CollisionSphere::CollisionSphere(const XMLnode& node, const Level* level) :
             (m_hasOffset ? m_matrix.m : NULL)
         ),
         m_propertyID,
-        mass);
+        record.mass);
 
     m_mesh = new SphereMesh(m_radius, 12, 12);
 }
 
-CollisionCylinder::CollisionCylinder(const XMLnode& node, const Level* level) :
-    CollisionConvex(node, level),
-    m_radius(1.0f),
-    m_height(1.0f)
+CollisionCylinder::CollisionCylinder(const CollisionRecord& record, const LevelRecords& records) :
+    CollisionConvex(record, records),
+    m_radius(record.size[0]),
+    m_height(record.size[1])
 {
-    float mass = node.getAttribute<float>("mass");
-
-    for each_const(XMLnodes, node.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if (node.name == "radius")
-        {
-            m_radius = cast<float>(node.value);
-        }
-        else if (node.name == "height")
-        {
-            m_height = cast<float>(node.value);
-        }
-        else if (node.name != "offset" && node.name != "rotation")
-        {
-            Exception("Invalid collision, unknown node - " + node.name);
-        }
-    }
-
     create(
         NewtonCreateCylinder(
             World::instance->m_newtonWorld, 
@@ -339,7 +428,7 @@ CollisionCylinder::CollisionCylinder(const XMLnode& node, const Level* level) :
             (m_hasOffset ? m_matrix.m : NULL)
         ),
         m_propertyID,
-        mass);
+        record.mass);
 
     m_hasOffset = true;
     m_matrix *= Matrix::translate(Vector(-m_height/2.0f, 0.0f, 0.0f));
@@ -347,30 +436,11 @@ CollisionCylinder::CollisionCylinder(const XMLnode& node, const Level* level) :
     m_mesh = new CylinderMesh(m_radius, m_height, 2, 12);
 }
 
-CollisionCone::CollisionCone(const XMLnode& node, const Level* level) :
-    CollisionConvex(node, level),
-    m_radius(1.0f),
-    m_height(1.0f)
+CollisionCone::CollisionCone(const CollisionRecord& record, const LevelRecords& records) :
+    CollisionConvex(record, records),
+    m_radius(record.size[0]),
+    m_height(record.size[1])
 {
-    float mass = node.getAttribute<float>("mass");
-
-    for each_const(XMLnodes, node.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if (node.name == "radius")
-        {
-            m_radius = cast<float>(node.value);
-        }
-        else if (node.name == "height")
-        {
-            m_height = cast<float>(node.value);
-        }
-        else if (node.name != "offset" && node.name != "rotation")
-        {
-            Exception("Invalid collision, unknown node - " + node.name);
-        }
-    }
-
     create(
         NewtonCreateCone(
             World::instance->m_newtonWorld, 
@@ -380,7 +450,7 @@ CollisionCone::CollisionCone(const XMLnode& node, const Level* level) :
             (m_hasOffset ? m_matrix.m : NULL)
         ),
         m_propertyID,
-        mass);
+        record.mass);
 
     m_hasOffset = true;
     m_matrix *= Matrix::translate(Vector(-m_height/2.0f, 0.0f, 0.0f));
@@ -388,74 +458,64 @@ CollisionCone::CollisionCone(const XMLnode& node, const Level* level) :
     m_mesh = new ConeMesh(m_radius, m_height, 2, 12);
 }
 
-CollisionTree::CollisionTree(const XMLnode& node, Level* level) : Collision(node)
+CollisionTree::CollisionTree(const CollisionRecord& record, const LevelRecords& records) :
+    Collision(records.data.getString(record.id))
 {
+    const LevelHeader& header = records.data.header();
+    for (unsigned int f = 0; f < record.faces.count; f++)
+    {
+        const FaceRecord& face = records.data.get<FaceRecord>(header.faces, record.faces, f);
+        m_materials.push_back(records.getMaterial(face.material));
+    }
+
     vector<int> props;
+    string path;
+    unsigned int hash = treeKey(record, records, props, path);
 
-    for each_const(XMLnodes, node.childs, iter)
+    NewtonCollision* collision;
+    m_mesh = static_cast<TreeMesh*>(AssetCache::instance->acquire(path, hash));
+    if (m_mesh == NULL)
     {
-        const XMLnode& node = *iter;
-        if (node.name == "face")
-        {
-            string material = node.getAttribute("material");
-            if (material.empty())
-            {
-                m_materials.push_back(NULL);
-            }
-            else
-            {
-                MaterialsMap::const_iterator iter = level->m_materials.find(material);
-                if (iter == level->m_materials.end())
-                {
-                    Exception("Couldn't find material '" + material + "'");
-                }
-                m_materials.push_back(iter->second);
-            }
-            
-            string p = node.getAttribute("property");
-            props.push_back(level->m_properties->getPropertyID(p));
-
-            size_t back = m_faces.size();
-            // needed in grass calculations
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "vertex")
-                {
-                    m_faces.push_back(Face(UV(node.getAttribute<float>("u"), node.getAttribute<float>("v")),
-                                           Vector(),
-                                           node.getAttributesInVector("xyz"))
-                                     );
-                }
-                else
-                { 
-                    Exception("Invalid face, unknown node - " + node.name);
-                }
-            }
-            if (m_faces.size() - back != 4)
-            {
-                Exception("Face must have 4 vertexes");
-            }
+        m_mesh = new TreeMesh();
+        collision = m_mesh->build(record, records.data, props, World::instance->m_newtonWorld);
+        AssetCache::instance->add(path, hash, m_mesh);
+    }
+    else
+    {
+        collision = m_mesh->createTree(World::instance->m_newtonWorld);
+    }
 
-            const Vector& v0 = Vector(m_faces[back].v);
-            const Vector& v1 = Vector(m_faces[back+1].v);
-            const Vector& v2 = Vector(m_faces[back+2].v);
-            
-            Vector normal = (v1-v0) ^ (v2-v0);
-            normal.norm();
+    create(collision);
+}
 
-            m_faces[back].n[0] = m_faces[back+1].n[0] = m_faces[back+2].n[0] = m_faces[back+3].n[0] = normal.x;
-            m_faces[back].n[1] = m_faces[back+1].n[1] = m_faces[back+2].n[1] = m_faces[back+3].n[1] = normal.y;
-            m_faces[back].n[2] = m_faces[back+1].n[2] = m_faces[back+2].n[2] = m_faces[back+3].n[2] = normal.z;
+NewtonCollision* TreeMesh::build(const CollisionRecord& record, const CompiledLevel& data, const vector<int>& props, const NewtonWorld* world)
+{
+    const LevelHeader& header = data.header();
+    for (unsigned int f = 0; f < record.faces.count; f++)
+    {
+        const FaceRecord& face = data.get<FaceRecord>(header.faces, record.faces, f);
 
-        }
-        else
+        size_t back = m_faces.size();
+        // needed in grass calculations
+        for (int k = 0; k < 4; k++)
         {
-            Exception("Invalid collision, unknown node - " + node.name);
+            const float* vertex = face.vertices[k];
+            m_faces.push_back(Face(UV(vertex[3], vertex[4]), Vector(), Vector(vertex)));
         }
+
+        const Vector& v0 = Vector(m_faces[back].v);
+        const Vector& v1 = Vector(m_faces[back+1].v);
+        const Vector& v2 = Vector(m_faces[back+2].v);
+        
+        Vector normal = (v1-v0) ^ (v2-v0);
+        normal.norm();
+
+        m_faces[back].n[0] = m_faces[back+1].n[0] = m_faces[back+2].n[0] = m_faces[back+3].n[0] = normal.x;
+        m_faces[back].n[1] = m_faces[back+1].n[1] = m_faces[back+2].n[1] = m_faces[back+3].n[1] = normal.y;
+        m_faces[back].n[2] = m_faces[back+1].n[2] = m_faces[back+2].n[2] = m_faces[back+3].n[2] = normal.z;
     }
     
-    NewtonCollision* collision = NewtonCreateTreeCollision(World::instance->m_newtonWorld, NULL);
+    NewtonCollision* collision = NewtonCreateTreeCollision(world, NULL);
     NewtonTreeCollisionBeginBuild(collision);
     for (size_t i=0; i<m_faces.size(); i+=4)
     {
@@ -465,19 +525,32 @@ CollisionTree::CollisionTree(const XMLnode& node, Level* level) : Collision(node
         std::swap(m_faces[i+2], m_faces[i+3]);
     }
     NewtonTreeCollisionEndBuild(collision, 1);
-    
-    create(collision);
+
+    NewtonCollisionSerialize(world, collision, serializeTree, &m_tree);
+    return collision;
+}
+
+NewtonCollision* TreeMesh::createTree(const NewtonWorld* world) const
+{
+    const char* data = &m_tree[0];
+    return NewtonCreateCollisionFromSerialization(world, deserializeTree, &data);
+}
+
+size_t TreeMesh::size() const
+{
+    return m_faces.size() * sizeof(Face) + m_tree.size();
 }
 
 void CollisionTree::render() const
 {
-    if (m_faces.size() == 0)
+    const FaceVector& faces = m_mesh->m_faces;
+    if (faces.size() == 0)
     {
         return;
     }
 
     Material* lastMaterial = NULL;
-    for (size_t i = 0; i < m_faces.size(); i += 4)
+    for (size_t i = 0; i < faces.size(); i += 4)
     {
         Material* material = m_materials[i/4];
         if (material != lastMaterial)
@@ -486,305 +559,274 @@ void CollisionTree::render() const
             lastMaterial = material;
         }
 
-        Video::instance->renderFace(m_faces, static_cast<int>(i), 4);
+        Video::instance->renderFace(faces, static_cast<int>(i), 4);
     }
 }
 
 CollisionTree::~CollisionTree()
 {
+    AssetCache::instance->release(m_mesh);
 }
 
-CollisionHMap::CollisionHMap(const XMLnode& node, Level* level) : Collision(node), m_material(NULL)
+CollisionHMap::CollisionHMap(const CollisionRecord& record, const LevelRecords& records, Level* level) :
+    Collision(records.data.getString(record.id)),
+    m_material(records.getMaterial(record.material))
 {
-    string hmap;
-    float size = 0.0f;
-    string material;
-    float repeat = 0.0f;
+    float size = record.size[0];
+    float repeat = record.size[1];
 
-    for each_const(XMLnodes, node.childs, iter)
+    if (m_material == NULL)
     {
-        const XMLnode& node = *iter;
-        if (node.name == "heightmap")
-        {
-            hmap = node.getAttribute("name");
-            size = node.getAttribute<float>("size");
-            material = node.getAttribute("material");
-            repeat = node.getAttribute<float>("repeat");
-        }
-        else
-        {
-            Exception("Invalid collision, unknown node - " + node.name);
-        }
-    }
-    
-    if (hmap.empty())
-    {
-        Exception("Invalid heightmap collision, heightmap name not specified");
+        Exception("Invalid heightmap collision, material name not specified");
     }
-    if (material.empty())
+
+    int id = level->m_properties->getPropertyID("grass");
+
+    string filename;
+    unsigned int hash = heightmapKey(record, records, id, filename);
+
+    NewtonCollision* collision;
+    m_heightmap = static_cast<Heightmap*>(AssetCache::instance->acquire(filename, hash));
+    if (m_heightmap == NULL)
     {
-        Exception("Invalid heightmap collision, material name not specified");
+        m_heightmap = new Heightmap();
+        collision = m_heightmap->build(filename, size, repeat, id, World::instance->m_newtonWorld);
+        AssetCache::instance->add(filename, hash, m_heightmap);
     }
-    if (repeat == 0.0f)
+    else
     {
-        Exception("Invalid heightmap collision, repeat not specified");
+        collision = m_heightmap->createTree(World::instance->m_newtonWorld);
     }
+    m_size = size;
 
-    if (!foundIn(level->m_materials, material))
+    if (m_material->m_id == "grass")
     {
-        Exception("Material '" + material + "' not found!");
+        const FaceVector& faces = m_heightmap->m_faces;
+        int count = m_heightmap->m_realCount;
+        for (int z=0; z<count-1; z++)
+        {
+            for (int x=0; x<count-1; x++)
+            {
+                int i1 = z*count+x;
+                int i2 = (z+1)*count+x;
+                int i3 = (z+1)*count+x+1;
+                int i4 = z*count+x+1;
+
+                Triangle tri;
+                tri.f0 = &faces[i1];
+                tri.f1 = &faces[i2];
+                tri.f2 = &faces[i3];
+                level->m_triangles.push_back(tri);
+
+                tri.f0 = &faces[i2];
+                tri.f1 = &faces[i3];
+                tri.f2 = &faces[i4];
+                level->m_triangles.push_back(tri);
+            }
+        }
     }
-    m_material = level->m_materials.find(material)->second;
 
-    const float c = repeat/size; //1.5f; //m_texture->m_size;//1.5f;
+    create(collision);  
+}
 
-    int id = level->m_properties->getPropertyID("grass");
+NewtonCollision* Heightmap::build(const string& filename, float size, float repeat, int id, const NewtonWorld* world)
+{
+    const float c = repeat/size; //1.5f; //m_texture->m_size;//1.5f;
 
-    NewtonCollision* collision = NewtonCreateTreeCollision(World::instance->m_newtonWorld, NULL);
+    NewtonCollision* collision = NewtonCreateTreeCollision(world, NULL);
     NewtonTreeCollisionBeginBuild(collision);
-     
-#if 0    
-    if (File::exists("/data/heightmaps/" + hmap + ".hmap"))
+
+    int width;
+    int height;
+    int comp;
+    unsigned char* image = loadImg(filename, width, height, comp);
+
+    if (comp != 1)
     {
-        string filename = "/data/heightmaps/" + hmap + ".hmap";
-        File::Reader file(filename);
-        if (!file.is_open())
-        {
-            Exception("Heightmap '" + filename + "' not found");
-        }
-        char head[4];
-        file.read(head, 4);
-        if (string(head, head+4) != "HMAP")
-        {
-            Exception("Invalid heightmap '" + filename + "' format");
-        }
-        int vlen, ilen;
-        file.read(&vlen, sizeof(vlen));
-        file.read(&ilen, sizeof(ilen));
+        Exception("Invalid heightmap '" + filename + "', image must be grayscale");
+    }
 
-        m_vertices.resize(vlen);
-        m_normals.resize(vlen);
-        m_uv.resize(vlen);
+    m_width = width;
+    m_height = height;
+    
+    float size2 = size/2.0f;
 
-        m_indices.resize(3*ilen);
+    // 0.5f, 1.0f, 1.5f
+    const float STEP = 0.25f;
 
-        file.read(&m_vertices[0], sizeof(Vector)*vlen);
-        file.read(&m_normals[0], sizeof(Vector)*vlen);
-        file.read(&m_uv[0], sizeof(UV)*vlen);
-        file.read(&m_indices[0], sizeof(unsigned short)*3*ilen);
-        
-        file.close();
+    int maxIdx = 0;
+    bool maxIdxB = false;
 
-        m_tmpFaces.resize(3*ilen);
-        for (int i=0; i<ilen*3; i+=3)
-        {
-            int i0 = m_indices[i+0];
-            int i1 = m_indices[i+1];
-            int i2 = m_indices[i+2];
-
-            const Vector arr[] = { m_vertices[i0], m_vertices[i1], m_vertices[i2] };
-            NewtonTreeCollisionAddFace(collision, 3, arr[0].v, sizeof(Vector), id);
-
-            Face* face = & m_tmpFaces[i];
-            face->vertexes.resize(3);
-            face->vertexes[0] = m_vertices[i0];
-            face->vertexes[1] = m_vertices[i1];
-            face->vertexes[2] = m_vertices[i2];
-            level->m_faces.insert(make_pair(face, level->m_materials["grass"]));
-        }
-    }
-    else
-#endif
+    float z = -size2;
+    while (true)
     {
-        int width;
-        int height;
-        int comp;
-        unsigned char* image = loadImg("/data/heightmaps/" + hmap + ".img", width, height, comp);
+        bool badMargin = false; // for normal
 
-        if (comp != 1)
+        float z2 = z + STEP;
+        int iz = static_cast<int>(std::floor((z + size2) * height / size));
+        int iz2 = static_cast<int>(std::floor((z2 + size2) * height / size));
+        if (iz >= height)
         {
-            Exception("Invalid heightmap '" + hmap + "', image must be grayscale");
+            z = size2;
+            iz = height-1;
+        }
+        if (iz2 >= height)
+        {
+            z2 = size2;
+            iz2 = height-1;
+            badMargin = true;
         }
 
-        m_size = size;
-        m_width = width;
-        m_height = height;
-        
-        float size2 = size/2.0f;
-
-        // 0.5f, 1.0f, 1.5f
-        const float STEP = 0.25f;
-
-        int maxIdx = 0;
-        bool maxIdxB = false;
-
-        float z = -size2;
+        float x = -size2;
         while (true)
         {
-            bool badMargin = false; // for normal
-
-            float z2 = z + STEP;
-            int iz = static_cast<int>(std::floor((z + size2) * height / size));
-            int iz2 = static_cast<int>(std::floor((z2 + size2) * height / size));
-            if (iz >= height)
+            float x2 = x + STEP;
+            int ix = static_cast<int>(std::floor((x + size2) * width / size));
+            int ix2 = static_cast<int>(std::floor((x2 + size2) * width / size));
+            if (ix >= width)
             {
-                z = size2;
-                iz = height-1;
+                x = size2;
+                ix = width-1;
             }
-            if (iz2 >= height)
+            if (ix2 >= width)
             {
-                z2 = size2;
-                iz2 = height-1;
+                x2 = size2;
+                ix2 = width-1;
                 badMargin = true;
             }
 
-            float x = -size2;
-            while (true)
+            float y1 = (image[width * (height-1-iz) + ix] - 128) / 20.0f;
+            float y2 = (image[width * (height-1-iz2) + ix] - 128) / 20.0f;
+            float y4 = (image[width * (height-1-iz) + ix2] - 128) / 20.0f;
+
+            const Vector v0 = Vector(x, y1, z);
+            const Vector v1 = Vector(x, y2, z2);
+            const Vector v3 = Vector(x2, y4, z);
+            
+            Vector normal;
+            if (badMargin)
             {
-                float x2 = x + STEP;
-                int ix = static_cast<int>(std::floor((x + size2) * width / size));
-                int ix2 = static_cast<int>(std::floor((x2 + size2) * width / size));
-                if (ix >= width)
-                {
-                    x = size2;
-                    ix = width-1;
-                }
-                if (ix2 >= width)
-                {
-                    x2 = size2;
-                    ix2 = width-1;
-                    badMargin = true;
-                }
-
-                float y1 = (image[width * (height-1-iz) + ix] - 128) / 20.0f;
-                float y2 = (image[width * (height-1-iz2) + ix] - 128) / 20.0f;
-                float y4 = (image[width * (height-1-iz) + ix2] - 128) / 20.0f;
-
-                const Vector v0 = Vector(x, y1, z);
-                const Vector v1 = Vector(x, y2, z2);
-                const Vector v3 = Vector(x2, y4, z);
-                
-                Vector normal;
-                if (badMargin)
-                {
-                    normal = Vector(m_faces.back().n);
-                }
-                else
-                {
-                    normal = (v1 - v0)  ^ (v3 - v0);
-                    normal.norm();
-                }
-
-                m_faces.push_back(Face(UV((x+size2)*c, (z+size2)*c), normal, v0));
-
-                if (x == size2)
-                {
-                    break;
-                }
-                x += STEP;
+                normal = Vector(m_faces.back().n);
             }
-            if (!maxIdxB)
+            else
             {
-                maxIdx = static_cast<int>(m_faces.size());
-                maxIdxB = true;
+                normal = (v1 - v0)  ^ (v3 - v0);
+                normal.norm();
             }
 
-            if (z == size2)
+            m_faces.push_back(Face(UV((x+size2)*c, (z+size2)*c), normal, v0));
+
+            if (x == size2)
             {
                 break;
             }
-            z += STEP;
+            x += STEP;
+        }
+        if (!maxIdxB)
+        {
+            maxIdx = static_cast<int>(m_faces.size());
+            maxIdxB = true;
         }
-      
-        delete [] image;
 
-        m_realCount = maxIdx;
+        if (z == size2)
+        {
+            break;
+        }
+        z += STEP;
+    }
+  
+    delete [] image;
 
-        for (int z=0; z<maxIdx-1; z++)
+    m_realCount = maxIdx;
+
+    for (int z=0; z<maxIdx-1; z++)
+    {
+        for (int x=0; x<maxIdx-1; x++)
         {
-            for (int x=0; x<maxIdx-1; x++)
+            int i1 = z*maxIdx+x;
+            int i2 = (z+1)*maxIdx+x;
+            int i3 = (z+1)*maxIdx+x+1;
+            int i4 = z*maxIdx+x+1;
+
+            const Vector v1 = Vector(m_faces[i1].v);
+            const Vector v2 = Vector(m_faces[i2].v);
+            const Vector v3 = Vector(m_faces[i3].v);
+            const Vector v4 = Vector(m_faces[i4].v);
+            
+            if (i3 > 65535)
             {
-                int i1 = z*maxIdx+x;
-                int i2 = (z+1)*maxIdx+x;
-                int i3 = (z+1)*maxIdx+x+1;
-                int i4 = z*maxIdx+x+1;
-
-                const Vector v1 = Vector(m_faces[i1].v);
-                const Vector v2 = Vector(m_faces[i2].v);
-                const Vector v3 = Vector(m_faces[i3].v);
-                const Vector v4 = Vector(m_faces[i4].v);
-                
-                if (i3 > 65535)
-                {
-                    Exception("Too many vertices in heightmap!!");
-                }
-
-                m_indices.push_back(i1);
-                m_indices.push_back(i2);
-                m_indices.push_back(i4);
-
-                m_indices.push_back(i2);
-                m_indices.push_back(i3);
-                m_indices.push_back(i4);
-
-                {
-                    const Vector arr[] = { v1, v2, v4 };
-                    NewtonTreeCollisionAddFace(collision, 3, arr[0].v, sizeof(Vector), id);
-                }
-                {
-                    const Vector arr[] = { v2, v3, v4 };
-                    NewtonTreeCollisionAddFace(collision, 3, arr[0].v, sizeof(Vector), id);
-                }
-
-                if (m_material->m_id == "grass")
-                {
-                    Triangle tri;
-                    tri.f0 = &m_faces[i1];
-                    tri.f1 = &m_faces[i2];
-                    tri.f2 = &m_faces[i3];
-                    level->m_triangles.push_back(tri);
-
-                    tri.f0 = &m_faces[i2];
-                    tri.f1 = &m_faces[i3];
-                    tri.f2 = &m_faces[i4];
-                    level->m_triangles.push_back(tri);
-                }
+                Exception("Too many vertices in heightmap!!");
+            }
+
+            m_indices.push_back(i1);
+            m_indices.push_back(i2);
+            m_indices.push_back(i4);
+
+            m_indices.push_back(i2);
+            m_indices.push_back(i3);
+            m_indices.push_back(i4);
+
+            {
+                const Vector arr[] = { v1, v2, v4 };
+                NewtonTreeCollisionAddFace(collision, 3, arr[0].v, sizeof(Vector), id);
+            }
+            {
+                const Vector arr[] = { v2, v3, v4 };
+                NewtonTreeCollisionAddFace(collision, 3, arr[0].v, sizeof(Vector), id);
             }
         }
     }
-    
+
     NewtonTreeCollisionEndBuild(collision, 0);
-    
-    create(collision);  
+
+    NewtonCollisionSerialize(world, collision, serializeTree, &m_tree);
+    return collision;
+}
+
+NewtonCollision* Heightmap::createTree(const NewtonWorld* world) const
+{
+    const char* data = &m_tree[0];
+    return NewtonCreateCollisionFromSerialization(world, deserializeTree, &data);
+}
+
+size_t Heightmap::size() const
+{
+    return m_faces.size() * sizeof(Face) + m_indices.size() * sizeof(unsigned short) + m_tree.size();
 }
 
 void CollisionHMap::render() const
 {
-    if (m_indices.size() == 0)
+    const FaceVector& faces = m_heightmap->m_faces;
+    const vector<unsigned short>& indices = m_heightmap->m_indices;
+    if (indices.size() == 0)
     {
         return;
     }
 
     m_material->bind();
 
-    glTexCoordPointer(2, GL_FLOAT, sizeof(Face), &m_faces[0].tc[0]);
-    glNormalPointer(GL_FLOAT,      sizeof(Face), &m_faces[0].n[0]);
-    glVertexPointer(3, GL_FLOAT,   sizeof(Face), &m_faces[0].v[0]);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Face), &faces[0].tc[0]);
+    glNormalPointer(GL_FLOAT,      sizeof(Face), &faces[0].n[0]);
+    glVertexPointer(3, GL_FLOAT,   sizeof(Face), &faces[0].v[0]);
 
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indices.size()), GL_UNSIGNED_SHORT, &m_indices[0]);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, &indices[0]);
 }
 
 CollisionHMap::~CollisionHMap()
 {
+    AssetCache::instance->release(m_heightmap);
 }
 
 float CollisionHMap::getHeight(float x, float z) const
 {
-    float x0 = (x + m_size/2.0f) * (m_realCount-1) / m_size;
-    float z0 = (z + m_size/2.0f) * (m_realCount-1) / m_size;
+    const FaceVector& faces = m_heightmap->m_faces;
+    int realCount = m_heightmap->m_realCount;
+
+    float x0 = (x + m_size/2.0f) * (realCount-1) / m_size;
+    float z0 = (z + m_size/2.0f) * (realCount-1) / m_size;
     
-    x0 = std::min(std::max(x0, 0.0f), static_cast<float>(m_realCount-2));
-    z0 = std::min(std::max(z0, 0.0f), static_cast<float>(m_realCount-2));
+    x0 = std::min(std::max(x0, 0.0f), static_cast<float>(realCount-2));
+    z0 = std::min(std::max(z0, 0.0f), static_cast<float>(realCount-2));
     
     int ix = static_cast<int>(std::floor(x0));
     int iz = static_cast<int>(std::floor(z0));
@@ -799,16 +841,16 @@ float CollisionHMap::getHeight(float x, float z) const
     if (x0+z0 <= 1.0f)
     {
         // lower triangle
-        v1 = Vector(m_faces[m_realCount * iz + ix].v);
-        v2 = Vector(m_faces[m_realCount * (iz+1) + ix].v);
-        v3 = Vector(m_faces[m_realCount * iz + ix+1].v);
+        v1 = Vector(faces[realCount * iz + ix].v);
+        v2 = Vector(faces[realCount * (iz+1) + ix].v);
+        v3 = Vector(faces[realCount * iz + ix+1].v);
     }
     else
     {
         // upper triangle
-        v1 = Vector(m_faces[m_realCount * (iz+1) + (ix+1)].v);
-        v2 = Vector(m_faces[m_realCount * (iz+1) + ix].v);
-        v3 = Vector(m_faces[m_realCount * iz + ix+1].v);
+        v1 = Vector(faces[realCount * (iz+1) + (ix+1)].v);
+        v2 = Vector(faces[realCount * (iz+1) + ix].v);
+        v3 = Vector(faces[realCount * iz + ix+1].v);
     }
    
     Vector s1 = v2 - v1;
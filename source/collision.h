@@ -7,32 +7,44 @@
 #include "video.h"
 
 class Body;
-class XMLnode;
 class Level;
+struct LevelRecords;
+struct CollisionRecord;
+class Material;
+class Asset;
 
 class Collision : public NoCopy
 {
     friend class Body;
+    friend class Level;
+    friend struct CollisionOrder;
 
 public:
-    static Collision* create(const XMLnode& node, Level* level);
+    static Collision* create(const CollisionRecord& record, const LevelRecords& records, Level* level);
+
+    // builds the trees and heightmaps of the level that are not in
+    // AssetCache in parallel, create() then only copies them, all stay
+    // referenced until the returned assets are released
+    static void prebuild(const LevelRecords& records, Level* level, vector<Asset*>& assets);
     
     virtual void render() const = 0;
     virtual void renderTri(float x, float z) const {}
     virtual float getHeight(float x, float z) const;
     virtual float getRadius() const { return 0.0f; }
+    virtual const Material* getMaterial() const { return NULL; } // first one
 
     NewtonCollision*  m_newtonCollision;
 
     virtual ~Collision();
 
 protected:
-    Collision(const XMLnode& node);
+    Collision(const string& id);
 
     void create(NewtonCollision* collision);
     void create(NewtonCollision* collision, int propertyID, float mass);
 
 private:
+    string m_id;
     Vector m_origin;
     Vector m_inertia;
     float  m_mass;
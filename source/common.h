@@ -12,6 +12,8 @@
 #include <iostream>
 #include <algorithm>
 
+#include "number.h"
+
 using std::set;
 using std::map; 
 using std::list;
@@ -64,6 +66,25 @@ inline string cast(const string& from)
     return from;
 }
 
+// numbers are converted in place, see number.h, everything else goes
+// through the stringstream above
+template <typename T>
+inline string formatNumber(T value)
+{
+    char buffer[NUMBER_CHARS];
+    return string(buffer, formatNumber(buffer, value));
+}
+
+template <> inline int           cast(const string& from) { return parseNumber<int>(from.data(), from.size()); }
+template <> inline unsigned int  cast(const string& from) { return parseNumber<unsigned int>(from.data(), from.size()); }
+template <> inline unsigned long cast(const string& from) { return parseNumber<unsigned long>(from.data(), from.size()); }
+template <> inline float         cast(const string& from) { return parseNumber<float>(from.data(), from.size()); }
+
+template <> inline string cast(const int& from)           { return formatNumber(from); }
+template <> inline string cast(const unsigned int& from)  { return formatNumber(from); }
+template <> inline string cast(const unsigned long& from) { return formatNumber(from); }
+template <> inline string cast(const float& from)         { return formatNumber(from); }
+
 template <typename ValueType>
 inline bool foundIn(const vector<ValueType>& Vector,
                     ValueType                Value)
@@ -140,6 +161,13 @@ T sqr(T x)
 #define STR2(X) #X
 #define STR(X) STR2(X)
 
+// one variable per thread, headless tools step worlds on several threads
+#ifdef _LINUX_VER
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif
+
 static void Exception(const std::string& msg)
 {
     clog << "Exception: " << msg << endl;
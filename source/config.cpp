@@ -3,22 +3,23 @@
 #include "xml.h"
 #include "version.h"
 
-template <class Config> Config* System<Config>::instance = NULL;
+template <class Config> Config* SharedInstance<Config>::instance = NULL;
 
 const string Config::CONFIG_FILE = "/config.xml";
 
-const MiscConfig Config::defaultMisc = { "en" };
+const MiscConfig Config::defaultMisc = { "en", 32 };
 
 Config::Config() : m_misc(defaultMisc)
 {
     clog << "Reading configuration." << endl;
 
-    XMLnode xml;
+    XMLdocument document;
     File::Reader in(CONFIG_FILE, true);
     if (in.is_open())
     {
-        xml.load(in);
+        document.load(in);
     }
+    const XMLelement& xml = document.root();
 
     string version = xml.getAttribute("version", string());
     
@@ -30,19 +31,23 @@ Config::Config() : m_misc(defaultMisc)
 
     // TODO: maybe rewrite with map<string, variable&>
 
-    for each_const(XMLnodes, xml.childs, iter)
+    for each_const(XMLelements, xml.childs, iter)
     {
-        const XMLnode& node = *iter;
+        const XMLelement& node = *iter;
 
         if (node.name == "misc")
         {
-            for each_const(XMLnodes, node.childs, iter)
+            for each_const(XMLelements, node.childs, iter)
             {
-                const XMLnode& node = *iter;
+                const XMLelement& node = *iter;
                 if (node.name == "language")
                 {
                     m_misc.language = node.value;
                 }
+                else if (node.name == "asset_cache")
+                {
+                    m_misc.assetCache = cast<int>(node.value);
+                }
                 else
                 {
                     string line = cast<string>(node.line);
@@ -72,6 +77,7 @@ void Config::save()
 
     xml.childs.push_back(XMLnode("misc"));
     xml.childs.back().childs.push_back(XMLnode("language", m_misc.language));
+    xml.childs.back().childs.push_back(XMLnode("asset_cache", cast<string>(m_misc.assetCache)));
 
     File::Writer out(CONFIG_FILE);
     if (!out.is_open())
@@ -7,6 +7,7 @@
 struct MiscConfig
 {
     string language;
+    int    assetCache; // megabytes kept by AssetCache
 };
 
 class Config : public System<Config>, public NoCopy
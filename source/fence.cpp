@@ -19,7 +19,7 @@ void makeFence(Level* level, const NewtonWorld* newtonWorld)
     //fencePartsCollisions.insert(level->getCollision("fenceClip2"));
     fencePartsCollisions.insert(level->getCollision("fenceTop"));
 
-    Collision* heightMap = level->getCollision("level");
+    Collision* heightMap = level->getGroundCollision();
 
     for (size_t fencesVectorIdx = 0; fencesVectorIdx < level->m_fences.size(); fencesVectorIdx++)
     {
@@ -48,7 +48,7 @@ void makeFence(Level* level, const NewtonWorld* newtonWorld)
                 NewtonBodySetFreezeState(body->m_newtonBody, 1);
                 //NewtonBodySetMassMatrix(body->m_newtonBody, 0, 0, 0, 0);
 
-                level->m_bodies[bodyID] = body;
+                level->addBody(body);
             }
         }
     }
@@ -2,19 +2,56 @@
 #include <algorithm>
 #include "file.h"
 #include "glue.h"
+#include "pack.h"
 
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 // PRIVATE part
 
 namespace File
 {  
+    static Reader* g_packFile = NULL;
+    static Pack*   g_pack = NULL;
 
-    Reader::Reader(const string& filename, bool inWriteFolder) : m_pointer(NULL)
+    bool openPack(const string& filename)
     {
+        closePack();
+
+        Reader* file = new Reader(filename);
+        if (!file->is_open() || !Pack::check(file->pointer(), file->size()))
+        {
+            delete file;
+            return false;
+        }
+        g_packFile = file;
+        g_pack = new Pack(file->pointer(), file->size());
+        clog << "Reading '" << filename << "' with " << g_pack->count() << " files." << endl;
+        return true;
+    }
+
+    void closePack()
+    {
+        delete g_pack;
+        delete g_packFile;
+        g_pack = NULL;
+        g_packFile = NULL;
+    }
+
+    Reader::Reader(const string& filename, bool inWriteFolder) : m_pointer(NULL), m_size(0), m_mapped(false)
+    {
+        if (!inWriteFolder && g_pack != NULL)
+        {
+            m_pointer = const_cast<unsigned char*>(g_pack->find(filename, m_size));
+            if (m_pointer != NULL)
+            {
+                return;
+            }
+        }
+
         int fd = open(((inWriteFolder ? file_get_writePath() : file_get_readPath()) + filename).c_str(), O_RDONLY, 0);
         if (fd >= 0)
         {
@@ -29,6 +66,7 @@ namespace File
                 else
                 {
                     m_size = statInfo.st_size;
+                    m_mapped = true;
                 }
             }
             
@@ -38,7 +76,7 @@ namespace File
     
     Reader::~Reader()
     {
-        if (m_pointer != NULL)
+        if (m_mapped)
         {
             munmap(m_pointer, m_size);
         }
@@ -85,6 +123,12 @@ namespace File
 
     bool exists(const string& filename)
     {
+        size_t size;
+        if (g_pack != NULL && g_pack->find(filename, size) != NULL)
+        {
+            return true;
+        }
+
         FILE* f = fopen((file_get_readPath() + filename).c_str(), "rb");
         if (f == NULL)
         {
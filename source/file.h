@@ -9,6 +9,13 @@ namespace File
 {
     bool exists(const string& filename);
 
+    // maps the pack (see pack.h) from the read folder, then Reader and
+    // exists look read folder files up there first, falling back to the
+    // folder for files not in it. Open it before starting any threads,
+    // Readers made from it must be gone before closePack.
+    bool openPack(const string& filename);
+    void closePack();
+
     class Reader : NoCopy
     {
     public:
@@ -24,6 +31,7 @@ namespace File
     private:
         unsigned char* m_pointer;
         size_t m_size;
+        bool m_mapped; // false for views into the pack
     };
 
     class Writer : NoCopy
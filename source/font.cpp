@@ -1,5 +1,6 @@
 #include <OpenGLES/ES1/gl.h>
 #include <OpenGLES/ES1/glext.h>
+#include <cstring>
 
 #include "font.h"
 #include "file.h"
@@ -6,10 +6,40 @@ Formatter::Formatter(const string& txt) : m_txt(txt)
    
 Formatter::operator string ()
 {
-    return m_txt;
+    // formatters are temporaries, so the text is handed over, not copied
+    string result;
+    result.swap(m_txt);
+    return result;
 }
 
-void Formatter::updateFirst(const string& value)
+Formatter& Formatter::operator () (const string& value)
+{
+    updateFirst(value.data(), value.size());
+    return *this;
+}
+
+Formatter& Formatter::operator () (int value)
+{
+    char buffer[NUMBER_CHARS];
+    updateFirst(buffer, formatNumber(buffer, value) - buffer);
+    return *this;
+}
+
+Formatter& Formatter::operator () (unsigned int value)
+{
+    char buffer[NUMBER_CHARS];
+    updateFirst(buffer, formatNumber(buffer, value) - buffer);
+    return *this;
+}
+
+Formatter& Formatter::operator () (float value)
+{
+    char buffer[NUMBER_CHARS];
+    updateFirst(buffer, formatNumber(buffer, value) - buffer);
+    return *this;
+}
+
+void Formatter::updateFirst(const char* value, size_t size)
 {
     size_t offset = 0;
     size_t pos = m_txt.find('$');
@@ -29,8 +59,8 @@ void Formatter::updateFirst(const string& value)
             int num = m_txt[pos+1] - '0';
             if (num == 1)
             {
-                m_txt = m_txt.substr(0, pos) + value + m_txt.substr(pos+2, m_txt.size());
-                offset = pos + value.size();
+                m_txt.replace(pos, 2, value, size);
+                offset = pos + size;
             }
             else
             {
@@ -11,18 +11,25 @@ public:
     template <typename T>
     inline Formatter& operator () (T value);
 
+    // no temporary strings for these, score texts are made every frame
+    Formatter& operator () (const string& value);
+    Formatter& operator () (int value);
+    Formatter& operator () (unsigned int value);
+    Formatter& operator () (float value);
+
     operator string ();
 
 private:
     string m_txt;
 
-    void updateFirst(const string& value);
+    void updateFirst(const char* value, size_t size);
 };
 
 template <typename T>
 Formatter& Formatter::operator () (T value)
 {
-    updateFirst(cast<string>(value));
+    string text = cast<string>(value);
+    updateFirst(text.data(), text.size());
     return *this;
 }
 
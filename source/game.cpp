@@ -6,6 +6,7 @@
 #include "audio.h"
 #include "network.h"
 #include "input.h"
+#include "asset_cache.h"
 #include "world.h"
 #include "menu.h"
 #include "intro.h"
@@ -19,8 +20,10 @@
 #include "random.h"
 #include "music.h"
 #include "glue.h"
+#include "file.h"
+#include "pack.h"
 
-template <class Game> Game* System<Game>::instance = NULL;
+template <class Game> Game* SharedInstance<Game>::instance = NULL;
 
 static const string USER_PROFILE_FILE = "/user.xml";
 
@@ -36,6 +39,10 @@ Game::Game() :
     m_menuMusic(NULL),
     m_accum(0.0f)
 {
+    // loose files in data/ are used if there is no pack, the iOS
+    // project bundles only those for now
+    File::openPack(PACK_FILE);
+
     // these and only these objects are singletons,
     // they all have public static instance attribute
     m_config = new Config();
@@ -44,6 +51,7 @@ Game::Game() :
     m_video = new Video();
     m_audio = new Audio();
     m_network = new Network();
+    m_assetCache = new AssetCache(static_cast<size_t>(m_config->m_misc.assetCache) << 20);
 	m_input->init();
     //
 
@@ -86,13 +94,19 @@ Game::~Game()
     {
         delete m_state;
     }
+    if (m_menuMusic != NULL)
+    {
+        m_audio->unloadMusic(m_menuMusic);
+    }
 
+    delete m_assetCache; // before Audio, it holds sound buffers
     delete m_network;
     delete m_audio;
     delete m_video;
     delete m_language;
     delete m_input;
     delete m_config;
+    File::closePack();
 }
 
 void Game::render(float delta)
@@ -193,14 +207,15 @@ State* Game::switchState(const State::Type nextState)
 void Game::loadUserData()
 {
     clog << "Reading user information." << endl;
-    XMLnode xml;
+    XMLdocument document;
     File::Reader in(USER_PROFILE_FILE, true);
     if (in.is_open())
     {
-        xml.load(in);
-        for each_const(XMLnodes, xml.childs, iter)
+        document.load(in);
+        const XMLelement& xml = document.root();
+        for each_const(XMLelements, xml.childs, iter)
         {
-            const XMLnode& node = *iter;
+            const XMLelement& node = *iter;
             if (node.name == "profile")
             {
                 if (m_userProfile != NULL)
@@ -214,9 +229,9 @@ void Game::loadUserData()
             }
             else if (node.name == "other_data")
             {
-                for each_const(XMLnodes, node.childs, iter)
+                for each_const(XMLelements, node.childs, iter)
                 {
-                    const XMLnode& node = *iter;
+                    const XMLelement& node = *iter;
                     if (node.name == "magic")
                     {
                         unsigned int magic1 = node.getAttribute<unsigned int>("magic1");
@@ -300,64 +315,5 @@ void Game::saveUserData()
 
 void Game::loadCpuData()
 {
-    XMLnode xml;
-    File::Reader in("/data/level/cpu_players.xml");
-    if (!in.is_open())
-    {
-        Exception("Level file 'data/level/cpu_players.xml' not found");  
-    }
-    xml.load(in);
-    int checks[4] = {0,0,0,0};
-
-    for each_const(XMLnodes, xml.childs, iter)
-    {
-        const XMLnode& node = *iter;
-        if ((node.name == "easy") || (node.name == "normal") || (node.name == "hard") || (node.name == "extra"))
-        {
-            size_t idx;
-            if (node.name == "easy")
-            {
-                idx = 0;
-            }
-            else if (node.name == "normal")
-            {
-                idx = 1;
-            }
-            else if (node.name == "hard")
-            {
-                idx = 2;
-            }
-            else // if (node.name == "extra")
-            {
-                idx = 3;
-            }
-
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "profile")
-                {
-                    Profile* profile = new Profile(node);
-                    m_cpuProfiles[idx].push_back(profile);
-                    checks[idx]++;
-                }
-                else
-                {
-                    Exception("Invalid profile, unknown node - " + node.name);
-                }
-            }
-        }
-        else
-        {
-            Exception("Invalid cpu_profiles, unknown node - " + node.name);
-        }
-    }
-
-    for (size_t i = 0; i < 4; i++)
-    {
-        if (checks[i] < 3)
-        {
-            Exception("Invalid cpu_profiles, there should be at least 3 profiles in each difficulty");
-        }
-    }
+    loadCpuProfiles(m_cpuProfiles);
 }
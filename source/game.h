@@ -15,6 +15,7 @@ class Video;
 class Audio;
 class Network;
 class Input;
+class AssetCache;
 class FPS;
 class Profile;
 class Music;
@@ -38,6 +39,7 @@ public:
     Audio*      m_audio;
     Network*    m_network;
     Input*      m_input;
+    AssetCache* m_assetCache;
     //
 
     ProfilesVector  m_cpuProfiles[4];
@@ -2,7 +2,7 @@
 #include "video.h"
 #include "glue.h"
 
-template <class Input> Input* System<Input>::instance = NULL;
+template <class Input> Input* SharedInstance<Input>::instance = NULL;
 
 Touches Input::m_touches;
 Touches Input::m_empty;
@@ -3,7 +3,7 @@
 #include "file.h"
 #include "config.h"
 
-template <class Language> Language* System<Language>::instance = NULL;
+template <class Language> Language* SharedInstance<Language>::instance = NULL;
 
 Language::Language()
 {
@@ -76,17 +76,18 @@ StringVector Language::getAvailable() const
 {
     StringVector result;
 
-    XMLnode xml;
+    XMLdocument document;
     File::Reader in("/data/language/list.xml");
     if (!in.is_open())
     {
         Exception("Level file 'data/language/list.xml' not found");  
     }
-    xml.load(in);
+    document.load(in);
+    const XMLelement& xml = document.root();
 
-    for each_const(XMLnodes, xml.childs, iter)
+    for each_const(XMLelements, xml.childs, iter)
     {
-        const XMLnode& node = *iter;
+        const XMLelement& node = *iter;
         if (node.name == "language")
         {
             result.push_back(node.value);
@@ -111,17 +112,18 @@ int Language::load(const string& name)
 
     int count = 0;
 
-    XMLnode xml;
+    XMLdocument document;
     File::Reader in(filename);
     if (!in.is_open())
     {
         Exception("Language file '" + filename + "' not found");  
     }
-    xml.load(in);
+    document.load(in);
+    const XMLelement& xml = document.root();
 
-    for each_const(XMLnodes, xml.childs, iter)
+    for each_const(XMLelements, xml.childs, iter)
     {
-        const XMLnode& node = *iter;
+        const XMLelement& node = *iter;
         if (node.name != "item")
         {
             Exception("Invalid language file '" + filename + "'");
@@ -1,6 +1,6 @@
+#include <cstring>
 #include "level.h"
 #include "file.h"
-#include "xml.h"
 #include "video.h"
 #include "world.h"
 #include "material.h"
@@ -11,170 +11,186 @@
 #include "music.h"
 #include "audio.h"
 #include "config.h"
+#include "level_format.h"
+#include "level_compiler.h"
+#include "asset_cache.h"
 
-Level::Level() : m_gravity(0.0f, -9.81f, 0.0f), m_skyboxName()
+// static bodies first, then by material so the same texture is bound
+// for neighbours, handle keeps the order the same on every run
+struct RenderOrder
+{
+    static const string& materialId(const Body* body)
+    {
+        static const string none;
+        if (body->m_collisions.empty() || (*body->m_collisions.begin())->getMaterial() == NULL)
+        {
+            return none;
+        }
+        return (*body->m_collisions.begin())->getMaterial()->m_id;
+    }
+
+    bool operator () (const Body* a, const Body* b) const
+    {
+        if (a->isMovable() != b->isMovable())
+        {
+            return b->isMovable();
+        }
+        int order = materialId(a).compare(materialId(b));
+        if (order != 0)
+        {
+            return order < 0;
+        }
+        return a->m_handle < b->m_handle;
+    }
+};
+
+Level::Level() : m_gravity(0.0f, -9.81f, 0.0f), m_skyboxName(),
+    m_ball(NULL), m_field(NULL), m_ground(NULL), m_groundCollision(NULL),
+    m_syncedBodies(0), m_syncedTotal(0), m_syncedFrames(0)
 {
     m_properties = new Properties();
 }
 
+Material* LevelRecords::getMaterial(unsigned int index) const
+{
+    if (index == NO_INDEX)
+    {
+        return NULL;
+    }
+    if (index >= materials.size())
+    {
+        Exception("Invalid compiled level, material index out of range");
+    }
+    return materials[index];
+}
+
+int LevelRecords::getPropertyID(unsigned int index) const
+{
+    if (index == NO_INDEX)
+    {
+        return defaultID;
+    }
+    if (index >= propertyIDs.size())
+    {
+        Exception("Invalid compiled level, property index out of range");
+    }
+    return propertyIDs[index];
+}
+
 void Level::load(const string& levelFile)
 {
-    StringSet tmp;
-    load(levelFile, tmp);
+    // written next to the XML by squares3d-levelc
+    string compiledFile = "/data/level/" + levelFile.substr(0, levelFile.rfind('.')) + ".lvl";
+
+    File::Reader in(compiledFile);
+    if (in.is_open() && CompiledLevel::check(in.pointer(), in.size()))
+    {
+        CompiledLevel level(in.pointer(), in.size());
+        if (level.isCurrent())
+        {
+            clog << "Reading '" << compiledFile << "' data." << endl;
+            load(level);
+            return;
+        }
+        clog << "Compiled '" << compiledFile << "' is out of date." << endl;
+    }
+
+    LevelCompiler compiler;
+    compiler.compile(levelFile);
+    const bytes& blob = compiler.getBlob();
+    CompiledLevel level(&blob[0], blob.size());
+    load(level);
 }
 
-void Level::load(const string& levelFile, StringSet& loaded)
+void Level::load(const CompiledLevel& level)
 {
-    clog << "Reading '" << levelFile << "' data." << endl;
+    const LevelHeader& header = level.header();
 
-    if (foundIn(loaded, levelFile))
+    m_gravity = Vector(header.gravity);
+    m_skyboxName = level.getString(header.skybox);
+    for (unsigned int i = 0; i < header.music.count; i++)
     {
-        clog << "ERROR: " << levelFile << " already is loaded!" << endl;
-        return;
+        const char* name = level.getString(level.get<unsigned int>(header.music, i));
+        m_music.push_back(Audio::instance->loadMusic(name));
     }
-    loaded.insert(levelFile);
 
-    XMLnode xml;
-    File::Reader in("/data/level/" + levelFile);
-    if (!in.is_open())
+    // registered in order of first use in the XML, so ids stay the same
+    LevelRecords records(level, m_properties->getDefault());
+    for (unsigned int i = 0; i < header.propertyNames.count; i++)
     {
-        Exception("Level file '" + levelFile + "' not found");  
+        const char* name = level.getString(level.get<unsigned int>(header.propertyNames, i));
+        records.propertyIDs.push_back(m_properties->getPropertyID(name));
     }
-    xml.load(in);
 
-    for each_const(XMLnodes, xml.childs, iter)
+    for (unsigned int i = 0; i < header.materials.count; i++)
     {
-        const XMLnode& node = *iter;
-        if (node.name == "gravity")
-        {
-            m_gravity = node.getAttributesInVector("xyz");
-        }
-        else if (node.name == "music")
-        {
-            m_music.push_back(Audio::instance->loadMusic(node.getAttribute("name")));
-        }
-        else if (node.name == "skybox")
-        {
-            m_skyboxName = node.getAttribute("name");
-        }
-        else if (node.name == "link")
-        {
-            load(node.getAttribute("file"), loaded);
-        }
-        else if (node.name == "bodies")
-        {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "body")
-                {
-                    string id = node.getAttribute("id");
-                    m_bodies[id] = new Body(node, this);
-                }
-                else
-                {
-                    Exception("Invalid body, unknown node - " + node.name);
-                }
-            }
-        }
-        else if (node.name == "materials")
-        {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "material")
-                {
-                    m_materials.insert(make_pair(node.getAttribute("id"), new Material(node)));
-                }
-                else
-                {
-                    Exception("Invalid materials, unknown node - " + node.name);
-                }
-            }
-        }
-        else if (node.name == "collisions")
-        {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "collision")
-                {
-                    m_collisions[node.getAttribute("id")] = Collision::create(node, this);
-                }
-                else
-                {
-                    Exception("Invalid collisions, unknown node - " + node.name);
-                }
-            }
-        }
-        else if (node.name == "joints")
-        {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "joint")
-                {
-                    // TODO: load joints
-                }
-                else
-                {
-                    Exception("Invalid joint, unknown node - " + node.name);
-                }
-            }
-        }
-        else if (node.name == "properties")
+        Material* material = new Material(level.get<MaterialRecord>(header.materials, i), level);
+        m_materials.insert(make_pair(material->m_id, material));
+        records.materials.push_back(material);
+    }
+
+    for (unsigned int i = 0; i < header.properties.count; i++)
+    {
+        const PropertyRecord& record = level.get<PropertyRecord>(header.properties, i);
+        if (record.isDefault)
         {
-            m_properties->load(node);
+            m_properties->loadDefault(record);
         }
-        else if (node.name == "defaultProperties")
+        else
         {
-            m_properties->loadDefault(node);
+            m_properties->load(record, records);
         }
-        else if (node.name == "fences")
+    }
+
+    vector<Asset*> built;
+    Collision::prebuild(records, this, built);
+    for (unsigned int i = 0; i < header.collisions.count; i++)
+    {
+        Collision* collision = Collision::create(level.get<CollisionRecord>(header.collisions, i), records, this);
+        m_collisions[collision->m_id] = collision;
+        if (collision->m_id == "level")
         {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "fence")
-                {
-                    vector<Vector> points;
-                    for each_const(XMLnodes, node.childs, iter)
-                    {
-                        const XMLnode& node = *iter;
-                        if (node.name == "point")
-                        {
-                            points.push_back(node.getAttributesInVector("xyz"));
-                        }
-                        else
-                        {
-                            Exception("Invalid fence, unknown node - " + node.name);
-                        }
-                    }
-                    if (points.size() < 2)
-                    {
-                        Exception("Too less points in fence, expected at least 2");
-                    }
-                    m_fences.push_back(points);
-                }
-                else
-                {
-                    Exception("Invalid fences, unknown node - " + node.name);
-                }
-            }
+            m_groundCollision = collision;
         }
-        else
+        records.collisions.push_back(collision);
+    }
+    for each_const(vector<Asset*>, built, iter)
+    {
+        AssetCache::instance->release(*iter);
+    }
+
+    for (unsigned int i = 0; i < header.bodies.count; i++)
+    {
+        Body* body = new Body(level.get<BodyRecord>(header.bodies, i), records, this);
+        if (m_bodies.find(body->m_id) != m_bodies.end())
         {
-            Exception("Invalid level file, unknown section - " + node.name);
+            Exception("Body '" + body->m_id + "' already is in level");
         }
+        addBody(body);
+        assignRole(body);
     }
-    if (m_skyboxName.empty())
+
+    for (unsigned int i = 0; i < header.fences.count; i++)
     {
-        Exception("Skybox not specified in level file");
+        const RecordRange& fence = level.get<RecordRange>(header.fences, i);
+
+        vector<Vector> points;
+        for (unsigned int k = 0; k < fence.count; k++)
+        {
+            points.push_back(Vector(level.get<PointRecord>(header.points, fence, k).xyz));
+        }
+        m_fences.push_back(points);
     }
 }
 
 Level::~Level()
 {
+    if (m_syncedFrames != 0)
+    {
+        clog << "Synced " << static_cast<float>(m_syncedTotal) / m_syncedFrames
+             << " of " << m_bodies.size() << " bodies per frame." << endl;
+    }
+
     for each_(BodiesMap, m_bodies, iter)
     {
         delete iter->second;
@@ -227,18 +243,185 @@ Collision* Level::getCollision(const string& id) const
     }
 }
 
-void Level::prepare()
+void Level::addBody(Body* body)
 {
+    body->m_handle = static_cast<int>(m_handles.size());
+    m_handles.push_back(body);
+    m_bodyOrder.clear();
+
+    // players are named by their profile, which may be any id
+    string key = body->m_id;
+    while (!m_bodies.insert(make_pair(key, body)).second)
+    {
+        key += "#" + cast<string>(body->m_handle);
+    }
+}
+
+void Level::assignRole(Body* body)
+{
+    if (body->m_id == "football")
+    {
+        m_ball = body;
+    }
+    else if (body->m_id == "field")
+    {
+        m_field = body;
+    }
+    else if (body->m_id == "level")
+    {
+        m_ground = body;
+    }
+}
+
+Body* Level::getBody(int handle) const
+{
+    assert(handle >= 0 && handle < static_cast<int>(m_handles.size()));
+    return m_handles[handle];
+}
+
+Body* Level::getBall() const
+{
+    if (m_ball == NULL)
+    {
+        Exception("Level has no 'football' body");
+    }
+    return m_ball;
+}
+
+Body* Level::getField() const
+{
+    if (m_field == NULL)
+    {
+        Exception("Level has no 'field' body");
+    }
+    return m_field;
+}
+
+Body* Level::getGround() const
+{
+    if (m_ground == NULL)
+    {
+        Exception("Level has no 'level' body");
+    }
+    return m_ground;
+}
+
+Collision* Level::getGroundCollision() const
+{
+    if (m_groundCollision == NULL)
+    {
+        Exception("Level has no 'level' collision");
+    }
+    return m_groundCollision;
+}
+
+void Level::updateBodyOrder() const
+{
+    if (m_bodyOrder.size() == m_bodies.size())
+    {
+        return;
+    }
+    m_bodyOrder.clear();
+    m_bodyIndices.resize(m_handles.size());
     for each_const(BodiesMap, m_bodies, iter)
     {
-        (iter->second)->prepare();
+        m_bodyIndices[iter->second->m_handle] = static_cast<int>(m_bodyOrder.size());
+        m_bodyOrder.push_back(iter->second);
     }
+
+    m_renderOrder = m_handles;
+    std::sort(m_renderOrder.begin(), m_renderOrder.end(), RenderOrder());
+}
+
+const vector<Body*>& Level::getBodies() const
+{
+    updateBodyOrder();
+    return m_bodyOrder;
+}
+
+int Level::getBodyIndex(const Body* body) const
+{
+    if (body == NULL)
+    {
+        return -1;
+    }
+    updateBodyOrder();
+    if (body->m_handle < 0 || body->m_handle >= static_cast<int>(m_handles.size()) ||
+        m_handles[body->m_handle] != body)
+    {
+        Exception("Body '" + body->m_id + "' is not in level");
+    }
+    return m_bodyIndices[body->m_handle];
+}
+
+Body* Level::getBodyByIndex(int index) const
+{
+    if (index == -1)
+    {
+        return NULL;
+    }
+    updateBodyOrder();
+    if (index < 0 || index >= static_cast<int>(m_bodyOrder.size()))
+    {
+        Exception("Invalid body index in saved state");
+    }
+    return m_bodyOrder[index];
+}
+
+void Level::markDirty(Body* body)
+{
+    if (!body->m_dirty)
+    {
+        body->m_dirty = true;
+        m_dirtyBodies.push_back(body);
+    }
+}
+
+unsigned int Level::syncedBodies() const
+{
+    return m_syncedBodies;
+}
+
+void Level::prepare()
+{
+    // only bodies moved by Newton or by setTransform/setMatrix since last frame
+    m_syncedBodies = static_cast<unsigned int>(m_dirtyBodies.size());
+    m_syncedTotal += m_syncedBodies;
+    m_syncedFrames++;
+
+    if (m_dirtyBodies.empty())
+    {
+        return;
+    }
+
+    int count = static_cast<int>(m_dirtyBodies.size());
+    m_syncNewtonBodies.resize(count);
+    m_syncMatrices.resize(16 * count);
+    m_syncVelocities.resize(4 * count);
+    for (int i = 0; i < count; i++)
+    {
+        m_syncNewtonBodies[i] = m_dirtyBodies[i]->m_newtonBody;
+    }
+
+    NewtonWorldGetBodyStates(World::instance->m_newtonWorld,
+                             &m_syncNewtonBodies[0], count,
+                             &m_syncMatrices[0], &m_syncVelocities[0]);
+
+    for (int i = 0; i < count; i++)
+    {
+        Body* body = m_dirtyBodies[i];
+        memcpy(body->m_matrix.m, &m_syncMatrices[16 * i], 16 * sizeof(float));
+        memcpy(body->m_velocity.v, &m_syncVelocities[4 * i], 4 * sizeof(float));
+        body->m_dirty = false;
+    }
+    m_dirtyBodies.clear();
 }
 
 void Level::render() const
 {
-    for each_const(BodiesMap, m_bodies, iter)
+    updateBodyOrder();
+    for (size_t i = 0; i < m_renderOrder.size(); i++)
     {
-        (iter->second)->render();
-    }    
+        m_renderOrder[i]->render();
+    }
 }
@@ -5,7 +5,7 @@
 #include "common.h"
 #include "vmath.h"
 
-class XMLnode;
+class CompiledLevel;
 class Material;    
 class Properties;
 class Collision;
@@ -29,20 +29,57 @@ typedef vector<Triangle>        TriangleVector;
 typedef vector<vector<Vector> > FencesVector;
 typedef vector<Music*>          MusicVector;
 
+// compiled level being loaded and the objects made from its records so far
+struct LevelRecords
+{
+    LevelRecords(const CompiledLevel& data, int defaultID) : data(data), defaultID(defaultID) {}
+
+    Material* getMaterial(unsigned int index) const;   // NULL for NO_INDEX
+    int       getPropertyID(unsigned int index) const; // default for NO_INDEX
+
+    const CompiledLevel& data;
+    int                  defaultID;
+    vector<Material*>    materials;   // by material record
+    vector<int>          propertyIDs; // by property name
+    vector<Collision*>   collisions;  // by collision record
+};
+
 class Level : public NoCopy
 {
 public:
     Level();
     ~Level();
+    // compiled .lvl next to the XML if it is up to date, else the XML
     void  load(const string& levelFile);
-    void  load(const string& levelFile, StringSet& loaded);
+    void  load(const CompiledLevel& level);
     void  render() const;
     void  prepare();
+    void  markDirty(Body* body);
+    unsigned int syncedBodies() const;
     Body* getBody(const string& id) const;
     Collision* getCollision(const string& id) const;
 
+    // bodies are added only here, id is interned into Body::m_handle,
+    // dense in order of adding, so hot paths never look up strings. A
+    // body whose id is taken is kept under another name.
+    void  addBody(Body* body);
+    Body* getBody(int handle) const;
+
+    // well known bodies of the level file, resolved when it is loaded
+    Body* getBall() const;                 // "football"
+    Body* getField() const;                // "field"
+    Body* getGround() const;               // "level"
+    Collision* getGroundCollision() const; // "level" heightmap
+
+    // stable body numbering (m_bodies order) for saved states, -1 is NULL
+    int   getBodyIndex(const Body* body) const;
+    Body* getBodyByIndex(int index) const;
+
+    // all bodies in that order, for linear scans instead of m_bodies
+    const vector<Body*>& getBodies() const;
+
     Vector          m_gravity;
-    BodiesMap       m_bodies;
+    BodiesMap       m_bodies;      // name index, iterate getBodies()
     CollisionsMap   m_collisions;
     TriangleVector  m_triangles;
     MaterialsMap    m_materials;
@@ -50,6 +87,37 @@ public:
     FencesVector    m_fences;
     MusicVector     m_music;
     string          m_skyboxName;
+
+private:
+    vector<Body*>             m_handles;   // by Body::m_handle
+
+    // well known bodies, only from the level file
+    void assignRole(Body* body);
+    Body*                     m_ball;
+    Body*                     m_field;
+    Body*                     m_ground;
+    Collision*                m_groundCollision;
+
+    // bodies moved since last prepare, filled by Body transform callbacks
+    vector<Body*>             m_dirtyBodies;
+
+    // contiguous body state buffers filled by NewtonWorldGetBodyStates
+    vector<const NewtonBody*> m_syncNewtonBodies;
+    vector<float>             m_syncMatrices;
+    vector<float>             m_syncVelocities;
+
+    unsigned int              m_syncedBodies;
+    unsigned int              m_syncedTotal;
+    unsigned int              m_syncedFrames;
+
+    // m_bodies in map order and its index by handle, rebuilt when
+    // bodies are added
+    mutable vector<Body*>     m_bodyOrder;
+    mutable vector<int>       m_bodyIndices;
+    void updateBodyOrder() const;
+
+    // static bodies first, then by material, rebuilt with m_bodyOrder
+    mutable vector<Body*>     m_renderOrder;
 };
 
 
@@ -0,0 +1,761 @@
+#include <cstring>
+#include "level_compiler.h"
+#include "file.h"
+#include "xml.h"
+#include "asset_cache.h"
+#include "task_pool.h"
+
+// parsed level file, kept for the next level compiled from it, text
+// points into the mapped file
+class LevelFile : public Asset
+{
+public:
+    LevelFile(const string& filename) : m_file(filename)
+    {
+        if (m_file.is_open())
+        {
+            m_xml.load(m_file);
+        }
+    }
+
+    size_t size() const { return m_file.size() + m_xml.size(); }
+
+    File::Reader m_file;
+    XMLdocument  m_xml;
+};
+
+class LevelFileTask : public Task
+{
+public:
+    LevelFileTask(const string& filename, unsigned int hash) :
+        m_filename(filename), m_hash(hash), m_file(NULL) {}
+
+    void run() { m_file = new LevelFile(m_filename); }
+
+    string       m_filename;
+    unsigned int m_hash;
+    LevelFile*   m_file;
+};
+
+static void setVector(float* v, const XMLelement& node, const char* attributeSymbols)
+{
+    Vector vector = node.getAttributesInVector(attributeSymbols);
+    for (size_t i = 0; attributeSymbols[i] != 0; i++)
+    {
+        v[i] = vector[i];
+    }
+}
+
+static RecordRange makeRange(size_t first, size_t end)
+{
+    RecordRange range;
+    range.first = static_cast<unsigned int>(first);
+    range.count = static_cast<unsigned int>(end - first);
+    return range;
+}
+
+LevelCompiler::LevelCompiler() : m_skybox(), m_defaults(NO_INDEX)
+{
+    memset(&m_header, 0, sizeof(m_header));
+    m_header.gravity[1] = -9.81f;
+
+    // offset 0 is the empty string
+    addString("");
+}
+
+void LevelCompiler::compile(const string& levelFile)
+{
+    prefetch(levelFile);
+    load(levelFile);
+    for each_const(vector<LevelFile*>, m_prefetched, iter)
+    {
+        AssetCache::instance->release(*iter);
+    }
+    m_prefetched.clear();
+
+    m_header.magic = LEVEL_MAGIC;
+    m_header.version = LEVEL_VERSION;
+    m_header.skybox = addString(m_skybox);
+
+    m_blob.assign(sizeof(LevelHeader), 0);
+    writeArray(m_header.sources, m_sources);
+    writeArray(m_header.music, m_music);
+    writeArray(m_header.propertyNames, m_propertyNames);
+    writeArray(m_header.materials, m_materials);
+    writeArray(m_header.properties, m_properties);
+    writeArray(m_header.sounds, m_sounds);
+    writeArray(m_header.collisions, m_collisions);
+    writeArray(m_header.faces, m_faces);
+    writeArray(m_header.bodies, m_bodies);
+    writeArray(m_header.bodyCollisions, m_bodyCollisions);
+    writeArray(m_header.fences, m_fences);
+    writeArray(m_header.points, m_points);
+    writeArray(m_header.strings, m_strings);
+
+    m_header.size = static_cast<unsigned int>(m_blob.size());
+    memcpy(&m_blob[0], &m_header, sizeof(LevelHeader));
+}
+
+const bytes& LevelCompiler::getBlob() const
+{
+    return m_blob;
+}
+
+template <typename T>
+void LevelCompiler::writeArray(RecordArray& array, const vector<T>& records)
+{
+    array.offset = static_cast<unsigned int>(m_blob.size());
+    array.count = static_cast<unsigned int>(records.size());
+    if (!records.empty())
+    {
+        const byte* data = reinterpret_cast<const byte*>(&records[0]);
+        m_blob.insert(m_blob.end(), data, data + records.size() * sizeof(T));
+    }
+    m_blob.resize((m_blob.size() + 3) & ~3, 0);
+}
+
+unsigned int LevelCompiler::addString(const string& text)
+{
+    UIntMap::const_iterator iter = m_stringOffsets.find(text);
+    if (iter != m_stringOffsets.end())
+    {
+        return iter->second;
+    }
+    unsigned int offset = static_cast<unsigned int>(m_strings.size());
+    m_strings.insert(m_strings.end(), text.c_str(), text.c_str() + text.size() + 1);
+    m_stringOffsets.insert(make_pair(text, offset));
+    return offset;
+}
+
+unsigned int LevelCompiler::getPropertyIndex(const string& name)
+{
+    if (name.empty())
+    {
+        return NO_INDEX;
+    }
+
+    UIntMap::const_iterator iter = m_propertyIndices.find(name);
+    if (iter != m_propertyIndices.end())
+    {
+        return iter->second;
+    }
+    unsigned int index = static_cast<unsigned int>(m_propertyNames.size());
+    m_propertyNames.push_back(addString(name));
+    m_propertyIndices.insert(make_pair(name, index));
+    return index;
+}
+
+unsigned int LevelCompiler::getMaterialIndex(const string& name) const
+{
+    UIntMap::const_iterator iter = m_materialIndices.find(name);
+    if (iter == m_materialIndices.end())
+    {
+        Exception("Couldn't find material '" + name + "'");
+    }
+    return iter->second;
+}
+
+// Parses the files of the link graph that are not in AssetCache, all files
+// linked from the previous round at once. Missing files and links without
+// a file are left for load() to report in order.
+void LevelCompiler::prefetch(const string& levelFile)
+{
+    StringSet seen;
+    seen.insert(levelFile);
+    StringVector round(1, levelFile);
+    while (!round.empty())
+    {
+        vector<LevelFile*> files;
+        vector<LevelFileTask*> tasks;
+        for each_const(StringVector, round, iter)
+        {
+            string filename = "/data/level/" + *iter;
+            unsigned int hash = AssetCache::hashFile(filename);
+            LevelFile* file = static_cast<LevelFile*>(AssetCache::instance->acquire(filename, hash));
+            if (file != NULL)
+            {
+                files.push_back(file);
+            }
+            else if (hash != 0)
+            {
+                tasks.push_back(new LevelFileTask(filename, hash));
+            }
+        }
+
+        TaskPool pool(tasks.size() > 1 ? TaskPool::defaultThreads() : 0);
+        for each_const(vector<LevelFileTask*>, tasks, iter)
+        {
+            pool.add(*iter);
+        }
+        pool.wait();
+
+        for each_const(vector<LevelFileTask*>, tasks, iter)
+        {
+            LevelFileTask* task = *iter;
+            if (task->m_file->m_file.is_open())
+            {
+                AssetCache::instance->add(task->m_filename, task->m_hash, task->m_file);
+                files.push_back(task->m_file);
+            }
+            else
+            {
+                delete task->m_file;
+            }
+            delete task;
+        }
+        m_prefetched.insert(m_prefetched.end(), files.begin(), files.end());
+
+        round.clear();
+        for each_const(vector<LevelFile*>, files, iter)
+        {
+            const XMLelement& xml = (*iter)->m_xml.root();
+            for each_const(XMLelements, xml.childs, node)
+            {
+                if (node->name == "link" && node->hasAttribute("file"))
+                {
+                    string link = node->getAttribute("file");
+                    if (seen.insert(link).second)
+                    {
+                        round.push_back(link);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LevelCompiler::load(const string& levelFile)
+{
+    clog << "Reading '" << levelFile << "' data." << endl;
+
+    if (foundIn(m_loaded, levelFile))
+    {
+        clog << "ERROR: " << levelFile << " already is loaded!" << endl;
+        return;
+    }
+    m_loaded.insert(levelFile);
+
+    string filename = "/data/level/" + levelFile;
+    unsigned int hash = AssetCache::hashFile(filename);
+    LevelFile* file = static_cast<LevelFile*>(AssetCache::instance->acquire(filename, hash));
+    if (file == NULL)
+    {
+        file = new LevelFile(filename);
+        if (!file->m_file.is_open())
+        {
+            Exception("Level file '" + levelFile + "' not found");  
+        }
+        AssetCache::instance->add(filename, hash, file);
+    }
+    const XMLelement& xml = file->m_xml.root();
+
+    SourceRecord source;
+    source.name = addString(levelFile);
+    source.hash = hash;
+    m_sources.push_back(source);
+
+    for each_const(XMLelements, xml.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "gravity")
+        {
+            setVector(m_header.gravity, node, "xyz");
+        }
+        else if (node.name == "music")
+        {
+            m_music.push_back(addString(node.getAttribute("name")));
+        }
+        else if (node.name == "skybox")
+        {
+            m_skybox = node.getAttribute("name");
+        }
+        else if (node.name == "link")
+        {
+            load(node.getAttribute("file"));
+        }
+        else if (node.name == "bodies")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "body")
+                {
+                    addBody(node);
+                }
+                else
+                {
+                    Exception("Invalid body, unknown node - " + node.name);
+                }
+            }
+        }
+        else if (node.name == "materials")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "material")
+                {
+                    addMaterial(node);
+                }
+                else
+                {
+                    Exception("Invalid materials, unknown node - " + node.name);
+                }
+            }
+        }
+        else if (node.name == "collisions")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "collision")
+                {
+                    addCollision(node);
+                }
+                else
+                {
+                    Exception("Invalid collisions, unknown node - " + node.name);
+                }
+            }
+        }
+        else if (node.name == "joints")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "joint")
+                {
+                    // TODO: load joints
+                }
+                else
+                {
+                    Exception("Invalid joint, unknown node - " + node.name);
+                }
+            }
+        }
+        else if (node.name == "properties")
+        {
+            addProperties(node);
+        }
+        else if (node.name == "defaultProperties")
+        {
+            addDefaultProperties(node);
+        }
+        else if (node.name == "fences")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "fence")
+                {
+                    addFence(node);
+                }
+                else
+                {
+                    Exception("Invalid fences, unknown node - " + node.name);
+                }
+            }
+        }
+        else
+        {
+            Exception("Invalid level file, unknown section - " + node.name);
+        }
+    }
+    AssetCache::instance->release(file);
+
+    if (m_skybox.empty())
+    {
+        Exception("Skybox not specified in level file");
+    }
+}
+
+void LevelCompiler::addMaterial(const XMLelement& node)
+{
+    MaterialRecord record;
+    record.id = addString(node.getAttribute("id"));
+    record.texture = NO_INDEX;
+    record.ambient[0] = record.ambient[1] = record.ambient[2] = 0.2f;
+    record.specular[0] = record.specular[1] = record.specular[2] = 0.0f;
+    record.emission[0] = record.emission[1] = record.emission[2] = 0.0f;
+    record.shine = 0.0f;
+
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "texture2D")
+        {
+            record.texture = addString(node.getAttribute("name"));
+        }
+        else if (node.name == "colors")
+        {
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "ambient")
+                {
+                    setVector(record.ambient, node, "rgb");
+                }
+                else if (node.name == "specular")
+                {
+                    setVector(record.specular, node, "rgb");
+                }
+                else if (node.name == "emission")
+                {
+                    setVector(record.emission, node, "rgb");
+                }
+                else if (node.name == "shine")
+                {
+                    record.shine = cast<float>(node.value);
+                }
+                else
+                {
+                    Exception("Invalid color, unknown node - " + node.name);
+                }
+            }
+        }
+        else
+        {
+            Exception("Invalid material, unknown node - " + node.name);
+        }
+    }
+
+    // first one with the id is used
+    string id = node.getAttribute("id");
+    if (!foundIn(m_materialIndices, id))
+    {
+        m_materialIndices.insert(make_pair(id, static_cast<unsigned int>(m_materials.size())));
+        m_materials.push_back(record);
+    }
+}
+
+void LevelCompiler::addProperties(const XMLelement& node)
+{
+    string prop0 = node.getAttribute("property0");
+    string prop1 = node.getAttribute("property1");
+
+    PropertyRecord record;
+    record.isDefault = 0;
+    record.property0 = getPropertyIndex(prop0);
+    record.property1 = getPropertyIndex(prop1);
+
+    pair<uint, uint> key(std::min(record.property0, record.property1),
+                         std::max(record.property0, record.property1));
+    if (!m_propertyPairs.insert(key).second)
+    {
+        Exception("Properties for '" + prop0 + "' and '"
+                                           + prop1 + "' already loaded");
+    }
+
+    if (m_defaults == NO_INDEX)
+    {
+        Exception("Properties for '" + prop0 + "' and '"
+                                           + prop1 + "' before defaultProperties");
+    }
+    const PropertyRecord& def = m_properties[m_defaults];
+
+    record.staticFriction = node.getAttribute("staticFriction", def.staticFriction);
+    record.kineticFriction = node.getAttribute("kineticFriction", def.kineticFriction);
+    record.elasticityCoefficient = node.getAttribute("elasticityCoefficient", def.elasticityCoefficient);
+    record.softnessCoefficient = node.getAttribute("softnessCoefficient", def.softnessCoefficient);
+
+    size_t first = m_sounds.size();
+    for each_const(XMLelements, node.childs, n)
+    {
+        if (n->name == "sound")
+        {
+            m_sounds.push_back(addString(n->getAttribute("name")));
+        }
+        else
+        {
+            Exception("Invalid property node, expected sound child, but got - " + node.name);
+        }       
+    }
+    record.sounds = makeRange(first, m_sounds.size());
+
+    m_properties.push_back(record);
+}
+
+void LevelCompiler::addDefaultProperties(const XMLelement& node)
+{
+    PropertyRecord record;
+    record.isDefault = 1;
+    record.property0 = record.property1 = NO_INDEX;
+    record.staticFriction = node.getAttribute<float>("staticFriction");
+    record.kineticFriction = node.getAttribute<float>("kineticFriction");
+    record.elasticityCoefficient = node.getAttribute<float>("elasticityCoefficient");
+    record.softnessCoefficient = node.getAttribute<float>("softnessCoefficient");
+    record.sounds = makeRange(m_sounds.size(), m_sounds.size());
+
+    m_propertyPairs.insert(make_pair(NO_INDEX, NO_INDEX));
+    if (m_defaults == NO_INDEX)
+    {
+        m_defaults = static_cast<unsigned int>(m_properties.size());
+    }
+    m_properties.push_back(record);
+}
+
+void LevelCompiler::addCollision(const XMLelement& node)
+{
+    string type = node.getAttribute("type");
+    string id = node.getAttribute("id");
+
+    CollisionRecord record;
+    memset(&record, 0, sizeof(record));
+    record.id = addString(id);
+    record.material = NO_INDEX;
+    record.property = NO_INDEX;
+    record.heightmap = NO_INDEX;
+    record.size[0] = record.size[1] = record.size[2] = 1.0f;
+    
+    if (type == "box")
+    {
+        record.type = COLLISION_BOX;
+        addConvex(node, record);
+    }    
+    else if (type == "sphere")
+    {
+        record.type = COLLISION_SPHERE;
+        addConvex(node, record);
+    }
+    else if (type == "cylinder")
+    {
+        record.type = COLLISION_CYLINDER;
+        addConvex(node, record);
+    }
+    else if (type == "cone")
+    {
+        record.type = COLLISION_CONE;
+        addConvex(node, record);
+    }
+    else if (type == "tree")
+    {
+        record.type = COLLISION_TREE;
+        addTree(node, record);
+    }
+    else if (type == "heightmap")
+    {
+        record.type = COLLISION_HEIGHTMAP;
+        addHeightmap(node, record);
+    }
+    else
+    {
+        Exception("Unknown collision type - " + type);
+    }
+
+    m_collisionIndices[id] = static_cast<unsigned int>(m_collisions.size());
+    m_collisions.push_back(record);
+}
+
+void LevelCompiler::addConvex(const XMLelement& node, CollisionRecord& record)
+{
+    if (node.hasAttribute("property"))
+    {
+        record.property = getPropertyIndex(node.getAttribute("property"));
+    }
+    if (node.hasAttribute("material"))
+    {
+        record.material = getMaterialIndex(node.getAttribute("material"));
+    }
+    record.mass = node.getAttribute<float>("mass");
+
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "offset")
+        {
+            setVector(record.offset, node, "xyz");
+            record.hasOffset = 1;
+        }
+        else if (node.name == "rotation")
+        {
+            setVector(record.rotation, node, "xyz");
+            record.hasOffset = 1;
+        }
+        else if (node.name == "size" && record.type == COLLISION_BOX)
+        {
+            setVector(record.size, node, "xyz");
+        }
+        else if (node.name == "radius" && record.type == COLLISION_SPHERE)
+        {
+            setVector(record.size, node, "xyz");
+        }
+        else if (node.name == "radius" && record.type != COLLISION_BOX)
+        {
+            record.size[0] = cast<float>(node.value);
+        }
+        else if (node.name == "height" && (record.type == COLLISION_CYLINDER || record.type == COLLISION_CONE))
+        {
+            record.size[1] = cast<float>(node.value);
+        }
+        else
+        {
+            Exception("Invalid collision, unknown node - " + node.name);
+        }
+    }
+}
+
+void LevelCompiler::addTree(const XMLelement& node, CollisionRecord& record)
+{
+    size_t first = m_faces.size();
+
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "face")
+        {
+            FaceRecord face;
+            string material = node.getAttribute("material");
+            face.material = material.empty() ? NO_INDEX : getMaterialIndex(material);
+            face.property = getPropertyIndex(node.getAttribute("property"));
+
+            int count = 0;
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "vertex")
+                {
+                    if (count < 4)
+                    {
+                        float* vertex = face.vertices[count];
+                        setVector(vertex, node, "xyz");
+                        vertex[3] = node.getAttribute<float>("u");
+                        vertex[4] = node.getAttribute<float>("v");
+                    }
+                    count++;
+                }
+                else
+                { 
+                    Exception("Invalid face, unknown node - " + node.name);
+                }
+            }
+            if (count != 4)
+            {
+                Exception("Face must have 4 vertexes");
+            }
+            m_faces.push_back(face);
+        }
+        else
+        {
+            Exception("Invalid collision, unknown node - " + node.name);
+        }
+    }
+
+    record.faces = makeRange(first, m_faces.size());
+}
+
+void LevelCompiler::addHeightmap(const XMLelement& node, CollisionRecord& record)
+{
+    string hmap;
+    float size = 0.0f;
+    string material;
+    float repeat = 0.0f;
+
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "heightmap")
+        {
+            hmap = node.getAttribute("name");
+            size = node.getAttribute<float>("size");
+            material = node.getAttribute("material");
+            repeat = node.getAttribute<float>("repeat");
+        }
+        else
+        {
+            Exception("Invalid collision, unknown node - " + node.name);
+        }
+    }
+    
+    if (hmap.empty())
+    {
+        Exception("Invalid heightmap collision, heightmap name not specified");
+    }
+    if (material.empty())
+    {
+        Exception("Invalid heightmap collision, material name not specified");
+    }
+    if (repeat == 0.0f)
+    {
+        Exception("Invalid heightmap collision, repeat not specified");
+    }
+    if (!foundIn(m_materialIndices, material))
+    {
+        Exception("Material '" + material + "' not found!");
+    }
+
+    record.heightmap = addString(hmap);
+    record.size[0] = size;
+    record.size[1] = repeat;
+    record.material = getMaterialIndex(material);
+
+    // heightmap faces are always grass
+    getPropertyIndex("grass");
+}
+
+void LevelCompiler::addBody(const XMLelement& node)
+{
+    BodyRecord record;
+    memset(&record, 0, sizeof(record));
+    record.id = addString(node.getAttribute("id"));
+    record.soundable = node.getAttribute<int>("soundable", 0) == 1;
+    record.important = node.getAttribute<int>("important", 0) == 1;
+
+    size_t first = m_bodyCollisions.size();
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "position")
+        {
+            setVector(record.position, node, "xyz");
+        }
+        else if (node.name == "rotation")
+        {
+            setVector(record.rotation, node, "xyz");
+        }
+        else if (node.name == "collision")
+        { 
+            UIntMap::const_iterator collision = m_collisionIndices.find(node.value);
+            if (collision == m_collisionIndices.end())
+            {
+                Exception("Could not find specified collision '" + node.value + "'");
+            }
+            m_bodyCollisions.push_back(collision->second);
+        }
+        else
+        {
+            Exception("Invalid body, unknown node - " + node.name);
+        }
+    }
+
+    if (m_bodyCollisions.size() == first)
+    {
+        Exception("No collisions were found for body '" + node.getAttribute("id") + "'");
+    }
+    record.collisions = makeRange(first, m_bodyCollisions.size());
+
+    m_bodies.push_back(record);
+}
+
+void LevelCompiler::addFence(const XMLelement& node)
+{
+    size_t first = m_points.size();
+    for each_const(XMLelements, node.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if (node.name == "point")
+        {
+            PointRecord point;
+            setVector(point.xyz, node, "xyz");
+            m_points.push_back(point);
+        }
+        else
+        {
+            Exception("Invalid fence, unknown node - " + node.name);
+        }
+    }
+    if (m_points.size() - first < 2)
+    {
+        Exception("Too less points in fence, expected at least 2");
+    }
+    m_fences.push_back(makeRange(first, m_points.size()));
+}
@@ -0,0 +1,71 @@
+#ifndef __LEVEL_COMPILER_H__
+#define __LEVEL_COMPILER_H__
+
+#include "common.h"
+#include "level_format.h"
+
+class XMLelement;
+class LevelFile;
+
+// Flattens a level XML file and its links into a compiled level, with the
+// checks Level did when it was loading the XML itself. Parsed files are
+// kept in AssetCache, files missing there are parsed in parallel first.
+class LevelCompiler : public NoCopy
+{
+public:
+    LevelCompiler();
+
+    void compile(const string& levelFile); // relative to /data/level/
+    const bytes& getBlob() const;
+
+private:
+    void prefetch(const string& levelFile);
+    void load(const string& levelFile);
+    void addMaterial(const XMLelement& node);
+    void addProperties(const XMLelement& node);
+    void addDefaultProperties(const XMLelement& node);
+    void addCollision(const XMLelement& node);
+    void addConvex(const XMLelement& node, CollisionRecord& record);
+    void addTree(const XMLelement& node, CollisionRecord& record);
+    void addHeightmap(const XMLelement& node, CollisionRecord& record);
+    void addBody(const XMLelement& node);
+    void addFence(const XMLelement& node);
+
+    unsigned int addString(const string& text);
+    unsigned int getPropertyIndex(const string& name); // NO_INDEX for default
+    unsigned int getMaterialIndex(const string& name) const;
+
+    template <typename T>
+    void writeArray(RecordArray& array, const vector<T>& records);
+
+    LevelHeader             m_header;
+    string                  m_skybox;
+    StringSet               m_loaded;
+    vector<LevelFile*>      m_prefetched;      // referenced until compiled
+
+    vector<char>            m_strings;
+    UIntMap                 m_stringOffsets;
+
+    vector<SourceRecord>    m_sources;
+    UIntVector              m_music;
+    UIntVector              m_propertyNames;
+    vector<MaterialRecord>  m_materials;
+    vector<PropertyRecord>  m_properties;
+    UIntVector              m_sounds;
+    vector<CollisionRecord> m_collisions;
+    vector<FaceRecord>      m_faces;
+    vector<BodyRecord>      m_bodies;
+    UIntVector              m_bodyCollisions;
+    vector<RecordRange>     m_fences;
+    vector<PointRecord>     m_points;
+
+    UIntMap                 m_propertyIndices;
+    UIntMap                 m_materialIndices;
+    UIntMap                 m_collisionIndices;  // latest with that id
+    set<pair<uint, uint> >  m_propertyPairs;
+    unsigned int            m_defaults;          // first defaultProperties
+
+    bytes                   m_blob;
+};
+
+#endif
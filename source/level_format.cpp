@@ -0,0 +1,82 @@
+#include "level_format.h"
+#include "asset_cache.h"
+
+bool CompiledLevel::check(const void* data, size_t size)
+{
+    if (size < sizeof(LevelHeader))
+    {
+        return false;
+    }
+    const LevelHeader* header = static_cast<const LevelHeader*>(data);
+    return header->magic == LEVEL_MAGIC && header->version == LEVEL_VERSION && header->size == size;
+}
+
+CompiledLevel::CompiledLevel(const void* data, size_t size) :
+    m_data(static_cast<const byte*>(data)),
+    m_header(static_cast<const LevelHeader*>(data))
+{
+    if (!check(data, size))
+    {
+        Exception("Invalid compiled level");
+    }
+
+    checkArray(m_header->strings, sizeof(char));
+    checkArray(m_header->sources, sizeof(SourceRecord));
+    checkArray(m_header->music, sizeof(unsigned int));
+    checkArray(m_header->propertyNames, sizeof(unsigned int));
+    checkArray(m_header->materials, sizeof(MaterialRecord));
+    checkArray(m_header->properties, sizeof(PropertyRecord));
+    checkArray(m_header->sounds, sizeof(unsigned int));
+    checkArray(m_header->collisions, sizeof(CollisionRecord));
+    checkArray(m_header->faces, sizeof(FaceRecord));
+    checkArray(m_header->bodies, sizeof(BodyRecord));
+    checkArray(m_header->bodyCollisions, sizeof(unsigned int));
+    checkArray(m_header->fences, sizeof(RecordRange));
+    checkArray(m_header->points, sizeof(PointRecord));
+
+    // every string is terminated, so the last one is too
+    const RecordArray& strings = m_header->strings;
+    if (strings.count == 0 || m_data[strings.offset + strings.count - 1] != 0)
+    {
+        Exception("Invalid compiled level, strings are not terminated");
+    }
+}
+
+void CompiledLevel::checkArray(const RecordArray& array, size_t recordSize) const
+{
+    if (array.offset % 4 != 0 || array.offset > m_header->size ||
+        array.count > (m_header->size - array.offset) / recordSize)
+    {
+        Exception("Invalid compiled level, record array out of range");
+    }
+}
+
+bool CompiledLevel::isCurrent() const
+{
+    for (unsigned int i = 0; i < m_header->sources.count; i++)
+    {
+        const SourceRecord& source = get<SourceRecord>(m_header->sources, i);
+
+        // shipped without the XML is fine too
+        unsigned int hash = AssetCache::hashFile("/data/level/" + string(getString(source.name)));
+        if (hash != 0 && hash != source.hash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const LevelHeader& CompiledLevel::header() const
+{
+    return *m_header;
+}
+
+const char* CompiledLevel::getString(unsigned int offset) const
+{
+    if (offset >= m_header->strings.count)
+    {
+        Exception("Invalid compiled level, string out of range");
+    }
+    return reinterpret_cast<const char*>(m_data + m_header->strings.offset + offset);
+}
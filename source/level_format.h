@@ -0,0 +1,180 @@
+#ifndef __LEVEL_FORMAT_H__
+#define __LEVEL_FORMAT_H__
+
+#include "common.h"
+
+// Compiled level: a level file with all its links flattened into one blob
+// of POD records, used in place from the mapped .lvl file. LevelCompiler
+// writes it from the XML. Names are offsets into the string block and
+// references are indices into other record arrays, NO_INDEX if not given.
+// Bump LEVEL_VERSION whenever a record changes.
+
+static const unsigned int LEVEL_MAGIC   = 0x4c335153; // "SQ3L"
+static const unsigned int LEVEL_VERSION = 1;
+static const unsigned int NO_INDEX      = 0xFFFFFFFF;
+
+enum CollisionType
+{
+    COLLISION_BOX,
+    COLLISION_SPHERE,
+    COLLISION_CYLINDER,
+    COLLISION_CONE,
+    COLLISION_TREE,
+    COLLISION_HEIGHTMAP
+};
+
+struct RecordArray
+{
+    unsigned int offset;    // in bytes from the start of the blob
+    unsigned int count;
+};
+
+struct RecordRange
+{
+    unsigned int first;     // index into another array
+    unsigned int count;
+};
+
+struct LevelHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int size;
+
+    float        gravity[3];
+    unsigned int skybox;
+
+    RecordArray  strings;        // char
+    RecordArray  sources;        // SourceRecord
+    RecordArray  music;          // unsigned int, name
+    RecordArray  propertyNames;  // unsigned int, name in order of first use
+    RecordArray  materials;      // MaterialRecord
+    RecordArray  properties;     // PropertyRecord
+    RecordArray  sounds;         // unsigned int, name
+    RecordArray  collisions;     // CollisionRecord
+    RecordArray  faces;          // FaceRecord
+    RecordArray  bodies;         // BodyRecord
+    RecordArray  bodyCollisions; // unsigned int, collision index
+    RecordArray  fences;         // RecordRange of points
+    RecordArray  points;         // PointRecord
+};
+
+// XML file the level was compiled from
+struct SourceRecord
+{
+    unsigned int name;      // relative to /data/level/
+    unsigned int hash;      // AssetCache::hashFile
+};
+
+struct MaterialRecord
+{
+    unsigned int id;
+    unsigned int texture;   // name, NO_INDEX for none
+    float        ambient[3];
+    float        specular[3];
+    float        emission[3];
+    float        shine;
+};
+
+// property indices are into propertyNames, NO_INDEX is the default
+struct PropertyRecord
+{
+    unsigned int isDefault; // defaultProperties, property0/1 unused
+    unsigned int property0;
+    unsigned int property1;
+    float        staticFriction;
+    float        kineticFriction;
+    float        elasticityCoefficient;
+    float        softnessCoefficient;
+    RecordRange  sounds;
+};
+
+struct CollisionRecord
+{
+    unsigned int id;
+    unsigned int type;      // CollisionType
+    unsigned int material;  // material index, NO_INDEX for none
+    unsigned int property;  // propertyNames index, NO_INDEX is the default
+    float        mass;
+    unsigned int hasOffset;
+    float        offset[3];
+    float        rotation[3]; // degrees
+
+    // box size, sphere radius, cylinder or cone radius and height,
+    // heightmap size and repeat
+    float        size[3];
+    unsigned int heightmap; // name
+    RecordRange  faces;     // tree
+};
+
+struct FaceRecord
+{
+    unsigned int material;  // material index, NO_INDEX for none
+    unsigned int property;  // propertyNames index, NO_INDEX is the default
+    float        vertices[4][5]; // x, y, z, u, v
+};
+
+struct PointRecord
+{
+    float        xyz[3];
+};
+
+struct BodyRecord
+{
+    unsigned int id;
+    unsigned int soundable;
+    unsigned int important;
+    float        position[3];
+    float        rotation[3]; // degrees
+    RecordRange  collisions;  // bodyCollisions
+};
+
+// checked view of a compiled level, data must outlive it
+class CompiledLevel : public NoCopy
+{
+public:
+    // false if data is not a compiled level of this version
+    static bool check(const void* data, size_t size);
+
+    CompiledLevel(const void* data, size_t size);
+
+    // false if some source XML file was changed after compiling
+    bool isCurrent() const;
+
+    const LevelHeader& header() const;
+    const char* getString(unsigned int offset) const;
+
+    template <typename T>
+    const T& get(const RecordArray& array, unsigned int index) const;
+
+    template <typename T>
+    const T& get(const RecordArray& array, const RecordRange& range, unsigned int index) const;
+
+private:
+    const byte*        m_data;
+    const LevelHeader* m_header;
+
+    void checkArray(const RecordArray& array, size_t recordSize) const;
+};
+
+template <typename T>
+const T& CompiledLevel::get(const RecordArray& array, unsigned int index) const
+{
+    if (index >= array.count)
+    {
+        Exception("Invalid compiled level, record index out of range");
+    }
+    return reinterpret_cast<const T*>(m_data + array.offset)[index];
+}
+
+template <typename T>
+const T& CompiledLevel::get(const RecordArray& array, const RecordRange& range, unsigned int index) const
+{
+    if (index >= range.count)
+    {
+        Exception("Invalid compiled level, record index out of range");
+    }
+    return get<T>(array, range.first + index);
+}
+
+#endif
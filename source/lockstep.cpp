@@ -0,0 +1,590 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+
+#include "lockstep.h"
+#include "world.h"
+#include "player_external.h"
+#include "game.h"
+#include "varint.h"
+
+static const byte LOCKSTEP_MAGIC[2] = { 'S', 'L' };
+
+// inputs in one packet, older ones are resent until acked
+static const int MAX_PACKET_INPUTS = 64;
+static const size_t MAX_PACKET_SIZE = 1500;
+
+// final world hashes kept for comparing with late peers
+static const int HASH_HISTORY = 64;
+
+static void putUInt(bytes& out, unsigned int value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out.push_back(static_cast<byte>(value >> (8 * i)));
+    }
+}
+
+static bool getUInt(const bytes& in, size_t& pos, unsigned int& value)
+{
+    if (pos > in.size() || in.size() - pos < 4)
+    {
+        return false;
+    }
+    value = in[pos] | (in[pos + 1] << 8) | (in[pos + 2] << 16) | (static_cast<unsigned int>(in[pos + 3]) << 24);
+    pos += 4;
+    return true;
+}
+
+static short quantize(float value)
+{
+    return static_cast<short>(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+}
+
+LockstepInput::LockstepInput() : x(0), z(0), buttons(0)
+{
+}
+
+bool LockstepInput::operator == (const LockstepInput& other) const
+{
+    return x == other.x && z == other.z && buttons == other.buttons;
+}
+
+bool LockstepInput::operator != (const LockstepInput& other) const
+{
+    return !(*this == other);
+}
+
+UdpLink::UdpLink(int port, const StringVector& addresses) :
+    m_socket(-1),
+    m_addresses(addresses.size())
+{
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0)
+    {
+        Exception("Can not create UDP socket");
+    }
+    fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<unsigned short>(port));
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+    {
+        Exception("Can not bind UDP port " + cast<string>(port));
+    }
+
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        const string& address = addresses[i];
+        size_t colon = address.rfind(':');
+        if (colon == string::npos)
+        {
+            continue;
+        }
+
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        addrinfo* info;
+        if (getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &info) != 0)
+        {
+            Exception("Can not resolve '" + address + "'");
+        }
+        const byte* addr = reinterpret_cast<const byte*>(info->ai_addr);
+        m_addresses[i].assign(addr, addr + info->ai_addrlen);
+        freeaddrinfo(info);
+    }
+}
+
+UdpLink::~UdpLink()
+{
+    close(m_socket);
+}
+
+void UdpLink::send(int peer, const bytes& packet)
+{
+    if (peer < 0 || peer >= static_cast<int>(m_addresses.size()) || m_addresses[peer].empty())
+    {
+        return;
+    }
+
+    // lost packets are resent by lockstep, errors are the same as loss
+    const bytes& address = m_addresses[peer];
+    sendto(m_socket, &packet[0], packet.size(), 0,
+           reinterpret_cast<const sockaddr*>(&address[0]), static_cast<socklen_t>(address.size()));
+}
+
+bool UdpLink::receive(bytes& packet)
+{
+    packet.resize(MAX_PACKET_SIZE);
+    ssize_t size = recvfrom(m_socket, &packet[0], packet.size(), 0, NULL, NULL);
+    if (size < 0)
+    {
+        packet.clear();
+        return false;
+    }
+    packet.resize(static_cast<size_t>(size));
+    return true;
+}
+
+LockstepStats::LockstepStats() :
+    rollbacks(0),
+    resimulated(0),
+    maxRollback(0),
+    stalls(0),
+    rttCount(0),
+    rttTotal(0),
+    rttMax(0),
+    packetsSent(0),
+    packetsReceived(0),
+    hashChecks(0),
+    desyncs(0),
+    desyncTick(-1)
+{
+}
+
+Lockstep::Lockstep(World* world, LockstepLink* link, int local, const bool human[4],
+                   int delay, int maxRollback, void (*advanceClock)(float seconds)) :
+    m_world(world),
+    m_link(link),
+    m_local(local),
+    m_delay(delay),
+    m_advanceClock(advanceClock),
+    m_tick(0),
+    m_rollback(INT_MAX),
+    m_firstInput(0),
+    m_states(maxRollback + 1),
+    m_hashes(HASH_HISTORY)
+{
+    if (m_world->m_localPlayers.size() != 4 || !human[m_local])
+    {
+        Exception("Lockstep needs four players and a human local player");
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        m_human[i] = human[i];
+        if (m_human[i] && dynamic_cast<ExternalPlayer*>(m_world->m_localPlayers[i]) == NULL)
+        {
+            Exception("Human players in lockstep must be ExternalPlayers");
+        }
+
+        // first delay ticks have no input on every peer
+        m_inputs[i].resize(m_delay);
+        m_received[i] = m_delay;
+        m_acked[i] = m_delay;
+        m_remoteTick[i] = -1;
+        m_remoteHash[i] = 0;
+        m_detailTick[i] = -1;
+        m_reported[i] = false;
+    }
+}
+
+Lockstep::~Lockstep()
+{
+}
+
+void Lockstep::setLocalInput(const Vector& direction, bool jump, bool kick)
+{
+    Vector dir(direction.x, 0.0f, direction.z);
+    float length = dir.magnitude();
+    if (length > 1.0f)
+    {
+        dir /= length;
+    }
+
+    m_localInput.x = quantize(dir.x);
+    m_localInput.z = quantize(dir.z);
+    m_localInput.buttons = (jump ? LockstepInput::JUMP : 0) | (kick ? LockstepInput::KICK : 0);
+}
+
+void Lockstep::poll()
+{
+    receive();
+    rollback();
+    checkHashes();
+    send();
+}
+
+bool Lockstep::advance()
+{
+    receive();
+    rollback();
+
+    // every tick past confirmed one may have to be simulated again
+    if (m_tick - getConfirmedTick() >= static_cast<int>(m_states.size()) - 1)
+    {
+        m_stats.stalls++;
+        send();
+        return false;
+    }
+
+    m_inputs[m_local].push_back(m_localInput);
+    m_received[m_local]++;
+    m_localInput = LockstepInput();
+
+    simulate(m_tick);
+    m_tick++;
+
+    checkHashes();
+    send();
+    trimInputs();
+    return true;
+}
+
+int Lockstep::getTick() const
+{
+    return m_tick;
+}
+
+int Lockstep::getConfirmedTick() const
+{
+    int confirmed = INT_MAX;
+    for (int i = 0; i < 4; i++)
+    {
+        if (m_human[i])
+        {
+            confirmed = std::min(confirmed, m_received[i]);
+        }
+    }
+    return confirmed;
+}
+
+const LockstepStats& Lockstep::getStats() const
+{
+    return m_stats;
+}
+
+void Lockstep::receive()
+{
+    bytes packet;
+    while (m_link->receive(packet))
+    {
+        m_stats.packetsReceived++;
+
+        // anything malformed is dropped like a lost packet
+        if (packet.size() < 3 || packet[0] != LOCKSTEP_MAGIC[0] || packet[1] != LOCKSTEP_MAGIC[1])
+        {
+            continue;
+        }
+        int slot = packet[2];
+        if (slot >= 4 || slot == m_local || !m_human[slot])
+        {
+            continue;
+        }
+
+        size_t pos = 3;
+        unsigned int ack, first, count;
+        if (!getVarint(packet, pos, ack) || !getVarint(packet, pos, first) ||
+            !getVarint(packet, pos, count) || count > static_cast<unsigned int>(MAX_PACKET_INPUTS) ||
+            count > (packet.size() - pos) / 5)
+        {
+            continue;
+        }
+        size_t hashPos = pos + 5 * count;
+
+        // local input of tick ack-1 was given delay ticks before it
+        if (static_cast<int>(ack) > m_acked[slot] && static_cast<int>(ack) <= m_received[m_local])
+        {
+            m_acked[slot] = ack;
+
+            int rtt = m_tick - (static_cast<int>(ack) - 1 - m_delay);
+            m_stats.rttCount++;
+            m_stats.rttTotal += rtt;
+            m_stats.rttMax = std::max(m_stats.rttMax, rtt);
+        }
+
+        std::deque<LockstepInput>& inputs = m_inputs[slot];
+        for (unsigned int i = 0; i < count; i++, pos += 5)
+        {
+            int tick = static_cast<int>(first + i);
+            if (tick < m_received[slot])
+            {
+                continue;
+            }
+            if (tick > m_received[slot])
+            {
+                break;
+            }
+
+            LockstepInput input;
+            input.x = static_cast<short>(packet[pos] | (packet[pos + 1] << 8));
+            input.z = static_cast<short>(packet[pos + 2] | (packet[pos + 3] << 8));
+            input.buttons = packet[pos + 4];
+
+            if (tick - m_firstInput < static_cast<int>(inputs.size()))
+            {
+                // already simulated with predicted input
+                if (inputs[tick - m_firstInput] != input)
+                {
+                    m_rollback = std::min(m_rollback, tick);
+                }
+                inputs[tick - m_firstInput] = input;
+            }
+            else
+            {
+                inputs.push_back(input);
+            }
+            m_received[slot]++;
+        }
+
+        // hash of newest final tick + 1, then parts of desynced tick + 1
+        unsigned int hashTick, total;
+        if (!getVarint(packet, hashPos, hashTick) || hashTick == 0 || !getUInt(packet, hashPos, total))
+        {
+            continue;
+        }
+        if (static_cast<int>(hashTick) - 1 > m_remoteTick[slot])
+        {
+            m_remoteTick[slot] = hashTick - 1;
+            m_remoteHash[slot] = total;
+        }
+
+        unsigned int detailTick, bodies;
+        WorldHash& detail = m_detail[slot];
+        if (m_reported[slot] || !getVarint(packet, hashPos, detailTick) || detailTick == 0 ||
+            !getUInt(packet, hashPos, detail.m_total) || !getUInt(packet, hashPos, detail.m_random) ||
+            !getUInt(packet, hashPos, detail.m_referee) || !getVarint(packet, hashPos, bodies) ||
+            bodies > m_world->m_level->m_bodies.size() || bodies > (packet.size() - hashPos) / 4)
+        {
+            continue;
+        }
+        detail.m_bodies.resize(bodies);
+        for (unsigned int i = 0; i < bodies; i++)
+        {
+            getUInt(packet, hashPos, detail.m_bodies[i]);
+        }
+        m_detailTick[slot] = detailTick - 1;
+    }
+}
+
+void Lockstep::send()
+{
+    const std::deque<LockstepInput>& inputs = m_inputs[m_local];
+
+    int finalTick = std::min(getConfirmedTick(), m_tick) - 1;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!m_human[i] || i == m_local)
+        {
+            continue;
+        }
+
+        int first = m_acked[i];
+        int count = std::min(m_received[m_local] - first, MAX_PACKET_INPUTS);
+
+        bytes packet(LOCKSTEP_MAGIC, LOCKSTEP_MAGIC + sizeof(LOCKSTEP_MAGIC));
+        packet.push_back(static_cast<byte>(m_local));
+        putVarint(packet, m_received[i]);
+        putVarint(packet, first);
+        putVarint(packet, count);
+        for (int k = first; k < first + count; k++)
+        {
+            const LockstepInput& input = inputs[k - m_firstInput];
+            packet.push_back(static_cast<byte>(input.x));
+            packet.push_back(static_cast<byte>(input.x >> 8));
+            packet.push_back(static_cast<byte>(input.z));
+            packet.push_back(static_cast<byte>(input.z >> 8));
+            packet.push_back(input.buttons);
+        }
+
+        if (finalTick < 0)
+        {
+            putVarint(packet, 0);
+        }
+        else
+        {
+            putVarint(packet, finalTick + 1);
+            putUInt(packet, m_hashes[finalTick % m_hashes.size()].m_total);
+        }
+        if (m_stats.desyncTick < 0)
+        {
+            putVarint(packet, 0);
+        }
+        else
+        {
+            putVarint(packet, m_stats.desyncTick + 1);
+            putUInt(packet, m_desync.m_total);
+            putUInt(packet, m_desync.m_random);
+            putUInt(packet, m_desync.m_referee);
+            putVarint(packet, static_cast<unsigned int>(m_desync.m_bodies.size()));
+            for each_const(UIntVector, m_desync.m_bodies, iter)
+            {
+                putUInt(packet, *iter);
+            }
+        }
+
+        m_link->send(i, packet);
+        m_stats.packetsSent++;
+    }
+}
+
+void Lockstep::rollback()
+{
+    if (m_rollback >= m_tick)
+    {
+        m_rollback = INT_MAX;
+        return;
+    }
+
+    int depth = m_tick - m_rollback;
+    assert(depth < static_cast<int>(m_states.size()));
+
+    m_stats.rollbacks++;
+    m_stats.resimulated += depth;
+    m_stats.maxRollback = std::max(m_stats.maxRollback, depth);
+
+    m_world->loadState(m_states[m_rollback % m_states.size()]);
+    for (int tick = m_rollback; tick < m_tick; tick++)
+    {
+        simulate(tick);
+    }
+    m_rollback = INT_MAX;
+}
+
+void Lockstep::simulate(int tick)
+{
+    // every tick starts from loaded state, Newton caches are flushed the
+    // same way on peers that rolled back and on peers that did not
+    WorldState& state = m_states[tick % m_states.size()];
+    state.clear();
+    m_world->saveState(state);
+    m_world->loadState(state);
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!m_human[i])
+        {
+            continue;
+        }
+
+        std::deque<LockstepInput>& inputs = m_inputs[i];
+        if (tick >= m_received[i])
+        {
+            // prediction is last known input, kick is a single press
+            LockstepInput input;
+            if (m_received[i] > 0)
+            {
+                input = inputs[m_received[i] - 1 - m_firstInput];
+                input.buttons &= ~LockstepInput::KICK;
+            }
+            inputs.resize(std::max(inputs.size(), static_cast<size_t>(tick + 1 - m_firstInput)));
+            inputs[tick - m_firstInput] = input;
+        }
+
+        const LockstepInput& input = inputs[tick - m_firstInput];
+        Vector direction(input.x / 32767.0f, 0.0f, input.z / 32767.0f);
+        static_cast<ExternalPlayer*>(m_world->m_localPlayers[i])->setAction(
+            direction, (input.buttons & LockstepInput::JUMP) != 0, (input.buttons & LockstepInput::KICK) != 0);
+    }
+
+    m_world->control();
+    m_world->update(DT);
+    m_world->updateStep(DT);
+    m_world->prepare();
+
+    if (m_advanceClock != NULL)
+    {
+        m_advanceClock(DT);
+    }
+
+    m_hasher.compute(m_world, m_hashes[tick % m_hashes.size()]);
+}
+
+const WorldHash* Lockstep::getFinalHash(int tick) const
+{
+    if (tick < 0 || tick < m_tick - static_cast<int>(m_hashes.size()) ||
+        tick >= std::min(getConfirmedTick(), m_tick))
+    {
+        return NULL;
+    }
+    return &m_hashes[tick % m_hashes.size()];
+}
+
+void Lockstep::desync(int tick, const WorldHash& hash)
+{
+    if (m_stats.desyncTick < 0)
+    {
+        m_stats.desyncTick = tick;
+        m_desync = hash;
+    }
+}
+
+void Lockstep::checkHashes()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (!m_human[i] || i == m_local)
+        {
+            continue;
+        }
+
+        // remote hashes wait until the same tick is final here
+        int tick = m_remoteTick[i];
+        const WorldHash* hash = getFinalHash(tick);
+        if (hash != NULL)
+        {
+            m_stats.hashChecks++;
+            if (hash->m_total != m_remoteHash[i])
+            {
+                m_stats.desyncs++;
+                desync(tick, *hash);
+            }
+            m_remoteTick[i] = -1;
+        }
+        else if (tick >= 0 && tick < m_tick - static_cast<int>(m_hashes.size()))
+        {
+            m_remoteTick[i] = -1;
+        }
+
+        tick = m_detailTick[i];
+        hash = getFinalHash(tick);
+        if (hash != NULL && !m_reported[i])
+        {
+            if (*hash != m_detail[i])
+            {
+                // peer may not have seen local hash of this tick yet
+                desync(tick, *hash);
+                clog << "Desync with peer " << i << " at tick " << tick << ": "
+                     << hash->difference(m_detail[i], m_world) << " differs." << endl;
+            }
+            m_reported[i] = true;
+            m_detailTick[i] = -1;
+        }
+    }
+}
+
+// inputs before the oldest a rollback, a prediction or a resend can read
+void Lockstep::trimInputs()
+{
+    int oldest = getConfirmedTick() - 1;
+    for (int i = 0; i < 4; i++)
+    {
+        if (m_human[i] && i != m_local)
+        {
+            oldest = std::min(oldest, m_acked[i]);
+        }
+    }
+
+    for (; m_firstInput < oldest; m_firstInput++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (m_human[i])
+            {
+                m_inputs[i].pop_front();
+            }
+        }
+    }
+}
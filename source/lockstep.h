@@ -0,0 +1,153 @@
+#ifndef __LOCKSTEP_H__
+#define __LOCKSTEP_H__
+
+#include <deque>
+#include "common.h"
+#include "vmath.h"
+#include "world_state.h"
+#include "world_hash.h"
+
+class World;
+
+// Deterministic lockstep with rollback: peers exchange only the inputs
+// of their human players, every peer simulates the whole match. Input
+// of the local player is applied delay ticks after it is given, inputs
+// of remote players that did not arrive yet are predicted (last input
+// repeated, without kick), and when real input differs from prediction
+// the world is rolled back to that tick and simulated again.
+//
+// Human slots must be ExternalPlayers (Network::setExternalProfiles),
+// other slots are AI and run the same on every peer. Every peer must
+// start from the same world with the same Randoms seed.
+//
+// Peers also exchange WorldHash of their newest final tick (inputs of
+// all slots known), first mismatch is logged with the part that differs.
+//
+// Only squares3d-lockstep drives it for now, Network::update is still a
+// stub and the menu cannot start a lockstep match.
+
+// One tick of human player input, quantized so every peer applies the
+// same floats.
+struct LockstepInput
+{
+    short x;       // world space direction, 1.0 is 32767
+    short z;
+    byte  buttons; // JUMP, KICK
+
+    enum { JUMP = 1, KICK = 2 };
+
+    LockstepInput();
+    bool operator == (const LockstepInput& other) const;
+    bool operator != (const LockstepInput& other) const;
+};
+
+// Unreliable datagrams between peers, peers are player slots.
+class LockstepLink : public NoCopy
+{
+public:
+    virtual ~LockstepLink() {}
+
+    virtual void send(int peer, const bytes& packet) = 0;
+    virtual bool receive(bytes& packet) = 0; // false when nothing waits
+};
+
+// UDP on all interfaces on port, addresses[i] is "host:port" of slot i,
+// own and AI slots are ignored.
+class UdpLink : public LockstepLink
+{
+public:
+    UdpLink(int port, const StringVector& addresses);
+    ~UdpLink();
+
+    void send(int peer, const bytes& packet);
+    bool receive(bytes& packet);
+
+private:
+    int           m_socket;
+    vector<bytes> m_addresses; // sockaddr_in of every slot, empty if unknown
+};
+
+struct LockstepStats
+{
+    int rollbacks;     // times world was rolled back
+    int resimulated;   // ticks simulated again
+    int maxRollback;   // deepest rollback in ticks
+    int stalls;        // advance calls that waited for remote inputs
+    int rttCount;      // round trips measured by acks, in ticks
+    int rttTotal;
+    int rttMax;
+    int packetsSent;
+    int packetsReceived;
+    int hashChecks;    // remote hashes compared with local ones
+    int desyncs;       // of them different
+    int desyncTick;    // first different tick, -1 if none
+
+    LockstepStats();
+};
+
+class Lockstep : public NoCopy
+{
+public:
+    // local is the slot of this peer, human[i] marks slots driven by
+    // peers, delay and maxRollback are in ticks, advanceClock moves
+    // Timer clock by one tick (see Replay::start)
+    Lockstep(World* world, LockstepLink* link, int local, const bool human[4],
+             int delay = 2, int maxRollback = 8, void (*advanceClock)(float seconds) = NULL);
+    ~Lockstep();
+
+    // input for the next advance, direction longer than 1 is clamped
+    void setLocalInput(const Vector& direction, bool jump, bool kick);
+
+    // receives inputs, rolls back if some prediction was wrong, sends
+    void poll();
+
+    // poll and simulate one DT tick, false when this peer is too far
+    // ahead of remote inputs and has to wait
+    bool advance();
+
+    int getTick() const;          // ticks simulated
+    int getConfirmedTick() const; // inputs of all ticks before it are known
+
+    const LockstepStats& getStats() const;
+
+private:
+    void receive();
+    void send();
+    void rollback();
+    void simulate(int tick);
+    void checkHashes();
+    void desync(int tick, const WorldHash& hash); // remembers first one
+    const WorldHash* getFinalHash(int tick) const;
+    void trimInputs();
+
+    World*              m_world;
+    LockstepLink*       m_link;
+    int                 m_local;
+    bool                m_human[4];
+    int                 m_delay;
+    void              (*m_advanceClock)(float seconds);
+
+    int                 m_tick;
+    int                 m_rollback;    // earliest mispredicted tick
+    LockstepInput       m_localInput;
+
+    std::deque<LockstepInput> m_inputs[4]; // per tick from m_firstInput, predicted past m_received
+    int                 m_firstInput;  // older inputs are not needed any more
+    int                 m_received[4]; // known inputs of every slot
+    int                 m_acked[4];    // local inputs known by every peer
+
+    vector<WorldState>  m_states;      // world at start of recent ticks
+
+    WorldHasher         m_hasher;
+    vector<WorldHash>   m_hashes;      // world after recent ticks
+    int                 m_remoteTick[4]; // newest final hash of peer, -1 if checked
+    unsigned int        m_remoteHash[4];
+    int                 m_detailTick[4]; // parts of peer hash after desync
+    WorldHash           m_detail[4];
+    bool                m_reported[4];
+    WorldHash           m_desync;      // local hash of m_stats.desyncTick
+
+    LockstepStats       m_stats;
+};
+
+#endif
@@ -1,58 +1,21 @@
 #include "material.h"
-#include "xml.h"
+#include "level_format.h"
 #include "video.h"
 #include "texture.h"
 #include "level.h"
 #include "world.h"
 
-Material::Material(const XMLnode& node) :
-    m_id(),
-    m_cAmbient(0.2f, 0.2f, 0.2f),
-    m_cSpecular(0.0f, 0.0f, 0.0f),
-    m_cEmission(0.0f, 0.0f, 0.0f),
-    m_cShine(0.0f),
+Material::Material(const MaterialRecord& record, const CompiledLevel& level) :
+    m_id(level.getString(record.id)),
+    m_cAmbient(record.ambient),
+    m_cSpecular(record.specular),
+    m_cEmission(record.emission),
+    m_cShine(record.shine),
     m_texture(0)
 {
-    m_id = node.getAttribute("id");
-
-    for each_const(XMLnodes, node.childs, iter)
+    if (record.texture != NO_INDEX)
     {
-        const XMLnode& node = *iter;
-        if (node.name == "texture2D")
-        {
-            m_texture = Video::instance->loadTexture(node.getAttribute("name"));
-        }
-        else if (node.name == "colors")
-        {
-            for each_const(XMLnodes, node.childs, iter)
-            {
-                const XMLnode& node = *iter;
-                if (node.name == "ambient")
-                {
-                    m_cAmbient = node.getAttributesInVector("rgb");
-                }
-                else if (node.name == "specular")
-                {
-                    m_cSpecular = node.getAttributesInVector("rgb");
-                }
-                else if (node.name == "emission")
-                {
-                    m_cEmission = node.getAttributesInVector("rgb");
-                }
-                else if (node.name == "shine")
-                {
-                    m_cShine = cast<float>(node.value);
-                }
-                else
-                {
-                    Exception("Invalid color, unknown node - " + node.name);
-                }
-            }
-        }
-        else
-        {
-            Exception("Invalid material, unknown node - " + node.name);
-        }
+        m_texture = Video::instance->loadTexture(level.getString(record.texture));
     }
 }
 
@@ -6,7 +6,8 @@
 
 class Level;
 class Texture;
-class XMLnode;
+class CompiledLevel;
+struct MaterialRecord;
 
 class Material : public NoCopy
 {
@@ -21,7 +22,7 @@ public:
 
     void bind() const;
 private: 
-    Material(const XMLnode& node);
+    Material(const MaterialRecord& record, const CompiledLevel& level);
 
     Texture* m_texture;
 };
@@ -9,8 +9,10 @@ Messages::Messages()
     m_fonts[72] = Font::get("Arial_72pt_bold");
 }
 
-void Messages::update(float delta)
+void Messages::update(float delta, const Matrix& modelview)
 {
+    setModelViewMatrix(modelview);
+
     for each_(MessageVectorsByHeight, m_buffer, iter)
     {
         MessageVector* currentHeightbuffer = &iter->second;
@@ -35,6 +37,11 @@ void Messages::update(float delta)
     }
 }
 
+void Messages::setModelViewMatrix(const Matrix& modelview)
+{
+    m_modelview = modelview;
+}
+
 void Messages::remove(Message* message)
 {
     MessageVector* currentHeightbuffer = &m_buffer.find(message->m_fontSize)->second;
@@ -66,7 +73,8 @@ void Messages::add3D(Message* message)
 {
     const Font* font = m_fonts.find(message->m_fontSize)->second;
 
-    const Matrix& modelview = Video::instance->getModelViewMatrix();
+    // own camera and not the Video one, worlds run on several threads
+    const Matrix& modelview = m_modelview;
     const Matrix& projection = Video::instance->getProjectionMatrix();
     int viewport_width;
     int viewport_height;
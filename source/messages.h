@@ -17,7 +17,8 @@ class Messages : public NoCopy
 public:
     Messages();
     ~Messages();
-    void update(float delta);
+    void update(float delta, const Matrix& modelview);
+    void setModelViewMatrix(const Matrix& modelview); // world camera, for add3D
     void add2D(Message* message);
     void add3D(Message* message);
     void remove(Message* message);
@@ -26,6 +27,7 @@ public:
     Fonts m_fonts;
 private:
     MessageVectorsByHeight m_buffer;
+    Matrix                 m_modelview;
 };
 
 
@@ -49,6 +49,19 @@ Music::~Music()
     delete [] m_buffer;
 }
 
+size_t Music::size() const
+{
+    return m_reader.size() + m_bufferSize;
+}
+
+void Music::rewind()
+{
+    stop();
+    alSourcei(m_source, AL_BUFFER, 0); // unqueues all buffers
+    reset();
+    init();
+}
+
 void Music::play(bool looping)
 {
     alSourcePlay(m_source);
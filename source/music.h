@@ -3,10 +3,11 @@
 
 #include "common.h"
 #include "oggDecoder.h"
+#include "asset_cache.h"
 
 static const int BUFFER_COUNT = 4;
 
-class Music : public OggDecoder
+class Music : public OggDecoder, public Asset
 {
     friend class Audio;
 
@@ -18,6 +19,8 @@ private:
     Music(const string& filename);
     ~Music();
 
+    size_t size() const;
+
     unsigned int m_source;
     unsigned int m_buffers[BUFFER_COUNT];
     char* m_buffer;
@@ -29,6 +32,7 @@ private:
 
     void update();
     void init();
+    void rewind(); // to the start, as a new one
 };
 
 #endif
@@ -4,6 +4,8 @@
 #include "profile.h"
 #include "player_ai.h"
 #include "player_local.h"
+#include "player_external.h"
+#include "player_replay.h"
 #include "network.h"
 #include "menu.h"
 #include "game.h"
@@ -13,8 +15,9 @@
 #include "properties.h"
 #include "config.h"
 #include "xml.h"
+#include "snapshot.h"
 
-template <class Network> Network* System<Network>::instance = NULL;
+template <class Network> Network* SharedInstance<Network>::instance = NULL;
 
 Network::Network() :
     m_inMenu(false),
@@ -37,12 +40,15 @@ Network::Network() :
     m_tmpProfile->m_name = "???";
 
     for (int i=0; i<4; i++) m_clientReady[i] = false;
+    for (int i=0; i<4; i++) m_externalIdx[i] = false;
+    for (int i=0; i<4; i++) m_replayIdx[i] = false;
 }
 
 Network::~Network()
 {
     clog << "Closing network." << endl;
 
+    removeBodies();
     delete m_tmpProfile;
 }
 
@@ -63,6 +69,39 @@ void Network::add(Body* body)
     m_activeBodies.push_back(ac);
 }
 
+void Network::removeBodies()
+{
+    for each_const(ActiveBodyVector, m_activeBodies, iter)
+    {
+        delete *iter;
+    }
+    m_activeBodies.clear();
+}
+
+void Network::captureSnapshot(Snapshot& snapshot, unsigned int tick)
+{
+    snapshot.m_tick = tick;
+    snapshot.m_bodies.resize(m_activeBodies.size());
+    for (size_t i = 0; i < m_activeBodies.size(); i++)
+    {
+        ActiveBody* ac = m_activeBodies[i];
+        snapshot.m_bodies[i].capture(ac->body);
+        ac->lastPosition = ac->body->m_matrix;
+    }
+}
+
+void Network::applySnapshot(const Snapshot& snapshot) const
+{
+    if (snapshot.m_bodies.size() != m_activeBodies.size())
+    {
+        Exception("Snapshot does not match network bodies");
+    }
+    for (size_t i = 0; i < m_activeBodies.size(); i++)
+    {
+        snapshot.m_bodies[i].apply(m_activeBodies[i]->body);
+    }
+}
+
 const vector<Profile*>& Network::getCurrentProfiles() const
 {
     return m_profiles;
@@ -73,6 +112,8 @@ void Network::setPlayerProfile(Profile* player)
     m_profiles[0] = player;
     m_localIdx = 0;
     m_aiIdx[0] = false;
+    m_externalIdx[0] = false;
+    m_replayIdx[0] = false;
 }
 
 void Network::setCpuProfiles(const vector<Profile*> profiles[], int level)
@@ -100,6 +141,42 @@ void Network::setCpuProfiles(const vector<Profile*> profiles[], int level)
     {
         m_profiles[1+i] = temp[i];
         m_aiIdx[1+i] = true;
+        m_externalIdx[1+i] = false;
+        m_replayIdx[1+i] = false;
+    }
+}
+
+void Network::setAiProfiles(const vector<Profile*>& profiles)
+{
+    const bool external[4] = { false, false, false, false };
+    setExternalProfiles(profiles, external);
+}
+
+void Network::setExternalProfiles(const vector<Profile*>& profiles, const bool external[4])
+{
+    assert(profiles.size() == 4);
+
+    m_localIdx = -1;
+    for (int i = 0; i < 4; i++)
+    {
+        m_profiles[i] = profiles[i];
+        m_aiIdx[i] = !external[i];
+        m_externalIdx[i] = external[i];
+        m_replayIdx[i] = false;
+    }
+}
+
+void Network::setReplayProfiles(const vector<Profile*>& profiles)
+{
+    assert(profiles.size() == 4);
+
+    m_localIdx = -1;
+    for (int i = 0; i < 4; i++)
+    {
+        m_profiles[i] = profiles[i];
+        m_aiIdx[i] = false;
+        m_externalIdx[i] = false;
+        m_replayIdx[i] = true;
     }
 }
 
@@ -122,6 +199,8 @@ void Network::createRemoteProfiles()
     {
         m_profiles[i] = m_tmpProfile;
         m_aiIdx[i] = false;
+        m_externalIdx[i] = false;
+        m_replayIdx[i] = false;
     }
 }
 
@@ -134,6 +213,14 @@ const vector<Player*>& Network::createPlayers(Level* level)
         {
             m_players[i] = new LocalPlayer(m_profiles[i], level);
         }
+        else if (m_externalIdx[i])
+        {
+            m_players[i] = new ExternalPlayer(m_profiles[i], level);
+        }
+        else if (m_replayIdx[i])
+        {
+            m_players[i] = new ReplayPlayer(m_profiles[i], level);
+        }
         else if (m_aiIdx[i])
         {
             m_players[i] = new AiPlayer(m_profiles[i], level);
@@ -213,7 +300,7 @@ void Network::changeCpu(int idx, bool forward)
 
 bool Network::isLocal(int idx) const
 {
-    return idx == m_localIdx || m_aiIdx[idx];
+    return idx == m_localIdx || m_aiIdx[idx] || m_externalIdx[idx] || m_replayIdx[idx];
 }
 
 int Network::getBodyIdx(const Body* body) const
@@ -271,17 +358,18 @@ string Network::getLevel() const
 
 void Network::loadLevelList()
 {
-    XMLnode xml;
+    XMLdocument document;
     File::Reader in("/data/level/level_list.xml");
     if (!in.is_open())
     {
         Exception("Level file 'data/level/level_list.xml' not found");  
     }
-    xml.load(in);
+    document.load(in);
+    const XMLelement& xml = document.root();
 
-    for each_const(XMLnodes, xml.childs, iter)
+    for each_const(XMLelements, xml.childs, iter)
     {
-        const XMLnode& node = *iter;
+        const XMLelement& node = *iter;
         if (node.name == "level")
         {
             m_levelFiles.push_back(node.getAttribute("file"));
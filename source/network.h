@@ -13,6 +13,7 @@ class Player;
 class Menu;
 class RefereeBase;
 class RemotePlayer;
+class Snapshot;
 
 struct ActiveBody
 {
@@ -31,16 +32,25 @@ public:
     void update();
 
     void add(Body* body);
+    void removeBodies();
+
+    // quantized state of added bodies, in order they were added
+    void captureSnapshot(Snapshot& snapshot, unsigned int tick);
+    void applySnapshot(const Snapshot& snapshot) const;
 
     void setPlayerProfile(Profile* player);
     void setCpuProfiles(const vector<Profile*> profiles[], int level);
+    void setAiProfiles(const vector<Profile*>& profiles); // four AI players, no local one
+    // like setAiProfiles, but players with external[i] set are ExternalPlayers
+    void setExternalProfiles(const vector<Profile*>& profiles, const bool external[4]);
+    void setReplayProfiles(const vector<Profile*>& profiles); // four ReplayPlayers
     void createRemoteProfiles();
     void setAiProfile(int idx, Profile* ai);
     Profile* getRandomAI();
 
     const vector<Profile*>& getCurrentProfiles() const;
     const vector<Player*>& createPlayers(Level* level);
-    int getLocalIdx() const;
+    int getLocalIdx() const; // -1 when all players are AI
     void changeCpu(int idx, bool forward);
     bool isLocal(int idx) const;
 
@@ -74,6 +84,8 @@ private:
     vector<Profile*> m_profiles;
     int              m_localIdx;
     bool             m_aiIdx[4];
+    bool             m_externalIdx[4];
+    bool             m_replayIdx[4];
     vector<Player*>  m_players;
 
     Menu*            m_menu;
@@ -0,0 +1,278 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <climits>
+#include "number.h"
+
+static bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// digits after an optional sign, overflow when above limit (+1 for
+// negative when negativeLimit), false if there are none
+static bool parseDigits(const char* text, size_t size, unsigned long long limit, bool negativeLimit,
+                        unsigned long long& result, bool& negative, bool& overflow)
+{
+    const char* end = text + size;
+    while (text != end && isSpace(*text))
+    {
+        text++;
+    }
+
+    negative = false;
+    if (text != end && (*text == '+' || *text == '-'))
+    {
+        negative = (*text == '-');
+        text++;
+    }
+    if (negative && negativeLimit)
+    {
+        limit++;
+    }
+
+    if (text == end || !isDigit(*text))
+    {
+        return false;
+    }
+
+    result = 0;
+    overflow = false;
+    while (text != end && isDigit(*text))
+    {
+        unsigned int digit = *text - '0';
+        if (result > (limit - digit) / 10)
+        {
+            overflow = true;
+        }
+        else if (!overflow)
+        {
+            result = result * 10 + digit;
+        }
+        text++;
+    }
+    return true;
+}
+
+template <typename T>
+static T parseSigned(const char* text, size_t size, long long min, long long max)
+{
+    unsigned long long result;
+    bool negative, overflow;
+    if (!parseDigits(text, size, max, true, result, negative, overflow))
+    {
+        return 0;
+    }
+    if (overflow)
+    {
+        return static_cast<T>(negative ? min : max);
+    }
+    return static_cast<T>(negative ? -static_cast<long long>(result) : static_cast<long long>(result));
+}
+
+template <typename T>
+static T parseUnsigned(const char* text, size_t size, unsigned long long max)
+{
+    unsigned long long result;
+    bool negative, overflow;
+    if (!parseDigits(text, size, max, false, result, negative, overflow))
+    {
+        return 0;
+    }
+    if (overflow)
+    {
+        return static_cast<T>(max);
+    }
+    // like strtoul, "-1" is the largest value
+    return negative ? static_cast<T>(0 - static_cast<T>(result)) : static_cast<T>(result);
+}
+
+void parseNumber(const char* text, size_t size, int& value)
+{
+    value = parseSigned<int>(text, size, INT_MIN, INT_MAX);
+}
+
+void parseNumber(const char* text, size_t size, unsigned int& value)
+{
+    value = parseUnsigned<unsigned int>(text, size, UINT_MAX);
+}
+
+void parseNumber(const char* text, size_t size, unsigned long& value)
+{
+    value = parseUnsigned<unsigned long>(text, size, ULONG_MAX);
+}
+
+// exact in float, so one multiply or divide rounds like strtof
+static const float g_powers[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+void parseNumber(const char* text, size_t size, float& value)
+{
+    const char* end = text + size;
+    while (text != end && isSpace(*text))
+    {
+        text++;
+    }
+
+    // same characters as the stream takes: sign, digits with a point,
+    // exponent after some digits
+    const char* start = text;
+    bool negative = false;
+    if (text != end && (*text == '+' || *text == '-'))
+    {
+        negative = (*text == '-');
+        text++;
+    }
+
+    unsigned int mantissa = 0;
+    int digits = 0;      // significant ones in mantissa
+    int scale = 0;       // decimal exponent of mantissa
+    bool found = false;
+    bool point = false;
+    for (; text != end; text++)
+    {
+        if (isDigit(*text))
+        {
+            found = true;
+            if (mantissa != 0 || *text != '0')
+            {
+                digits++;
+                if (digits <= 7)
+                {
+                    mantissa = mantissa * 10 + (*text - '0');
+                }
+            }
+            if (point)
+            {
+                scale--;
+            }
+        }
+        else if (*text == '.' && !point)
+        {
+            point = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        value = 0.0f;
+        return;
+    }
+
+    int exponent = 0;
+    if (text != end && (*text == 'e' || *text == 'E'))
+    {
+        text++;
+        bool negativeExponent = false;
+        if (text != end && (*text == '+' || *text == '-'))
+        {
+            negativeExponent = (*text == '-');
+            text++;
+        }
+        if (text == end || !isDigit(*text))
+        {
+            // the stream takes "1e" and then can not convert it
+            value = 0.0f;
+            return;
+        }
+        while (text != end && isDigit(*text))
+        {
+            if (exponent < 10000)
+            {
+                exponent = exponent * 10 + (*text - '0');
+            }
+            text++;
+        }
+        if (negativeExponent)
+        {
+            exponent = -exponent;
+        }
+    }
+    scale += exponent;
+
+    // up to 7 digits are below 2^24, exact as the 10^scale they are scaled by
+    if (digits <= 7 && scale >= -10 && scale <= 10)
+    {
+        float result = static_cast<float>(mantissa);
+        result = (scale < 0 ? result / g_powers[-scale] : result * g_powers[scale]);
+        value = negative ? -result : result;
+        return;
+    }
+
+    // longer digits are rounded by strtof, which wants a terminated copy
+    char buffer[64];
+    size_t length = text - start;
+    if (length >= sizeof(buffer))
+    {
+        length = sizeof(buffer) - 1;
+    }
+    memcpy(buffer, start, length);
+    buffer[length] = 0;
+
+    value = strtof(buffer, NULL);
+    if (value > FLT_MAX)
+    {
+        value = FLT_MAX;
+    }
+    else if (value < -FLT_MAX)
+    {
+        value = -FLT_MAX;
+    }
+}
+
+template <typename T>
+static char* formatDigits(char* buffer, T value, bool negative)
+{
+    char digits[NUMBER_CHARS];
+    char* last = digits + sizeof(digits);
+    char* first = last;
+    do
+    {
+        *--first = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    while (value != 0);
+
+    if (negative)
+    {
+        *buffer++ = '-';
+    }
+    memcpy(buffer, first, last - first);
+    return buffer + (last - first);
+}
+
+char* formatNumber(char* buffer, int value)
+{
+    unsigned int magnitude = (value < 0 ? 0u - static_cast<unsigned int>(value) : static_cast<unsigned int>(value));
+    return formatDigits(buffer, magnitude, value < 0);
+}
+
+char* formatNumber(char* buffer, unsigned int value)
+{
+    return formatDigits(buffer, value, false);
+}
+
+char* formatNumber(char* buffer, unsigned long value)
+{
+    return formatDigits(buffer, value, false);
+}
+
+char* formatNumber(char* buffer, float value)
+{
+    // whole numbers below 10^6 print all their digits with "%g"
+    if (value != 0.0f && value > -1e6f && value < 1e6f && value == static_cast<float>(static_cast<int>(value)))
+    {
+        return formatNumber(buffer, static_cast<int>(value));
+    }
+    int length = snprintf(buffer, NUMBER_CHARS, "%g", value);
+    return buffer + length;
+}
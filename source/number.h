@@ -0,0 +1,33 @@
+#ifndef __NUMBER_H__
+#define __NUMBER_H__
+
+#include <cstddef>
+
+// Numbers to and from text without streams or allocations, for cast<>.
+// Results are the same as stringstream >> and << give them: leading
+// spaces are skipped, parsing stops at the first character that does not
+// fit, nothing parsed is 0 and out of range is the largest value. Floats
+// are written like "%g", with 6 significant digits.
+
+const size_t NUMBER_CHARS = 32; // longest formatted number and more
+
+void parseNumber(const char* text, size_t size, int& value);
+void parseNumber(const char* text, size_t size, unsigned int& value);
+void parseNumber(const char* text, size_t size, unsigned long& value);
+void parseNumber(const char* text, size_t size, float& value);
+
+// return end of the text, buffer must have NUMBER_CHARS
+char* formatNumber(char* buffer, int value);
+char* formatNumber(char* buffer, unsigned int value);
+char* formatNumber(char* buffer, unsigned long value);
+char* formatNumber(char* buffer, float value);
+
+template <typename T>
+inline T parseNumber(const char* text, size_t size)
+{
+    T value;
+    parseNumber(text, size, value);
+    return value;
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <cstring>
 #include "openal_includes.h"
 
 #include "oggDecoder.h"
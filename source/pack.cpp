@@ -0,0 +1,102 @@
+#include <cstring>
+#include "pack.h"
+#include "world_hash.h"
+
+struct HashLess
+{
+    bool operator () (const PackEntry& entry, unsigned int hash) const
+    {
+        return entry.hash < hash;
+    }
+};
+
+bool Pack::check(const void* data, size_t size)
+{
+    if (size < sizeof(PackHeader))
+    {
+        return false;
+    }
+    const PackHeader* header = static_cast<const PackHeader*>(data);
+    return header->magic == PACK_MAGIC && header->version == PACK_VERSION && header->size == size;
+}
+
+Pack::Pack(const void* data, size_t size) :
+    m_data(static_cast<const byte*>(data)),
+    m_header(static_cast<const PackHeader*>(data)),
+    m_entries(NULL)
+{
+    if (!check(data, size))
+    {
+        Exception("Invalid pack");
+    }
+
+    if (m_header->index % 4 != 0 || m_header->index > size ||
+        m_header->count > (size - m_header->index) / sizeof(PackEntry))
+    {
+        Exception("Invalid pack, index out of range");
+    }
+    m_entries = reinterpret_cast<const PackEntry*>(m_data + m_header->index);
+    if (m_header->names > size || m_header->namesSize > size - m_header->names ||
+        m_header->namesSize == 0 || m_data[m_header->names + m_header->namesSize - 1] != 0)
+    {
+        Exception("Invalid pack, paths out of range");
+    }
+
+    for (unsigned int i = 0; i < m_header->count; i++)
+    {
+        const PackEntry& entry = m_entries[i];
+        if (entry.name >= m_header->namesSize ||
+            entry.offset % PACK_ALIGN != 0 || entry.offset > size || entry.size > size - entry.offset)
+        {
+            Exception("Invalid pack, entry out of range");
+        }
+    }
+}
+
+unsigned int Pack::hash(const char* path, size_t length)
+{
+    return xxhash32(path, length);
+}
+
+bool Pack::less(const PackEntry& a, const char* aName,
+                const PackEntry& b, const char* bName)
+{
+    if (a.hash != b.hash)
+    {
+        return a.hash < b.hash;
+    }
+    return strcmp(aName, bName) < 0;
+}
+
+const unsigned char* Pack::find(const string& path, size_t& size) const
+{
+    unsigned int pathHash = hash(path.c_str(), path.size());
+
+    const PackEntry* end = m_entries + m_header->count;
+    for (const PackEntry* entry = std::lower_bound(m_entries, end, pathHash, HashLess());
+         entry != end && entry->hash == pathHash; entry++)
+    {
+        if (path == getName(*entry))
+        {
+            size = entry->size;
+            return m_data + entry->offset;
+        }
+    }
+    return NULL;
+}
+
+unsigned int Pack::count() const
+{
+    return m_header->count;
+}
+
+const PackEntry& Pack::getEntry(unsigned int index) const
+{
+    assert(index < m_header->count);
+    return m_entries[index];
+}
+
+const char* Pack::getName(const PackEntry& entry) const
+{
+    return reinterpret_cast<const char*>(m_data + m_header->names + entry.name);
+}
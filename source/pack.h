@@ -0,0 +1,65 @@
+#ifndef __PACK_H__
+#define __PACK_H__
+
+#include "common.h"
+
+// Asset pack: every file under data/ in one file, mapped once by
+// File::openPack and read in place by File::Reader. Entries are kept
+// in path order and aligned to PACK_ALIGN, the index is sorted by
+// the hash of the path and then by the path itself. Paths are as
+// given to File::Reader ("/data/level/world.xml"). squares3d-pack
+// writes it, only the headless Makefile runs it so far. Bump
+// PACK_VERSION whenever a record changes.
+
+static const unsigned int PACK_MAGIC   = 0x50335153; // "SQ3P"
+static const unsigned int PACK_VERSION = 1;
+static const unsigned int PACK_ALIGN   = 16;
+static const char         PACK_FILE[]  = "/data.pak"; // in the read folder
+
+struct PackHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int size;
+    unsigned int count;     // entries
+    unsigned int index;     // offset of count PackEntry
+    unsigned int names;     // offset of the path strings
+    unsigned int namesSize;
+};
+
+struct PackEntry
+{
+    unsigned int hash;      // Pack::hash of the path
+    unsigned int name;      // offset into the path strings
+    unsigned int offset;    // in bytes from the start of the pack
+    unsigned int size;
+};
+
+class Pack : public NoCopy
+{
+public:
+    // false if data is not a pack of this version
+    static bool check(const void* data, size_t size);
+
+    Pack(const void* data, size_t size);
+
+    static unsigned int hash(const char* path, size_t length);
+
+    // index order
+    static bool less(const PackEntry& a, const char* aName,
+                     const PackEntry& b, const char* bName);
+
+    // NULL if the path is not in the pack
+    const unsigned char* find(const string& path, size_t& size) const;
+
+    unsigned int count() const;
+    const PackEntry& getEntry(unsigned int index) const;
+    const char* getName(const PackEntry& entry) const;
+
+private:
+    const byte*       m_data;
+    const PackHeader* m_header;
+    const PackEntry*  m_entries;
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include "properties.h"
 #include "level.h"
 #include "network.h"
+#include "world_state.h"
 
 static const pair<float, float> jumpMinMax = make_pair(0.7f, 1.0f);
 static const pair<float, float> speedMinMax = make_pair(2.5f, 4.5f);
@@ -34,13 +35,16 @@ Player::Player(const Profile* profile, Level* level) :
     m_upVector(NULL),
     m_isOnGround(true),
     m_jump(false),
-    m_levelCollision(level->getCollision("level")),
-    m_ballBody(level->getBody("football"))
+    m_kick(false),
+    m_kickRequested(false),
+    m_halt(true),
+    m_levelCollision(level->getGroundCollision()),
+    m_ballBody(level->getBall())
 {
     CollisionSet collisions;
     collisions.insert(level->getCollision(m_profile->m_collisionID));
     m_body = new Body(m_profile->m_name, level, collisions);
-    level->m_bodies[m_profile->m_name] = m_body;
+    level->addBody(m_body);
     
     m_radius = (*collisions.begin())->getRadius();
     
@@ -85,6 +89,7 @@ Player::~Player()
 void Player::setKick(bool needKick)
 {
     m_kick = needKick;
+    m_kickRequested |= needKick;
     
     if (m_kick)
     {
@@ -195,6 +200,84 @@ void Player::setJump(bool needJump)
     m_jump = needJump;
 }
 
+void Player::halt()
+{
+    //halt those englander bastards!
+    m_halt = true;
+}
+
+void Player::release() 
+{
+    //ok you can go..
+    m_halt = false;
+}
+
+PlayerInput Player::getInput()
+{
+    PlayerInput input;
+    input.direction = m_direction;
+    input.rotation = m_rotation;
+    input.jump = m_jump;
+    input.kick = m_kickRequested;
+    m_kickRequested = false;
+    return input;
+}
+
+void Player::applyInput(const PlayerInput& input)
+{
+    // setters would blend, recorded values are already blended
+    m_direction = input.direction;
+    m_rotation = input.rotation;
+    m_jump = input.jump;
+    if (input.kick)
+    {
+        setKick(true);
+    }
+}
+
+void Player::saveState(WorldState& state) const
+{
+    state.write(m_direction);
+    state.write(m_rotation);
+    state.write(m_isOnGround);
+    state.write(m_jump);
+    state.write(m_kick);
+    state.write(m_halt);
+    state.write(m_timer);
+
+    // solver starts from last joint forces
+    float forces[32];
+    int rows = NewtonJointGetRowForces(m_upVector, forces);
+    state.write(rows);
+    for (int i = 0; i < rows; i++)
+    {
+        state.write(forces[i]);
+    }
+}
+
+void Player::loadState(WorldState& state)
+{
+    m_direction = state.readVector();
+    m_rotation = state.readVector();
+    m_isOnGround = state.readBool();
+    m_jump = state.readBool();
+    m_kick = state.readBool();
+    m_halt = state.readBool();
+    state.read(m_timer);
+
+    float forces[32];
+    int rows = state.readInt();
+    if (rows != NewtonJointGetRowForces(m_upVector, forces))
+    {
+        Exception("World state does not match this world");
+    }
+    for (int i = 0; i < rows; i++)
+    {
+        forces[i] = state.readFloat();
+    }
+    NewtonJointSetRowForces(m_upVector, forces);
+}
+
 void Player::renderColor() const
 {
     Vector c(m_profile->m_color);
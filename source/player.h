@@ -9,17 +9,28 @@
 
 class RefereeBase;
 class Collision;
+class WorldState;
 
 static const float FIELD_LENGTH = 3.0f;
 
+// what control() left for the physics step, recorded in replays
+struct PlayerInput
+{
+    Vector direction;
+    Vector rotation;
+    bool   jump;
+    bool   kick; // setKick(true) was called
+};
+
 class Player : public Collideable
 {
 public:
     Player(const Profile* profile, Level* level);
     virtual ~Player();
 
-    virtual void halt() {}
-    virtual void release() {}
+    // only AI players obey, halt is kept here so all players save the same state
+    void halt();
+    void release();
     
     void setDirection(const Vector& direction);
     void setRotation(const Vector& rotation);
@@ -30,6 +41,13 @@ public:
 
     virtual void control() = 0;
 
+    // getInput clears kick, so it reports setKick calls since the last time
+    PlayerInput getInput();
+    void applyInput(const PlayerInput& input);
+
+    virtual void saveState(WorldState& state) const;
+    virtual void loadState(WorldState& state);
+
     Vector getPosition() const;
     Vector getFieldCenter() const;
 
@@ -55,6 +73,8 @@ protected:
     bool         m_isOnGround; // TODO: rename, current name is incorrect
     bool         m_jump;
     bool         m_kick;
+    bool         m_kickRequested;
+    bool         m_halt;
 
     Vector       m_direction;
     Vector       m_rotation;
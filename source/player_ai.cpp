@@ -4,33 +4,21 @@
 #include "body.h"
 #include "random.h"
 #include "geometry.h"
-#include "level.h"
+#include "ball_prediction.h"
 
 AiPlayer::AiPlayer(const Profile* profile, Level* level) :
-    Player(profile, level),
-    m_halt(true)
+    Player(profile, level)
 {
 }
 
-void AiPlayer::halt()
-{
-    //halt those englander bastards!
-    m_halt = true;
-}
-
-void AiPlayer::release() 
-{
-    //ok you can go..
-    m_halt = false;
-}
-
 AiPlayer::~AiPlayer()
 {
 }
 
 void AiPlayer::control()
 {
-    Body* ball = World::instance->m_level->getBody("football");
+    Body* ball = m_ballBody;
+    const BallPrediction* prediction = World::instance->m_ballPrediction;
 
     Vector ballPosition = ball->getPosition();
     const Vector selfPosition = m_body->getPosition();
@@ -41,14 +29,7 @@ void AiPlayer::control()
 
     if (!isPointInRectangle(ballPosition, m_lowerLeft, m_upperRight))
     {
-        Vector ballVelocity;
-        NewtonBodyGetVelocity(ball->m_newtonBody, ballVelocity.v);
-
-        ballPosition = findBallAndSquareIntersection(
-            ballPosition, 
-            ballVelocity, 
-            m_lowerLeft, 
-            m_upperRight);
+        ballPosition = prediction->getSquareEntry(getQuadrant(getFieldCenter()));
 
         important = (getFieldCenter() - ballPosition).magnitude() >= 1.0f;
     }
@@ -12,13 +12,7 @@ public:
     AiPlayer(const Profile* profile, Level* level);
     ~AiPlayer();
 
-    void halt();
-    void release();
-
     void control();
-
-private:
-    bool              m_halt;
 };
 
 #endif
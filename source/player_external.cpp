@@ -0,0 +1,40 @@
+#include "player_external.h"
+#include "body.h"
+
+ExternalPlayer::ExternalPlayer(const Profile* profile, Level* level) :
+    Player(profile, level),
+    m_actionJump(false),
+    m_actionKick(false)
+{
+}
+
+ExternalPlayer::~ExternalPlayer()
+{
+}
+
+void ExternalPlayer::setAction(const Vector& direction, bool jump, bool kick)
+{
+    m_actionDirection = Vector(direction.x, 0.0f, direction.z);
+    float length = m_actionDirection.magnitude();
+    if (length > 1.0f)
+    {
+        m_actionDirection /= length;
+    }
+    m_actionJump = jump;
+    m_actionKick = kick;
+}
+
+void ExternalPlayer::control()
+{
+    // always face the ball, same as LocalPlayer
+    Vector dir = m_ballBody->getPosition() - m_body->getPosition();
+    Vector rot = m_body->getRotation();
+    Vector rotation;
+    rotation.y = ( rot % dir );
+    rotation /= 5.0f;
+
+    setDirection(m_actionDirection);
+    setJump(m_actionJump);
+    setRotation(rotation);
+    setKick(m_actionKick);
+}
@@ -0,0 +1,25 @@
+#ifndef __PLAYER_EXTERNAL_H__
+#define __PLAYER_EXTERNAL_H__
+
+#include "common.h"
+#include "player.h"
+
+// Player driven by code outside of the game, e.g. batched environments.
+class ExternalPlayer : public Player
+{
+public:
+    ExternalPlayer(const Profile* profile, Level* level);
+    ~ExternalPlayer();
+
+    // direction is in world space, longer than 1 is clamped
+    void setAction(const Vector& direction, bool jump, bool kick);
+
+    void control();
+
+private:
+    Vector m_actionDirection;
+    bool   m_actionJump;
+    bool   m_actionKick;
+};
+
+#endif
@@ -40,9 +40,7 @@ void LocalPlayer::control()
 
     Vector finalDirection = Matrix::rotateY(World::instance->m_camera->angleY()) * direction;
 
-    Body* ball = World::instance->m_level->getBody("football");
-
-    Vector ballPosition = ball->getPosition();
+    Vector ballPosition = m_ballBody->getPosition();
     Vector selfPosition = m_body->getPosition();
 
     Vector dir = ballPosition - selfPosition;
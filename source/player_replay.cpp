@@ -0,0 +1,36 @@
+#include "player_replay.h"
+#include "random.h"
+
+ReplayPlayer::ReplayPlayer(const Profile* profile, Level* level) :
+    Player(profile, level),
+    m_draws(0)
+{
+    m_input.jump = false;
+    m_input.kick = false;
+}
+
+ReplayPlayer::~ReplayPlayer()
+{
+}
+
+void ReplayPlayer::setInput(const PlayerInput& input, unsigned int draws)
+{
+    m_input = input;
+    m_draws = draws;
+}
+
+void ReplayPlayer::control()
+{
+    unsigned int before = Randoms::getDraws();
+    applyInput(m_input);
+
+    // kick sound draws again here, the rest were AI decisions
+    unsigned int drawn = Randoms::getDraws() - before;
+    if (m_draws > drawn)
+    {
+        Randoms::skip(m_draws - drawn);
+    }
+
+    // input is for one control() only
+    m_input.kick = false;
+}
@@ -0,0 +1,24 @@
+#ifndef __PLAYER_REPLAY_H__
+#define __PLAYER_REPLAY_H__
+
+#include "common.h"
+#include "player.h"
+
+// Player driven by a recorded input stream.
+class ReplayPlayer : public Player
+{
+public:
+    ReplayPlayer(const Profile* profile, Level* level);
+    ~ReplayPlayer();
+
+    // draws is how many randoms the recorded player used in its control()
+    void setInput(const PlayerInput& input, unsigned int draws);
+
+    void control();
+
+private:
+    PlayerInput  m_input;
+    unsigned int m_draws;
+};
+
+#endif
@@ -23,7 +23,7 @@ Profile::Profile(const Profile& profile) :
 {
 }
 
-Profile::Profile(const XMLnode& node) :
+Profile::Profile(const XMLelement& node) :
     m_name("Player"),
     m_collisionID("player_small"),
     m_color(Pink),
@@ -31,9 +31,9 @@ Profile::Profile(const XMLnode& node) :
     m_accuracy(0.5f),
     m_jump(0.5f)
 {
-    for each_const(XMLnodes, node.childs, iter)
+    for each_const(XMLelements, node.childs, iter)
     {
-        const XMLnode& node = *iter;
+        const XMLelement& node = *iter;
         if (node.name == "name")
         {
             m_name = node.value;
@@ -59,3 +59,68 @@ Profile::Profile(const XMLnode& node) :
         }
     }
 }
+
+void loadCpuProfiles(ProfilesVector profiles[4])
+{
+    XMLdocument document;
+    File::Reader in("/data/level/cpu_players.xml");
+    if (!in.is_open())
+    {
+        Exception("Level file 'data/level/cpu_players.xml' not found");  
+    }
+    document.load(in);
+    const XMLelement& xml = document.root();
+    int checks[4] = {0,0,0,0};
+
+    for each_const(XMLelements, xml.childs, iter)
+    {
+        const XMLelement& node = *iter;
+        if ((node.name == "easy") || (node.name == "normal") || (node.name == "hard") || (node.name == "extra"))
+        {
+            size_t idx;
+            if (node.name == "easy")
+            {
+                idx = 0;
+            }
+            else if (node.name == "normal")
+            {
+                idx = 1;
+            }
+            else if (node.name == "hard")
+            {
+                idx = 2;
+            }
+            else // if (node.name == "extra")
+            {
+                idx = 3;
+            }
+
+            for each_const(XMLelements, node.childs, iter)
+            {
+                const XMLelement& node = *iter;
+                if (node.name == "profile")
+                {
+                    Profile* profile = new Profile(node);
+                    profiles[idx].push_back(profile);
+                    checks[idx]++;
+                }
+                else
+                {
+                    Exception("Invalid profile, unknown node - " + node.name);
+                }
+            }
+        }
+        else
+        {
+            Exception("Invalid cpu_profiles, unknown node - " + node.name);
+        }
+    }
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        if (checks[i] < 3)
+        {
+            Exception("Invalid cpu_profiles, there should be at least 3 profiles in each difficulty");
+        }
+    }
+}
@@ -4,12 +4,12 @@
 #include "common.h"
 #include "vmath.h"
 
-class XMLnode;
+class XMLelement;
 
 class Profile : public NoCopy
 {
 public:
-    Profile(const XMLnode& node);
+    Profile(const XMLelement& node);
     Profile();
     Profile(const Profile& profile);
 
@@ -21,4 +21,9 @@ public:
     float  m_jump;
 };
 
+typedef vector<Profile*> ProfilesVector;
+
+// reads data/level/cpu_players.xml into easy, normal, hard and extra lists
+void loadCpuProfiles(ProfilesVector profiles[4]);
+
 #endif
@@ -7,7 +7,7 @@
 #include "level.h"
 #include "body.h"
 #include "collision.h"
-#include "xml.h"
+#include "level_format.h"
 #include "sound.h"
 #include "sound_buffer.h"
 #include "random.h"
@@ -19,18 +19,12 @@ struct MaterialContact : NoCopy
     static int onBegin(const NewtonMaterial* material, const NewtonBody* body0, const NewtonBody* body1, int threadIndex);
     static void onProcess(const NewtonJoint* contact, float timestep, int threadIndex);
     
-    void onEnd(Body* body0, Body* body1);
+    void onEnd(const CollisionEvent& event);
 
     Properties* properties;
-
-    int m0;
-    int m1;
-    
-    Vector position;
-    float  maxSpeed;
 };
 
-Properties::Properties() : m_uniqueID(2), m_soundBufID(0)
+Properties::Properties() : m_uniqueID(2), m_soundBufID(0), m_tableSize(0), m_playerID(0)
 {
     NewtonWorld* world = World::instance->m_newtonWorld;
     int defaultID = NewtonMaterialGetDefaultGroupID(world);
@@ -45,6 +39,8 @@ Properties::Properties() : m_uniqueID(2), m_soundBufID(0)
         MaterialContact::onBegin, 
         MaterialContact::onProcess);
 
+    m_events.resize(NewtonGetThreadsCount(world));
+
     for (int i=0; i<8; i++)
     {
         m_idle.push_back(Soundable(new Sound(false), i<4+1)); // 5 important sources!
@@ -89,6 +85,18 @@ void Properties::update()
     }
 }
 
+void Properties::processEvents()
+{
+    for each_(vector<CollisionEvents>, m_events, events)
+    {
+        for each_const(CollisionEvents, *events, event)
+        {
+            m_materialContact->onEnd(*event);
+        }
+        events->clear();
+    }
+}
+
 void Properties::play(Body* body, const pair<byte, SoundBuffer*>* buffer, bool important, const Vector& position)
 {
     if (buffer == NULL)
@@ -232,53 +240,44 @@ bool Properties::hasPropertyID(int id) const
     return id >= 2;
 }
 
-void Properties::load(const XMLnode& node)
+void Properties::load(const PropertyRecord& record, const LevelRecords& records)
 {
-    string prop0 = node.getAttribute("property0");
-    string prop1 = node.getAttribute("property1");
-    
-    const int id0 = getPropertyID(prop0);
-    const int id1 = getPropertyID(prop1);
+    m_tableSize = 0;
+
+    const int id0 = records.getPropertyID(record.property0);
+    const int id1 = records.getPropertyID(record.property1);
     
     if (foundIn(m_properties, makepID(id0, id1)))
     {
-        Exception("Properties for '" + prop0 + "' and '"
-                                           + prop1 + "' already loaded");
+        Exception("Properties for " + cast<string>(id0) + " and "
+                                           + cast<string>(id1) + " already loaded");
     }
 
-    const Property& def = m_properties.find(makepID(getDefault(), getDefault()))->second;
-
-    float sF = node.getAttribute("staticFriction", def.staticFriction);
-    float kF = node.getAttribute("kineticFriction", def.kineticFriction);
-    float eC = node.getAttribute("elasticityCoefficient", def.elasticityCoefficient);
-    float sC = node.getAttribute("softnessCoefficient", def.softnessCoefficient);
-
-    m_properties.insert(make_pair(makepID(id0, id1), Property(sF, kF, eC, sC)));
+    m_properties.insert(make_pair(makepID(id0, id1),
+        Property(record.staticFriction, record.kineticFriction,
+                 record.elasticityCoefficient, record.softnessCoefficient)));
 
+    const LevelHeader& header = records.data.header();
     SoundBufferVector& vec = m_soundBufs.insert(make_pair(makepID(id0, id1), SoundBufferVector())).first->second;
-    for each_const(XMLnodes, node.childs, n)
+    for (unsigned int i = 0; i < record.sounds.count; i++)
     {
-        if (n->name == "sound")
-        {
-            vec.push_back(make_pair(m_soundBufID++, Audio::instance->loadSound(n->getAttribute("name"))));
-        }
-        else
-        {
-            Exception("Invalid property node, expected sound child, but got - " + node.name);
-        }       
+        const char* name = records.data.getString(records.data.get<unsigned int>(header.sounds, record.sounds, i));
+        vec.push_back(make_pair(m_soundBufID++, Audio::instance->loadSound(name)));
     }
 }
 
-void Properties::loadDefault(const XMLnode& node)
+void Properties::loadDefault(const PropertyRecord& record)
 {
+    m_tableSize = 0;
+
     NewtonWorld* world = World::instance->m_newtonWorld;
 
     int defaultID = NewtonMaterialGetDefaultGroupID(world);
 
-    float sF = node.getAttribute<float>("staticFriction");
-    float kF = node.getAttribute<float>("kineticFriction");
-    float eC = node.getAttribute<float>("elasticityCoefficient");
-    float sC = node.getAttribute<float>("softnessCoefficient");
+    float sF = record.staticFriction;
+    float kF = record.kineticFriction;
+    float eC = record.elasticityCoefficient;
+    float sC = record.softnessCoefficient;
 
     m_properties.insert(make_pair(makepID(getDefault(), getDefault()), Property(sF, kF, eC, sC)));
 
@@ -297,8 +296,42 @@ pID Properties::makepID(int id0, int id1) const
     return (static_cast<pID>(id0) << 32) | (id1);
 }
 
+void Properties::compile()
+{
+    m_playerID = getPropertyID("player");
+
+    m_tableSize = m_uniqueID + 1;
+    m_propertyTable.assign(m_tableSize * m_tableSize, NULL);
+    m_soundTable.assign(m_tableSize * m_tableSize, NULL);
+
+    for each_const(PropertiesMap, m_properties, iter)
+    {
+        const unsigned int id0 = static_cast<unsigned int>(iter->first >> 32);
+        const unsigned int id1 = static_cast<unsigned int>(iter->first & 0xFFFFFFFF);
+        m_propertyTable[id0 * m_tableSize + id1] = &iter->second;
+        m_propertyTable[id1 * m_tableSize + id0] = &iter->second;
+    }
+
+    for each_const(SoundBufMap, m_soundBufs, iter)
+    {
+        if (iter->second.empty())
+        {
+            continue;
+        }
+        const unsigned int id0 = static_cast<unsigned int>(iter->first >> 32);
+        const unsigned int id1 = static_cast<unsigned int>(iter->first & 0xFFFFFFFF);
+        m_soundTable[id0 * m_tableSize + id1] = &iter->second;
+        m_soundTable[id1 * m_tableSize + id0] = &iter->second;
+    }
+}
+
 const Property* Properties::get(int id0, int id1) const
 {
+    if (static_cast<unsigned int>(id0) < m_tableSize && static_cast<unsigned int>(id1) < m_tableSize)
+    {
+        return m_propertyTable[id0 * m_tableSize + id1];
+    }
+
     PropertiesMap::const_iterator iter = m_properties.find(makepID(id0, id1));
     
     if (iter != m_properties.end())
@@ -313,6 +346,17 @@ const Property* Properties::get(int id0, int id1) const
     
 const pair<byte, SoundBuffer*>* Properties::getSB(int id0, int id1) const
 {
+    if (static_cast<unsigned int>(id0) < m_tableSize && static_cast<unsigned int>(id1) < m_tableSize)
+    {
+        const SoundBufferVector* vec = m_soundTable[id0 * m_tableSize + id1];
+        if (vec == NULL)
+        {
+            return NULL;
+        }
+        int r = Randoms::getIntN(static_cast<int>(vec->size()));
+        return &(*vec)[r];
+    }
+
     SoundBufMap::const_iterator iter = m_soundBufs.find(makepID(id0, id1));
     
     if (iter != m_soundBufs.end())
@@ -330,65 +374,39 @@ const pair<byte, SoundBuffer*>* Properties::getSB(int id0, int id1) const
 
 int MaterialContact::onBegin(const NewtonMaterial* material, const NewtonBody* body0, const NewtonBody* body1, int threadIndex)
 {
-    MaterialContact* self = static_cast<MaterialContact*>(NewtonMaterialGetMaterialPairUserData(material));
-   
     if (body0 == body1)
     {
         assert(false);
         return 0;
     }
 
-    self->maxSpeed = 0.0f;
-
     return 1;
 }
 
 void MaterialContact::onProcess(const NewtonJoint* contactJoint, dFloat timestep, int threadIndex)
 {
-    Contacts contactsToRemove;
-
     Body* body0 = static_cast<Body*>(NewtonBodyGetUserData(NewtonJointGetBody0(contactJoint)));
     Body* body1 = static_cast<Body*>(NewtonBodyGetUserData(NewtonJointGetBody1(contactJoint)));
 
-    bool hasContact = false;
+    MaterialContact* self = NULL;
 
-    MaterialContact* selff = NULL;
+    CollisionEvent event;
+    event.body0 = body0;
+    event.body1 = body1;
+    event.speed = 0.0f;
 
     for (void* contact = NewtonContactJointGetFirstContact(contactJoint);
          contact != NULL;
          contact = NewtonContactJointGetNextContact(contactJoint, contact))
     {
         NewtonMaterial* material = NewtonContactGetMaterial(contact);
-        MaterialContact* self = static_cast<MaterialContact*>(NewtonMaterialGetMaterialPairUserData(material));
+        bool first = (self == NULL);
+        self = static_cast<MaterialContact*>(NewtonMaterialGetMaterialPairUserData(material));
         
         int colID0 = NewtonMaterialGetBodyCollisionID(material, body0->m_newtonBody);
         int colID1 = NewtonMaterialGetBodyCollisionID(material, body1->m_newtonBody);
         int faceAttr = NewtonMaterialGetContactFaceAttribute(material);
 
-        if (colID0 == self->properties->getInvisible())
-        {
-            body0->onCollideHull(body1);
-
-            const Property * prop = self->properties->get((faceAttr ? faceAttr : colID1), self->properties->getPropertyID("football"));
-            if (prop != NULL)
-            {
-                prop->apply(material);
-            }
-            contactsToRemove.push_back(contact);
-            continue;
-        }
-        else if (colID1 == self->properties->getInvisible())
-        {
-            body1->onCollideHull(body0);
-            const Property * prop = self->properties->get((faceAttr ? faceAttr : colID0), self->properties->getPropertyID("football"));
-            if (prop != NULL)
-            {
-                prop->apply(material);
-            }
-            contactsToRemove.push_back(contact);
-            continue;
-        }
-         
         bool isConvex0 = self->properties->hasPropertyID(colID0);
         bool isConvex1 = self->properties->hasPropertyID(colID1);
 
@@ -423,23 +441,23 @@ void MaterialContact::onProcess(const NewtonJoint* contactJoint, dFloat timestep
         Vector normal;
 
         float sp = NewtonMaterialGetContactNormalSpeed(material);
-        if (sp > self->maxSpeed)
+        if (sp > event.speed || first)
         {
-            self->maxSpeed = sp;
-            NewtonMaterialGetContactPositionAndNormal(material, self->position.v, normal.v);
-            self->m0 = m0;
-            self->m1 = m1;
+            event.speed = std::max(sp, 0.0f);
+            NewtonMaterialGetContactPositionAndNormal(material, event.position.v, normal.v);
+            event.m0 = m0;
+            event.m1 = m1;
         }
 
         for (int i=0; i<2; i++)
         {
             float speed = NewtonMaterialGetContactTangentSpeed(material, i);
-            if (speed > self->maxSpeed)
+            if (speed > event.speed)
             {
-                self->maxSpeed = speed;
-                NewtonMaterialGetContactPositionAndNormal(material, self->position.v, normal.v);
-                self->m0 = m0;
-                self->m1 = m1;
+                event.speed = speed;
+                NewtonMaterialGetContactPositionAndNormal(material, event.position.v, normal.v);
+                event.m0 = m0;
+                event.m1 = m1;
             }
         }
 
@@ -450,7 +468,7 @@ void MaterialContact::onProcess(const NewtonJoint* contactJoint, dFloat timestep
             prop = self->properties->get(self->properties->getDefault(), 
                                          self->properties->getDefault());
         }
-        int playerID = self->properties->getPropertyID("player");
+        int playerID = self->properties->m_playerID;
         if (m0==playerID && m1==playerID)
         {
             // TODO: this is hack, to bounce players off each other
@@ -458,36 +476,34 @@ void MaterialContact::onProcess(const NewtonJoint* contactJoint, dFloat timestep
         }
 
         prop->apply(material);
-        
-        hasContact = true;
-        selff = self;
     }
     
-    if (hasContact)
+    // game code sees the contact only after NewtonUpdate, see Properties::processEvents
+    if (self != NULL)
     {
-        selff->onEnd(body0, body1);
-    }
-
-    for each_const(Contacts, contactsToRemove, c)
-    {
-        NewtonContactJointRemoveContact(contactJoint, *c);
+        // sized in constructor, Newton thread count must not grow after it
+        assert(threadIndex < static_cast<int>(self->properties->m_events.size()));
+        self->properties->m_events[threadIndex].push_back(event);
     }
 }
 
-void MaterialContact::onEnd(Body* body0, Body* body1)
+void MaterialContact::onEnd(const CollisionEvent& event)
 {
-    body0->onCollide(body1, position, maxSpeed);
-    body1->onCollide(body0, position, maxSpeed);
+    Body* body0 = event.body0;
+    Body* body1 = event.body1;
+
+    body0->onCollide(body1, event.position, event.speed);
+    body1->onCollide(body0, event.position, event.speed);
     
-    if (maxSpeed > 0.5f && !properties->isPlaying(body0) && !properties->isPlaying(body1) )
+    if (event.speed > 0.5f && !properties->isPlaying(body0) && !properties->isPlaying(body1) )
     {
         if (body0->m_soundable)
         {
-            properties->play(body0, properties->getSB(m0, m1), body0->m_important, position);
+            properties->play(body0, properties->getSB(event.m0, event.m1), body0->m_important, event.position);
         }
         else if (body1->m_soundable)
         {
-            properties->play(body1, properties->getSB(m0, m1), body1->m_important, position);
+            properties->play(body1, properties->getSB(event.m0, event.m1), body1->m_important, event.position);
         }
     }
 }
@@ -6,7 +6,8 @@
 #include "vmath.h"
 
 class Property;
-class XMLnode;
+struct PropertyRecord;
+struct LevelRecords;
 class Sound;
 class SoundBuffer;
 class Body;
@@ -24,10 +25,20 @@ struct Soundable
     bool   important;
 };
 
+struct CollisionEvent
+{
+    Body*  body0;
+    Body*  body1;
+    Vector position;
+    float  speed;
+    int    m0;
+    int    m1;
+};
+
 typedef list<Soundable>                   SoundableList;
 typedef vector<pair<byte, SoundBuffer*> > SoundBufferVector;
 typedef map<pID, SoundBufferVector>       SoundBufMap;
-typedef vector<void*>                     Contacts;
+typedef vector<CollisionEvent>            CollisionEvents;
 
 class Properties : public NoCopy
 {
@@ -37,9 +48,11 @@ public:
     ~Properties();
 
     void update();
+    void processEvents();
 
-    void load(const XMLnode& node);
-    void loadDefault(const XMLnode& node);
+    void load(const PropertyRecord& record, const LevelRecords& records);
+    void loadDefault(const PropertyRecord& record);
+    void compile();
     const Property* get(int id0, int id1) const;
     const pair<byte, SoundBuffer*>* getSB(int id0, int id1) const;
 
@@ -63,6 +76,16 @@ private:
     IntMap              m_propertiesID;
     MaterialContact*    m_materialContact;
 
+    // filled from Newton callbacks, one buffer per Newton thread as
+    // counted when Properties is created
+    vector<CollisionEvents> m_events;
+
+    // dense id0*m_tableSize+id1 lookup built by compile(), maps are used when empty
+    unsigned int                     m_tableSize;
+    vector<const Property*>          m_propertyTable;
+    vector<const SoundBufferVector*> m_soundTable;
+    int                              m_playerID;
+
     pID makepID(int id0, int id1) const;
 
     SoundableList m_active;
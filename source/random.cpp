@@ -1,15 +1,28 @@
 #include <cstdlib>
 #include <ctime>
 #include <climits>
+#include <cstring>
 
 #include "random.h"
 
-static const unsigned int N = 624;
-static const unsigned int M = 397;
+// signed, p[M-N] must step backwards on 64-bit pointers too
+static const int N = 624;
+static const int M = 397;
     
-static unsigned int  state[N];
-static unsigned int* pNext;
-static unsigned int  left;
+static THREAD_LOCAL unsigned int  state[N];
+static THREAD_LOCAL unsigned int* pNext;
+static THREAD_LOCAL unsigned int  left;
+
+// for replays and saved states, sequence is init(initSeed) and draws getInt calls
+static THREAD_LOCAL unsigned int  initSeed;
+static THREAD_LOCAL unsigned int  draws;
+
+// block before the last reload, so seek can go back without init, blocks
+// start at draws prevStart and blockStart, blocks counts reloads since init
+static THREAD_LOCAL unsigned int  prevState[N];
+static THREAD_LOCAL unsigned int  blockStart;
+static THREAD_LOCAL unsigned int  prevStart;
+static THREAD_LOCAL int           blocks;
 
 inline unsigned int twist(unsigned int m, unsigned int s0, unsigned int s1)
 {
@@ -31,6 +44,14 @@ inline void seed(unsigned int seed)
 
 void reload()
 {
+    if (blocks > 0)
+    {
+        memcpy(prevState, state, sizeof(state));
+        prevStart = blockStart;
+    }
+    blocks++;
+    blockStart = draws;
+
     unsigned int* p = state;
 
 #pragma warning ( push )
@@ -65,14 +86,73 @@ void Randoms::init()
 {
     clog << "Initializing random seed." << endl;
 
+    init(hash(time(NULL), std::clock()));
+}
+
+void Randoms::init(unsigned int s)
+{
     left = 0;
-    seed(hash(time(NULL), std::clock()));
+    initSeed = s;
+    draws = 0;
+    blocks = 0;
+    seed(s);
+}
+
+unsigned int Randoms::getSeed()
+{
+    return initSeed;
+}
+
+unsigned int Randoms::getDraws()
+{
+    return draws;
+}
+
+void Randoms::skip(unsigned int count)
+{
+    while (count != 0)
+    {
+        if (left == 0) reload();
+        unsigned int n = std::min(count, left);
+        left -= n;
+        pNext += n;
+        draws += n;
+        count -= n;
+    }
+}
+
+void Randoms::seek(unsigned int s, unsigned int count)
+{
+    if (s == initSeed && blocks > 1 && count >= prevStart && count < blockStart)
+    {
+        // back into previous block, next reload makes the current one again
+        memcpy(state, prevState, sizeof(state));
+        blocks = 1;
+        blockStart = prevStart;
+    }
+
+    if (s == initSeed && blocks > 0 && count >= blockStart && count <= blockStart + N)
+    {
+        pNext = state + (count - blockStart);
+        left = N - (count - blockStart);
+        draws = count;
+    }
+    else if (s == initSeed && count >= draws)
+    {
+        skip(count - draws);
+    }
+    else
+    {
+        init(s);
+        skip(count);
+    }
 }
 
 unsigned int Randoms::getInt()
 {
     if (left == 0) reload();
     --left;
+    ++draws;
 
     unsigned int s1 = *pNext++;
     s1 ^= (s1 >> 11);
@@ -6,6 +6,17 @@
 namespace Randoms
 {
     void init();
+    void init(unsigned int seed); // same seed gives the same sequence
+
+    // position in the sequence, init(getSeed()) and skip(getDraws())
+    // brings another Randoms to the same place
+    unsigned int getSeed();
+    unsigned int getDraws();
+    void skip(unsigned int count);
+
+    // same as init(seed) and skip(draws), but cheap when going back or
+    // forward a few hundred draws in the current sequence
+    void seek(unsigned int seed, unsigned int draws);
 
     unsigned int getInt();               // [0,2^32)
     unsigned int getIntN(unsigned int n); // [0,n)
@@ -8,6 +8,7 @@
 #include "sound.h"
 #include "video.h"
 #include "profile.h"
+#include "world_state.h"
 
 RefereeBase::~RefereeBase()
 {
@@ -101,6 +102,16 @@ void RefereeBase::registerPlayers(const vector<Player*> players)
     m_scoreBoard->registerPlayers(players);
 }
 
+void RefereeBase::saveState(WorldState& state) const
+{
+    state.write(m_gameOver);
+}
+
+void RefereeBase::loadState(WorldState& state)
+{
+    m_gameOver = state.readBool();
+}
+
 void RefereeBase::resetOwnCombo(const Body* player)
 {
     m_scoreBoard->resetOwnCombo(player->m_id);
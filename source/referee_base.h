@@ -13,6 +13,7 @@ class Messages;
 class Message;
 class Sound;
 class SoundBuffer;
+class WorldState;
 
 
 typedef vector<TextType> FaultsVector;
@@ -34,6 +35,9 @@ public:
 
     virtual string getLoserName() const { return ""; }
 
+    virtual void saveState(WorldState& state) const;
+    virtual void loadState(WorldState& state);
+
     void resetOwnCombo(const Body* player);
     void resetCombo();
     void incrementCombo(const Body* player, const Vector& position);
@@ -14,6 +14,7 @@
 #include "world.h"
 #include "network.h"
 #include "colors.h"
+#include "world_state.h"
 
 static const float BALL_RESET_TIME = 3.0f;
 //TODO: make universaly proportional to field size?
@@ -92,6 +93,7 @@ RefereeLocal::RefereeLocal(Messages* messages, ScoreBoard* scoreBoard) :
     RefereeBase(messages, scoreBoard),
     m_ball(NULL),
     m_lastFieldOwner(NULL),
+    m_lastTouchedObject(NULL),
     m_lastTouchedPlayer(NULL),
     m_lastWhoGotPoint(NULL),
     m_mustResetBall(false),
@@ -114,6 +116,71 @@ string RefereeLocal::getLoserName() const
     return m_scoreBoard->getMostScoreData().first;
 }
 
+void RefereeLocal::writePlayer(WorldState& state, const Player* player) const
+{
+    state.write(player == NULL ? NULL : player->m_body);
+}
+
+Player* RefereeLocal::readPlayer(WorldState& state) const
+{
+    Body* body = state.readBody();
+    return body == NULL ? NULL : m_players.find(body)->second;
+}
+
+void RefereeLocal::saveState(WorldState& state) const
+{
+    RefereeBase::saveState(state);
+
+    state.write(m_playersAreHalted);
+    state.write(m_mustResetBall);
+    state.write(m_lastFieldOwner);
+    state.write(m_lastTouchedObject);
+    state.write(m_lastTouchedPlayer);
+    state.write(m_ballResetPosition);
+    state.write(m_ballResetVelocity);
+    state.write(m_timer);
+    state.write(m_haltWait);
+    writePlayer(state, m_lastWhoGotPoint);
+    writePlayer(state, m_releaseTehOne);
+    writePlayer(state, m_releaseTehOneD);
+    state.write(m_lastTouchedPosition);
+
+    state.write(static_cast<unsigned int>(m_delayedProcesses.size()));
+    for each_const(DelayedProcessesVector, m_delayedProcesses, iter)
+    {
+        state.write(iter->first.first);
+        state.write(iter->first.second);
+        state.write(iter->second);
+    }
+}
+
+void RefereeLocal::loadState(WorldState& state)
+{
+    RefereeBase::loadState(state);
+
+    m_playersAreHalted = state.readBool();
+    m_mustResetBall = state.readBool();
+    m_lastFieldOwner = state.readBody();
+    m_lastTouchedObject = state.readBody();
+    m_lastTouchedPlayer = state.readBody();
+    m_ballResetPosition = state.readVector();
+    m_ballResetVelocity = state.readVector();
+    state.read(m_timer);
+    m_haltWait = state.readInt();
+    m_lastWhoGotPoint = readPlayer(state);
+    m_releaseTehOne = readPlayer(state);
+    m_releaseTehOneD = readPlayer(state);
+    m_lastTouchedPosition = state.readVector();
+
+    m_delayedProcesses.resize(state.readUInt());
+    for each_(DelayedProcessesVector, m_delayedProcesses, iter)
+    {
+        iter->first.first = state.readBody();
+        iter->first.second = state.readBody();
+        iter->second = state.readFloat();
+    }
+}
+
 bool RefereeLocal::isGroundObject(const Body* body) const
 {
     return ((body == m_ground) || (body == m_field));
@@ -268,7 +335,7 @@ void RefereeLocal::processCriticalEvent()
     if (maxScore.second >= m_matchPoints)
     {
         string overText;
-        if (maxScore.first == m_humanPlayer->m_profile->m_name)
+        if (m_humanPlayer != NULL && maxScore.first == m_humanPlayer->m_profile->m_name)
         {
             overText = Language::instance->get(TEXT_RESTART);
         }
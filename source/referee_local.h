@@ -31,6 +31,9 @@ public:
 
     string getLoserName() const;
 
+    void saveState(WorldState& state) const;
+    void loadState(WorldState& state);
+
 
 private:
     bool m_mustResetBall;
@@ -55,6 +58,9 @@ private:
     void processPlayerGround(const Body* player);
     void updateDelayedProcesses();
 
+    void    writePlayer(WorldState& state, const Player* player) const;
+    Player* readPlayer(WorldState& state) const;
+
     void resetOwnCombo(const Body* player);
     void resetCombo();
     void incrementCombo(const Body* player, const Vector& position);
@@ -0,0 +1,571 @@
+#include <cstring>
+#include "replay.h"
+#include "world.h"
+#include "player.h"
+#include "player_replay.h"
+#include "referee_base.h"
+#include "profile.h"
+#include "file.h"
+#include "varint.h"
+
+static const char         REPLAY_MAGIC[4] = { 'S', '3', 'R', 'P' };
+static const unsigned int REPLAY_VERSION = 2;
+
+// record tags, low two bits of first varint, frame has step count above
+static const unsigned int TAG_FRAME = 0;
+static const unsigned int TAG_KEYFRAME = 1;
+static const unsigned int TAG_END = 2;
+
+// words per player in frame: direction, rotation, jump, kick, draws
+static const int INPUT_WORDS = 11;
+static const int PLAYERS = 4;
+
+static unsigned int floatBits(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// small differences both ways give small numbers
+static unsigned int zigzag(unsigned int diff)
+{
+    int value = static_cast<int>(diff);
+    return static_cast<unsigned int>((value << 1) ^ (value >> 31));
+}
+
+static unsigned int unzigzag(unsigned int value)
+{
+    return (value >> 1) ^ (0U - (value & 1));
+}
+
+static void putString(bytes& out, const string& value)
+{
+    putVarint(out, static_cast<unsigned int>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+static void putFloat(bytes& out, float value)
+{
+    putVarint(out, floatBits(value));
+}
+
+static void inputWords(const PlayerInput& input, unsigned int draws, unsigned int words[INPUT_WORDS])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        words[i] = floatBits(input.direction.v[i]);
+        words[4 + i] = floatBits(input.rotation.v[i]);
+    }
+    words[8] = input.jump ? 1 : 0;
+    words[9] = input.kick ? 1 : 0;
+    words[10] = draws;
+}
+
+static PlayerInput wordsInput(const unsigned int words[INPUT_WORDS])
+{
+    PlayerInput input;
+    for (int i = 0; i < 4; i++)
+    {
+        input.direction.v[i] = bitsFloat(words[i]);
+        input.rotation.v[i] = bitsFloat(words[4 + i]);
+    }
+    input.jump = words[8] != 0;
+    input.kick = words[9] != 0;
+    return input;
+}
+
+ReplayRecorder::ReplayRecorder(const string& filename, World* world, int keyframeSteps) :
+    m_filename(filename),
+    m_world(world),
+    m_keyframeSteps(keyframeSteps),
+    m_steps(0),
+    m_update(0),
+    m_lastUpdate(0),
+    m_step(0),
+    m_lastStep(0),
+    m_frameSteps(0),
+    m_gameOver(false)
+{
+    memset(m_input, 0, sizeof(m_input));
+    memset(m_lastInput, 0, sizeof(m_lastInput));
+
+    if (m_world->m_localPlayers.size() != PLAYERS)
+    {
+        Exception("Replay can be recorded only with four players");
+    }
+
+    m_data.insert(m_data.end(), REPLAY_MAGIC, REPLAY_MAGIC + sizeof(REPLAY_MAGIC));
+    putVarint(m_data, REPLAY_VERSION);
+    putVarint(m_data, m_world->m_current);
+    putVarint(m_data, m_keyframeSteps);
+    for (int i = 0; i < PLAYERS; i++)
+    {
+        const Profile* profile = m_world->m_localPlayers[i]->m_profile;
+        putString(m_data, profile->m_name);
+        putString(m_data, profile->m_collisionID);
+        for (int k = 0; k < 4; k++)
+        {
+            putFloat(m_data, profile->m_color.v[k]);
+        }
+        putFloat(m_data, profile->m_speed);
+        putFloat(m_data, profile->m_accuracy);
+        putFloat(m_data, profile->m_jump);
+    }
+
+    keyframe();
+    m_world->setRecorder(this);
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+    if (m_world != NULL)
+    {
+        save();
+    }
+}
+
+bool ReplayRecorder::save()
+{
+    assert(m_world != NULL);
+    m_world->setRecorder(NULL);
+    m_world = NULL;
+    putVarint(m_data, TAG_END);
+
+    File::Writer out(m_filename);
+    if (!out.is_open() || out.write(&m_data[0], m_data.size()) != m_data.size())
+    {
+        clog << "ERROR: can not write replay '" << m_filename << "'" << endl;
+        return false;
+    }
+    return true;
+}
+
+size_t ReplayRecorder::size() const
+{
+    return m_data.size();
+}
+
+void ReplayRecorder::control(int idx, Player* player, unsigned int draws)
+{
+    inputWords(player->getInput(), draws, m_input[idx]);
+}
+
+void ReplayRecorder::update(float delta)
+{
+    m_update = floatBits(delta);
+}
+
+void ReplayRecorder::step(float delta)
+{
+    // all steps in one frame have the same delta
+    m_step = floatBits(delta);
+    m_frameSteps++;
+}
+
+void ReplayRecorder::frame()
+{
+    putVarint(m_data, (m_frameSteps << 2) | TAG_FRAME);
+    putVarint(m_data, zigzag(m_update - m_lastUpdate));
+    putVarint(m_data, zigzag(m_step - m_lastStep));
+    m_lastUpdate = m_update;
+    m_lastStep = m_step;
+
+    for (int i = 0; i < PLAYERS; i++)
+    {
+        unsigned int mask = 0;
+        for (int k = 0; k < INPUT_WORDS; k++)
+        {
+            if (m_input[i][k] != m_lastInput[i][k])
+            {
+                mask |= 1 << k;
+            }
+        }
+        putVarint(m_data, mask);
+        for (int k = 0; k < INPUT_WORDS; k++)
+        {
+            if (mask & (1 << k))
+            {
+                putVarint(m_data, zigzag(m_input[i][k] - m_lastInput[i][k]));
+                m_lastInput[i][k] = m_input[i][k];
+            }
+        }
+    }
+
+    m_steps += m_frameSteps;
+    m_frameSteps = 0;
+
+    // last keyframe lets playback check the final state too
+    bool over = m_world->m_referee->m_gameOver && !m_gameOver;
+    m_gameOver = m_world->m_referee->m_gameOver;
+    if (m_steps >= m_keyframeSteps || over)
+    {
+        keyframe();
+    }
+}
+
+void ReplayRecorder::keyframe()
+{
+    WorldState state;
+    m_world->saveState(state);
+
+    putVarint(m_data, TAG_KEYFRAME);
+    putVarint(m_data, static_cast<unsigned int>(state.m_words.size()));
+    for (size_t i = 0; i < state.m_words.size(); i++)
+    {
+        unsigned int last = (i < m_lastKeyframe.m_words.size() ? m_lastKeyframe.m_words[i] : 0);
+        putVarint(m_data, zigzag(state.m_words[i] - last));
+    }
+    m_lastKeyframe = state;
+
+    // continue from exactly what was saved, so playback that starts at
+    // this keyframe goes the same way as the recorded match
+    m_world->loadState(state);
+
+    // next frame does not depend on anything before keyframe
+    memset(m_lastInput, 0, sizeof(m_lastInput));
+    m_lastUpdate = 0;
+    m_lastStep = 0;
+    m_steps = 0;
+}
+
+// reading
+
+Replay::Replay(const string& filename) :
+    m_pos(0),
+    m_framesStart(0),
+    m_level(0),
+    m_keyframeSteps(0),
+    m_length(0.0f),
+    m_world(NULL),
+    m_advanceClock(NULL),
+    m_time(0.0f),
+    m_over(false),
+    m_desyncs(0),
+    m_nextKeyframe(0),
+    m_lastUpdate(0),
+    m_lastStep(0)
+{
+    memset(m_lastInput, 0, sizeof(m_lastInput));
+
+    File::Reader in(filename, true);
+    if (!in.is_open())
+    {
+        Exception("Replay file '" + filename + "' not found");
+    }
+    m_data.assign(in.pointer(), in.pointer() + in.size());
+
+    readHeader();
+    m_framesStart = m_pos;
+
+    // index keyframes and find out length
+    float time = 0.0f;
+    float lastUpdate = 0.0f;
+    while (true)
+    {
+        unsigned int tag = readVarint();
+        if (tag == TAG_END)
+        {
+            break;
+        }
+        else if (tag == TAG_KEYFRAME)
+        {
+            Keyframe keyframe;
+            readKeyframe(keyframe.state);
+            keyframe.offset = m_pos;
+            keyframe.time = time;
+            keyframe.update = lastUpdate;
+            m_keyframes.push_back(keyframe);
+        }
+        else if ((tag & 3) == TAG_FRAME)
+        {
+            PlayerInput inputs[PLAYERS];
+            unsigned int draws[PLAYERS];
+            float update;
+            float step;
+            readFrame(update, step, inputs, draws);
+            time += update;
+            lastUpdate = update;
+        }
+        else
+        {
+            Exception("Replay file '" + filename + "' is corrupted");
+        }
+    }
+    m_length = time;
+
+    if (m_keyframes.empty())
+    {
+        Exception("Replay file '" + filename + "' has no keyframes");
+    }
+}
+
+Replay::~Replay()
+{
+    for each_const(vector<Profile*>, m_profiles, iter)
+    {
+        delete *iter;
+    }
+}
+
+unsigned int Replay::readVarint()
+{
+    unsigned int value;
+    if (!getVarint(m_data, m_pos, value))
+    {
+        Exception(m_pos >= m_data.size() ? "Replay file is truncated" : "Replay file is corrupted");
+    }
+    return value;
+}
+
+float Replay::readFloat()
+{
+    return bitsFloat(readVarint());
+}
+
+string Replay::readString()
+{
+    unsigned int size = readVarint();
+    if (m_pos + size > m_data.size())
+    {
+        Exception("Replay file is truncated");
+    }
+    string value(m_data.begin() + m_pos, m_data.begin() + m_pos + size);
+    m_pos += size;
+    return value;
+}
+
+void Replay::readHeader()
+{
+    if (m_data.size() < sizeof(REPLAY_MAGIC) ||
+        memcmp(&m_data[0], REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+    {
+        Exception("Not a replay file");
+    }
+    m_pos = sizeof(REPLAY_MAGIC);
+
+    if (readVarint() != REPLAY_VERSION)
+    {
+        Exception("Unsupported replay version");
+    }
+    m_level = readVarint();
+    m_keyframeSteps = readVarint();
+
+    for (int i = 0; i < PLAYERS; i++)
+    {
+        Profile* profile = new Profile();
+        profile->m_name = readString();
+        profile->m_collisionID = readString();
+        for (int k = 0; k < 4; k++)
+        {
+            profile->m_color.v[k] = readFloat();
+        }
+        profile->m_speed = readFloat();
+        profile->m_accuracy = readFloat();
+        profile->m_jump = readFloat();
+        m_profiles.push_back(profile);
+    }
+}
+
+void Replay::readFrame(float& update, float& step, PlayerInput* inputs, unsigned int* draws)
+{
+    m_lastUpdate += unzigzag(readVarint());
+    m_lastStep += unzigzag(readVarint());
+    update = bitsFloat(m_lastUpdate);
+    step = bitsFloat(m_lastStep);
+
+    for (int i = 0; i < PLAYERS; i++)
+    {
+        unsigned int mask = readVarint();
+        for (int k = 0; k < INPUT_WORDS; k++)
+        {
+            if (mask & (1 << k))
+            {
+                m_lastInput[i][k] += unzigzag(readVarint());
+            }
+        }
+        inputs[i] = wordsInput(m_lastInput[i]);
+        draws[i] = m_lastInput[i][10];
+    }
+}
+
+void Replay::readKeyframe(WorldState& state)
+{
+    unsigned int count = readVarint();
+    state.clear();
+    state.m_words.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned int last = (i < m_lastKeyframe.m_words.size() ? m_lastKeyframe.m_words[i] : 0);
+        state.m_words[i] = last + unzigzag(readVarint());
+    }
+    m_lastKeyframe = state;
+
+    memset(m_lastInput, 0, sizeof(m_lastInput));
+    m_lastUpdate = 0;
+    m_lastStep = 0;
+}
+
+const vector<Profile*>& Replay::getProfiles() const
+{
+    return m_profiles;
+}
+
+int Replay::getLevel() const
+{
+    return m_level;
+}
+
+float Replay::getLength() const
+{
+    return m_length;
+}
+
+float Replay::getTime() const
+{
+    return m_time;
+}
+
+bool Replay::isOver() const
+{
+    return m_over;
+}
+
+int Replay::getDesyncs() const
+{
+    return m_desyncs;
+}
+
+void Replay::start(World* world, void (*advanceClock)(float seconds))
+{
+    m_world = world;
+    m_advanceClock = advanceClock;
+    m_desyncs = 0;
+    restore(0);
+}
+
+void Replay::restore(size_t keyframe)
+{
+    const Keyframe& key = m_keyframes[keyframe];
+
+    WorldState state = key.state;
+    m_world->loadState(state);
+    if (m_advanceClock != NULL)
+    {
+        m_advanceClock(key.update);
+    }
+
+    m_pos = key.offset;
+    m_time = key.time;
+    m_over = false;
+    m_nextKeyframe = keyframe + 1;
+
+    memset(m_lastInput, 0, sizeof(m_lastInput));
+    m_lastUpdate = 0;
+    m_lastStep = 0;
+}
+
+bool Replay::playFrame()
+{
+    if (m_over)
+    {
+        return false;
+    }
+
+    unsigned int tag = readVarint();
+    if (tag == TAG_END)
+    {
+        m_over = true;
+        return false;
+    }
+
+    PlayerInput inputs[PLAYERS];
+    unsigned int draws[PLAYERS];
+    float update;
+    float step;
+    readFrame(update, step, inputs, draws);
+
+    for (int i = 0; i < PLAYERS; i++)
+    {
+        static_cast<ReplayPlayer*>(m_world->m_localPlayers[i])->setInput(inputs[i], draws[i]);
+    }
+
+    m_world->control();
+    m_world->update(update);
+    for (unsigned int i = 0; i < (tag >> 2); i++)
+    {
+        m_world->updateStep(step);
+    }
+    m_world->prepare();
+
+    // keyframes are recorded in prepare, before clock moves on
+    size_t pos = m_pos;
+    while (readVarint() == TAG_KEYFRAME)
+    {
+        // already decoded when loading, only check that playback matches
+        const Keyframe& key = m_keyframes[m_nextKeyframe];
+
+        WorldState current;
+        m_world->saveState(current);
+        if (current != key.state)
+        {
+            size_t word = 0;
+            while (word < current.m_words.size() && word < key.state.m_words.size() &&
+                   current.m_words[word] == key.state.m_words[word])
+            {
+                word++;
+            }
+            clog << "Replay differs from keyframe at " << key.time << " s, word " << word
+                 << " of " << key.state.m_words.size() << endl;
+
+            m_desyncs++;
+        }
+
+        // recorder continued from loaded keyframe too
+        WorldState state = key.state;
+        m_world->loadState(state);
+
+        m_pos = key.offset;
+        m_nextKeyframe++;
+        memset(m_lastInput, 0, sizeof(m_lastInput));
+        m_lastUpdate = 0;
+        m_lastStep = 0;
+
+        pos = m_pos;
+    }
+    m_pos = pos;
+
+    if (m_advanceClock != NULL)
+    {
+        m_advanceClock(update);
+    }
+    m_time += update;
+
+    return true;
+}
+
+void Replay::seek(float time)
+{
+    size_t keyframe = 0;
+    while (keyframe + 1 < m_keyframes.size() && m_keyframes[keyframe + 1].time <= time)
+    {
+        keyframe++;
+    }
+
+    // going forward without passing a keyframe is cheaper by playing
+    if (time < m_time || keyframe >= m_nextKeyframe)
+    {
+        restore(keyframe);
+    }
+
+    while (m_time < time && playFrame())
+    {
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include "common.h"
+#include "world_state.h"
+
+class World;
+class Player;
+class Profile;
+struct PlayerInput;
+
+// Replay file: header with level and profiles, then one record per frame
+// with update and step deltas and what every player's control() left
+// (only changed words, as varint encoded differences), and every
+// keyframe interval steps a full WorldState, encoded against the
+// previous keyframe. Frame differences start over after each keyframe,
+// so playback can start at any keyframe.
+
+class ReplayRecorder : public NoCopy
+{
+public:
+    // attaches to world and writes the first keyframe, world must be
+    // initialized, file is written in write folder by save or when
+    // recorder is deleted, which must happen before world is deleted.
+    // Every keyframe reloads the world from the saved state, which
+    // flushes Newton caches, so a recorded match does not go bit for
+    // bit like the same match without a recorder
+    ReplayRecorder(const string& filename, World* world, int keyframeSteps = 150);
+    ~ReplayRecorder();
+
+    // detaches from world and writes the file, false if it can not
+    bool save();
+
+    // called by World
+    void control(int idx, Player* player, unsigned int draws);
+    void update(float delta);
+    void step(float delta);
+    void frame();
+
+    size_t size() const;
+
+private:
+    void keyframe();
+
+    string               m_filename;
+    World*               m_world;
+    int                  m_keyframeSteps;
+    int                  m_steps;        // since last keyframe
+
+    bytes                m_data;
+    WorldState           m_lastKeyframe;
+
+    unsigned int         m_input[4][11];
+    unsigned int         m_lastInput[4][11];
+    unsigned int         m_update;
+    unsigned int         m_lastUpdate;
+    unsigned int         m_step;
+    unsigned int         m_lastStep;
+    int                  m_frameSteps;
+    bool                 m_gameOver;
+};
+
+class Replay : public NoCopy
+{
+public:
+    Replay(const string& filename); // from write folder
+    ~Replay();
+
+    // for Network::setReplayProfiles and World
+    const vector<Profile*>& getProfiles() const;
+    int   getLevel() const;
+
+    float getLength() const; // in seconds
+    float getTime() const;
+    bool  isOver() const;
+    int   getDesyncs() const; // keyframes that did not match while playing
+
+    // world must be created with getProfiles as ReplayPlayers and with
+    // getLevel, advanceClock moves Timer clock by recorded frame time
+    void start(World* world, void (*advanceClock)(float seconds) = NULL);
+    bool playFrame();     // false when replay is over
+    void seek(float time); // nearest keyframe before time, then plays to time
+
+private:
+    struct Keyframe
+    {
+        size_t     offset; // first frame after keyframe
+        float      time;
+        float      update; // clock of frame before keyframe is not moved yet
+        WorldState state;
+    };
+
+    unsigned int readVarint();
+    float        readFloat();
+    string       readString();
+    void         readHeader();
+    void         readFrame(float& update, float& step, PlayerInput* inputs, unsigned int* draws);
+    void         readKeyframe(WorldState& state);
+    void         restore(size_t keyframe);
+
+    bytes             m_data;
+    size_t            m_pos;
+    size_t            m_framesStart;
+    vector<Profile*>  m_profiles;
+    int               m_level;
+    int               m_keyframeSteps;
+
+    vector<Keyframe>  m_keyframes;
+    float             m_length;
+
+    World*            m_world;
+    void            (*m_advanceClock)(float seconds);
+    float             m_time;
+    bool              m_over;
+    int               m_desyncs;
+    size_t            m_nextKeyframe;
+
+    WorldState        m_lastKeyframe;
+    unsigned int      m_lastInput[4][11];
+    unsigned int      m_lastUpdate;
+    unsigned int      m_lastStep;
+};
+
+#endif
@@ -8,10 +8,15 @@
 #include "colors.h"
 #include "profile.h"
 #include "network.h"
+#include "world_state.h"
 
 Account::Account() : 
     m_total(0),
-    m_combo(0)
+    m_combo(0),
+    m_faults(0),
+    m_combos(0),
+    m_comboHits(0),
+    m_bestCombo(0)
 {
 }
 
@@ -56,6 +61,7 @@ void ScoreBoard::registerPlayers(const vector<Player*>& players)
         string name = players[i]->m_profile->m_name;
         m_scores[name] = Account();
         m_playerOrder.push_back(name);
+        m_orderAccounts.push_back(&m_scores[name]);
         ScoreMessage* msg = new ScoreMessage(Language::instance->get(TEXT_SCORE_MESSAGE)(m_playerOrder[i]),
                                              m_boardPositions[newIndex].m_position, 
                                              players[i]->m_profile->m_color, 
@@ -92,9 +98,50 @@ StringIntPair ScoreBoard::getMostScoreData()
     return make_pair(name, max);
 }
 
+const Scores& ScoreBoard::getScores() const
+{
+    return m_scores;
+}
+
+void ScoreBoard::saveState(WorldState& state) const
+{
+    for each_const(Scores, m_scores, iter)
+    {
+        const Account& account = iter->second;
+        state.write(account.m_total);
+        state.write(account.m_combo);
+        state.write(account.m_faults);
+        state.write(account.m_combos);
+        state.write(account.m_comboHits);
+        state.write(account.m_bestCombo);
+    }
+    state.write(m_joinedCombo);
+}
+
+void ScoreBoard::loadState(WorldState& state)
+{
+    for each_(Scores, m_scores, iter)
+    {
+        Account& account = iter->second;
+        account.m_total = state.readInt();
+        account.m_combo = state.readInt();
+        account.m_faults = state.readInt();
+        account.m_combos = state.readInt();
+        account.m_comboHits = state.readInt();
+        account.m_bestCombo = state.readInt();
+    }
+    m_joinedCombo = state.readInt();
+}
+
 void ScoreBoard::resetOwnCombo(const string& name)
 {
     Account& acc = m_scores[name];
+    if (acc.m_combo != 0)
+    {
+        acc.m_combos++;
+        acc.m_comboHits += acc.m_combo;
+        acc.m_bestCombo = std::max(acc.m_bestCombo, acc.m_combo);
+    }
     acc.m_combo = 0;
 }
 
@@ -121,6 +168,7 @@ void ScoreBoard::addPoints(const string& name, int points)
 {
     Account& acc = m_scores.find(name)->second;
     acc.m_total += points;
+    acc.m_faults++;
 }
 
 int ScoreBoard::getSelfTotalPoints(const string& name)
@@ -147,9 +195,9 @@ void ScoreBoard::fadeOutLastTouchedMsg()
 void ScoreBoard::update()
 {
     m_comboMessage->m_points = m_joinedCombo;
-    for (size_t i = 0; i < m_playerOrder.size(); i++)
+    for (size_t i = 0; i < m_orderAccounts.size(); i++)
     {
-        m_scoreMessages[i]->m_score = m_scores[m_playerOrder[i]].m_total;
-        m_selfComboMessages[i]->m_points = m_scores[m_playerOrder[i]].m_combo;
+        m_scoreMessages[i]->m_score = m_orderAccounts[i]->m_total;
+        m_selfComboMessages[i]->m_points = m_orderAccounts[i]->m_combo;
     }
 }
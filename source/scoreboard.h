@@ -10,12 +10,19 @@ class ComboMessage;
 class LastTouchedMessage;
 class Messages;
 class Player;
+class WorldState;
 
 struct Account
 {
     Account();
     int m_total;
     int m_combo;
+
+    // match statistics
+    int m_faults;
+    int m_combos;     // finished own combos
+    int m_comboHits;  // hits in finished own combos
+    int m_bestCombo;
 };
 
 struct BoardInfo
@@ -50,11 +57,17 @@ public:
     void fadeOutLastTouchedMsg();
 
 	StringIntPair getMostScoreData();
+    const Scores& getScores() const;
+
+    // accounts are changed in place, score messages keep pointing at them
+    void saveState(WorldState& state) const;
+    void loadState(WorldState& state);
     
 
 private:
     Scores               m_scores;
     Order                m_playerOrder;
+    vector<const Account*> m_orderAccounts; // of m_playerOrder, for update
     int                  m_joinedCombo;
     Messages*            m_messages;
     //TODO: make universal
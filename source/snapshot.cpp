@@ -0,0 +1,665 @@
+#include <cmath>
+#include "snapshot.h"
+#include "body.h"
+#include "varint.h"
+
+static const byte SNAPSHOT_MAGIC[2] = { 'S', 'N' };
+
+static const int   POSITION_SCALE = 1024;
+static const int   POSITION_BITS = 18;           // +-128 m, world ends at 80 m
+static const float ROTATION_SCALE = 1023.0f * 1.41421356f;
+static const int   ROTATION_BITS = 11;
+static const int   VELOCITY_SCALE = 256;
+static const int   VELOCITY_BITS = 15;           // +-64 m/s
+static const float OMEGA_SCALE = 64.0f;
+static const int   OMEGA_BITS = 15;              // +-256 rad/s
+
+static const size_t HISTORY = 64;                // snapshots kept for baselines
+static const size_t MAX_HEADER = 2 + 5 * 5;      // magic and five varints
+// delta body with every field changed by more than 272, see writeDelta
+static const size_t MAX_BODY_BITS = 1 + (1 + 3 * (3 + POSITION_BITS)) + (2 + 3 * (3 + ROTATION_BITS)) +
+                                    (1 + 3 * (3 + VELOCITY_BITS)) + (1 + 3 * (3 + OMEGA_BITS));
+static const unsigned int MAX_BODIES = 4096;
+
+// little endian bit stream, first value in lowest bits
+class BitWriter
+{
+public:
+    BitWriter(bytes& out) : m_out(out), m_bits(0), m_count(0)
+    {
+    }
+
+    void write(unsigned int value, int count)
+    {
+        if (count < 32)
+        {
+            value &= (1U << count) - 1;
+        }
+        m_bits |= static_cast<uint64_t>(value) << m_count;
+        m_count += count;
+        if (m_count >= 32)
+        {
+            // from a local, bytes stored to m_out could alias members
+            unsigned int word = static_cast<unsigned int>(m_bits);
+            byte* out = grow(4);
+            out[0] = static_cast<byte>(word);
+            out[1] = static_cast<byte>(word >> 8);
+            out[2] = static_cast<byte>(word >> 16);
+            out[3] = static_cast<byte>(word >> 24);
+            m_bits >>= 32;
+            m_count -= 32;
+        }
+    }
+
+    void flush()
+    {
+        while (m_count > 0)
+        {
+            m_out.push_back(static_cast<byte>(m_bits));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+    size_t size() const
+    {
+        return m_out.size() * 8 + m_count;
+    }
+
+private:
+    byte* grow(size_t count)
+    {
+        size_t size = m_out.size();
+        m_out.resize(size + count);
+        return &m_out[size];
+    }
+
+    bytes&   m_out;
+    uint64_t m_bits;
+    int      m_count;
+};
+
+class BitReader
+{
+public:
+    BitReader(const bytes& in, size_t pos) :
+        m_in(in), m_pos(pos), m_bits(0), m_count(0), m_overflow(false)
+    {
+    }
+
+    unsigned int read(int count)
+    {
+        while (m_count < count)
+        {
+            if (m_pos == m_in.size())
+            {
+                m_overflow = true;
+                return 0;
+            }
+            m_bits |= static_cast<uint64_t>(m_in[m_pos++]) << m_count;
+            m_count += 8;
+        }
+        unsigned int value = static_cast<unsigned int>(m_bits);
+        if (count < 32)
+        {
+            value &= (1U << count) - 1;
+        }
+        m_bits >>= count;
+        m_count -= count;
+        return value;
+    }
+
+    bool overflow() const
+    {
+        return m_overflow;
+    }
+
+private:
+    const bytes& m_in;
+    size_t       m_pos;
+    uint64_t     m_bits;
+    int          m_count;
+    bool         m_overflow;
+};
+
+static int quantize(float value, float scale, int bits)
+{
+    int limit = 1 << (bits - 1);
+    float scaled = std::floor(value * scale + 0.5f);
+    if (scaled < static_cast<float>(-limit))
+    {
+        return -limit;
+    }
+    if (scaled > static_cast<float>(limit - 1))
+    {
+        return limit - 1;
+    }
+    return static_cast<int>(scaled);
+}
+
+// wrapping tick comparison
+static bool newer(unsigned int tick, unsigned int than)
+{
+    return static_cast<int>(tick - than) > 0;
+}
+
+QuantizedBody::QuantizedBody() : largest(3)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        position[i] = rotation[i] = velocity[i] = omega[i] = 0;
+    }
+}
+
+void QuantizedBody::capture(const Body* body)
+{
+    const Matrix& m = body->m_matrix;
+
+    float q[4]; // x, y, z, w
+    float trace = m.m00 + m.m11 + m.m22;
+    if (trace > 0.0f)
+    {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q[3] = 0.25f * s;
+        q[0] = (m.m21 - m.m12) / s;
+        q[1] = (m.m02 - m.m20) / s;
+        q[2] = (m.m10 - m.m01) / s;
+    }
+    else if (m.m00 > m.m11 && m.m00 > m.m22)
+    {
+        float s = std::sqrt(1.0f + m.m00 - m.m11 - m.m22) * 2.0f;
+        q[3] = (m.m21 - m.m12) / s;
+        q[0] = 0.25f * s;
+        q[1] = (m.m01 + m.m10) / s;
+        q[2] = (m.m02 + m.m20) / s;
+    }
+    else if (m.m11 > m.m22)
+    {
+        float s = std::sqrt(1.0f + m.m11 - m.m00 - m.m22) * 2.0f;
+        q[3] = (m.m02 - m.m20) / s;
+        q[0] = (m.m01 + m.m10) / s;
+        q[1] = 0.25f * s;
+        q[2] = (m.m12 + m.m21) / s;
+    }
+    else
+    {
+        float s = std::sqrt(1.0f + m.m22 - m.m00 - m.m11) * 2.0f;
+        q[3] = (m.m10 - m.m01) / s;
+        q[0] = (m.m02 + m.m20) / s;
+        q[1] = (m.m12 + m.m21) / s;
+        q[2] = 0.25f * s;
+    }
+
+    // q and -q are the same rotation, left out component is made positive
+    largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (std::fabs(q[i]) > std::fabs(q[largest]))
+        {
+            largest = i;
+        }
+    }
+    float sign = (q[largest] < 0.0f ? -1.0f : 1.0f);
+    for (int i = 0, k = 0; i < 4; i++)
+    {
+        if (i != largest)
+        {
+            rotation[k++] = quantize(sign * q[i], ROTATION_SCALE, ROTATION_BITS);
+        }
+    }
+
+    float w[3];
+    NewtonBodyGetOmega(body->m_newtonBody, w);
+    Vector v = body->getVelocity();
+    for (int i = 0; i < 3; i++)
+    {
+        position[i] = quantize(m.m[12 + i], static_cast<float>(POSITION_SCALE), POSITION_BITS);
+        velocity[i] = quantize(v.v[i], static_cast<float>(VELOCITY_SCALE), VELOCITY_BITS);
+        omega[i] = quantize(w[i], OMEGA_SCALE, OMEGA_BITS);
+    }
+}
+
+Matrix QuantizedBody::getMatrix() const
+{
+    float q[4];
+    float sum = 0.0f;
+    for (int i = 0, k = 0; i < 4; i++)
+    {
+        if (i != largest)
+        {
+            q[i] = rotation[k++] / ROTATION_SCALE;
+            sum += q[i] * q[i];
+        }
+    }
+    q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    return Matrix(1.0f - 2.0f * (y*y + z*z), 2.0f * (x*y - z*w),        2.0f * (x*z + y*w),        0.0f,
+                  2.0f * (x*y + z*w),        1.0f - 2.0f * (x*x + z*z), 2.0f * (y*z - x*w),        0.0f,
+                  2.0f * (x*z - y*w),        2.0f * (y*z + x*w),        1.0f - 2.0f * (x*x + y*y), 0.0f,
+                  static_cast<float>(position[0]) / POSITION_SCALE,
+                  static_cast<float>(position[1]) / POSITION_SCALE,
+                  static_cast<float>(position[2]) / POSITION_SCALE, 1.0f);
+}
+
+void QuantizedBody::apply(Body* body) const
+{
+    float v[3];
+    float w[3];
+    for (int i = 0; i < 3; i++)
+    {
+        v[i] = static_cast<float>(velocity[i]) / VELOCITY_SCALE;
+        w[i] = omega[i] / OMEGA_SCALE;
+    }
+    body->setMatrix(getMatrix());
+    NewtonBodySetVelocity(body->m_newtonBody, v);
+    NewtonBodySetOmega(body->m_newtonBody, w);
+}
+
+bool QuantizedBody::operator == (const QuantizedBody& other) const
+{
+    if (largest != other.largest)
+    {
+        return false;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        if (position[i] != other.position[i] || rotation[i] != other.rotation[i] ||
+            velocity[i] != other.velocity[i] || omega[i] != other.omega[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QuantizedBody::operator != (const QuantizedBody& other) const
+{
+    return !(*this == other);
+}
+
+Snapshot::Snapshot() : m_tick(0)
+{
+}
+
+bool Snapshot::operator == (const Snapshot& other) const
+{
+    return m_tick == other.m_tick && m_bodies == other.m_bodies;
+}
+
+bool Snapshot::operator != (const Snapshot& other) const
+{
+    return !(*this == other);
+}
+
+// values are written in full as unsigned offset from -limit, or as
+// zigzag difference from baseline: 0 for none, 10 and 4 bits, 110 and
+// 8 bits, or 111 and full value
+
+static void writeValue(BitWriter& out, int value, int bits)
+{
+    out.write(static_cast<unsigned int>(value + (1 << (bits - 1))), bits);
+}
+
+static int readValue(BitReader& in, int bits)
+{
+    return static_cast<int>(in.read(bits)) - (1 << (bits - 1));
+}
+
+static void writeDelta(BitWriter& out, int value, int base, int bits)
+{
+    int diff = value - base;
+    unsigned int zigzag = static_cast<unsigned int>((diff << 1) ^ (diff >> 31));
+    if (zigzag == 0)
+    {
+        out.write(0, 1);
+    }
+    else if (zigzag <= 16)
+    {
+        out.write(1, 2);
+        out.write(zigzag - 1, 4);
+    }
+    else if (zigzag <= 272)
+    {
+        out.write(3, 3);
+        out.write(zigzag - 17, 8);
+    }
+    else
+    {
+        out.write(7, 3);
+        writeValue(out, value, bits);
+    }
+}
+
+static int readDelta(BitReader& in, int base, int bits)
+{
+    unsigned int zigzag;
+    if (in.read(1) == 0)
+    {
+        return base;
+    }
+    else if (in.read(1) == 0)
+    {
+        zigzag = in.read(4) + 1;
+    }
+    else if (in.read(1) == 0)
+    {
+        zigzag = in.read(8) + 17;
+    }
+    else
+    {
+        return readValue(in, bits);
+    }
+    return base + static_cast<int>((zigzag >> 1) ^ (0U - (zigzag & 1)));
+}
+
+static void writeVector(BitWriter& out, const int value[3], const int* base, int bits)
+{
+    if (base == NULL)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            writeValue(out, value[i], bits);
+        }
+        return;
+    }
+
+    bool changed = (value[0] != base[0] || value[1] != base[1] || value[2] != base[2]);
+    out.write(changed ? 1 : 0, 1);
+    if (changed)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            writeDelta(out, value[i], base[i], bits);
+        }
+    }
+}
+
+static void readVector(BitReader& in, int value[3], const int* base, int bits)
+{
+    if (base == NULL)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            value[i] = readValue(in, bits);
+        }
+        return;
+    }
+
+    bool changed = (in.read(1) != 0);
+    for (int i = 0; i < 3; i++)
+    {
+        value[i] = (changed ? readDelta(in, base[i], bits) : base[i]);
+    }
+}
+
+static void writeRotation(BitWriter& out, const QuantizedBody& body, const QuantizedBody* base)
+{
+    if (base != NULL)
+    {
+        bool same = (body.largest == base->largest);
+        out.write(same ? 1 : 0, 1);
+        if (same)
+        {
+            writeVector(out, body.rotation, base->rotation, ROTATION_BITS);
+            return;
+        }
+    }
+    out.write(body.largest, 2);
+    writeVector(out, body.rotation, NULL, ROTATION_BITS);
+}
+
+static void readRotation(BitReader& in, QuantizedBody& body, const QuantizedBody* base)
+{
+    if (base != NULL && in.read(1) != 0)
+    {
+        body.largest = base->largest;
+        readVector(in, body.rotation, base->rotation, ROTATION_BITS);
+        return;
+    }
+    body.largest = in.read(2);
+    readVector(in, body.rotation, NULL, ROTATION_BITS);
+}
+
+// without base every field is written in full, with base one bit
+// for unchanged body or for every unchanged field
+static void writeBody(BitWriter& out, const QuantizedBody& body, const QuantizedBody* base)
+{
+    if (base != NULL)
+    {
+        bool changed = (body != *base);
+        out.write(changed ? 1 : 0, 1);
+        if (!changed)
+        {
+            return;
+        }
+    }
+    writeVector(out, body.position, base == NULL ? NULL : base->position, POSITION_BITS);
+    writeRotation(out, body, base);
+    writeVector(out, body.velocity, base == NULL ? NULL : base->velocity, VELOCITY_BITS);
+    writeVector(out, body.omega, base == NULL ? NULL : base->omega, OMEGA_BITS);
+}
+
+static void readBody(BitReader& in, QuantizedBody& body, const QuantizedBody* base)
+{
+    if (base != NULL && in.read(1) == 0)
+    {
+        body = *base;
+        return;
+    }
+    readVector(in, body.position, base == NULL ? NULL : base->position, POSITION_BITS);
+    readRotation(in, body, base);
+    readVector(in, body.velocity, base == NULL ? NULL : base->velocity, VELOCITY_BITS);
+    readVector(in, body.omega, base == NULL ? NULL : base->omega, OMEGA_BITS);
+}
+
+static const QuantizedBody* baseBody(const Snapshot* baseline, size_t index)
+{
+    if (baseline == NULL || index >= baseline->m_bodies.size())
+    {
+        return NULL;
+    }
+    return &baseline->m_bodies[index];
+}
+
+SnapshotEncoder::SnapshotEncoder(size_t mtu) :
+    m_mtu(mtu),
+    m_history(HISTORY),
+    m_sent(HISTORY, false),
+    m_acked(false),
+    m_ackTick(0)
+{
+    if (m_mtu < MAX_HEADER + MAX_BODY_BITS / 8 + 1)
+    {
+        Exception("Snapshot MTU is too small");
+    }
+}
+
+void SnapshotEncoder::ack(unsigned int tick)
+{
+    if (!m_acked || newer(tick, m_ackTick))
+    {
+        m_acked = true;
+        m_ackTick = tick;
+    }
+}
+
+void SnapshotEncoder::reset()
+{
+    m_acked = false;
+    m_sent.assign(HISTORY, false);
+}
+
+const Snapshot* SnapshotEncoder::getBaseline() const
+{
+    if (!m_acked)
+    {
+        return NULL;
+    }
+    size_t slot = m_ackTick % HISTORY;
+    if (!m_sent[slot] || m_history[slot].m_tick != m_ackTick)
+    {
+        return NULL;
+    }
+    return &m_history[slot];
+}
+
+void SnapshotEncoder::encode(const Snapshot& snapshot, vector<bytes>& packets)
+{
+    const Snapshot* baseline = getBaseline();
+    if (baseline != NULL && !newer(snapshot.m_tick, baseline->m_tick))
+    {
+        baseline = NULL;
+    }
+    unsigned int distance = (baseline == NULL ? 0 : snapshot.m_tick - baseline->m_tick);
+    unsigned int total = static_cast<unsigned int>(snapshot.m_bodies.size());
+    if (total > MAX_BODIES)
+    {
+        Exception("Too many bodies in snapshot");
+    }
+
+    size_t budget = (m_mtu - MAX_HEADER) * 8;
+    size_t used = 0;
+    size_t first = 0;
+    while (first < total || used == 0)
+    {
+        m_bits.clear();
+        BitWriter out(m_bits);
+        size_t last = first;
+        while (last < total && out.size() + MAX_BODY_BITS <= budget)
+        {
+            writeBody(out, snapshot.m_bodies[last], baseBody(baseline, last));
+            last++;
+        }
+        out.flush();
+
+        // packets of earlier calls are reused, so they keep their memory
+        if (used == packets.size())
+        {
+            packets.push_back(bytes());
+        }
+        bytes& packet = packets[used++];
+        packet.assign(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + sizeof(SNAPSHOT_MAGIC));
+        putVarint(packet, snapshot.m_tick);
+        putVarint(packet, distance);
+        putVarint(packet, total);
+        putVarint(packet, static_cast<unsigned int>(first));
+        putVarint(packet, static_cast<unsigned int>(last - first));
+        packet.insert(packet.end(), m_bits.begin(), m_bits.end());
+
+        first = last;
+    }
+    packets.resize(used);
+
+    size_t slot = snapshot.m_tick % HISTORY;
+    m_history[slot] = snapshot;
+    m_sent[slot] = true;
+}
+
+SnapshotDecoder::SnapshotDecoder() :
+    m_history(HISTORY),
+    m_complete(HISTORY, false),
+    m_hasSnapshot(false),
+    m_newest(0),
+    m_pendingMissing(0),
+    m_hasPending(false)
+{
+}
+
+bool SnapshotDecoder::decode(const bytes& packet)
+{
+    if (packet.size() < sizeof(SNAPSHOT_MAGIC) ||
+        packet[0] != SNAPSHOT_MAGIC[0] || packet[1] != SNAPSHOT_MAGIC[1])
+    {
+        return false;
+    }
+
+    size_t pos = sizeof(SNAPSHOT_MAGIC);
+    unsigned int tick, distance, total, first, count;
+    if (!getVarint(packet, pos, tick) || !getVarint(packet, pos, distance) ||
+        !getVarint(packet, pos, total) || !getVarint(packet, pos, first) ||
+        !getVarint(packet, pos, count) ||
+        total > MAX_BODIES || first > total || count > total - first)
+    {
+        return false;
+    }
+    if (m_hasSnapshot && !newer(tick, m_newest))
+    {
+        return false;
+    }
+    if (m_hasPending && newer(m_pending.m_tick, tick))
+    {
+        return false;
+    }
+
+    const Snapshot* baseline = NULL;
+    if (distance != 0)
+    {
+        unsigned int baseTick = tick - distance;
+        size_t slot = baseTick % HISTORY;
+        if (!m_complete[slot] || m_history[slot].m_tick != baseTick)
+        {
+            return false;
+        }
+        baseline = &m_history[slot];
+    }
+
+    m_bodies.resize(count);
+    BitReader in(packet, pos);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        readBody(in, m_bodies[i], baseBody(baseline, first + i));
+    }
+    if (in.overflow())
+    {
+        return false;
+    }
+
+    if (!m_hasPending || m_pending.m_tick != tick || m_pending.m_bodies.size() != total)
+    {
+        m_pending.m_tick = tick;
+        m_pending.m_bodies.resize(total);
+        m_pendingBodies.assign(total, false);
+        m_pendingMissing = static_cast<int>(total);
+        m_hasPending = true;
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!m_pendingBodies[first + i])
+        {
+            m_pending.m_bodies[first + i] = m_bodies[i];
+            m_pendingBodies[first + i] = true;
+            m_pendingMissing--;
+        }
+    }
+    if (m_pendingMissing != 0)
+    {
+        return false;
+    }
+
+    size_t slot = tick % HISTORY;
+    m_history[slot] = m_pending;
+    m_complete[slot] = true;
+    m_newest = tick;
+    m_hasSnapshot = true;
+    m_hasPending = false;
+    return true;
+}
+
+bool SnapshotDecoder::hasSnapshot() const
+{
+    return m_hasSnapshot;
+}
+
+const Snapshot& SnapshotDecoder::getSnapshot() const
+{
+    assert(m_hasSnapshot);
+    return m_history[m_newest % HISTORY];
+}
+
+unsigned int SnapshotDecoder::getAck() const
+{
+    return m_newest;
+}
@@ -0,0 +1,96 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include "common.h"
+#include "vmath.h"
+
+class Body;
+
+// Body snapshots for sending game state to clients. Bodies are quantized
+// (position 1/1024 m, rotation as smallest three quaternion components,
+// velocity 1/256 m/s, angular velocity 1/64 rad/s), delta encoded against
+// the newest snapshot the receiver acknowledged and bit packed into
+// packets of at most mtu bytes. Every packet carries a range of bodies,
+// so a snapshot is complete when all its packets arrived.
+
+static const size_t SNAPSHOT_MTU = 1200; // UDP payload that is not fragmented
+
+struct QuantizedBody
+{
+    int position[3];
+    int largest;     // index of quaternion component left out
+    int rotation[3]; // other three, scaled from +-1/sqrt(2)
+    int velocity[3];
+    int omega[3];
+
+    QuantizedBody();
+
+    void   capture(const Body* body);
+    void   apply(Body* body) const;
+    Matrix getMatrix() const;
+
+    bool operator == (const QuantizedBody& other) const;
+    bool operator != (const QuantizedBody& other) const;
+};
+
+class Snapshot
+{
+public:
+    Snapshot();
+
+    bool operator == (const Snapshot& other) const;
+    bool operator != (const Snapshot& other) const;
+
+    unsigned int          m_tick;
+    vector<QuantizedBody> m_bodies;
+};
+
+// Sender side, one for every receiver.
+class SnapshotEncoder : public NoCopy
+{
+public:
+    SnapshotEncoder(size_t mtu = SNAPSHOT_MTU);
+
+    void ack(unsigned int tick);   // receiver has complete snapshot of tick
+    void reset();                  // next snapshot is sent in full
+    void encode(const Snapshot& snapshot, vector<bytes>& packets);
+
+private:
+    const Snapshot* getBaseline() const;
+
+    size_t           m_mtu;
+    bytes            m_bits;
+    vector<Snapshot> m_history;    // sent snapshots by tick % size
+    vector<bool>     m_sent;
+    bool             m_acked;
+    unsigned int     m_ackTick;
+};
+
+// Receiver side. Packets may come lost, late or out of order.
+class SnapshotDecoder : public NoCopy
+{
+public:
+    SnapshotDecoder();
+
+    // true when packet completed a snapshot, damaged packets, packets
+    // older than newest snapshot and with unknown baseline are dropped
+    bool decode(const bytes& packet);
+
+    bool            hasSnapshot() const;
+    const Snapshot& getSnapshot() const; // newest complete snapshot
+    unsigned int    getAck() const;      // tick to acknowledge
+
+private:
+    vector<Snapshot> m_history;
+    vector<bool>     m_complete;
+    bool             m_hasSnapshot;
+    unsigned int     m_newest;
+
+    vector<QuantizedBody> m_bodies; // bodies of last packet
+    Snapshot         m_pending;
+    vector<bool>     m_pendingBodies;
+    int              m_pendingMissing;
+    bool             m_hasPending;
+};
+
+#endif
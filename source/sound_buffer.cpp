@@ -2,7 +2,8 @@
 
 #include "sound_buffer.h"
 
-SoundBuffer::SoundBuffer(const string& filename) : OggDecoder("/data/sound/" + filename + ".ogg")
+SoundBuffer::SoundBuffer(const string& filename) : OggDecoder("/data/sound/" + filename + ".ogg"),
+    m_size(0)
 {
     size_t bufferSize = totalSize();
 
@@ -16,6 +17,12 @@ SoundBuffer::SoundBuffer(const string& filename) : OggDecoder("/data/sound/" + f
         alBufferData(m_buffer, m_format, buffer, static_cast<int>(written), m_frequency);
     }
     delete [] buffer;
+    m_size = written;
+}
+
+size_t SoundBuffer::size() const
+{
+    return m_size + m_reader.size();
 }
 
 SoundBuffer::~SoundBuffer()
@@ -3,8 +3,9 @@
 
 #include "common.h"
 #include "oggDecoder.h"
+#include "asset_cache.h"
 
-class SoundBuffer : public OggDecoder
+class SoundBuffer : public OggDecoder, public Asset
 {
     friend class Sound;
     friend class Audio;
@@ -13,7 +14,10 @@ private:
     SoundBuffer(const string& filename);
     ~SoundBuffer();
 
+    size_t size() const;
+
     unsigned int m_buffer;
+    size_t       m_size; // decoded
 };
 
 #endif
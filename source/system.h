@@ -3,27 +3,39 @@
 
 #include "common.h"
 
+// where System keeps its instance, defined in the .cpp of T
 template <class T>
-class System
+struct SharedInstance
 {
-public:
     static T* instance;
-    
+};
+
+// own instance in every thread
+template <class T>
+struct ThreadInstance
+{
+    static THREAD_LOCAL T* instance;
+};
+
+template <class T, class Instance = SharedInstance<T> >
+class System : public Instance
+{
+public:
     System()
     {
-        assert(instance == NULL);
-        instance = reinterpret_cast<T*>(this);
+        assert(Instance::instance == NULL);
+        Instance::instance = reinterpret_cast<T*>(this);
     }
 
     ~System()
     {
-        assert(instance != NULL);
-        instance = NULL;
+        assert(Instance::instance != NULL);
+        Instance::instance = NULL;
     }
 
     void setInstance(T* instance)
     {
-        this->instance = instance;
+        Instance::instance = instance;
     }
 };
 
@@ -0,0 +1,103 @@
+#include <unistd.h>
+#include "task_pool.h"
+
+TaskPool::TaskPool(int threads) : m_running(0), m_stop(false)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_added, NULL);
+    pthread_cond_init(&m_finished, NULL);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, this) != 0)
+        {
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    wait();
+
+    pthread_mutex_lock(&m_mutex);
+    m_stop = true;
+    pthread_cond_broadcast(&m_added);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        pthread_join(m_threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&m_finished);
+    pthread_cond_destroy(&m_added);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+int TaskPool::defaultThreads()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return static_cast<int>(std::min(std::max(cores - 1, 0L), 7L));
+}
+
+void TaskPool::add(Task* task)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_tasks.push_back(task);
+    pthread_cond_signal(&m_added);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void TaskPool::wait()
+{
+    while (runNext(false))
+    {
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_running != 0)
+    {
+        pthread_cond_wait(&m_finished, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// false when there is nothing left to run, or when stopping for workers
+bool TaskPool::runNext(bool block)
+{
+    pthread_mutex_lock(&m_mutex);
+    while (block && m_tasks.empty() && !m_stop)
+    {
+        pthread_cond_wait(&m_added, &m_mutex);
+    }
+    if (m_tasks.empty())
+    {
+        pthread_mutex_unlock(&m_mutex);
+        return false;
+    }
+    Task* task = m_tasks.front();
+    m_tasks.pop_front();
+    m_running++;
+    pthread_mutex_unlock(&m_mutex);
+
+    task->run();
+
+    pthread_mutex_lock(&m_mutex);
+    if (--m_running == 0 && m_tasks.empty())
+    {
+        pthread_cond_broadcast(&m_finished);
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return true;
+}
+
+void* TaskPool::worker(void* pool)
+{
+    while (static_cast<TaskPool*>(pool)->runNext(true))
+    {
+    }
+    return NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef __TASK_POOL_H__
+#define __TASK_POOL_H__
+
+#include <pthread.h>
+#include <deque>
+#include "common.h"
+
+// Work for a TaskPool, owned by whoever added it and keeps its results.
+class Task
+{
+public:
+    virtual ~Task() {}
+    virtual void run() = 0;
+};
+
+// Worker threads running added tasks in any order, the thread waiting for
+// them runs tasks too. Tasks must keep away from what is not thread safe:
+// AssetCache, clog, World and the Newton world of it. THREAD_LOCAL is
+// empty on iPad, so per thread state a task touches (Randoms,
+// World::instance) is shared there, use a pthread key instead.
+class TaskPool : public NoCopy
+{
+public:
+    TaskPool(int threads = defaultThreads()); // 0 runs all tasks in wait()
+    ~TaskPool();
+
+    void add(Task* task);
+    void wait();                              // until all added have run
+
+    static int defaultThreads();              // other cores, at most 7
+
+private:
+    std::deque<Task*> m_tasks;
+    int               m_running;
+    bool              m_stop;
+    vector<pthread_t> m_threads;
+    pthread_mutex_t   m_mutex;
+    pthread_cond_t    m_added;
+    pthread_cond_t    m_finished;
+
+    static void* worker(void* pool);
+    bool runNext(bool block);
+};
+
+#endif
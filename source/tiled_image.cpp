@@ -0,0 +1,274 @@
+#include <cstring>
+#include <zlib.h>
+#include "tiled_image.h"
+#include "task_pool.h"
+
+// one row of tiles with one inflate stream
+class TileRowDecode : public Task
+{
+public:
+    TileRowDecode(const TiledImage* image, int tileY, unsigned char* pixels) :
+        m_image(image), m_tileY(tileY), m_pixels(pixels), m_ok(false) {}
+
+    void run() { m_ok = m_image->decodeRow(m_tileY, m_pixels); }
+
+    const TiledImage* m_image;
+    int               m_tileY;
+    unsigned char*    m_pixels;
+    bool              m_ok;
+};
+
+bool TiledImage::check(const void* data, size_t size)
+{
+    if (size < sizeof(ImageHeader))
+    {
+        return false;
+    }
+    const ImageHeader* header = static_cast<const ImageHeader*>(data);
+    return header->magic == IMAGE_MAGIC && header->version == IMAGE_VERSION && header->size == size;
+}
+
+TiledImage::TiledImage(const void* data, size_t size) :
+    m_data(static_cast<const byte*>(data)),
+    m_header(static_cast<const ImageHeader*>(data)),
+    m_tiles(NULL)
+{
+    if (!check(data, size))
+    {
+        Exception("Invalid tiled image");
+    }
+    m_tiles = reinterpret_cast<const ImageTile*>(m_data + sizeof(ImageHeader));
+
+    const ImageHeader& header = *m_header;
+    if (header.width == 0 || header.height == 0 || header.width > 0xFFFF || header.height > 0xFFFF ||
+        header.components == 0 || header.components > 4 || header.tileSize == 0 ||
+        header.tilesX != (header.width + header.tileSize - 1) / header.tileSize ||
+        header.tilesY != (header.height + header.tileSize - 1) / header.tileSize ||
+        header.tilesX * header.tilesY > (size - sizeof(ImageHeader)) / sizeof(ImageTile))
+    {
+        Exception("Invalid tiled image, bad size");
+    }
+
+    for (unsigned int i = 0; i < header.tilesX * header.tilesY; i++)
+    {
+        if (m_tiles[i].offset > size || m_tiles[i].size > size - m_tiles[i].offset)
+        {
+            Exception("Invalid tiled image, tile out of range");
+        }
+    }
+}
+
+void TiledImage::encode(const unsigned char* pixels, int width, int height, int components,
+                        bytes& data, int tileSize)
+{
+    ImageHeader header;
+    header.magic = IMAGE_MAGIC;
+    header.version = IMAGE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.components = components;
+    header.tileSize = tileSize;
+    header.tilesX = (width + tileSize - 1) / tileSize;
+    header.tilesY = (height + tileSize - 1) / tileSize;
+
+    vector<ImageTile> tiles(header.tilesX * header.tilesY);
+    data.assign(sizeof(ImageHeader) + tiles.size() * sizeof(ImageTile), 0);
+
+    bytes tile;
+    bytes packed;
+    for (unsigned int ty = 0; ty < header.tilesY; ty++)
+    {
+        for (unsigned int tx = 0; tx < header.tilesX; tx++)
+        {
+            int w = std::min(tileSize, width - static_cast<int>(tx) * tileSize);
+            int h = std::min(tileSize, height - static_cast<int>(ty) * tileSize);
+
+            tile.resize(w * h * components);
+            for (int y = 0; y < h; y++)
+            {
+                const unsigned char* row = pixels + ((ty * tileSize + y) * width + tx * tileSize) * components;
+                std::copy(row, row + w * components, &tile[y * w * components]);
+            }
+
+            uLongf packedSize = compressBound(static_cast<uLong>(tile.size()));
+            packed.resize(packedSize);
+            if (compress2(&packed[0], &packedSize, &tile[0], static_cast<uLong>(tile.size()), Z_BEST_COMPRESSION) != Z_OK)
+            {
+                Exception("Can not compress image tile");
+            }
+            packed.resize(packedSize);
+            const bytes& stored = packed.size() < tile.size() ? packed : tile;
+
+            ImageTile& entry = tiles[ty * header.tilesX + tx];
+            entry.offset = static_cast<unsigned int>(data.size());
+            entry.size = static_cast<unsigned int>(stored.size());
+            data.insert(data.end(), stored.begin(), stored.end());
+        }
+    }
+    header.size = static_cast<unsigned int>(data.size());
+
+    memcpy(&data[0], &header, sizeof(header));
+    memcpy(&data[sizeof(header)], &tiles[0], tiles.size() * sizeof(ImageTile));
+}
+
+int TiledImage::width() const
+{
+    return m_header->width;
+}
+
+int TiledImage::height() const
+{
+    return m_header->height;
+}
+
+int TiledImage::components() const
+{
+    return m_header->components;
+}
+
+int TiledImage::tileWidth(int tileX) const
+{
+    return std::min(m_header->tileSize, m_header->width - tileX * m_header->tileSize);
+}
+
+int TiledImage::tileHeight(int tileY) const
+{
+    return std::min(m_header->tileSize, m_header->height - tileY * m_header->tileSize);
+}
+
+bool TiledImage::inflateTile(z_stream& stream, int tileX, int tileY, int rows,
+                             unsigned char* pixels, int stride, bytes& scratch) const
+{
+    const ImageTile& tile = m_tiles[tileY * m_header->tilesX + tileX];
+    int row = tileWidth(tileX) * m_header->components;
+    int size = row * tileHeight(tileY);
+    const byte* data = m_data + tile.offset;
+    stride *= m_header->components;
+
+    if (tile.size != static_cast<unsigned int>(size))
+    {
+        // in one call, inflate is much slower with less than 258 bytes of
+        // room, so rows shorter than the image go through scratch
+        unsigned char* target = pixels;
+        if (stride != row)
+        {
+            scratch.resize(size);
+            target = &scratch[0];
+        }
+
+        if (inflateReset(&stream) != Z_OK)
+        {
+            return false;
+        }
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = tile.size;
+        stream.next_out = target;
+        stream.avail_out = rows * row;
+        int result = inflate(&stream, Z_FINISH);
+        if (stream.avail_out != 0 || (result != Z_STREAM_END && result != Z_BUF_ERROR))
+        {
+            return false;
+        }
+        if (target == pixels)
+        {
+            return true;
+        }
+        data = target;
+    }
+
+    for (int y = 0; y < rows; y++)
+    {
+        memcpy(pixels + y * stride, data + y * row, row);
+    }
+    return true;
+}
+
+bool TiledImage::decodeRow(int tileY, unsigned char* pixels) const
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    bytes scratch;
+    int stride = m_header->width;
+    for (unsigned int tileX = 0; tileX < m_header->tilesX && ok; tileX++)
+    {
+        unsigned char* target = pixels + (tileY * m_header->tileSize * stride + tileX * m_header->tileSize) * m_header->components;
+        ok = inflateTile(stream, tileX, tileY, tileHeight(tileY), target, stride, scratch);
+    }
+
+    inflateEnd(&stream);
+    return ok;
+}
+
+void TiledImage::decode(unsigned char* pixels, int threads) const
+{
+    int count = m_header->tilesY;
+    TaskPool pool(count > 1 ? std::min(threads, count - 1) : 0);
+
+    vector<TileRowDecode> tasks;
+    tasks.reserve(count);
+    for (int ty = 0; ty < count; ty++)
+    {
+        tasks.push_back(TileRowDecode(this, ty, pixels));
+        pool.add(&tasks.back());
+    }
+    pool.wait();
+
+    for each_const(vector<TileRowDecode>, tasks, iter)
+    {
+        if (!iter->m_ok)
+        {
+            Exception("Invalid tiled image, corrupt tile");
+        }
+    }
+}
+
+void TiledImage::decodeRegion(int x, int y, int width, int height, unsigned char* pixels) const
+{
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > static_cast<int>(m_header->width) || y + height > static_cast<int>(m_header->height))
+    {
+        Exception("Image region out of range");
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+    {
+        Exception("Can not inflate image tile");
+    }
+
+    int size = m_header->tileSize;
+    int components = m_header->components;
+    bytes tile(size * size * components);
+    bytes scratch;
+    for (int ty = y / size; ty <= (y + height - 1) / size; ty++)
+    {
+        // rows below the region are not inflated
+        int top = std::max(y, ty * size);
+        int bottom = std::min(y + height, ty * size + tileHeight(ty));
+        for (int tx = x / size; tx <= (x + width - 1) / size; tx++)
+        {
+            int w = tileWidth(tx);
+            if (!inflateTile(stream, tx, ty, bottom - ty * size, &tile[0], w, scratch))
+            {
+                Exception("Invalid tiled image, corrupt tile");
+            }
+
+            int left = std::max(x, tx * size);
+            int right = std::min(x + width, tx * size + w);
+            for (int row = top; row < bottom; row++)
+            {
+                memcpy(pixels + ((row - y) * width + left - x) * components,
+                       &tile[((row - ty * size) * w + left - tx * size) * components],
+                       (right - left) * components);
+            }
+        }
+    }
+    inflateEnd(&stream);
+}
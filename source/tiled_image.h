@@ -0,0 +1,76 @@
+#ifndef __TILED_IMAGE_H__
+#define __TILED_IMAGE_H__
+
+#include <zlib.h>
+#include "common.h"
+
+// Image split into square tiles, each compressed with zlib on its own (or
+// stored as is when that is not smaller), so rows of tiles inflate in
+// parallel and a region inflates only the tiles it covers. Pixels of a tile are stored
+// row by row, tiles on the right and bottom edge are cut to the image.
+// Used in place from the mapped file, loadImg also reads the old .img
+// files with one zlib stream. Bump IMAGE_VERSION whenever a record changes.
+
+static const unsigned int IMAGE_MAGIC     = 0x49335153; // "SQ3I"
+static const unsigned int IMAGE_VERSION   = 1;
+static const unsigned int IMAGE_TILE_SIZE = 128;
+
+struct ImageHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int size;
+    unsigned int width;
+    unsigned int height;
+    unsigned int components; // bytes in a pixel
+    unsigned int tileSize;
+    unsigned int tilesX;
+    unsigned int tilesY;
+    // then tilesX * tilesY ImageTile rows from the top
+};
+
+struct ImageTile
+{
+    unsigned int offset;     // in bytes from the start of the file
+    unsigned int size;       // stored, same as the pixels if not compressed
+};
+
+class TiledImage : public NoCopy
+{
+public:
+    // false if data is not a tiled image of this version
+    static bool check(const void* data, size_t size);
+
+    TiledImage(const void* data, size_t size);
+
+    // data for pixels of width * height * components bytes
+    static void encode(const unsigned char* pixels, int width, int height, int components,
+                       bytes& data, int tileSize = IMAGE_TILE_SIZE);
+
+    int width() const;
+    int height() const;
+    int components() const;
+
+    // whole image, tiles spread over up to threads TaskPool threads
+    void decode(unsigned char* pixels, int threads) const;
+
+    // pixels of the region in rows of width * components bytes, only the
+    // tiles it covers are inflated, down to its last row
+    void decodeRegion(int x, int y, int width, int height, unsigned char* pixels) const;
+
+    // one row of tiles into the whole image, false if a tile is corrupt,
+    // safe from any thread
+    bool decodeRow(int tileY, unsigned char* pixels) const;
+
+private:
+    const byte*        m_data;
+    const ImageHeader* m_header;
+    const ImageTile*   m_tiles;
+
+    int tileWidth(int tileX) const;
+    int tileHeight(int tileY) const;
+    bool inflateTile(z_stream& stream, int tileX, int tileY, int rows,
+                     unsigned char* pixels, int stride, bytes& scratch) const;
+};
+
+#endif
@@ -60,3 +60,24 @@ float Timer::read() const
     
     return (float)res / 1000.0f;
 }
+
+int Timer::running() const
+{
+    return m_running;
+}
+
+uint64_t Timer::elapsed() const
+{
+    if (m_running <= 0)
+    {
+        return m_elapsed;
+    }
+    return mach_absolute_time() - m_resumed + m_elapsed;
+}
+
+void Timer::restore(int running, uint64_t elapsed)
+{
+    m_running = running;
+    m_elapsed = elapsed;
+    m_resumed = mach_absolute_time();
+}
@@ -14,6 +14,11 @@ public:
 
     float read() const;
 
+    // raw state for saved world states, elapsed is in clock ticks
+    int      running() const;
+    uint64_t elapsed() const;
+    void     restore(int running, uint64_t elapsed);
+
 private:
     int      m_running;
     uint64_t m_elapsed;
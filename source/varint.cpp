@@ -0,0 +1,30 @@
+#include "varint.h"
+
+void putVarint(bytes& out, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<byte>(value));
+}
+
+bool getVarint(const bytes& in, size_t& pos, unsigned int& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pos >= in.size())
+        {
+            return false;
+        }
+        byte b = in[pos++];
+        value |= static_cast<unsigned int>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
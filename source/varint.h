@@ -0,0 +1,14 @@
+#ifndef __VARINT_H__
+#define __VARINT_H__
+
+#include "common.h"
+
+// LEB128 unsigned varints as used by replays, lockstep and snapshot
+// packets: seven bits a byte, low first, high bit set on all but the last.
+
+void putVarint(bytes& out, unsigned int value);
+
+// false if in ends before the value does or it is longer than five bytes
+bool getVarint(const bytes& in, size_t& pos, unsigned int& value);
+
+#endif
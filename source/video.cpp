@@ -8,11 +8,13 @@
 #include "collision.h"
 #include "input.h"
 #include "zlib.h"
+#include "tiled_image.h"
+#include "task_pool.h"
 #include "file.h"
 
 static const int CIRCLE_DIVISIONS = 12;
 
-template <class Video> Video* System<Video>::instance = NULL;
+template <class Video> Video* SharedInstance<Video>::instance = NULL;
 
 void Video::resize(int width, int height)
 {
@@ -335,6 +337,20 @@ unsigned char* loadImg(const string& fname, int& w, int& h, int& t)
     {
         Exception("File " + fname + " not found");
     }
+
+    if (TiledImage::check(f.pointer(), f.size()))
+    {
+        TiledImage image(f.pointer(), f.size());
+        w = image.width();
+        h = image.height();
+        t = image.components();
+
+        unsigned char* res = new unsigned char[w*h*t];
+        image.decode(res, TaskPool::defaultThreads());
+        return res;
+    }
+
+    // one zlib stream after width, height and type
     size_t bufSize = f.size() - 2 - 2 - 4;
     unsigned short width = *((unsigned short*)f.pointer());
     unsigned short height = *((unsigned short*)(f.pointer() + 2));
@@ -92,6 +92,7 @@ private:
     vector<float> m_circleCos;
 };
 
+// tiled (tiled_image.h) or one zlib stream, new [] rows from the top
 unsigned char* loadImg(const string& fname, int& w, int& h, int& type);
 
 #endif
@@ -16,6 +16,7 @@
 #include "referee_local.h"
 #include "referee_base.h"
 #include "ball.h"
+#include "ball_prediction.h"
 #include "messages.h"
 #include "message.h"
 #include "language.h"
@@ -30,6 +31,8 @@
 #include "random.h"
 #include "input_mover.h"
 #include "input_button.h"
+#include "world_state.h"
+#include "replay.h"
 
 static const float OBJECT_BRIGHTNESS_1 = 0.5f; // shadowed
 static const float OBJECT_BRIGHTNESS_2 = 0.6f; // lit
@@ -42,7 +45,7 @@ static const Vector playerPositions[4] = {Vector(- FIELD_LENGTH / 2, 1.5f, - FIE
                                           Vector(  FIELD_LENGTH / 2, 1.5f, - FIELD_LENGTH / 2)
                                           };
 
-template <class World> World* System<World>::instance = NULL;
+template <class World> THREAD_LOCAL World* ThreadInstance<World>::instance = NULL;
 
 Message* World::createMenuMessage()
 {
@@ -68,6 +71,7 @@ World::World(Profile* userProfile, int& unlockable, int current) :
     m_newtonWorld(NULL),
     m_level(NULL),
     m_ball(NULL),
+    m_ballPrediction(NULL),
     m_referee(NULL),
     m_messages(NULL),
     m_scoreBoard(NULL),
@@ -79,7 +83,9 @@ World::World(Profile* userProfile, int& unlockable, int current) :
     m_cameraTouch(NULL),
     m_inputMover(NULL),
     m_inputJump(NULL),
-    m_inputCatch(NULL)
+    m_inputCatch(NULL),
+    m_recorder(NULL),
+    m_initialState(new WorldState())
 {
     setInstance(this); // MUST go first
 
@@ -101,6 +107,7 @@ void World::init()
         }
         m_localPlayers.clear();
        
+        delete m_ballPrediction;
         delete m_ball;
         delete m_referee;
         delete m_grass;
@@ -120,6 +127,7 @@ void World::init()
         m_scoreBoard = NULL;
 
         m_ball = NULL;
+        m_ballPrediction = NULL;
         m_referee = NULL;
         m_level = NULL;
         m_newtonWorld = NULL;
@@ -141,8 +149,7 @@ void World::init()
     
     m_level = new Level();
 
-    StringSet tmp;
-    m_level->load( ( m_current < 3 ? "world.xml" : "extra.xml" ), tmp);
+    m_level->load( m_current < 3 ? "world.xml" : "extra.xml" );
     m_grass = new Grass(m_level);
     
     if (m_level->m_fences.empty() == false)
@@ -152,15 +159,16 @@ void World::init()
 
     m_skybox = new SkyBox(m_level->m_skyboxName);
 
-    NewtonBodySetContinuousCollisionMode(m_level->getBody("football")->m_newtonBody, 1);
+    NewtonBodySetContinuousCollisionMode(m_level->getBall()->m_newtonBody, 1);
 
     m_localPlayers = Network::instance->createPlayers(m_level);
 
-    m_ball = new Ball(m_level->getBody("football"), m_level->m_collisions["level"]);
+    m_ball = new Ball(m_level->getBall(), m_level->getGroundCollision());
+    m_ballPrediction = new BallPrediction(m_ball, m_localPlayers);
 
     m_referee = new RefereeLocal(m_messages, m_scoreBoard);
-    m_referee->m_field = m_level->getBody("field"); //referee now can recognize game field
-    m_referee->m_ground = m_level->getBody("level");; //referee now can recognize ground outside
+    m_referee->m_field = m_level->getField(); //referee now can recognize game field
+    m_referee->m_ground = m_level->getGround(); //referee now can recognize ground outside
     
     //this is for correct registering when waiting for ball bounce in referee
     //it is handled specifically in Ball OnCollide
@@ -169,17 +177,22 @@ void World::init()
 
     m_referee->registerBall(m_ball);
 
-    m_referee->m_humanPlayer = m_localPlayers[Network::instance->getLocalIdx()];
+    int localIdx = Network::instance->getLocalIdx();
+    m_referee->m_humanPlayer = (localIdx == -1 ? NULL : m_localPlayers[localIdx]);
 
     m_referee->registerPlayers(m_localPlayers);
 
+    // all property ids are known now, players and fences are loaded
+    m_level->m_properties->compile();
+
     for (size_t i = 0; i < m_localPlayers.size(); i++)
     {
         m_localPlayers[i]->setPositionRotation(playerPositions[i], Vector::Zero);
         m_ball->addBodyToFilter(m_localPlayers[i]->m_body);
     }
 
-    LocalPlayer* localPlayer = (LocalPlayer*)m_localPlayers[Network::instance->getLocalIdx()];
+    // without local player touch controls are never activated
+    LocalPlayer* localPlayer = (localIdx == -1 ? NULL : (LocalPlayer*)m_localPlayers[localIdx]);
     m_inputMover = new InputMover(localPlayer);
     m_inputJump = new InputButton("J", localPlayer);
     m_inputCatch = new InputButton("C", localPlayer);
@@ -193,9 +206,45 @@ void World::init()
 
     m_referee->m_sound->play(m_referee->m_soundGameStart);
 
-    float angleAdjust = Network::instance->getLocalIdx() * 90.0f;
+    float angleAdjust = std::max(localIdx, 0) * 90.0f;
     m_camera = new Camera(Vector(0.0f, 1.0f, 12.0f), 20.0f, 0.0f + angleAdjust);
-    Video::instance->setModelViewMatrix(m_camera->getModelViewMatrix());
+    m_messages->setModelViewMatrix(m_camera->getModelViewMatrix());
+
+    Input::instance->clearBuffer();
+
+    m_initialState->clear();
+    saveMatch(*m_initialState);
+}
+
+void World::reset()
+{
+    // Randoms keep going, so a retry does not replay the same match
+    m_initialState->rewind();
+    loadMatch(*m_initialState);
+
+    if (m_referee->m_over != NULL)
+    {
+        m_messages->remove(m_referee->m_over);
+        m_referee->m_over = NULL;
+    }
+    if (m_escMessage != NULL)
+    {
+        m_messages->remove(m_escMessage);
+        m_escMessage = NULL;
+    }
+    if (m_menuMessage == NULL)
+    {
+        m_messages->add2D(m_menuMessage = createMenuMessage());
+    }
+    m_freeze = false;
+
+    m_referee->m_sound->play(m_referee->m_soundGameStart);
+
+    int localIdx = Network::instance->getLocalIdx();
+    float angleAdjust = std::max(localIdx, 0) * 90.0f;
+    delete m_camera;
+    m_camera = new Camera(Vector(0.0f, 1.0f, 12.0f), 20.0f, 0.0f + angleAdjust);
+    m_messages->setModelViewMatrix(m_camera->getModelViewMatrix());
 
     Input::instance->clearBuffer();
 }
@@ -212,6 +261,7 @@ World::~World()
         delete *iter;
     }
 
+    delete m_ballPrediction;
     delete m_ball;
     delete m_referee;
     delete m_level;
@@ -223,6 +273,7 @@ World::~World()
     delete m_messages;
     delete m_skybox;
     delete m_camera;
+    delete m_initialState;
 }
 
 static bool contains(const Touches& touches, void* touch)
@@ -369,8 +420,8 @@ void World::control()
                     }
                     else
                     {
-                        //if none from above - we return State::m_current to retry (reload the same level)
-                        init();
+                        //if none from above - we return State::m_current to retry (same level, not reloaded)
+                        reset();
                     }
                 }
             }
@@ -455,9 +506,15 @@ void World::control()
     }
     
     // player control
+    m_ballPrediction->update();
     for (size_t i=0; i<m_localPlayers.size(); i++)
     {
+        unsigned int draws = Randoms::getDraws();
         m_localPlayers[i]->control();
+        if (m_recorder != NULL)
+        {
+            m_recorder->control(static_cast<int>(i), m_localPlayers[i], Randoms::getDraws() - draws);
+        }
     }
 }
 
@@ -469,9 +526,14 @@ void World::updateStep(float delta)
 
     if (!m_freeze)
     {
-        m_ball->triggerBegin();
+        if (m_recorder != NULL)
+        {
+            m_recorder->step(delta);
+        }
+
         NewtonUpdate(m_newtonWorld, delta);
-        m_ball->triggerEnd();
+        m_level->m_properties->processEvents();
+        m_ball->processTriggers();
 
         for (size_t i=0; i<m_localPlayers.size(); i++)
         {
@@ -496,7 +558,7 @@ void World::updateStep(float delta)
             }
             else
             {
-                m_referee->process(m_ball->m_body, m_level->getBody("level")); 
+                m_referee->process(m_ball->m_body, m_level->getGround()); 
             }
         }
 
@@ -507,21 +569,101 @@ void World::update(float delta)
 {
     // update is called one time in frame
 
+    if (m_recorder != NULL)
+    {
+        m_recorder->update(delta);
+    }
+
     alListenerfv(AL_POSITION, m_localPlayers[0]->getPosition().v);
     alListenerfv(AL_VELOCITY, m_localPlayers[0]->m_body->getVelocity().v);
 
     m_camera->update(delta);
     m_scoreBoard->update();
     m_referee->update();
-    m_messages->update(delta);
-
-    Video::instance->setModelViewMatrix(m_camera->getModelViewMatrix());
+    m_messages->update(delta, m_camera->getModelViewMatrix());
 }
 
 void World::prepare()
 {
     m_camera->prepare();
     m_level->prepare();
+
+    if (m_recorder != NULL)
+    {
+        m_recorder->frame();
+    }
+}
+
+void World::saveState(WorldState& state) const
+{
+    state.write(Randoms::getSeed());
+    state.write(Randoms::getDraws());
+    saveMatch(state);
+}
+
+void World::saveMatch(WorldState& state) const
+{
+    const vector<Body*>& bodies = m_level->getBodies();
+    for each_const(vector<Body*>, bodies, iter)
+    {
+        if ((*iter)->isMovable())
+        {
+            (*iter)->saveState(state);
+        }
+    }
+    for each_const(vector<Player*>, m_localPlayers, iter)
+    {
+        (*iter)->saveState(state);
+    }
+    m_ball->saveState(state);
+    m_referee->saveState(state);
+    m_scoreBoard->saveState(state);
+}
+
+void World::loadState(WorldState& state)
+{
+    state.rewind();
+
+    unsigned int seed = state.readUInt();
+    unsigned int draws = state.readUInt();
+    Randoms::seek(seed, draws);
+
+    loadMatch(state);
+}
+
+void World::loadMatch(WorldState& state)
+{
+    const vector<Body*>& bodies = m_level->getBodies();
+    for each_const(vector<Body*>, bodies, iter)
+    {
+        if ((*iter)->isMovable())
+        {
+            (*iter)->loadState(state);
+        }
+    }
+    for each_const(vector<Player*>, m_localPlayers, iter)
+    {
+        (*iter)->loadState(state);
+    }
+    m_ball->loadState(state);
+    m_referee->loadState(state);
+    m_scoreBoard->loadState(state);
+
+    if (!state.atEnd())
+    {
+        Exception("World state does not match this world");
+    }
+
+    // contacts cached by Newton belong to the state before loading
+    NewtonInvalidateCache(m_newtonWorld);
+
+    // cached body matrices are read by control() before the next step
+    m_level->prepare();
+}
+
+void World::setRecorder(ReplayRecorder* recorder)
+{
+    m_recorder = recorder;
 }
 
 void World::render() const
@@ -529,6 +671,7 @@ void World::render() const
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     
     m_camera->render();
+    Video::instance->setModelViewMatrix(m_camera->getModelViewMatrix());
 
     glLightfv(GL_LIGHT0, GL_POSITION, m_lightPosition.v);
     glLightfv(GL_LIGHT0, GL_AMBIENT, (OBJECT_BRIGHTNESS_1*Vector::One).v);
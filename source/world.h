@@ -1,7 +1,7 @@
 #ifndef __WORLD_H__
 #define __WORLD_H__
 
-#include <newton.h>
+#include <Newton.h>
 #include "common.h"
 #include "vmath.h"
 #include "system.h"
@@ -16,6 +16,7 @@ class Music;
 class RefereeLocal;
 class RefereeBase;
 class Ball;
+class BallPrediction;
 class Messages;
 class Message;
 class ScoreBoard;
@@ -24,16 +25,22 @@ class Profile;
 class Game;
 class InputMover;
 class InputButton;
+class WorldState;
+class ReplayRecorder;
 
 typedef vector<Profile*> ProfilesVector;
 
-class World : public State, public System<World>
+class World : public State, public System<World, ThreadInstance<World> >
 {
 public:
     World(Profile* userProfile, int& unlockable, int current);
     ~World();
 
     void init();
+
+    // restarts the match keeping level, collisions and grass loaded,
+    // bodies, players and score go back to the state after init()
+    void reset();
     
     void control();
     void updateStep(float delta);
@@ -42,6 +49,13 @@ public:
     void render() const;
     State::Type progress();
 
+    // match state without UI, see WorldState
+    void saveState(WorldState& state) const;
+    void loadState(WorldState& state);
+
+    // NULL stops recording, recorder is not owned
+    void setRecorder(ReplayRecorder* recorder);
+
     void begin2D();
     void end2D();
 
@@ -52,6 +66,7 @@ public:
     Level*           m_level;
     vector<Player*>  m_localPlayers;
     Ball*            m_ball;
+    BallPrediction*  m_ballPrediction; // for AI players
     RefereeBase*     m_referee;
     Messages*        m_messages;
     ScoreBoard*      m_scoreBoard;
@@ -75,12 +90,20 @@ private:
     InputButton*   m_inputJump;
     InputButton*   m_inputCatch;
 
+    ReplayRecorder* m_recorder;
+
     void renderScene() const;
 
     State::Type     m_nextState;
 
     void setLight(const Vector& position);
 
+    WorldState*     m_initialState; // saved at the end of init()
+
+    // saveState and loadState without the Randoms position
+    void saveMatch(WorldState& state) const;
+    void loadMatch(WorldState& state);
+
     Message* createMenuMessage();
 };
 
@@ -0,0 +1,183 @@
+#include <cstring>
+#include "world_hash.h"
+#include "world.h"
+#include "level.h"
+#include "body.h"
+#include "referee_base.h"
+#include "scoreboard.h"
+#include "random.h"
+
+static const unsigned int PRIME1 = 2654435761U;
+static const unsigned int PRIME2 = 2246822519U;
+static const unsigned int PRIME3 = 3266489917U;
+static const unsigned int PRIME4 = 668265263U;
+static const unsigned int PRIME5 = 374761393U;
+
+static inline unsigned int rotl(unsigned int value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static inline unsigned int read32(const byte* data)
+{
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline unsigned int round32(unsigned int acc, unsigned int input)
+{
+    return rotl(acc + input * PRIME2, 13) * PRIME1;
+}
+
+unsigned int xxhash32(const void* data, size_t size, unsigned int seed)
+{
+    const byte* p = static_cast<const byte*>(data);
+    const byte* end = p + size;
+
+    unsigned int h;
+    if (size >= 16)
+    {
+        // four independent lanes, compilers keep them in one vector register
+        unsigned int v1 = seed + PRIME1 + PRIME2;
+        unsigned int v2 = seed + PRIME2;
+        unsigned int v3 = seed;
+        unsigned int v4 = seed - PRIME1;
+        const byte* limit = end - 16;
+        do
+        {
+            v1 = round32(v1, read32(p));
+            v2 = round32(v2, read32(p + 4));
+            v3 = round32(v3, read32(p + 8));
+            v4 = round32(v4, read32(p + 12));
+            p += 16;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    }
+    else
+    {
+        h = seed + PRIME5;
+    }
+    h += static_cast<unsigned int>(size);
+
+    for (; p + 4 <= end; p += 4)
+    {
+        h = rotl(h + read32(p) * PRIME3, 17) * PRIME4;
+    }
+    for (; p < end; p++)
+    {
+        h = rotl(h + *p * PRIME5, 11) * PRIME1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME2;
+    h ^= h >> 13;
+    h *= PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+WorldHash::WorldHash() : m_total(0), m_random(0), m_referee(0)
+{
+}
+
+bool WorldHash::operator == (const WorldHash& other) const
+{
+    return m_total == other.m_total;
+}
+
+bool WorldHash::operator != (const WorldHash& other) const
+{
+    return m_total != other.m_total;
+}
+
+string WorldHash::difference(const WorldHash& other, const World* world) const
+{
+    if (m_random != other.m_random)
+    {
+        return "random sequence";
+    }
+    if (m_bodies.size() != other.m_bodies.size())
+    {
+        return "number of bodies";
+    }
+    for (size_t i = 0; i < m_bodies.size(); i++)
+    {
+        if (m_bodies[i] != other.m_bodies[i])
+        {
+            // index counts movable bodies only
+            int movable = -1;
+            const vector<Body*>& bodies = world->m_level->getBodies();
+            for each_const(vector<Body*>, bodies, iter)
+            {
+                if ((*iter)->isMovable() && ++movable == static_cast<int>(i))
+                {
+                    return "body '" + (*iter)->m_id + "'";
+                }
+            }
+            return "body " + cast<string>(i);
+        }
+    }
+    if (m_referee != other.m_referee)
+    {
+        return "referee";
+    }
+    return m_total != other.m_total ? "total" : "";
+}
+
+WorldHasher::WorldHasher() : m_level(NULL), m_levelBodies(0)
+{
+}
+
+void WorldHasher::updateMovable(const Level* level)
+{
+    if (level == m_level && level->m_bodies.size() == m_levelBodies)
+    {
+        return;
+    }
+    m_level = level;
+    m_levelBodies = level->m_bodies.size();
+    m_movable.clear();
+    const vector<Body*>& bodies = level->getBodies();
+    for each_const(vector<Body*>, bodies, iter)
+    {
+        if ((*iter)->isMovable())
+        {
+            m_movable.push_back(*iter);
+        }
+    }
+}
+
+void WorldHasher::compute(const World* world, WorldHash& hash)
+{
+    unsigned int random[2] = { Randoms::getSeed(), Randoms::getDraws() };
+    hash.m_random = xxhash32(random, sizeof(random));
+
+    // from Body, not through Newton and WorldState, which costs 3x more
+    updateMovable(world->m_level);
+    hash.m_bodies.resize(m_movable.size());
+    for (size_t i = 0; i < m_movable.size(); i++)
+    {
+        const Body* body = m_movable[i];
+        float state[19];
+        Vector velocity = body->getVelocity();
+        memcpy(state, body->m_matrix.m, 16 * sizeof(float));
+        memcpy(state + 16, velocity.v, 3 * sizeof(float));
+        hash.m_bodies[i] = xxhash32(state, sizeof(state));
+    }
+
+    m_scratch.clear();
+    world->m_referee->saveState(m_scratch);
+    world->m_scoreBoard->saveState(m_scratch);
+    const UIntVector& words = m_scratch.m_words;
+    hash.m_referee = xxhash32(&words[0], words.size() * sizeof(unsigned int));
+
+    // parts hashed again, bodies chained after random and referee
+    unsigned int parts[2] = { hash.m_random, hash.m_referee };
+    unsigned int total = xxhash32(parts, sizeof(parts));
+    if (!hash.m_bodies.empty())
+    {
+        total = xxhash32(&hash.m_bodies[0], hash.m_bodies.size() * sizeof(unsigned int), total);
+    }
+    hash.m_total = total;
+}
@@ -0,0 +1,54 @@
+#ifndef __WORLD_HASH_H__
+#define __WORLD_HASH_H__
+
+#include "common.h"
+#include "world_state.h"
+
+class World;
+class Level;
+class Body;
+
+// xxHash32, little endian words as on x86 and ARM
+unsigned int xxhash32(const void* data, size_t size, unsigned int seed = 0);
+
+// Fingerprint of a World for desync detection, cheap enough for every
+// tick: transform and velocity of movable bodies as synced by
+// Level::prepare, what referee and scores save in WorldState and the
+// Randoms position. Hidden Newton and player state is not included, it
+// shows up in bodies a tick later.
+class WorldHash
+{
+public:
+    WorldHash();
+
+    bool operator == (const WorldHash& other) const; // by m_total
+    bool operator != (const WorldHash& other) const;
+
+    // first part that differs, like "body 'football'", empty if none
+    string difference(const WorldHash& other, const World* world) const;
+
+    unsigned int m_total;   // of all parts below
+    unsigned int m_random;  // Randoms seed and draws
+    UIntVector   m_bodies;  // movable bodies, in level order
+    unsigned int m_referee; // referee and scores
+};
+
+class WorldHasher : public NoCopy
+{
+public:
+    WorldHasher();
+
+    void compute(const World* world, WorldHash& hash);
+
+private:
+    void updateMovable(const Level* level);
+
+    WorldState    m_scratch;
+
+    // movable bodies of m_level, rebuilt when players are added
+    const Level*  m_level;
+    size_t        m_levelBodies;
+    vector<Body*> m_movable;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include <cstring>
+#include "world_state.h"
+#include "world.h"
+#include "level.h"
+#include "timer.h"
+
+WorldState::WorldState() : m_pos(0)
+{
+}
+
+void WorldState::clear()
+{
+    m_words.clear();
+    m_pos = 0;
+}
+
+void WorldState::rewind()
+{
+    m_pos = 0;
+}
+
+bool WorldState::atEnd() const
+{
+    return m_pos == m_words.size();
+}
+
+void WorldState::write(unsigned int value)
+{
+    m_words.push_back(value);
+}
+
+void WorldState::write(int value)
+{
+    m_words.push_back(static_cast<unsigned int>(value));
+}
+
+void WorldState::write(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    m_words.push_back(bits);
+}
+
+void WorldState::write(bool value)
+{
+    m_words.push_back(value ? 1 : 0);
+}
+
+void WorldState::write(uint64_t value)
+{
+    m_words.push_back(static_cast<unsigned int>(value));
+    m_words.push_back(static_cast<unsigned int>(value >> 32));
+}
+
+void WorldState::write(const Vector& value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        write(value.v[i]);
+    }
+}
+
+void WorldState::write(const Matrix& value)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        write(value.m[i]);
+    }
+}
+
+void WorldState::write(const Body* body)
+{
+    write(World::instance->m_level->getBodyIndex(body));
+}
+
+void WorldState::write(const Timer& timer)
+{
+    write(timer.running());
+    write(timer.elapsed());
+}
+
+unsigned int WorldState::readUInt()
+{
+    if (m_pos >= m_words.size())
+    {
+        Exception("World state is too short");
+    }
+    return m_words[m_pos++];
+}
+
+int WorldState::readInt()
+{
+    return static_cast<int>(readUInt());
+}
+
+float WorldState::readFloat()
+{
+    unsigned int bits = readUInt();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool WorldState::readBool()
+{
+    return readUInt() != 0;
+}
+
+uint64_t WorldState::readUInt64()
+{
+    uint64_t low = readUInt();
+    uint64_t high = readUInt();
+    return low | (high << 32);
+}
+
+Vector WorldState::readVector()
+{
+    Vector value;
+    for (int i = 0; i < 4; i++)
+    {
+        value.v[i] = readFloat();
+    }
+    return value;
+}
+
+Matrix WorldState::readMatrix()
+{
+    Matrix value;
+    for (int i = 0; i < 16; i++)
+    {
+        value.m[i] = readFloat();
+    }
+    return value;
+}
+
+Body* WorldState::readBody()
+{
+    return World::instance->m_level->getBodyByIndex(readInt());
+}
+
+void WorldState::read(Timer& timer)
+{
+    int running = readInt();
+    uint64_t elapsed = readUInt64();
+    timer.restore(running, elapsed);
+}
+
+bool WorldState::operator == (const WorldState& other) const
+{
+    return m_words == other.m_words;
+}
+
+bool WorldState::operator != (const WorldState& other) const
+{
+    return m_words != other.m_words;
+}
@@ -0,0 +1,51 @@
+#ifndef __WORLD_STATE_H__
+#define __WORLD_STATE_H__
+
+#include "common.h"
+#include "vmath.h"
+
+class Body;
+class Timer;
+
+// Everything needed to continue a match from some step: movable bodies,
+// players, ball sensor, referee, scores and the random sequence. Stored as plain
+// 32-bit words so states can be compared, diffed and packed.
+class WorldState
+{
+public:
+    WorldState();
+
+    void clear();
+    void rewind();           // next read starts from the first word
+    bool atEnd() const;
+
+    void write(unsigned int value);
+    void write(int value);
+    void write(float value);
+    void write(bool value);
+    void write(uint64_t value);
+    void write(const Vector& value);
+    void write(const Matrix& value);
+    void write(const Body* body); // as index in level, NULL is allowed
+    void write(const Timer& timer);
+
+    unsigned int readUInt();
+    int          readInt();
+    float        readFloat();
+    bool         readBool();
+    uint64_t     readUInt64();
+    Vector       readVector();
+    Matrix       readMatrix();
+    Body*        readBody();
+    void         read(Timer& timer);
+
+    bool operator == (const WorldState& other) const;
+    bool operator != (const WorldState& other) const;
+
+    vector<unsigned int> m_words;
+
+private:
+    size_t m_pos;
+};
+
+#endif
@@ -2,11 +2,12 @@
 #include <ostream>
 #include <sstream>
 #include <iomanip>
+#include <new>
 
+#include <pthread.h>
 #include <expat.h>
 
 #include "xml.h"
-#include "utilities.h"
 
 /** OUTPUT **/
 
@@ -88,64 +89,236 @@ void XMLnode::save(File::Writer& writer)
 
 /** INPUT **/
 
+// expat has no user data for memory callbacks, so it allocates from the
+// arena of the document being parsed on this thread. A pthread key and
+// not THREAD_LOCAL, which is empty on iPad, level files parse in parallel
+static pthread_key_t  g_parserArena;
+static pthread_once_t g_parserArenaOnce = PTHREAD_ONCE_INIT;
+
+static void createParserArena()
+{
+    if (pthread_key_create(&g_parserArena, NULL) != 0)
+    {
+        Exception("Error creating XML parser arena key");
+    }
+}
+
+static void* XMLCALL parserMalloc(size_t size)
+{
+    Arena* arena = static_cast<Arena*>(pthread_getspecific(g_parserArena));
+
+    // size in front for realloc, keeps 8 byte alignment
+    size_t* block = static_cast<size_t*>(arena->allocate(sizeof(size_t) + size));
+    *block = size;
+    return block + 1;
+}
+
+static void* XMLCALL parserRealloc(void* ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return parserMalloc(size);
+    }
+    size_t old = static_cast<size_t*>(ptr)[-1];
+    if (size <= old)
+    {
+        return ptr;
+    }
+    void* result = parserMalloc(size);
+    memcpy(result, ptr, old);
+    return result;
+}
+
+static void XMLCALL parserFree(void* ptr)
+{
+}
+
+static bool isSpace(char c)
+{
+    return c=='\n' || c=='\t' || c==' ' || c=='\r';
+}
+
 class XMLreader
 {
 private:
-    File::Reader&  m_reader;
-    XML_Parser     m_parser;
+    const File::Reader&  m_reader;
+    XMLdocument&         m_document;
+    Arena&               m_arena;
+    Arena                m_parserArena;
+    Arena*               m_previousArena;
+    XML_Parser           m_parser;
 
-    bool           m_root;
-    list<XMLnode*> m_elements;
+    // character data of an open element, points into the file until
+    // expat passes something that is not there
+    struct Text
+    {
+        const char* data;    // NULL before the first non space
+        size_t      size;
+        bool        copied;  // in buffer instead
+        string      buffer;
+        string      space;   // after the text, dropped if nothing follows
+    };
+
+    vector<XMLelement*> m_elements;
+    vector<Text>        m_text;
 
-    static const size_t BUFSIZE = 4096;
+    bool inFile(const char* s) const
+    {
+        const char* begin = reinterpret_cast<const char*>(m_reader.pointer());
+        return s >= begin && s < begin + m_reader.size();
+    }
+
+    XMLstring copy(const char* s)
+    {
+        size_t size = strlen(s);
+        return XMLstring(m_arena.copy(s, size), size);
+    }
 
     static void XMLCALL StartElementHandler(void *userData, const XML_Char *name, const XML_Char **atts)
     {
         XMLreader* self = static_cast<XMLreader*>(userData);
-        XMLnode* parent = self->m_elements.back();
-        XMLnode* node;
-        if (self->m_root)
+        XMLelement* node = new (self->m_arena.allocate(sizeof(XMLelement))) XMLelement();
+        node->name = self->copy(name);
+        node->line = XML_GetCurrentLineNumber(self->m_parser);
+
+        unsigned int count = 0;
+        while (atts[2 * count] != NULL)
         {
-            self->m_root = false;
-            node = parent;
-            node->name = name;
+            count++;
         }
-        else
+        if (count != 0)
         {
-            parent->childs.push_back(XMLnode(name));
-            node = & parent->childs.back();
+            XMLattribute* attributes = static_cast<XMLattribute*>(self->m_arena.allocate(count * sizeof(XMLattribute)));
+            for (unsigned int i = 0; i < count; i++)
+            {
+                new (&attributes[i]) XMLattribute();
+                attributes[i].name = self->copy(atts[2 * i]);
+                attributes[i].value = self->copy(atts[2 * i + 1]);
+            }
+            node->m_attributes = attributes;
+            node->m_attributeCount = count;
         }
 
-        while (*atts != NULL)
+        if (self->m_elements.empty())
         {
-            const XML_Char* name = *atts;
-            atts++;
-            const XML_Char* value = *atts;
-            atts++;
-
-            node->attributes.insert(make_pair(name, value));
+            self->m_document.m_root = node;
         }
-        node->line = XML_GetCurrentLineNumber(self->m_parser);
+        else
+        {
+            XMLelements& childs = self->m_elements.back()->childs;
+            if (childs.m_last == NULL)
+            {
+                childs.m_first = node;
+            }
+            else
+            {
+                childs.m_last->m_next = node;
+            }
+            childs.m_last = node;
+        }
+
         self->m_elements.push_back(node);
+        if (self->m_text.size() < self->m_elements.size())
+        {
+            self->m_text.resize(self->m_elements.size());
+        }
+        Text& text = self->m_text[self->m_elements.size() - 1];
+        text.data = NULL;
+        text.size = 0;
+        text.copied = false;
     }
 
     static void XMLCALL EndElementHandler(void *userData, const XML_Char *name)
     {
         XMLreader* self = static_cast<XMLreader*>(userData);
-        self->m_elements.back()->value = trim(self->m_elements.back()->value);
+        XMLelement* node = self->m_elements.back();
+        Text& text = self->m_text[self->m_elements.size() - 1];
+
+        if (text.copied)
+        {
+            node->value = XMLstring(self->m_arena.copy(text.buffer.data(), text.buffer.size()), text.buffer.size());
+        }
+        else if (text.data != NULL)
+        {
+            node->value = XMLstring(text.data, text.size);
+        }
         self->m_elements.pop_back();
     }
 
     static void XMLCALL CharacterDataHandler(void *userData, const XML_Char *s, int len)
     {
         XMLreader* self = static_cast<XMLreader*>(userData);
-        self->m_elements.back()->value += string(s, s+len);
+        Text& text = self->m_text[self->m_elements.size() - 1];
+
+        int first = 0;
+        while (first < len && isSpace(s[first]))
+        {
+            first++;
+        }
+
+        if (first == len)
+        {
+            // leading space is trimmed, space after text kept in case more follows
+            if (text.data != NULL)
+            {
+                text.space.append(s, len);
+            }
+            return;
+        }
+
+        int last = len;
+        while (isSpace(s[last - 1]))
+        {
+            last--;
+        }
+
+        if (text.data == NULL)
+        {
+            text.data = s + first;
+            text.size = last - first;
+            text.copied = !self->inFile(s);
+            if (text.copied)
+            {
+                text.buffer.assign(s + first, last - first);
+            }
+        }
+        else
+        {
+            if (!text.copied && text.space.empty() && text.data + text.size == s + first && self->inFile(s))
+            {
+                text.size += last - first;
+            }
+            else
+            {
+                if (!text.copied)
+                {
+                    text.buffer.assign(text.data, text.size);
+                    text.copied = true;
+                }
+                text.buffer.append(text.space);
+                text.buffer.append(s, last);
+            }
+        }
+        text.space.assign(s + last, len - last);
     }
 
 public:
-    XMLreader(File::Reader& reader) : m_reader(reader), m_root(true)
+    XMLreader(const File::Reader& reader, XMLdocument& document) :
+        m_reader(reader),
+        m_document(document),
+        m_arena(document.m_arena),
+        m_parserArena(65536)
     {
-        m_parser = XML_ParserCreate(NULL);
+        pthread_once(&g_parserArenaOnce, createParserArena);
+        m_previousArena = static_cast<Arena*>(pthread_getspecific(g_parserArena));
+        pthread_setspecific(g_parserArena, &m_parserArena);
+
+        // deeper than any file here, so they do not grow while parsing
+        m_elements.reserve(16);
+        m_text.resize(16);
+
+        static const XML_Memory_Handling_Suite memory = { parserMalloc, parserRealloc, parserFree };
+        m_parser = XML_ParserCreate_MM(NULL, &memory, NULL);
         if (m_parser == NULL)
         {
             Exception("Error creating XML parser");
@@ -160,12 +333,11 @@ public:
     ~XMLreader()
     {
         XML_ParserFree(m_parser);
+        pthread_setspecific(g_parserArena, m_previousArena);
     }
 
-    void parse(XMLnode& xml)
+    void parse()
     {
-        m_elements.push_back(&xml);
-
         if (XML_Parse(m_parser, (const char*)m_reader.pointer(), (int)m_reader.size(), 1) == XML_STATUS_ERROR)
         {
             int c = static_cast<int>(XML_GetErrorColumnNumber(m_parser));
@@ -176,8 +348,26 @@ public:
     }
 };
 
-void XMLnode::load(File::Reader& reader)
+void XMLdocument::load(const File::Reader& reader)
+{
+    m_arena.rewind();
+    m_root = NULL;
+
+    XMLreader xmlReader(reader, *this);
+    xmlReader.parse();
+}
+
+const XMLelement& XMLdocument::root() const
+{
+    return m_root == NULL ? m_empty : *m_root;
+}
+
+size_t XMLdocument::size() const
+{
+    return m_arena.size();
+}
+
+void XMLelement::missing(const char* name) const
 {
-    XMLreader xmlReader(reader);
-    xmlReader.parse(*this);
+    Exception("Missing attribute '" + string(name) + "' in node '" + this->name + "' at line " + cast<string>(line));
 }
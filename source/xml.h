@@ -1,120 +1,264 @@
 #ifndef __XML_H__
 #define __XML_H__
 
+#include <cstring>
 #include "common.h"
 #include "file.h"
 #include "vmath.h"
+#include "arena.h"
 
 class XMLnode;
+class XMLelement;
 
 typedef vector<XMLnode> XMLnodes;
 
 class XMLreader;
 class XMLwriter;
 
+// tree built for saving with XMLnode::save
 class XMLnode
 {
     friend void outputNode(const XMLnode& node, std::ostream& stream, int level);
-    friend class XMLreader;
     friend class XMLwriter;
 public:
     XMLnode() {};
-    XMLnode(const string& name, const string& value = "") : name(name), value(value), line(0) {}
+    XMLnode(const string& name, const string& value = "") : name(name), value(value) {}
 
-    void load(File::Reader& reader);
     void save(File::Writer& writer);
 
     XMLnodes childs;
     string name;
     string value;
+
+    inline void setAttribute(const string& name, const string& value);
+
+private:
+    StringMap attributes;
+};
+
+void XMLnode::setAttribute(const string& name, const string& value)
+{
+    attributes[name] = value;
+}
+
+// text of an XMLdocument, not terminated when it points into the file
+class XMLstring
+{
+public:
+    XMLstring() : m_data(""), m_size(0) {}
+    XMLstring(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+    const char* data() const { return m_data; }
+    size_t      size() const { return m_size; }
+    bool        empty() const { return m_size == 0; }
+
+    string str() const { return string(m_data, m_size); }
+    operator string() const { return str(); }
+
+    bool operator == (const char* other) const
+    {
+        return strncmp(m_data, other, m_size) == 0 && other[m_size] == 0;
+    }
+    bool operator != (const char* other) const { return !(*this == other); }
+
+private:
+    const char* m_data;
+    size_t      m_size;
+};
+
+inline string operator + (const string& first, const XMLstring& second)
+{
+    return first + second.str();
+}
+
+inline std::ostream& operator << (std::ostream& stream, const XMLstring& text)
+{
+    return stream.write(text.data(), text.size());
+}
+
+template <>
+inline string cast(const XMLstring& from)
+{
+    return from.str();
+}
+
+// numbers are parsed straight from the document text
+template <> inline int           cast(const XMLstring& from) { return parseNumber<int>(from.data(), from.size()); }
+template <> inline unsigned int  cast(const XMLstring& from) { return parseNumber<unsigned int>(from.data(), from.size()); }
+template <> inline unsigned long cast(const XMLstring& from) { return parseNumber<unsigned long>(from.data(), from.size()); }
+template <> inline float         cast(const XMLstring& from) { return parseNumber<float>(from.data(), from.size()); }
+
+struct XMLattribute
+{
+    XMLstring name;
+    XMLstring value;
+};
+
+// children of an element, linked in the document arena
+class XMLelements
+{
+    friend class XMLreader;
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator(const XMLelement* node = NULL) : m_node(node) {}
+
+        const XMLelement& operator * () const { return *m_node; }
+        const XMLelement* operator -> () const { return m_node; }
+        inline const_iterator& operator ++ ();
+        inline const_iterator operator ++ (int);
+
+        bool operator == (const const_iterator& other) const { return m_node == other.m_node; }
+        bool operator != (const const_iterator& other) const { return m_node != other.m_node; }
+
+    private:
+        const XMLelement* m_node;
+    };
+
+    XMLelements() : m_first(NULL), m_last(NULL) {}
+
+    const_iterator begin() const { return const_iterator(m_first); }
+    const_iterator end() const { return const_iterator(); }
+    bool empty() const { return m_first == NULL; }
+
+private:
+    XMLelement* m_first;
+    XMLelement* m_last;
+};
+
+class XMLelement : public NoCopy
+{
+    friend class XMLreader;
+    friend class XMLelements::const_iterator;
+public:
+    XMLelement() : line(0), m_attributes(NULL), m_attributeCount(0), m_next(NULL) {}
+
+    XMLstring    name;
+    XMLstring    value;
     unsigned int line;
+    XMLelements  childs;
 
     inline bool hasAttributes() const;
-    inline bool hasAttribute(const string& name) const;
+    inline bool hasAttribute(const char* name) const;
 
     template <typename T>
-    inline T getAttribute(const string& name) const;
-    inline string getAttribute(const string& name) const;
+    inline T getAttribute(const char* name) const;
+    inline string getAttribute(const char* name) const;
 
     template <typename T>
-    inline T getAttribute(const string& name, T defaultValue) const;
-    inline string getAttribute(const string& name, const string& defaultValue) const;
-    inline Vector getAttributesInVector(const string& attributeSymbols) const;
+    inline T getAttribute(const char* name, T defaultValue) const;
+    inline string getAttribute(const char* name, const string& defaultValue) const;
+    inline Vector getAttributesInVector(const char* attributeSymbols) const;
 
-    inline void setAttribute(const string& name, const string& value);
+private:
+    const XMLattribute* m_attributes;
+    unsigned int        m_attributeCount;
+    XMLelement*         m_next;
+
+    inline const XMLstring* find(const char* name) const;
+    void missing(const char* name) const;
+};
+
+// Read only DOM, elements, attributes and text all live in one arena.
+// Expat is given arena memory too. Character data that expat passes
+// straight from the file is not copied, so the reader has to stay open
+// while the document is used.
+class XMLdocument : public NoCopy
+{
+    friend class XMLreader;
+public:
+    XMLdocument() : m_root(NULL) {}
+
+    void load(const File::Reader& reader);
+
+    const XMLelement& root() const; // empty before load
+    size_t size() const;            // arena bytes
 
 private:
-    StringMap attributes;
+    Arena       m_arena;
+    XMLelement* m_root;
+    XMLelement  m_empty;
 };
 
-inline bool XMLnode::hasAttributes() const
+XMLelements::const_iterator& XMLelements::const_iterator::operator ++ ()
 {
-    return attributes.size() != 0;
+    m_node = m_node->m_next;
+    return *this;
 }
 
-inline bool XMLnode::hasAttribute(const string& name) const
+XMLelements::const_iterator XMLelements::const_iterator::operator ++ (int)
 {
-    return foundIn(attributes, name);
+    const_iterator result = *this;
+    m_node = m_node->m_next;
+    return result;
 }
 
-template <typename T>
-T XMLnode::getAttribute(const string& name) const
+const XMLstring* XMLelement::find(const char* name) const
 {
-    StringMap::const_iterator iter = attributes.find(name);
-    if (iter != attributes.end())
+    for (unsigned int i = 0; i < m_attributeCount; i++)
     {
-        return cast<T>(iter->second);
+        if (m_attributes[i].name == name)
+        {
+            return &m_attributes[i].value;
+        }
     }
-
-    Exception("Missing attribute '" + name + "' in node '" + name + "' at line " + cast<string>(line));
-    return T();
+    return NULL;
 }
 
-string XMLnode::getAttribute(const string& name) const
+bool XMLelement::hasAttributes() const
 {
-    StringMap::const_iterator iter = attributes.find(name);
-    if (iter != attributes.end())
-    {
-        return iter->second;
-    }
+    return m_attributeCount != 0;
+}
 
-    Exception("Missing attribute '" + name + "' in node '" + name + "' at line " + cast<string>(line));
-    return string();
+bool XMLelement::hasAttribute(const char* name) const
+{
+    return find(name) != NULL;
 }
 
 template <typename T>
-T XMLnode::getAttribute(const string& name, T defaultValue) const
+T XMLelement::getAttribute(const char* name) const
 {
-    StringMap::const_iterator iter = attributes.find(name);
-    if (iter != attributes.end())
+    const XMLstring* value = find(name);
+    if (value == NULL)
     {
-        return cast<T>(iter->second);
+        missing(name);
+        return T();
     }
-    return defaultValue;
+    return cast<T>(*value);
 }
 
-string XMLnode::getAttribute(const string& name, const string& defaultValue) const
+string XMLelement::getAttribute(const char* name) const
 {
-    StringMap::const_iterator iter = attributes.find(name);
-    if (iter != attributes.end())
+    const XMLstring* value = find(name);
+    if (value == NULL)
     {
-        return iter->second;
+        missing(name);
+        return string();
     }
-    return defaultValue;
+    return value->str();
 }
 
-void XMLnode::setAttribute(const string& name, const string& value)
+template <typename T>
+T XMLelement::getAttribute(const char* name, T defaultValue) const
 {
-    attributes[name] = value;
+    const XMLstring* value = find(name);
+    return value == NULL ? defaultValue : cast<T>(*value);
+}
+
+string XMLelement::getAttribute(const char* name, const string& defaultValue) const
+{
+    const XMLstring* value = find(name);
+    return value == NULL ? defaultValue : value->str();
 }
 
-Vector XMLnode::getAttributesInVector(const string& attributeSymbols) const
+Vector XMLelement::getAttributesInVector(const char* attributeSymbols) const
 {
-    assert(attributeSymbols.size() < 5);
+    assert(strlen(attributeSymbols) < 5);
     Vector vector;
-    for (size_t i = 0; i < attributeSymbols.size(); i++)
+    for (size_t i = 0; attributeSymbols[i] != 0; i++)
     {
-        string key(1, attributeSymbols[i]);
+        const char key[] = { attributeSymbols[i], 0 };
         vector[i] = getAttribute<float>(key);
     }
     return vector;